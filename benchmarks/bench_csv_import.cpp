@@ -0,0 +1,154 @@
+#include "audio_library/file_io.h"
+#include "audio_library/track.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace audio_library;
+
+namespace {
+
+void write_catalogue(const std::filesystem::path& path, size_t count) {
+    std::mt19937 rng(99);
+    std::uniform_int_distribution<int> length(3, 10);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<int> words(1, 4);
+    std::uniform_int_distribution<int> duration(60, 600);
+    std::uniform_int_distribution<int> coin(0, 19);
+    auto phrase = [&]() {
+        std::string text;
+        for (int i = words(rng); i > 0; --i) {
+            std::string word(static_cast<size_t>(length(rng)), 'a');
+            for (auto& c : word) c = static_cast<char>(letter(rng));
+            text += word;
+            if (i > 1) text += coin(rng) == 0 ? ", " : " ";
+        }
+        return text;
+    };
+
+    std::vector<Track> tracks;
+    tracks.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        Track track(phrase(), phrase(), duration(rng));
+        track.set_album(phrase());
+        track.set_genre(phrase());
+        track.set_year(1960 + static_cast<int>(i % 60));
+        track.set_rating(static_cast<double>(i % 11) * 0.5);
+        tracks.push_back(std::move(track));
+    }
+    FileIO::export_csv(path, tracks);
+}
+
+// The getline and std::stoi based import FileIO used before
+std::optional<Track> previous_from_csv_line(const std::string& line) {
+    std::vector<std::string> fields;
+    std::string current_field;
+    bool in_quotes = false;
+    bool quote_escaped = false;
+    for (size_t i = 0; i < line.length(); ++i) {
+        char c = line[i];
+        if (quote_escaped) {
+            if (c == '"') {
+                current_field += '"';
+            } else {
+                in_quotes = false;
+                --i;
+            }
+            quote_escaped = false;
+        } else if (in_quotes) {
+            if (c == '"') {
+                if (i + 1 < line.length() && line[i + 1] == '"') {
+                    quote_escaped = true;
+                } else {
+                    in_quotes = false;
+                }
+            } else {
+                current_field += c;
+            }
+        } else if (c == '"' && current_field.empty()) {
+            in_quotes = true;
+        } else if (c == ',') {
+            fields.push_back(current_field);
+            current_field.clear();
+        } else {
+            current_field += c;
+        }
+    }
+    fields.push_back(current_field);
+    if (fields.size() < 3) {
+        return std::nullopt;
+    }
+    try {
+        Track track(fields[0], fields[1], std::stoi(fields[2]));
+        if (fields.size() > 3 && !fields[3].empty()) track.set_album(fields[3]);
+        if (fields.size() > 4 && !fields[4].empty()) track.set_genre(fields[4]);
+        if (fields.size() > 5 && !fields[5].empty()) track.set_year(std::stoi(fields[5]));
+        if (fields.size() > 6 && !fields[6].empty()) static_cast<void>(std::stoull(fields[6])); // Not settable
+        if (fields.size() > 7 && !fields[7].empty()) track.set_rating(std::stod(fields[7]));
+        return track;
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+size_t previous_import(const std::filesystem::path& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line); // Header
+    std::vector<Track> tracks;
+    while (std::getline(file, line)) {
+        if (auto track = previous_from_csv_line(line)) {
+            tracks.push_back(std::move(*track));
+        }
+    }
+    return tracks.size();
+}
+
+template <typename Function>
+double seconds(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main() {
+    const size_t track_count = 1000000;
+    const auto path = std::filesystem::temp_directory_path() / "bench_csv_import.csv";
+    write_catalogue(path, track_count);
+    const double megabytes = static_cast<double>(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+
+    std::cout << "FileIO::import_csv (" << track_count << " tracks, "
+              << std::fixed << std::setprecision(1) << megabytes << " MB)\n";
+    std::cout << "=============================================\n";
+
+    size_t previous_tracks = 0;
+    double previous = seconds([&]() { previous_tracks = previous_import(path); });
+    FileIO::ImportOptions options;
+    options.thread_count = 1;
+    size_t imported_tracks = 0;
+    double imported = seconds([&]() { imported_tracks = FileIO::import_csv(path, options).size(); });
+    const size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    options.thread_count = thread_count;
+    size_t parallel_tracks = 0;
+    double parallel = seconds([&]() { parallel_tracks = FileIO::import_csv(path, options).size(); });
+
+    std::cout << "getline + stoi     " << std::setw(8) << megabytes / previous
+              << " MB/s   (" << previous_tracks << " tracks)\n";
+    std::cout << "mapped + from_chars" << std::setw(8) << megabytes / imported
+              << " MB/s   (" << imported_tracks << " tracks, 1 thread)\n";
+    std::cout << "mapped + from_chars" << std::setw(8) << megabytes / parallel
+              << " MB/s   (" << parallel_tracks << " tracks, " << thread_count << " threads)\n";
+
+    std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,237 @@
+#include "audio_library/csv_reader.h"
+#include "audio_library/track.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace audio_library;
+
+namespace {
+
+// The byte-at-a-time CsvReader the block scanner replaced
+class ByteReader {
+public:
+    explicit ByteReader(std::string_view text) : text_(text) {}
+
+    bool next_record(std::vector<std::string_view>& fields) {
+        fields.clear();
+        const char* data = text_.data();
+        const size_t end = text_.size();
+
+        // Blank lines hold no record
+        while (position_ < end && (data[position_] == '\n' ||
+               (data[position_] == '\r' && position_ + 1 < end && data[position_ + 1] == '\n'))) {
+            position_ += data[position_] == '\r' ? 2 : 1;
+            ++next_line_;
+        }
+        if (position_ >= end) {
+            return false;
+        }
+
+        const size_t record_begin = position_;
+        line_number_ = next_line_;
+        spans_.clear();
+        unescaped_.clear();
+
+        size_t i = position_;
+        for (;;) {
+            if (i < end && data[i] == '"') {
+                i = read_quoted(i);
+            } else {
+                const size_t begin = i;
+                while (i < end && !is_field_end(data[i])) {
+                    ++i;
+                }
+                spans_.push_back({begin, i - begin, false});
+            }
+
+            if (i < end && data[i] == ',') {
+                ++i;
+                continue;
+            }
+            // A "\r\n" line break leaves its '\r' at the end of the last
+            // field, unless that field was quoted and closed before it
+            Span& last = spans_.back();
+            if (i < end && data[i - 1] == '\r' && last.length > 0 &&
+                (last.unescaped || last.offset + last.length == i)) {
+                --last.length;
+            }
+            if (i < end) {
+                ++i; // The '\n'
+            }
+            break;
+        }
+
+        position_ = i;
+        next_line_ += static_cast<size_t>(std::count(data + record_begin, data + i, '\n'));
+
+        // The buffer no longer grows, so views into it stay valid
+        fields.reserve(spans_.size());
+        for (const auto& span : spans_) {
+            const char* base = span.unescaped ? unescaped_.data() : data;
+            fields.emplace_back(base + span.offset, span.length);
+        }
+        return true;
+    }
+
+    size_t read_quoted(size_t i) {
+        const char* data = text_.data();
+        const size_t end = text_.size();
+        const size_t content = i + 1;
+
+        // Find the closing quote, noting whether any quotes are doubled
+        bool doubled = false;
+        size_t close = end;
+        for (size_t at = content; at < end;) {
+            const void* quote = std::memchr(data + at, '"', end - at);
+            if (!quote) break;
+            at = static_cast<size_t>(static_cast<const char*>(quote) - data);
+            if (at + 1 < end && data[at + 1] == '"') {
+                doubled = true;
+                at += 2;
+            } else {
+                close = at;
+                break;
+            }
+        }
+
+        // Text between the closing quote and the end of the field
+        size_t after = close < end ? close + 1 : end;
+        size_t field_end = after;
+        while (field_end < end && !is_field_end(data[field_end])) {
+            ++field_end;
+        }
+        const bool trailing = field_end > after &&
+            !(field_end - after == 1 && field_end < end && data[after] == '\r');
+
+        if (!doubled && !trailing) {
+            spans_.push_back({content, std::min(close, end) - content, false});
+            return field_end;
+        }
+
+        const size_t offset = unescaped_.size();
+        for (size_t at = content; at < close; ++at) {
+            unescaped_ += data[at];
+            if (data[at] == '"') {
+                ++at; // Skip the second quote of the pair
+            }
+        }
+        unescaped_.append(data + after, field_end - after);
+        spans_.push_back({offset, unescaped_.size() - offset, true});
+        return field_end;
+    }
+
+private:
+    struct Span {
+        size_t offset;
+        size_t length;
+        bool unescaped;
+    };
+
+    static bool is_field_end(char c) {
+        return c == ',' || c == '\n';
+    }
+
+    std::string_view text_;
+    size_t position_ = 0;
+    size_t next_line_ = 1;
+    size_t line_number_ = 0;
+    std::vector<Span> spans_;
+    std::string unescaped_;
+};
+
+std::string phrase(std::mt19937& rng, int max_words) {
+    std::uniform_int_distribution<int> length(3, 10);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<int> words(1, max_words);
+    std::uniform_int_distribution<int> coin(0, 19);
+    std::string text;
+    for (int i = words(rng); i > 0; --i) {
+        std::string word(static_cast<size_t>(length(rng)), 'a');
+        for (auto& c : word) c = static_cast<char>(letter(rng));
+        text += word;
+        if (i > 1) text += coin(rng) == 0 ? ", " : " ";
+    }
+    return text;
+}
+
+// Exported tracks, with album fields of up to max_words words
+std::string make_csv(size_t count, int max_words) {
+    std::mt19937 rng(3);
+    std::string csv = "Title,Artist,Duration,Album,Genre,Year,PlayCount,Rating\n";
+    for (size_t i = 0; i < count; ++i) {
+        Track track(phrase(rng, 4), phrase(rng, 4), 60 + static_cast<int>(i % 500));
+        track.set_album(phrase(rng, max_words));
+        track.set_genre(phrase(rng, 2));
+        track.set_year(1960 + static_cast<int>(i % 60));
+        csv += track.to_csv() + "\n";
+    }
+    return csv;
+}
+
+struct Timing {
+    double seconds;
+    double cycles; // Time stamp counter ticks, 0 where there is none
+};
+
+template <typename Function>
+Timing measure(Function function) {
+#if defined(__x86_64__) || defined(__i386__)
+    const uint64_t start_cycles = __rdtsc();
+#endif
+    auto start = std::chrono::steady_clock::now();
+    function();
+    Timing timing{std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), 0.0};
+#if defined(__x86_64__) || defined(__i386__)
+    timing.cycles = static_cast<double>(__rdtsc() - start_cycles);
+#endif
+    return timing;
+}
+
+template <typename Reader>
+size_t count_fields(std::string_view text) {
+    Reader reader(text);
+    std::vector<std::string_view> fields;
+    size_t count = 0;
+    while (reader.next_record(fields)) count += fields.size();
+    return count;
+}
+
+void report(const char* name, const std::string& csv) {
+    const double bytes = static_cast<double>(csv.size());
+    size_t byte_fields = 0;
+    size_t block_fields = 0;
+    Timing byte = measure([&]() { byte_fields = count_fields<ByteReader>(csv); });
+    Timing block = measure([&]() { block_fields = count_fields<CsvReader>(csv); });
+
+    std::cout << name << " (" << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0) << " MB, "
+              << block_fields << " fields" << (byte_fields == block_fields ? "" : ", MISMATCH") << ")\n";
+    for (const auto& [label, timing] : {std::pair{"  byte at a time ", byte}, std::pair{"  64-byte blocks ", block}}) {
+        std::cout << label << std::setw(8) << std::setprecision(1) << bytes / (1024.0 * 1024.0) / timing.seconds
+                  << " MB/s";
+        if (timing.cycles > 0) {
+            std::cout << std::setw(8) << std::setprecision(2) << bytes / timing.cycles << " bytes/cycle";
+        }
+        std::cout << "\n";
+    }
+}
+
+} // namespace
+
+int main() {
+    std::cout << "CSV field splitting\n";
+    std::cout << "=============================================\n";
+    report("Catalogue", make_csv(1000000, 4));
+    report("Long albums", make_csv(250000, 40));
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include "audio_library/edit_distance.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace audio_library;
+
+namespace {
+
+// The full-table implementation the bit-parallel kernel replaced
+size_t table_distance(const std::string& s1, const std::string& s2) {
+    const size_t m = s1.length();
+    const size_t n = s2.length();
+    
+    if (m == 0) return n;
+    if (n == 0) return m;
+    
+    std::vector<std::vector<size_t>> dp(m + 1, std::vector<size_t>(n + 1));
+    for (size_t i = 0; i <= m; ++i) dp[i][0] = i;
+    for (size_t j = 0; j <= n; ++j) dp[0][j] = j;
+    
+    for (size_t i = 1; i <= m; ++i) {
+        for (size_t j = 1; j <= n; ++j) {
+            size_t cost = (s1[i-1] == s2[j-1]) ? 0 : 1;
+            dp[i][j] = std::min({dp[i-1][j] + 1, dp[i][j-1] + 1, dp[i-1][j-1] + cost});
+        }
+    }
+    return dp[m][n];
+}
+
+std::vector<std::string> make_words(size_t count, size_t min_len, size_t max_len) {
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<size_t> length(min_len, max_len);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    
+    std::vector<std::string> words;
+    words.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string word(length(rng), ' ');
+        for (auto& c : word) c = static_cast<char>(letter(rng));
+        words.push_back(std::move(word));
+    }
+    return words;
+}
+
+template <typename Fn>
+void run(const std::string& name, const std::vector<std::string>& words, Fn&& distance) {
+    const size_t queries = 50;
+    size_t checksum = 0;
+    
+    auto start = std::chrono::steady_clock::now();
+    for (size_t q = 0; q < queries; ++q) {
+        for (const auto& word : words) {
+            checksum += distance(words[q], word);
+        }
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    double comparisons = static_cast<double>(queries * words.size());
+    std::cout << std::left << std::setw(34) << name
+              << std::right << std::setw(14) << std::fixed << std::setprecision(0)
+              << comparisons / elapsed << " cmp/s"
+              << "   (checksum " << checksum << ")\n";
+}
+
+void run_suite(const std::string& label, size_t min_len, size_t max_len) {
+    auto words = make_words(4000, min_len, max_len);
+    std::cout << "\n" << label << " (" << min_len << "-" << max_len << " bytes)\n";
+    
+    run("  full table", words, [](const std::string& a, const std::string& b) {
+        return table_distance(a, b);
+    });
+    run("  bit-parallel", words, [](const std::string& a, const std::string& b) {
+        return edit_distance(a, b);
+    });
+    run("  bit-parallel, max_distance = 2", words, [](const std::string& a, const std::string& b) {
+        return edit_distance(a, b, 2);
+    });
+}
+
+} // namespace
+
+int main() {
+    std::cout << "Edit distance throughput\n";
+    std::cout << "========================\n";
+    
+    run_suite("Index terms", 3, 12);
+    run_suite("Full titles", 15, 60);
+    run_suite("Long strings (multi-word)", 80, 200);
+    
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "audio_library/search_engine.h"
+#include "audio_library/track.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace audio_library;
+
+namespace {
+
+std::vector<std::shared_ptr<Track>> make_tracks(size_t count) {
+    std::mt19937 rng(2024);
+    std::uniform_int_distribution<int> length(3, 10);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<size_t> pick(0, 19999);
+    std::uniform_int_distribution<int> words(1, 5);
+    
+    // Zipf-ish vocabulary: a few words are very common, most are rare
+    std::vector<std::string> vocabulary(20000);
+    for (auto& word : vocabulary) {
+        word.resize(static_cast<size_t>(length(rng)));
+        for (auto& c : word) c = static_cast<char>(letter(rng));
+    }
+    auto phrase = [&]() {
+        std::string text;
+        for (int i = words(rng); i > 0; --i) {
+            size_t index = std::min(pick(rng), pick(rng));
+            text += vocabulary[std::min(index, pick(rng))];
+            if (i > 1) text += ' ';
+        }
+        return text;
+    };
+    
+    std::vector<std::shared_ptr<Track>> tracks;
+    tracks.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        auto track = std::make_shared<Track>(phrase(), phrase(), 200);
+        track->set_album(phrase());
+        track->set_genre(vocabulary[pick(rng) % 50]);
+        tracks.push_back(std::move(track));
+    }
+    return tracks;
+}
+
+} // namespace
+
+int main() {
+    const size_t track_count = 200000;
+    auto tracks = make_tracks(track_count);
+    
+    std::cout << "SearchEngine::rebuild_index (" << track_count << " tracks)\n";
+    std::cout << "=============================================\n";
+    
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> thread_counts;
+    for (size_t threads = 1; threads < cores; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(cores);
+    
+    double sequential = 0.0;
+    for (size_t threads : thread_counts) {
+        SearchEngine engine;
+        engine.set_tracks(&tracks);
+        
+        auto start = std::chrono::steady_clock::now();
+        engine.rebuild_index(tracks, threads);
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (threads == 1) sequential = elapsed;
+        
+        std::cout << std::setw(3) << threads << " thread(s)  "
+                  << std::fixed << std::setprecision(3) << elapsed << " s"
+                  << "   speedup " << std::setprecision(2) << sequential / elapsed
+                  << "   (" << engine.get_indexed_terms_count() << " terms)\n";
+    }
+    
+    // A saved index instead of a rebuild, up to the first answered query
+    SearchEngine saved;
+    saved.set_tracks(&tracks);
+    saved.rebuild_index(tracks, cores);
+    const auto path = std::filesystem::temp_directory_path() / "bench_index_build.index";
+    if (!saved.save_index(path)) {
+        std::cerr << "could not save " << path << "\n";
+        return 1;
+    }
+    
+    SearchEngine loaded;
+    loaded.set_tracks(&tracks);
+    auto start = std::chrono::steady_clock::now();
+    bool ok = loaded.load_index(path);
+    auto results = loaded.search(tracks.front()->genre());
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "load_index   " << std::fixed << std::setprecision(3) << elapsed << " s"
+              << "   (" << (ok ? "mapped" : "failed") << ", " << std::filesystem::file_size(path) / (1024 * 1024)
+              << " MB, first query " << results.size() << " results)\n";
+    std::filesystem::remove(path);
+    
+    return 0;
+}
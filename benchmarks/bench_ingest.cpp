@@ -0,0 +1,77 @@
+#include "audio_library/music_library.h"
+#include "audio_library/track.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace audio_library;
+
+namespace {
+
+std::vector<Track> make_tracks(size_t count, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> length(3, 10);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<int> words(1, 4);
+    auto phrase = [&]() {
+        std::string text;
+        for (int i = words(rng); i > 0; --i) {
+            std::string word(static_cast<size_t>(length(rng)), 'a');
+            for (auto& c : word) c = static_cast<char>(letter(rng));
+            text += word;
+            if (i > 1) text += ' ';
+        }
+        return text;
+    };
+
+    std::vector<Track> tracks;
+    tracks.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        Track track(phrase(), phrase(), 200);
+        track.set_album(phrase());
+        track.set_genre(phrase());
+        tracks.push_back(std::move(track));
+    }
+    return tracks;
+}
+
+template <typename Function>
+double seconds(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main() {
+    const size_t library_size = 100000;
+    const size_t batch_size = 10000;
+    const auto existing = make_tracks(library_size, 5);
+    const auto batch = make_tracks(batch_size, 6);
+
+    std::cout << "Importing " << batch_size << " tracks into a library of " << library_size << "\n";
+    std::cout << "=============================================\n";
+
+    MusicLibrary one_by_one;
+    MusicLibrary bulk;
+    one_by_one.ingest(existing);
+    double filled = seconds([&]() { bulk.ingest(existing); });
+
+    // How import_from_csv added tracks before
+    double previous = seconds([&]() {
+        for (const auto& track : batch) {
+            one_by_one.add_track(track);
+        }
+    });
+    double ingested = seconds([&]() { bulk.ingest(batch); });
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "add_track per track " << std::setw(10) << batch_size / previous << " tracks/s\n";
+    std::cout << "ingest              " << std::setw(10) << batch_size / ingested << " tracks/s\n";
+    std::cout << "(filling the library by ingest: " << library_size / filled << " tracks/s)\n";
+    return 0;
+}
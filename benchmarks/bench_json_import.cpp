@@ -0,0 +1,130 @@
+#include "audio_library/file_io.h"
+#include "audio_library/track.h"
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <regex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace audio_library;
+
+namespace {
+
+void write_catalogue(const std::filesystem::path& path, size_t count) {
+    std::mt19937 rng(99);
+    std::uniform_int_distribution<int> length(3, 10);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<int> words(1, 4);
+    std::uniform_int_distribution<int> duration(60, 600);
+    auto phrase = [&]() {
+        std::string text;
+        for (int i = words(rng); i > 0; --i) {
+            std::string word(static_cast<size_t>(length(rng)), 'a');
+            for (auto& c : word) c = static_cast<char>(letter(rng));
+            text += word;
+            if (i > 1) text += ' ';
+        }
+        return text;
+    };
+
+    std::vector<Track> tracks;
+    tracks.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        Track track(phrase(), phrase(), duration(rng));
+        track.set_album(phrase());
+        track.set_genre(phrase());
+        track.set_year(1960 + static_cast<int>(i % 60));
+        track.set_rating(static_cast<double>(i % 11) * 0.5);
+        tracks.push_back(std::move(track));
+    }
+    FileIO::export_json(path, tracks);
+}
+
+// The regex-based Track::from_json FileIO used before
+std::optional<Track> previous_from_json(const std::string& json) {
+    static const std::regex field_regex("\"(\\w+)\"\\s*:\\s*(\"([^\"\\\\]|\\\\.)*\"|\\d+(\\.\\d+)?)");
+    std::unordered_map<std::string, std::string> fields;
+    for (auto it = std::sregex_iterator(json.begin(), json.end(), field_regex); it != std::sregex_iterator(); ++it) {
+        std::string value = (*it)[2];
+        if (value.front() == '"') value = value.substr(1, value.length() - 2); // Escapes left as is
+        fields[(*it)[1]] = value;
+    }
+    if (!fields.count("title") || !fields.count("artist") || !fields.count("duration")) {
+        return std::nullopt;
+    }
+    try {
+        Track track(fields["title"], fields["artist"], std::stoi(fields["duration"]));
+        if (fields.count("album")) track.set_album(fields["album"]);
+        if (fields.count("genre")) track.set_genre(fields["genre"]);
+        if (fields.count("year")) track.set_year(std::stoi(fields["year"]));
+        if (fields.count("rating")) track.set_rating(std::stod(fields["rating"]));
+        return track;
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+// The brace-counting import FileIO used before
+size_t previous_import(const std::filesystem::path& path) {
+    std::ifstream file(path);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::vector<Track> tracks;
+    size_t pos = content.find('[') + 1;
+    const size_t end = content.rfind(']');
+    while (pos < end) {
+        while (pos < end && (std::isspace(static_cast<unsigned char>(content[pos])) || content[pos] == ',')) ++pos;
+        if (pos >= end || content[pos] != '{') break;
+        int depth = 1;
+        size_t object_end = pos + 1;
+        while (object_end < end && depth > 0) {
+            if (content[object_end] == '{') ++depth;
+            else if (content[object_end] == '}') --depth;
+            ++object_end;
+        }
+        if (auto track = previous_from_json(content.substr(pos, object_end - pos))) {
+            tracks.push_back(std::move(*track));
+        }
+        pos = object_end;
+    }
+    return tracks.size();
+}
+
+template <typename Function>
+double seconds(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main() {
+    const size_t track_count = 200000;
+    const auto path = std::filesystem::temp_directory_path() / "bench_json_import.json";
+    write_catalogue(path, track_count);
+    const double megabytes = static_cast<double>(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+
+    std::cout << "FileIO::import_json (" << track_count << " tracks, "
+              << std::fixed << std::setprecision(1) << megabytes << " MB)\n";
+    std::cout << "=============================================\n";
+
+    size_t previous_tracks = 0;
+    double previous = seconds([&]() { previous_tracks = previous_import(path); });
+    size_t imported_tracks = 0;
+    double imported = seconds([&]() { imported_tracks = FileIO::import_json(path).size(); });
+
+    std::cout << "braces + std::regex " << std::setw(8) << megabytes / previous
+              << " MB/s   (" << previous_tracks << " tracks)\n";
+    std::cout << "streaming reader    " << std::setw(8) << megabytes / imported
+              << " MB/s   (" << imported_tracks << " tracks)\n";
+
+    std::filesystem::remove(path);
+    return 0;
+}
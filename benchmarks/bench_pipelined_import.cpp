@@ -0,0 +1,97 @@
+#include "audio_library/file_io.h"
+#include "audio_library/music_library.h"
+#include "audio_library/track.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace audio_library;
+
+namespace {
+
+void write_csv(const std::filesystem::path& path, size_t count) {
+    std::mt19937 rng(23);
+    std::uniform_int_distribution<int> length(3, 10);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<int> words(1, 4);
+    std::uniform_int_distribution<int> duration(60, 600);
+    auto phrase = [&]() {
+        std::string text;
+        for (int i = words(rng); i > 0; --i) {
+            std::string word(static_cast<size_t>(length(rng)), 'a');
+            for (auto& c : word) c = static_cast<char>(letter(rng));
+            text += word;
+            if (i > 1) text += ' ';
+        }
+        return text;
+    };
+
+    std::ofstream file(path, std::ios::binary);
+    file << "Title,Artist,Duration,Album,Genre\n";
+    for (size_t i = 0; i < count; ++i) {
+        file << phrase() << ',' << phrase() << ',' << duration(rng) << ','
+             << phrase() << ',' << phrase() << '\n';
+    }
+}
+
+template <typename Function>
+double seconds(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main() {
+    const size_t track_count = 100000;
+    const auto path = std::filesystem::temp_directory_path() / "bench_pipelined_import.csv";
+    write_csv(path, track_count);
+    const double megabytes = static_cast<double>(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+
+    std::cout << "CSV import into a library (" << track_count << " tracks, "
+              << std::fixed << std::setprecision(1) << megabytes << " MB)\n";
+    std::cout << "=============================================\n";
+
+    // Parse everything, then index everything
+    MusicLibrary sequential;
+    double one_after_another = seconds([&]() {
+        FileIO::ImportOptions options;
+        options.thread_count = 1;
+        sequential.ingest(FileIO::import_csv(path, options));
+    });
+
+    // Read, parse, validate and index overlapping
+    MusicLibrary pipelined;
+    FileIO::PipelineStats stats;
+    double overlapped = seconds([&]() {
+        FileIO::ImportOptions options;
+        options.pipelined = true;
+        options.pipeline_stats = &stats;
+        options.batch_callback = [&pipelined](std::vector<Track>&& tracks) { pipelined.ingest(std::move(tracks)); };
+        static_cast<void>(FileIO::import_csv(path, options));
+    });
+
+    std::cout << "parse, then index     " << std::setw(8) << megabytes / one_after_another
+              << " MB/s   (" << sequential.size() << " tracks)\n";
+    std::cout << "pipelined             " << std::setw(8) << megabytes / overlapped
+              << " MB/s   (" << pipelined.size() << " tracks)\n\n";
+
+    std::cout << std::setprecision(3);
+    std::cout << "stage      batches     busy s  waiting in s  waiting out s\n";
+    for (const auto& stage : stats.stages) {
+        std::cout << std::left << std::setw(10) << stage.name << std::right
+                  << std::setw(8) << stage.batches
+                  << std::setw(11) << stage.busy_seconds
+                  << std::setw(14) << stage.input_wait_seconds
+                  << std::setw(15) << stage.output_wait_seconds << "\n";
+    }
+
+    std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "audio_library/search_engine.h"
+#include "audio_library/track.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace audio_library;
+
+int main() {
+    const size_t track_count = 50000;
+    const size_t query_count = 5000;
+    
+    std::mt19937 rng(99);
+    std::uniform_int_distribution<int> length(3, 9);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<size_t> pick(0, 4999);
+    std::uniform_int_distribution<int> words(1, 4);
+    
+    std::vector<std::string> vocabulary(5000);
+    for (auto& word : vocabulary) {
+        word.resize(static_cast<size_t>(length(rng)));
+        for (auto& c : word) c = static_cast<char>(letter(rng));
+    }
+    auto phrase = [&](int count) {
+        std::string text;
+        for (int i = count; i > 0; --i) {
+            text += vocabulary[std::min(pick(rng), pick(rng))];
+            if (i > 1) text += ' ';
+        }
+        return text;
+    };
+    
+    std::vector<std::shared_ptr<Track>> tracks;
+    tracks.reserve(track_count);
+    for (size_t i = 0; i < track_count; ++i) {
+        tracks.push_back(std::make_shared<Track>(phrase(words(rng)), phrase(words(rng)), 200));
+    }
+    
+    // Artist/title lookups: a popular head that repeats and a long tail
+    std::vector<SearchEngine::Query> queries;
+    queries.reserve(query_count);
+    for (size_t i = 0; i < query_count; ++i) {
+        SearchEngine::Query query;
+        query.text = phrase(2);
+        query.options.max_results = 10;
+        queries.push_back(query);
+    }
+    for (size_t i = 0; i < query_count / 5; ++i) {
+        queries[pick(rng) % query_count] = queries[i % 50];
+    }
+    
+    SearchEngine engine;
+    engine.set_tracks(&tracks);
+    engine.rebuild_index(tracks);
+    engine.set_result_cache_capacity(0);
+    
+    std::cout << "SearchEngine batch search (" << track_count << " tracks, "
+              << query_count << " substring queries)\n";
+    std::cout << "=============================================\n";
+    
+    auto start = std::chrono::steady_clock::now();
+    size_t found = 0;
+    for (const auto& query : queries) {
+        found += engine.search(query.text, query.options).size();
+    }
+    double single = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "search() loop       " << std::fixed << std::setprecision(3) << single
+              << " s   (" << found << " results)\n";
+    
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t threads : {size_t{1}, cores}) {
+        start = std::chrono::steady_clock::now();
+        auto results = engine.search_batch(queries, threads);
+        double batch = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        found = 0;
+        for (const auto& result : results) found += result.size();
+        std::cout << "search_batch x" << std::setw(2) << threads << "   " << batch
+                  << " s   speedup " << std::setprecision(2) << single / batch << std::setprecision(3)
+                  << "   (" << found << " results)\n";
+        if (cores == 1) break;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "audio_library/search_engine.h"
+#include "audio_library/tokenizer.h"
+#include "audio_library/track.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace audio_library;
+
+namespace {
+
+std::vector<std::string> make_texts(size_t count) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> length(2, 10);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<int> words(1, 6);
+    std::uniform_int_distribution<int> coin(0, 7);
+
+    std::vector<std::string> texts(count);
+    for (auto& text : texts) {
+        for (int i = words(rng); i > 0; --i) {
+            std::string word(static_cast<size_t>(length(rng)), 'a');
+            for (auto& c : word) c = static_cast<char>(letter(rng));
+            word[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(word[0])));
+            if (coin(rng) == 0) word = "(" + word + ")";
+            text += word;
+            if (i > 1) text += ' ';
+        }
+    }
+    return texts;
+}
+
+// The stream-based tokenizer the search engine used before
+size_t stream_tokenize(const std::string& text) {
+    std::vector<std::string> tokens;
+    std::stringstream ss(text);
+    std::string word;
+    while (ss >> word) {
+        word.erase(0, word.find_first_not_of("!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~"));
+        while (!word.empty() && std::ispunct(static_cast<unsigned char>(word.back()))) {
+            word.pop_back();
+        }
+        if (word.empty()) continue;
+        std::transform(word.begin(), word.end(), word.begin(), ::tolower);
+        tokens.push_back(word);
+    }
+    return tokens.size();
+}
+
+template <typename Function>
+double seconds(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main() {
+    const size_t text_count = 1000000;
+    auto texts = make_texts(text_count);
+    size_t bytes = 0;
+    for (const auto& text : texts) bytes += text.size();
+    const double megabytes = static_cast<double>(bytes) / (1024.0 * 1024.0);
+
+    std::cout << "Tokenizer throughput (" << text_count << " texts, "
+              << std::fixed << std::setprecision(1) << megabytes << " MB)\n";
+    std::cout << "=============================================\n";
+
+    size_t stream_tokens = 0;
+    double stream = seconds([&]() {
+        for (const auto& text : texts) stream_tokens += stream_tokenize(text);
+    });
+
+    size_t tokenizer_tokens = 0;
+    Tokenizer tokenizer;
+    double reused = seconds([&]() {
+        for (const auto& text : texts) {
+            tokenizer.clear();
+            tokenizer_tokens += tokenizer.append(text);
+        }
+    });
+
+    std::cout << "stream tokenizer   " << std::setprecision(1) << std::setw(8) << megabytes / stream
+              << " MB/s   (" << stream_tokens << " tokens)\n";
+    std::cout << "Tokenizer          " << std::setw(8) << megabytes / reused
+              << " MB/s   (" << tokenizer_tokens << " tokens)\n";
+
+    // End-to-end: the same texts as track fields
+    std::vector<std::shared_ptr<Track>> tracks;
+    tracks.reserve(text_count / 4);
+    for (size_t i = 0; i + 3 < text_count; i += 4) {
+        auto track = std::make_shared<Track>(texts[i], texts[i + 1], 200);
+        track->set_album(texts[i + 2]);
+        track->set_genre(texts[i + 3]);
+        tracks.push_back(std::move(track));
+    }
+    SearchEngine engine;
+    engine.set_tracks(&tracks);
+    double build = seconds([&]() { engine.rebuild_index(tracks, 1); });
+    std::cout << "index build        " << std::setw(8) << megabytes / build
+              << " MB/s   (" << tracks.size() << " tracks, 1 thread)\n";
+
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include "audio_library/search_engine.h"
+#include "audio_library/track.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace audio_library;
+
+int main() {
+    const size_t track_count = 200000;
+    const size_t query_count = 200;
+    
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> length(3, 9);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<int> words(1, 5);
+    
+    // Zipfian word frequencies: the head words ("love", "the", ...) are in
+    // a large share of titles, as in real libraries
+    std::vector<std::string> vocabulary(20000);
+    std::vector<double> weights(vocabulary.size());
+    for (size_t i = 0; i < vocabulary.size(); ++i) {
+        vocabulary[i].resize(static_cast<size_t>(length(rng)));
+        for (auto& c : vocabulary[i]) c = static_cast<char>(letter(rng));
+        weights[i] = 1.0 / static_cast<double>(i + 1);
+    }
+    std::discrete_distribution<size_t> zipf(weights.begin(), weights.end());
+    const std::vector<std::string> genres = {"rock", "pop", "jazz", "hip hop", "classical", "electronic",
+                                             "indie rock", "soul", "metal", "folk", "blues", "reggae"};
+    std::uniform_int_distribution<size_t> genre(0, genres.size() - 1);
+    
+    auto word = [&]() { return vocabulary[zipf(rng)]; };
+    auto phrase = [&](int count) {
+        std::string text;
+        for (int i = count; i > 0; --i) {
+            text += word();
+            if (i > 1) text += ' ';
+        }
+        return text;
+    };
+    
+    std::vector<std::shared_ptr<Track>> tracks;
+    tracks.reserve(track_count);
+    for (size_t i = 0; i < track_count; ++i) {
+        auto track = std::make_shared<Track>(phrase(words(rng)), phrase(words(rng)), 200);
+        track->set_album(phrase(words(rng)));
+        track->set_genre(genres[genre(rng)]);
+        tracks.push_back(std::move(track));
+    }
+    
+    std::uniform_int_distribution<size_t> head(0, 49);
+    std::vector<std::string> queries;
+    for (size_t i = 0; i < query_count; ++i) {
+        switch (i % 3) {
+            case 0: queries.push_back(vocabulary[head(rng)]); break;
+            case 1: queries.push_back(vocabulary[head(rng)] + " OR " + vocabulary[head(rng)]); break;
+            default: queries.push_back(genres[genre(rng)] + " OR " + vocabulary[head(rng)]); break;
+        }
+    }
+    
+    SearchEngine engine;
+    engine.set_tracks(&tracks);
+    engine.rebuild_index(tracks);
+    engine.set_result_cache_capacity(0);
+    
+    std::cout << "SearchEngine top-k retrieval (" << track_count << " tracks, "
+              << query_count << " exact queries on head words and genres)\n";
+    std::cout << "=============================================\n";
+    
+    SearchEngine::SearchOptions options;
+    options.mode = SearchEngine::SearchMode::EXACT;
+    
+    auto time = [&](bool prune) {
+        engine.set_prune_top_k(prune);
+        size_t found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& query : queries) {
+            found += engine.search(query, options).size();
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return std::make_pair(elapsed, found);
+    };
+    
+    for (size_t k : {10u, 100u}) {
+        options.max_results = k;
+        auto [exhaustive, all_found] = time(false);
+        auto [pruned, found] = time(true);
+        std::cout << "top-" << std::setw(3) << std::left << k << std::right << " every match scored "
+                  << std::fixed << std::setprecision(3) << exhaustive << " s   pruned " << pruned
+                  << " s   speedup " << std::setprecision(2) << exhaustive / pruned
+                  << "   (" << found << "/" << all_found << " results)\n";
+    }
+    
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "audio_library/file_io.h"
+#include "audio_library/track.h"
+#include "audio_library/tsv_reader.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace audio_library;
+
+namespace {
+
+// A tracks.txt-style dump: title<TAB>artist<TAB>seconds
+void write_dump(const std::filesystem::path& path, size_t count) {
+    std::mt19937 rng(17);
+    std::uniform_int_distribution<int> length(3, 10);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<int> words(1, 4);
+    std::uniform_int_distribution<int> duration(60, 600);
+    auto phrase = [&]() {
+        std::string text;
+        for (int i = words(rng); i > 0; --i) {
+            std::string word(static_cast<size_t>(length(rng)), 'a');
+            for (auto& c : word) c = static_cast<char>(letter(rng));
+            text += word;
+            if (i > 1) text += ' ';
+        }
+        return text;
+    };
+
+    std::ofstream file(path, std::ios::binary);
+    for (size_t i = 0; i < count; ++i) {
+        file << phrase() << '\t' << phrase() << '\t' << duration(rng) << '\n';
+    }
+}
+
+// How legacy/file_loader.cpp reads these files
+size_t legacy_import(const std::filesystem::path& path) {
+    std::ifstream file(path);
+    std::vector<Track> tracks;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream ss(line);
+        std::string title, artist, duration;
+        std::getline(ss, title, '\t');
+        std::getline(ss, artist, '\t');
+        std::getline(ss, duration, '\t');
+        tracks.emplace_back(title, artist, std::stoi(duration));
+    }
+    return tracks.size();
+}
+
+template <typename Function>
+double seconds(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main() {
+    const size_t track_count = 1000000;
+    const auto path = std::filesystem::temp_directory_path() / "bench_tsv_import.txt";
+    write_dump(path, track_count);
+    const double megabytes = static_cast<double>(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+
+    std::cout << "FileIO::import_tsv (" << track_count << " tracks, "
+              << std::fixed << std::setprecision(1) << megabytes << " MB)\n";
+    std::cout << "=============================================\n";
+
+    std::ifstream file(path, std::ios::binary);
+    const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    size_t fields_read = 0;
+    double split = seconds([&]() {
+        TsvReader reader(text);
+        std::vector<std::string_view> fields;
+        while (reader.next_record(fields)) fields_read += fields.size();
+    });
+
+    size_t legacy_tracks = 0;
+    double legacy = seconds([&]() { legacy_tracks = legacy_import(path); });
+
+    FileIO::ImportOptions one_thread;
+    one_thread.thread_count = 1;
+    size_t imported_tracks = 0;
+    double imported = seconds([&]() { imported_tracks = FileIO::import_tsv(path, one_thread).size(); });
+    double parallel = seconds([&]() { imported_tracks = FileIO::import_tsv(path).size(); });
+
+    std::cout << "TsvReader split only  " << std::setw(8) << megabytes / split
+              << " MB/s   (" << fields_read << " fields)\n";
+    std::cout << "getline + istringstream" << std::setw(7) << megabytes / legacy
+              << " MB/s   (" << legacy_tracks << " tracks)\n";
+    std::cout << "import_tsv, 1 thread  " << std::setw(8) << megabytes / imported
+              << " MB/s   (" << imported_tracks << " tracks)\n";
+    std::cout << "import_tsv, " << std::max(1u, std::thread::hardware_concurrency()) << " threads "
+              << std::setw(8) << megabytes / parallel << " MB/s\n";
+
+    std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "audio_library/file_io.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+
+using namespace audio_library;
+
+namespace {
+
+// A vendor drop with one bad row in a thousand
+void write_csv(const std::filesystem::path& path, size_t count) {
+    std::mt19937 rng(31);
+    std::uniform_int_distribution<int> length(3, 10);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<int> words(1, 4);
+    std::uniform_int_distribution<int> duration(60, 600);
+    auto phrase = [&]() {
+        std::string text;
+        for (int i = words(rng); i > 0; --i) {
+            std::string word(static_cast<size_t>(length(rng)), 'a');
+            for (auto& c : word) c = static_cast<char>(letter(rng));
+            text += word;
+            if (i > 1) text += ' ';
+        }
+        return text;
+    };
+
+    std::ofstream file(path, std::ios::binary);
+    file << "Title,Artist,Duration,Album,Genre,Year\n";
+    for (size_t i = 0; i < count; ++i) {
+        file << phrase() << ',' << (i % 1000 == 7 ? std::string() : phrase()) << ',' << duration(rng) << ','
+             << phrase() << ',' << phrase() << ',' << 1950 + static_cast<int>(i % 70) << '\n';
+    }
+}
+
+template <typename Function>
+double seconds(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main() {
+    const size_t track_count = 1000000;
+    const auto path = std::filesystem::temp_directory_path() / "bench_validate.csv";
+    write_csv(path, track_count);
+    const double megabytes = static_cast<double>(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+
+    std::cout << "Validating a CSV file (" << track_count << " tracks, "
+              << std::fixed << std::setprecision(1) << megabytes << " MB)\n";
+    std::cout << "=============================================\n";
+
+    // Reading the file, for the disk speed to compare against
+    size_t lines = 0;
+    double read = seconds([&]() {
+        std::ifstream file(path, std::ios::binary);
+        std::string block(1 << 20, '\0');
+        while (file.read(block.data(), static_cast<std::streamsize>(block.size())) || file.gcount() > 0) {
+            lines += static_cast<size_t>(std::count(block.begin(), block.begin() + file.gcount(), '\n'));
+        }
+    });
+
+    size_t invalid = 0;
+    FileIO::ImportOptions options;
+    options.error_callback = [&invalid](const std::string&, size_t) { ++invalid; };
+    options.max_errors = SIZE_MAX;
+    size_t imported = 0;
+    double import = seconds([&]() { imported = FileIO::import_csv(path, options).size(); });
+
+    FileIO::ValidationReport one_thread;
+    double validate_one = seconds([&]() { one_thread = FileIO::validate_csv_file(path, 1); });
+    FileIO::ValidationReport parallel;
+    double validate = seconds([&]() { parallel = FileIO::validate_csv_file(path); });
+
+    std::cout << "read + count lines    " << std::setw(8) << megabytes / read
+              << " MB/s   (" << lines << " lines)\n";
+    std::cout << "import_csv            " << std::setw(8) << megabytes / import
+              << " MB/s   (" << imported << " tracks, " << invalid << " errors)\n";
+    std::cout << "validate, 1 thread    " << std::setw(8) << megabytes / validate_one
+              << " MB/s   (" << one_thread.valid_records << " valid, " << one_thread.error_count() << " errors)\n";
+    std::cout << "validate, " << std::max(1u, std::thread::hardware_concurrency()) << " threads   "
+              << std::setw(8) << megabytes / validate << " MB/s\n";
+
+    std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace audio_library {
+
+// Fixed-size queue from one producing thread to one consuming thread,
+// without locks. push() waits while the queue is full, holding a producer
+// back to the pace of its consumer, and pop() waits while it is empty.
+// After close(), push() drops its item and returns false, while pop()
+// returns what is left and then false.
+template <typename T>
+class BoundedQueue {
+public:
+    // Capacity is rounded up to a power of two
+    explicit BoundedQueue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    bool push(T&& item) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        for (size_t spins = 0; tail - head_.load(std::memory_order_acquire) > mask_; ++spins) {
+            if (closed_.load(std::memory_order_acquire)) return false;
+            wait(spins);
+        }
+        if (closed_.load(std::memory_order_acquire)) return false;
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        for (size_t spins = 0; tail_.load(std::memory_order_acquire) == head; ++spins) {
+            // Items pushed before close() are still taken
+            if (closed_.load(std::memory_order_acquire) &&
+                tail_.load(std::memory_order_acquire) == head) {
+                return false;
+            }
+            wait(spins);
+        }
+        item = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    void close() { closed_.store(true, std::memory_order_release); }
+
+private:
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+    // Apart, so that the two threads do not share a cache line
+    alignas(64) std::atomic<size_t> head_{0}; // Next to pop
+    alignas(64) std::atomic<size_t> tail_{0}; // Next to push
+    alignas(64) std::atomic<bool> closed_{false};
+
+    // Yields for short waits, then sleeps so that a stalled stage does not
+    // hold a core
+    static void wait(size_t spins) {
+        if (spins < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+};
+
+} // namespace audio_library
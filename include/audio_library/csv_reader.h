@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace audio_library {
+
+// Splits CSV text into records of fields, viewing the text in place. Only
+// fields with doubled quotes or text after their closing quote are copied,
+// into a buffer reused from record to record. The text is scanned 64 bytes
+// at a time for commas, line breaks and quotes, with SIMD where available.
+//
+// A field starting with a quote runs to the next lone quote and may hold
+// commas and line breaks; text after the closing quote is kept as is.
+// Quotes elsewhere are ordinary characters. Records end at an unquoted
+// "\n" or "\r\n", and blank lines are skipped.
+class CsvReader {
+public:
+    explicit CsvReader(std::string_view text) : text_(text) {}
+
+    // Fields of the next record, valid until the next call. Returns false
+    // at the end of the text.
+    bool next_record(std::vector<std::string_view>& fields);
+
+    // Line the last record returned starts on, counting from 1
+    [[nodiscard]] size_t line_number() const noexcept { return line_number_; }
+    // Offset of the next record in the text
+    [[nodiscard]] size_t position() const noexcept { return position_; }
+    // Line breaks before position()
+    [[nodiscard]] size_t lines_read() const noexcept { return next_line_ - 1; }
+
+private:
+    struct Span {
+        size_t offset;
+        size_t length;
+        bool unescaped; // In unescaped_ rather than the text
+    };
+
+    // Where the quotes and the field ends (',' and '\n') are in up to 64
+    // bytes of the text, one bit per byte
+    struct Block {
+        size_t begin = 0;
+        size_t size = 0;
+        uint64_t quotes = 0;
+        uint64_t separators = 0;
+    };
+
+    std::string_view text_;
+    Block block_;
+    size_t position_ = 0;
+    size_t next_line_ = 1;
+    size_t line_number_ = 0;
+    std::vector<Span> spans_;
+    std::string unescaped_;
+
+    // Reads the quoted field whose opening quote is at text_[i], returning
+    // the offset after it
+    size_t read_quoted(size_t i);
+    // Offset of the first ',' or '\n' at or after i, or the text size
+    size_t find_field_end(size_t i);
+    // The block holding text_[i], scanning a new one from i if needed
+    const Block& block_at(size_t i);
+};
+
+// Parse the leading number of a CSV field like std::stoi, std::stoull and
+// std::stod: after optional whitespace and sign, ignoring what follows
+// the number. Return false if there is no number or it is out of range.
+bool parse_csv_number(std::string_view field, int& value);
+bool parse_csv_number(std::string_view field, uint64_t& value);
+bool parse_csv_number(std::string_view field, double& value);
+
+} // namespace audio_library
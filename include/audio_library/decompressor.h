@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace audio_library {
+
+enum class Compression { kNone, kGzip, kZstd };
+
+// Compression of data, told by its magic bytes
+[[nodiscard]] Compression detect_compression(std::string_view data) noexcept;
+[[nodiscard]] const char* compression_name(Compression compression) noexcept;
+// Whether this build was linked with the library that decompresses it,
+// zlib for gzip and libzstd for zstd
+[[nodiscard]] bool can_decompress(Compression compression) noexcept;
+
+// Decompresses gzip or zstd data a block at a time. Concatenated gzip
+// members and zstd frames are read as one stream.
+class Decompressor {
+public:
+    static constexpr size_t kBlockSize = 256 << 10;
+    
+    // Receives each block of output; returns false to stop
+    using Sink = std::function<bool(std::string&& block)>;
+    
+    explicit Decompressor(Compression compression) : compression_(compression) {}
+    
+    // Passes the decompressed input to sink in blocks of up to block_size
+    // bytes. Returns false, with error() set, if the input is corrupt or
+    // cut short, or cannot be decompressed by this build; the blocks
+    // before the fault have been passed on by then. Stopping the sink is
+    // not an error.
+    bool run(std::string_view input, const Sink& sink, size_t block_size = kBlockSize);
+    
+    [[nodiscard]] const std::string& error() const noexcept { return error_; }
+    // Input bytes decompressed by the last run
+    [[nodiscard]] size_t bytes_read() const noexcept { return bytes_read_; }
+    
+    // Decompressed size the input's header or trailer records, or 0 if it
+    // does not. For gzip it is exact only for one member under 4 GiB.
+    [[nodiscard]] static size_t expected_size(std::string_view input, Compression compression) noexcept;
+
+private:
+    Compression compression_;
+    std::string error_;
+    size_t bytes_read_ = 0;
+    
+    bool run_gzip(std::string_view input, const Sink& sink, size_t block_size);
+    bool run_zstd(std::string_view input, const Sink& sink, size_t block_size);
+    bool fail(std::string error);
+};
+
+} // namespace audio_library
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <string_view>
+
+namespace audio_library {
+
+// Longest shorter-operand (in bytes) handled by the allocation-free
+// bit-parallel path. Longer inputs fall back to a two-row dynamic programme.
+inline constexpr size_t kBitParallelMaxLength = 512;
+
+// Levenshtein distance between two byte strings, computed with the
+// bit-parallel algorithm of Myers (1999) as extended to multiple 64-bit words
+// by Hyyrö (2003).
+//
+// If the distance is greater than max_distance, max_distance + 1 is returned
+// as soon as that is certain, without finishing the computation.
+[[nodiscard]] size_t edit_distance(std::string_view a, std::string_view b,
+                                   size_t max_distance = std::numeric_limits<size_t>::max());
+
+} // namespace audio_library
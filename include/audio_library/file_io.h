@@ -1,11 +1,14 @@
 #pragma once
 
+#include "decompressor.h"
 #include "track.h"
+#include <array>
 #include <vector>
 #include <string>
 #include <memory>
 #include <functional>
 #include <optional>
+#include <string_view>
 #include <filesystem>
 
 namespace audio_library {
@@ -16,12 +19,76 @@ public:
     using ProgressCallback = std::function<void(size_t current, size_t total)>;
     using ErrorCallback = std::function<void(const std::string& error, size_t line_number)>;
     
+    // A record an import can resume from: its offset in the file, the
+    // line breaks before it and the tracks imported before it
+    struct ImportCheckpoint {
+        size_t byte_offset = 0;
+        size_t lines_read = 0;
+        size_t tracks_imported = 0;
+    };
+    
+    struct ImportProgress {
+        ImportCheckpoint checkpoint;
+        size_t total_bytes = 0;             // File size
+        size_t bytes_read = 0;              // By this run, which may have resumed
+        double elapsed_seconds = 0.0;       // Of this run
+        
+        [[nodiscard]] double bytes_per_second() const {
+            return elapsed_seconds > 0.0 ? static_cast<double>(bytes_read) / elapsed_seconds : 0.0;
+        }
+        [[nodiscard]] double seconds_remaining() const {
+            const double rate = bytes_per_second();
+            return rate > 0.0 ? static_cast<double>(total_bytes - checkpoint.byte_offset) / rate : 0.0;
+        }
+    };
+    using CheckpointCallback = std::function<void(const ImportProgress& progress)>;
+    using BatchCallback = std::function<void(std::vector<Track>&& tracks)>;
+    
+    static constexpr size_t kDefaultCheckpointInterval = 64 << 20;
+    
+    // Where the stages of a pipelined import spent their time: working,
+    // waiting for the stage before, and held back by the stage after
+    struct PipelineStageStats {
+        const char* name = "";
+        size_t batches = 0;
+        double busy_seconds = 0.0;
+        double input_wait_seconds = 0.0;
+        double output_wait_seconds = 0.0;
+    };
+    struct PipelineStats {
+        // Reading ahead, parsing, validating and delivering the tracks
+        std::array<PipelineStageStats, 4> stages{};
+        double elapsed_seconds = 0.0;
+    };
+    
     struct ImportOptions {
-        bool skip_invalid_lines = true;
+        bool skip_invalid_lines = true;     // Otherwise stop at the first line that fails to parse
         bool validate_data = true;
         size_t max_errors = 100;
-        ProgressCallback progress_callback = nullptr;
+        size_t thread_count = 0;            // Threads parsing large CSV and TSV files, 0 for one per core
+        ProgressCallback progress_callback = nullptr; // Bytes read and file size
         ErrorCallback error_callback = nullptr;
+        
+        // CSV and TSV imports run checkpoint_interval bytes (0 for the whole
+        // file) at a time. After each run, and where an import stops early
+        // at a failing record, the tracks go to batch_callback if set, in
+        // place of the result, and checkpoint_callback is told where to
+        // resume. An import given resume_from starts at that record.
+        size_t checkpoint_interval = kDefaultCheckpointInterval;
+        ImportCheckpoint resume_from{};
+        BatchCallback batch_callback = nullptr;
+        CheckpointCallback checkpoint_callback = nullptr;
+        
+        // Pipelined CSV and TSV imports overlap reading ahead in the file,
+        // parsing, validation and delivery, each stage on its own thread
+        // but the last, which runs the callbacks on the calling thread.
+        // Batches of kPipelineBatchBytes, or checkpoint_interval if less,
+        // pass between the stages through queues kPipelineDepth deep, and
+        // each delivered batch ends with a checkpoint. thread_count does
+        // not apply. Timings go to pipeline_stats if set. An exception from
+        // a callback or a stage stops every stage and reaches the caller.
+        bool pipelined = false;
+        PipelineStats* pipeline_stats = nullptr;
     };
     
     struct ExportOptions {
@@ -30,7 +97,29 @@ public:
         ProgressCallback progress_callback = nullptr;
     };
     
-    // CSV operations
+    // Smallest share of a CSV or TSV file worth a thread of its own in
+    // import_csv or import_tsv
+    static constexpr size_t kMinBytesPerImportThread = 1 << 20;
+    static constexpr size_t kPipelineBatchBytes = 256 << 10;
+    static constexpr size_t kPipelineDepth = 8;
+    // Longest array element a compressed JSON import waits for before
+    // taking it to be malformed
+    static constexpr size_t kMaxJsonElementBytes = 16 << 20;
+    // Longest record a compressed CSV or TSV import waits for before
+    // reporting its first line as unparsable and going on after it
+    static constexpr size_t kMaxRecordBytes = 16 << 20;
+    
+    // CSV operations. Imports map the file and parse it in place; quoted
+    // fields may span lines. Large files are split into chunks parsed in
+    // parallel, with the same result as parsing them in one go. Callbacks
+    // are made on the calling thread, in file order, with lines that fail
+    // to parse reported to error_callback.
+    //
+    // gzip and zstd files, told by their magic bytes, are decompressed on
+    // a thread of their own as they are parsed, always as a pipelined
+    // import, and checkpoints count decompressed bytes. If the data is
+    // corrupt, or this build cannot decompress it, the tracks before the
+    // fault are kept and error_callback is told why.
     static std::vector<Track> import_csv(const std::filesystem::path& path, 
                                         const ImportOptions& options);
     static std::vector<Track> import_csv(const std::filesystem::path& path) {
@@ -53,7 +142,35 @@ public:
         return export_csv(path, tracks, ExportOptions{});
     }
     
-    // JSON operations
+    // TSV operations, for title<TAB>artist<TAB>seconds dumps and the
+    // optional fields of the CSV layout after them. Fields are not quoted,
+    // so exports write tabs and line breaks inside fields as spaces, and
+    // no header. Imports run like import_csv, but split the file exactly
+    // at line breaks.
+    static std::vector<Track> import_tsv(const std::filesystem::path& path,
+                                        const ImportOptions& options);
+    static std::vector<Track> import_tsv(const std::filesystem::path& path) {
+        return import_tsv(path, ImportOptions{});
+    }
+    
+    static bool export_tsv(const std::filesystem::path& path,
+                          const std::vector<Track>& tracks,
+                          const ExportOptions& options);
+    static bool export_tsv(const std::filesystem::path& path,
+                          const std::vector<Track>& tracks) {
+        return export_tsv(path, tracks, ExportOptions{});
+    }
+    
+    static bool export_tsv(const std::filesystem::path& path,
+                          const std::vector<TrackPtr>& tracks,
+                          const ExportOptions& options);
+    static bool export_tsv(const std::filesystem::path& path,
+                          const std::vector<TrackPtr>& tracks) {
+        return export_tsv(path, tracks, ExportOptions{});
+    }
+    
+    // JSON operations. Imports read the array one element at a time, and
+    // decompress gzip and zstd files alongside, like import_csv.
     static std::vector<Track> import_json(const std::filesystem::path& path,
                                          const ImportOptions& options);
     static std::vector<Track> import_json(const std::filesystem::path& path) {
@@ -82,16 +199,84 @@ public:
                                const std::vector<Track>& tracks,
                                const std::string& playlist_name = "");
     
-    // Utility methods
+    // What a full validation pass found in a CSV or TSV file
+    struct ValidationReport {
+        // Why a record would not be imported
+        enum class Problem { kUnparsable, kMissingTitle, kMissingArtist, kBadDuration, kBadYear };
+        static constexpr size_t kProblemCount = 5;
+        static constexpr size_t kSampleLines = 10;
+        
+        std::string error;              // Why the file could not be read, or read to the end
+        size_t bytes = 0;
+        size_t records = 0;             // Not counting a header
+        size_t valid_records = 0;
+        std::array<size_t, kProblemCount> problem_counts{};
+        // Line numbers of the first kSampleLines records with each problem
+        std::array<std::vector<size_t>, kProblemCount> sample_lines{};
+        double elapsed_seconds = 0.0;
+        
+        [[nodiscard]] size_t error_count() const noexcept { return records - valid_records; }
+        [[nodiscard]] bool ok() const noexcept { return error.empty() && error_count() == 0; }
+        [[nodiscard]] static const char* problem_name(Problem problem) noexcept;
+    };
+    
+    // Checks every record of a CSV or TSV file by the rules of an import,
+    // reading the file once in chunks checked in parallel, without making
+    // Tracks. thread_count is as for imports. Compressed files are
+    // decompressed into memory first.
+    static ValidationReport validate_csv_file(const std::filesystem::path& path, size_t thread_count = 0);
+    static ValidationReport validate_tsv_file(const std::filesystem::path& path, size_t thread_count = 0);
+    
+    // Utility methods. The format checks look at the start of the file.
     static bool validate_csv_format(const std::filesystem::path& path);
+    static bool validate_tsv_format(const std::filesystem::path& path);
     static bool validate_json_format(const std::filesystem::path& path);
+    // "csv", "tsv", "json" or "m3u". The extension is trusted when the
+    // content agrees with it; otherwise, as for ".txt" files, the content
+    // decides. Compressed files go by the extension before ".gz" or ".zst"
+    // and their decompressed content.
     static std::optional<std::string> detect_file_format(const std::filesystem::path& path);
     
 private:
-    // Helper methods
+    struct RecordChunk;
+    class ImportRun;
+    struct ValidationChunk;
+    
+    // Helper methods, for Reader being CsvReader or TsvReader
+    template <typename Reader>
+    static std::vector<Track> import_records(const std::filesystem::path& path, const ImportOptions& options);
+    template <typename Reader>
+    static void import_windows(std::string_view text, const ImportOptions& options, ImportRun& run);
+    template <typename Reader>
+    static void import_pipelined(std::string_view text, const ImportOptions& options, ImportRun& run);
+    template <typename Reader>
+    static void import_compressed(std::string_view input, Compression compression, const ImportOptions& options,
+                                  ImportRun& run);
+    // Runs read and parse on threads of their own, with validation on
+    // another, delivering on the calling thread. close_input closes the
+    // queue from read to parse, to stop them early.
+    template <typename Read, typename Parse, typename CloseInput>
+    static void run_pipeline(const ImportOptions& options, ImportRun& run, Read read, Parse parse,
+                             CloseInput close_input);
+    template <typename Reader>
+    static void parse_chunk(std::string_view text, const ImportOptions& options, RecordChunk& chunk);
+    static void skip_overlong_record(std::string_view text, RecordChunk& chunk);
+    static void validate_chunk(RecordChunk& chunk);
+    template <typename Reader>
+    static ValidationReport validate_records(const std::filesystem::path& path, size_t thread_count);
+    template <typename Reader>
+    static void check_chunk(std::string_view text, ValidationChunk& chunk);
+    static bool is_csv_head(const std::string& head);
+    static bool is_tsv_head(const std::string& head);
+    static bool is_json_head(const std::string& head);
     static std::vector<std::string> split_csv_line(const std::string& line);
     static std::string escape_csv_field(const std::string& field);
     static bool validate_track_data(const Track& track);
+    // The rules validate_track_data applies, to a track or to the fields
+    // it would be made from
+    static std::optional<ValidationReport::Problem> check_track_fields(
+        std::string_view title, std::string_view artist, int duration, int year);
+    static std::optional<ValidationReport::Problem> check_record(const std::vector<std::string_view>& fields);
 };
 
 } // namespace audio_library
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace audio_library {
+
+// Reads JSON text in one pass, value by value, viewing it in place. Only
+// strings with escapes are copied, into a buffer reused from string to
+// string, so a large array can be streamed element by element.
+//
+// Each read consumes one value or one step into or out of a container;
+// the commas and colons between them are checked and skipped. After a
+// syntax error every read fails and failed() is set.
+class JsonReader {
+public:
+    enum class Type { kObject, kArray, kString, kNumber, kTrue, kFalse, kNull, kEnd, kInvalid };
+
+    explicit JsonReader(std::string_view text);
+    
+    // Starts over on text, keeping the buffers
+    void reset(std::string_view text);
+
+    // Type of the next value, or kEnd at the end of the text
+    [[nodiscard]] Type peek();
+
+    // Enter the array or object starting at the next value
+    bool begin_array();
+    bool begin_object();
+    // Step to the next element of the innermost array, returning false
+    // once it ends (leaving it) or on error
+    bool next_element();
+    // Step to the next member of the innermost object and read its key,
+    // returning false once it ends (leaving it) or on error. The key is
+    // valid until the next read.
+    bool next_member(std::string_view& key);
+
+    // Read a string value, unescaped, valid until the next read
+    bool read_string(std::string_view& value);
+    // Read the text of a number value
+    bool read_number(std::string_view& value);
+    // Read or skip any value, including nested containers
+    bool skip_value();
+
+    [[nodiscard]] bool failed() const noexcept { return failed_; }
+    // Offset of the next unread byte in the text
+    [[nodiscard]] size_t position() const noexcept { return position_; }
+
+private:
+    std::string_view text_;
+    size_t position_ = 0;
+    bool failed_ = false;
+    // Per open container, whether an element or member has been read
+    std::vector<bool> started_;
+    std::string unescaped_;
+
+    void skip_space();
+    bool fail();
+    // Consumes the ',' before all but the first item of the innermost
+    // container, or its closing bracket; false at the end
+    bool next_item(char close);
+    bool read_literal(std::string_view literal);
+    // Decodes escapes from the string content starting at `from`
+    bool unescape(size_t begin, size_t from, std::string_view& value);
+};
+
+} // namespace audio_library
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace audio_library {
+
+// Regular expression matcher for the ECMAScript subset used by REGEX search.
+// Patterns are compiled to a Thompson NFA and matched through a lazily built
+// DFA, so matching time is linear in the input no matter how the pattern is
+// written; there is no backtracking to blow up.
+//
+// Supported: literals, '.', character classes ([a-z], [^...]), the escapes
+// \d \w \s \D \W \S \t \n \r \f \v \0 \xHH, groups ((...) and (?:...)),
+// alternation, the quantifiers * + ? {n} {n,} {n,m} (lazy forms are accepted
+// and behave the same since only a yes/no answer is needed), and the anchors
+// ^ and $. Backreferences, lookaround and \b are rejected at compile time.
+class LinearRegex {
+public:
+    using CharSet = std::bitset<256>;
+
+    // Returns nullopt if the pattern is malformed or uses unsupported features
+    static std::optional<LinearRegex> compile(std::string_view pattern, bool case_insensitive);
+
+    // Substrings every match must contain, used to discard candidate texts
+    // before running the automaton. For case-insensitive patterns letters
+    // are lowercase, so compare against lowercased text.
+    [[nodiscard]] const std::vector<std::string>& required_literals() const noexcept {
+        return required_literals_;
+    }
+
+    // Lazily built DFA over a compiled pattern. Construct one per batch of
+    // searches: it remembers the states it has already built, so it gets
+    // faster the more texts it sees. Not thread-safe; the LinearRegex it
+    // refers to may be shared freely.
+    class Matcher {
+    public:
+        explicit Matcher(const LinearRegex& regex);
+
+        // True if the pattern matches anywhere in text
+        [[nodiscard]] bool search(std::string_view text);
+
+    private:
+        struct DfaState {
+            std::vector<uint32_t> nfa_states;
+            bool accepting = false;        // Contains the match state
+            bool accepting_at_end = false; // Reaches the match state through '$'
+            int32_t next[256];
+        };
+
+        const LinearRegex& regex_;
+        std::vector<DfaState> states_;
+        std::unordered_map<std::string, int32_t> state_ids_;
+        std::vector<uint32_t> floating_start_; // Start closure away from position 0
+        int32_t initial_ = -1;
+
+        int32_t state_for(std::vector<uint32_t> nfa_states);
+        int32_t step(int32_t from, unsigned char c);
+        void reset();
+    };
+
+private:
+    enum class Op : uint8_t {
+        Char,   // Consume one byte in sets_[set], continue at out
+        Split,  // Epsilon to out and out1
+        Begin,  // '^': epsilon to out at position 0 only
+        End,    // '$': epsilon to out at end of input only
+        Match
+    };
+
+    struct State {
+        Op op;
+        uint32_t out = 0;
+        uint32_t out1 = 0;
+        uint32_t set = 0;
+    };
+
+    std::vector<State> states_;
+    std::vector<CharSet> sets_;
+    uint32_t start_ = 0;
+    std::vector<std::string> required_literals_;
+
+    friend class RegexCompiler;
+
+    void add_closure(uint32_t state, bool at_begin, std::vector<uint32_t>& set,
+                     std::vector<bool>& seen) const;
+    [[nodiscard]] bool closure_reaches_match_at_end(const std::vector<uint32_t>& states) const;
+};
+
+} // namespace audio_library
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+namespace audio_library {
+
+// Read-only memory mapping of a whole file. Pages are loaded on first
+// access and shared with every other process mapping the same file.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps path, replacing any earlier mapping. Returns false, leaving the
+    // file unmapped, if it cannot be opened or mapped. An empty file maps
+    // to no data.
+    bool open(const std::filesystem::path& path);
+    void close() noexcept;
+
+    [[nodiscard]] bool is_open() const noexcept { return open_; }
+    [[nodiscard]] const char* data() const noexcept { return data_; }
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool open_ = false;
+};
+
+} // namespace audio_library
@@ -37,6 +37,10 @@ public:
     // Track management
     bool add_track(Track track);
     bool add_track(TrackPtr track);
+    // Adds a batch of tracks, skipping those add_track would reject as
+    // duplicates, and returns how many were added. Costs time in proportion
+    // to the batch rather than to the library, under one lock.
+    size_t ingest(std::vector<Track> tracks);
     bool remove_track(const std::string& title, const std::string& artist);
     bool remove_tracks_by_title(const std::string& title);
     bool remove_tracks_by_artist(const std::string& artist);
@@ -50,6 +54,8 @@ public:
     [[nodiscard]] std::vector<TrackPtr> search(const std::string& query) const;
     [[nodiscard]] std::vector<TrackPtr> search_advanced(const std::string& query, 
                                                         const TrackFilter& filter = nullptr) const;
+    // Runs many searches under one lock; results are in input order
+    [[nodiscard]] std::vector<std::vector<TrackPtr>> search_batch(const std::vector<std::string>& queries) const;
     
     // Listing operations
     [[nodiscard]] std::vector<TrackPtr> get_all_tracks() const;
@@ -65,6 +71,12 @@ public:
     [[nodiscard]] std::vector<TrackPtr> get_most_played_tracks(size_t limit = 10) const;
     [[nodiscard]] std::vector<TrackPtr> get_top_rated_tracks(size_t limit = 10) const;
     
+    // Duplicate detection: pairs of tracks whose title and artist, folded as
+    // for search, differ by at most max_distance edits in total. Pairs are
+    // in library order.
+    [[nodiscard]] std::vector<std::pair<TrackPtr, TrackPtr>> find_potential_duplicates(
+        size_t max_distance = 2) const;
+    
     // Statistics
     [[nodiscard]] size_t size() const;
     [[nodiscard]] bool empty() const;
@@ -73,16 +85,26 @@ public:
     // Import/Export
     bool import_from_csv(const std::string& filename);
     bool export_to_csv(const std::string& filename) const;
+    bool import_from_tsv(const std::string& filename);
     bool import_from_json(const std::string& filename);
     bool export_to_json(const std::string& filename) const;
     
+    // Search index files, so that a restarted process can search without
+    // reindexing (see SearchEngine::save_index). Loading fails unless the
+    // file was saved for the tracks now in the library.
+    bool save_search_index(const std::string& filename) const;
+    bool load_search_index(const std::string& filename);
+    
     // Thread-safe iteration
     void for_each_track(const std::function<void(const Track&)>& func) const;
     
 private:
     // Internal data structures
     mutable std::shared_mutex mutex_;
+    // Removed tracks leave a null slot, so that the other tracks keep their
+    // indexes, until half the slots are empty and the library is compacted
     std::vector<TrackPtr> tracks_;
+    size_t removed_count_ = 0;
     
     // Indexes for fast lookup
     std::unordered_multimap<std::string, size_t> title_index_;
@@ -97,6 +119,10 @@ private:
     void rebuild_indexes();
     void add_to_indexes(size_t index, const Track& track);
     void remove_from_indexes(size_t index, const Track& track);
+    void remove_at(size_t index);
+    bool remove_all(const std::unordered_multimap<std::string, size_t>& index, const std::string& key);
+    void compact_if_sparse();
+    [[nodiscard]] std::vector<TrackPtr> live_tracks() const;
     [[nodiscard]] std::vector<TrackPtr> get_tracks_by_indexes(const std::vector<size_t>& indexes) const;
 };
 
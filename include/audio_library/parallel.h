@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace audio_library {
+
+// Runs task(0) to task(count - 1) on separate threads, the first on the
+// calling thread, and waits for all of them
+template <typename Task>
+void run_parallel(size_t count, const Task& task) {
+    std::vector<std::thread> threads;
+    threads.reserve(count - 1);
+    for (size_t i = 1; i < count; ++i) {
+        threads.emplace_back(task, i);
+    }
+    task(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+} // namespace audio_library
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace audio_library {
+
+// Path-compressed trie over weighted byte strings, used for autocomplete.
+// Nodes live in one vector and edge labels in one shared string, so a word
+// costs about one node plus the bytes it does not share with others, instead
+// of a heap allocation per character.
+//
+// Every node with children keeps the kTopCompletions heaviest words below
+// it, updated on each change, so completing a prefix costs the walk down to
+// it plus building the returned strings. Ties go to the earlier node, which
+// after freeze() favours shorter words.
+//
+// freeze() rewrites the nodes breadth first with every node's children
+// adjacent, dropping nodes left behind by erase(); the trie stays writable
+// afterwards, but later inserts land outside the compact layout until the
+// next freeze().
+//
+// serialize() writes the storage out as flat arrays, and attach() reads
+// such arrays in place, for example from a memory-mapped file. The first
+// change after attach() copies them into the trie's own storage.
+class RadixTrie {
+public:
+    static constexpr size_t kTopCompletions = 10;
+
+    RadixTrie();
+
+    // Adds the word, or updates its weight if already present. Returns true
+    // if the word was not already present.
+    bool insert(std::string_view word, uint32_t weight = 0);
+    // Returns true if the word was present
+    bool erase(std::string_view word);
+    [[nodiscard]] bool contains(std::string_view word) const;
+
+    // Up to max_results stored words starting with prefix, heaviest first.
+    // Requests for more than kTopCompletions scan the prefix's subtree.
+    [[nodiscard]] std::vector<std::string> complete(std::string_view prefix,
+                                                    size_t max_results) const;
+
+    void freeze();
+    void clear();
+
+    // Appends the trie to out, in native byte order
+    void serialize(std::string& out) const;
+    // Reads a serialize()d trie in place, without copying it. data must be
+    // aligned to 4 bytes and stay unchanged until detach(), clear() or the
+    // next change. Returns false, leaving the trie as it was, if data does
+    // not hold a whole trie.
+    bool attach(const char* data, size_t size);
+    // Copies attached storage into the trie's own
+    void detach();
+    [[nodiscard]] bool attached() const noexcept { return attached_nodes_ != nullptr; }
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    // Bytes held by the node, label and completion storage, not counting
+    // attached memory
+    [[nodiscard]] size_t memory_usage() const noexcept;
+
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct Node {
+        uint32_t label_offset = 0;   // Edge label from the parent, in labels_
+        uint32_t label_length = 0;
+        uint32_t parent = kNone;
+        uint32_t first_child = kNone;
+        uint32_t next_sibling = kNone;
+        uint32_t top = kNone;        // Block of kTopCompletions slots in top_, once it has children
+        uint32_t weight = 0;
+        unsigned char first = 0;     // labels_[label_offset], kept for child lookup
+        uint8_t top_count = 0;
+        bool terminal = false;       // A stored word ends here
+    };
+
+    struct Completion {
+        uint32_t node;
+        uint32_t weight;
+    };
+
+    std::vector<Node> nodes_;        // nodes_[0] is the root, with an empty label
+    std::string labels_;
+    std::vector<Completion> top_;
+    std::vector<Completion> scratch_;
+    size_t size_ = 0;
+
+    // Storage read in place after attach(), instead of the vectors above
+    const Node* attached_nodes_ = nullptr;
+    const Completion* attached_top_ = nullptr;
+    std::string_view attached_labels_;
+    size_t attached_node_count_ = 0;
+    size_t attached_top_count_ = 0;
+
+    // Read paths go through these so that they work on attached storage
+    [[nodiscard]] const Node& node_at(uint32_t node) const {
+        return attached_nodes_ ? attached_nodes_[node] : nodes_[node];
+    }
+    [[nodiscard]] const Completion* top_at(uint32_t top) const {
+        return (attached_top_ ? attached_top_ : top_.data()) + top * kTopCompletions;
+    }
+    [[nodiscard]] std::string_view labels() const {
+        return attached_nodes_ ? attached_labels_ : std::string_view(labels_);
+    }
+    [[nodiscard]] std::string_view label(const Node& node) const {
+        return labels().substr(node.label_offset, node.label_length);
+    }
+    // Child of parent whose label starts with c, or kNone. If prev is given
+    // it receives the sibling before the child's position in the sorted list.
+    [[nodiscard]] uint32_t find_child(uint32_t parent, unsigned char c,
+                                      uint32_t* prev = nullptr) const;
+    // Node below which every word starts with prefix, or kNone
+    [[nodiscard]] uint32_t find_prefix(std::string_view prefix) const;
+    void link_child(uint32_t parent, uint32_t prev, uint32_t child);
+    void unlink_child(uint32_t parent, uint32_t prev, uint32_t child);
+
+    // Whether serialized storage links only to nodes, completion slots and
+    // label bytes it holds, in a tree hanging from the root
+    [[nodiscard]] static bool well_formed(const Node* nodes, size_t node_count, const Completion* top,
+                                          size_t top_count, size_t label_bytes);
+    [[nodiscard]] std::string word_at(uint32_t node) const;
+    [[nodiscard]] static bool heavier(const Completion& a, const Completion& b) {
+        return a.weight > b.weight || (a.weight == b.weight && a.node < b.node);
+    }
+    void allocate_top(uint32_t node);
+    // Merges a word whose weight grew into the lists of node and its ancestors
+    void raise_completion(uint32_t node, Completion completion);
+    // Recomputes the lists of node and its ancestors from their children
+    void rebuild_completions(uint32_t node);
+    void rebuild_top(uint32_t node);
+};
+
+} // namespace audio_library
@@ -1,11 +1,20 @@
 #pragma once
 
 #include "track.h"
+#include "linear_regex.h"
+#include "radix_trie.h"
+#include "tokenizer.h"
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <unordered_map>
-#include <set>
 
 namespace audio_library {
 
@@ -31,8 +40,43 @@ public:
         bool search_genre = true;
         size_t max_results = 100;
         double min_relevance = 0.0;
+        bool match_all_terms = true;    // Implicit operator between query words: AND, or OR if false
     };
     
+    // Indexed fields, in the order used by the per-field arrays below
+    enum class Field : uint8_t { TITLE, ARTIST, ALBUM, GENRE };
+    static constexpr size_t kFieldCount = 4;
+    
+    // BM25F ranking parameters. Term frequencies are normalized per field by
+    // the field's length relative to its average, weighted, summed, and then
+    // saturated with k1.
+    struct ScoringParameters {
+        double k1 = 1.2;
+        std::array<double, kFieldCount> field_weights = {1.0, 0.8, 0.6, 0.4};
+        std::array<double, kFieldCount> field_length_normalization = {0.75, 0.75, 0.75, 0.75};
+    };
+    
+    // One query of a batch
+    struct Query {
+        std::string text;
+        SearchOptions options;
+    };
+    
+    struct ResultCacheStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t entries = 0;
+        size_t bytes = 0;     // Approximate memory held by cached results
+    };
+    
+    static constexpr size_t kDefaultResultCacheBytes = 4 * 1024 * 1024;
+    
+    // Smallest share of tracks worth a thread of its own in rebuild_index
+    // and index_tracks
+    static constexpr size_t kMinTracksPerBuildThread = 512;
+    // Smallest share of distinct queries worth a thread of its own in search_batch
+    static constexpr size_t kMinQueriesPerBatchThread = 16;
+    
     SearchEngine();
     ~SearchEngine();
     
@@ -40,17 +84,77 @@ public:
     void index_track(size_t id, const Track& track);
     void remove_track(size_t id);
     void clear_index();
-    void rebuild_index(const std::vector<TrackPtr>& tracks);
-    void set_tracks(const std::vector<TrackPtr>* tracks) { tracks_ = tracks; }
+    // Reindexes all tracks, splitting large libraries across thread_count
+    // threads (0 for one per core). The result is identical to indexing
+    // the tracks one by one.
+    void rebuild_index(const std::vector<TrackPtr>& tracks, size_t thread_count = 0);
+    // Indexes tracks[first] onwards as a batch, in the same way. Their ids
+    // must be above those of every track already indexed, as when tracks
+    // are appended to the library.
+    void index_tracks(const std::vector<TrackPtr>& tracks, size_t first, size_t thread_count = 0);
+    // index_tracks in two steps, so that callers can tokenize a batch
+    // without holding their own lock against searches. prepare_tracks()
+    // reads only the index settings; add_prepared_tracks() indexes the
+    // result as tracks first onwards, or returns false, leaving the index
+    // as it was, if the settings changed in between. Defined in the source
+    // file.
+    struct PreparedTracks;
+    [[nodiscard]] std::shared_ptr<PreparedTracks> prepare_tracks(const std::vector<TrackPtr>& tracks, size_t first,
+                                                                 size_t thread_count = 0) const;
+    bool add_prepared_tracks(PreparedTracks& prepared, size_t first);
+    void set_tracks(const std::vector<TrackPtr>* tracks) { tracks_ = tracks; ++generation_; }
+    void set_scoring_parameters(const ScoringParameters& parameters) { scoring_ = parameters; ++generation_; }
+    // Whether postings record where in each field a term occurs, which
+    // phrase and NEAR queries need (on by default). Applies to tracks
+    // indexed afterwards; without positions those queries match like AND.
+    void set_store_positions(bool store) { store_positions_ = store; ++generation_; }
+    [[nodiscard]] bool stores_positions() const { return store_positions_; }
+    // Whether queries for a few best results skip tracks that cannot make
+    // them (on by default). Results are the same either way.
+    void set_prune_top_k(bool prune) { prune_top_k_ = prune; }
+    [[nodiscard]] bool prunes_top_k() const { return prune_top_k_; }
+    
+    // Index files. save_index() writes the index in a layout that
+    // load_index() maps into memory and searches in place, so a new
+    // process answers queries without rebuilding the index and processes
+    // on one host share the file's pages. Files are in native byte order.
+    // The first index change after loading copies the index into memory.
+    // load_index() returns false, leaving the index as it was, if the file
+    // is missing, damaged or from another format version, or if it was
+    // saved for other tracks than those given to set_tracks.
+    bool save_index(const std::filesystem::path& path) const;
+    bool load_index(const std::filesystem::path& path);
+    [[nodiscard]] bool is_index_mapped() const { return segment_ != nullptr; }
     
-    // Search operations
+    // Recently returned results are cached per (query, options), least
+    // recently used first out once the byte budget is exceeded; 0 disables
+    // caching. Any change to the index makes earlier entries stale.
+    void set_result_cache_capacity(size_t bytes);
+    void clear_result_cache();
+    [[nodiscard]] ResultCacheStats get_result_cache_stats() const;
+    
+    // Search operations. Outside REGEX mode the query is split into words
+    // that must all match (see match_all_terms); "a OR b" matches either
+    // word, and "-a" or "NOT a" excludes tracks matching a. "a b c" in
+    // quotes matches the words in sequence within one field, and
+    // "a NEAR b" (or NEAR/n, default 5) matches them in either order with
+    // at most n other words between. Words of a phrase or NEAR group match
+    // exactly, whatever the mode.
     [[nodiscard]] std::vector<SearchResult> search(const std::string& query, 
                                                    const SearchOptions& options) const;
     [[nodiscard]] std::vector<SearchResult> search(const std::string& query) const {
         return search(query, SearchOptions{});
     }
+    // Answers many queries at once, in input order, each exactly as
+    // search() would. Identical queries are evaluated once, words shared by
+    // several queries are matched against the vocabulary once, and the
+    // distinct queries are spread over thread_count threads (0 for one per
+    // core). Like search(), not safe against concurrent index changes.
+    [[nodiscard]] std::vector<std::vector<SearchResult>> search_batch(const std::vector<Query>& queries,
+                                                                      size_t thread_count = 0) const;
     
-    // Autocomplete/Suggestions
+    // Autocomplete/Suggestions: indexed terms starting with prefix, those
+    // found in the most tracks first
     [[nodiscard]] std::vector<std::string> get_suggestions(const std::string& prefix, 
                                                            size_t max_suggestions = 10) const;
     
@@ -59,49 +163,251 @@ public:
     [[nodiscard]] size_t get_indexed_tracks_count() const;
     
 private:
-    struct IndexEntry {
-        size_t track_id;
-        std::string field; // "title", "artist", "album", "genre"
-        double weight;     // Importance weight for ranking
+    // One posting per (term, track), kept sorted by track id. The document
+    // frequency of a term is the length of its posting list.
+    struct Posting {
+        uint32_t track_id;
+        std::array<uint16_t, kFieldCount> term_frequency; // Occurrences per field
+        uint32_t positions;   // Offset into the term's positions_ bytes, or kNoPositions
     };
+    static constexpr uint32_t kNoPositions = std::numeric_limits<uint32_t>::max();
+    
+    // Inverted index for fast text search. Terms are numbered densely in
+    // order of first appearance; an id stays valid (possibly with no
+    // postings) until the index is cleared.
+    std::unordered_map<std::string, uint32_t> term_ids_;
+    std::vector<std::string> terms_;
+    std::vector<std::vector<Posting>> postings_;
+    size_t live_terms_ = 0;
+    
+    // Per-field bounds over each run of kBlockSize postings of a term, from
+    // which query-time upper bounds on a posting's score follow. They let
+    // top-k retrieval skip postings that cannot reach the results.
+    static constexpr size_t kBlockSize = 128;
+    struct BlockSummary {
+        std::array<uint16_t, kFieldCount> max_term_frequency{};
+        std::array<uint16_t, kFieldCount> min_field_length{}; // Over postings with the field
+        uint8_t max_fields = 0; // Most fields any one posting has the term in
+    };
+    std::vector<std::vector<BlockSummary>> blocks_;
+    
+    // Word positions of each term's postings: for every field the term
+    // occurs in, its term_frequency positions as varint deltas. Bytes of
+    // removed postings are reclaimed when the term empties or on rebuild.
+    std::vector<std::vector<uint8_t>> positions_;
+    bool store_positions_ = true;
+    bool prune_top_k_ = true;
+    
+    // Forward index: ids of the terms each track id was indexed under, so
+    // removing a track only edits its own posting lists
+    std::vector<std::vector<uint32_t>> track_terms_;
+    
+    // Token counts per field for each track id, and their totals, for BM25F
+    // length normalization
+    std::vector<std::array<uint16_t, kFieldCount>> field_lengths_;
+    std::array<uint64_t, kFieldCount> total_field_lengths_{};
+    size_t indexed_tracks_ = 0;
+    ScoringParameters scoring_;
+    
+    // Trigram -> ascending ids of the terms containing it, used to prune the
+    // vocabulary before running REGEX patterns
+    std::unordered_map<uint32_t, std::vector<uint32_t>> trigram_index_;
+
+    // Recently compiled REGEX patterns (nullptr for invalid ones), most
+    // recently used first
+    using RegexCacheList = std::list<std::pair<std::string, std::shared_ptr<const LinearRegex>>>;
+    mutable std::mutex regex_cache_mutex_;
+    mutable RegexCacheList regex_cache_;
+    mutable std::unordered_map<std::string, RegexCacheList::iterator> regex_cache_index_;
     
-    // Inverted index for fast text search
-    std::unordered_map<std::string, std::vector<IndexEntry>> inverted_index_;
+    // Search results by query key, most recently used first. Entries from
+    // an older generation than generation_ are dropped when looked up.
+    struct CachedResults {
+        std::string key;
+        uint64_t generation;
+        std::vector<SearchResult> results;
+        size_t bytes;
+    };
+    using ResultCacheList = std::list<CachedResults>;
+    mutable std::mutex result_cache_mutex_;
+    mutable ResultCacheList result_cache_;
+    mutable std::unordered_map<std::string_view, ResultCacheList::iterator> result_cache_index_;
+    mutable size_t result_cache_bytes_ = 0;
+    mutable uint64_t result_cache_hits_ = 0;
+    mutable uint64_t result_cache_misses_ = 0;
+    size_t result_cache_capacity_ = kDefaultResultCacheBytes;
+    uint64_t generation_ = 0; // Bumped by every index change
     
-    // Trie for autocomplete
-    struct TrieNode {
-        std::unordered_map<char, std::unique_ptr<TrieNode>> children;
-        std::set<std::string> suggestions;
-        bool is_end_of_word = false;
+    // Largest weighted term frequency over all fields in each block of a
+    // term, exact for one generation and computed when top-k retrieval
+    // first needs it. Much tighter than the block summaries alone.
+    struct BlockMaxima {
+        uint64_t generation = std::numeric_limits<uint64_t>::max();
+        std::vector<double> term_frequency;
     };
-    std::unique_ptr<TrieNode> trie_root_;
+    mutable std::mutex block_maxima_mutex_;
+    mutable std::vector<BlockMaxima> block_maxima_;
+
+    // Terms with postings weighted by their document frequency, for
+    // autocomplete. Frozen after a full rebuild.
+    RadixTrie trie_;
     
     // Reference to tracks for search results
     const std::vector<TrackPtr>* tracks_ = nullptr;
     
+    // A loaded index file, read in place of the structures above until the
+    // index first changes. Defined in the source file.
+    struct Segment;
+    std::unique_ptr<const Segment> segment_;
+    
+    // Read-only run of entries, in the structures above or in a segment
+    template <typename T>
+    class View {
+    public:
+        View() = default;
+        View(const T* data, size_t size) : data_(data), size_(size) {}
+        View(const std::vector<T>& entries) : data_(entries.data()), size_(entries.size()) {}
+        
+        [[nodiscard]] const T* begin() const { return data_; }
+        [[nodiscard]] const T* end() const { return data_ + size_; }
+        [[nodiscard]] const T* data() const { return data_; }
+        [[nodiscard]] size_t size() const { return size_; }
+        [[nodiscard]] bool empty() const { return size_ == 0; }
+        const T& operator[](size_t i) const { return data_[i]; }
+        
+    private:
+        const T* data_ = nullptr;
+        size_t size_ = 0;
+    };
+    using FieldLengths = std::array<uint16_t, kFieldCount>;
+    static constexpr uint32_t kNoTerm = std::numeric_limits<uint32_t>::max();
+    
+    // Every query reads the index through these, whether mapped or not
+    [[nodiscard]] size_t term_count() const;
+    [[nodiscard]] std::string_view term_text(uint32_t term_id) const;
+    [[nodiscard]] uint32_t find_term(const std::string& term) const; // Or kNoTerm
+    [[nodiscard]] View<Posting> term_postings(uint32_t term_id) const;
+    [[nodiscard]] View<uint8_t> term_positions(uint32_t term_id) const;
+    [[nodiscard]] View<BlockSummary> term_blocks(uint32_t term_id) const;
+    [[nodiscard]] const FieldLengths& track_field_lengths(uint32_t track_id) const;
+    [[nodiscard]] View<uint32_t> track_term_ids(uint32_t track_id) const;
+    [[nodiscard]] View<uint32_t> trigram_terms(uint32_t key) const; // Ascending term ids
+    // Copies a mapped index into the structures above before changing it
+    void ensure_writable();
+    // Hash of the indexed text of every track, to match index files to tracks
+    static uint64_t tracks_fingerprint(const std::vector<TrackPtr>& tracks);
+    
+    // Dense per-query score table, defined in the source file
+    struct ScoreAccumulator;
+    
+    // Index terms a query word expanded to, with how well each matched
+    using TermMatches = std::vector<std::pair<uint32_t, double>>;
+    
+    // Query words joined by OR, one excluded word, or a phrase or NEAR
+    // group, defined in the source file
+    struct QueryClause;
+    
+    // Vocabulary matches of query words, shared by the queries of a batch
+    struct TermExpansions;
+    
+    // The terms of one track: per-field occurrences of each, in order of
+    // first occurrence and viewing the tokenizer's buffer, with each term's
+    // tokens chained in order for encoding positions
+    struct TrackTerms {
+        Tokenizer tokenizer;
+        std::vector<std::pair<std::string_view, std::array<uint16_t, kFieldCount>>> counts;
+        std::array<uint32_t, kFieldCount + 1> field_begin{}; // First token of each field
+        std::vector<uint32_t> first_token;                   // Per counts entry
+        std::vector<uint32_t> last_token;                    // Per counts entry
+        std::vector<uint32_t> next_token;                    // Per token
+        std::vector<uint8_t> positions;                      // Encoding scratch
+    };
+    
+    // Scratch space reused by index_track
+    TrackTerms track_terms_scratch_;
+    std::string term_key_;
+    
     // Helper methods
-    std::vector<std::string> tokenize(const std::string& text) const;
+    std::array<uint32_t, kFieldCount> count_terms(const Track& track, TrackTerms& terms) const;
+    // Encodes the positions of terms.counts[entry], shifted by base per field
+    void encode_positions(TrackTerms& terms, size_t entry,
+                          const std::array<uint16_t, kFieldCount>& base) const;
+    void decode_positions(uint32_t term_id, const Posting& posting, Field field,
+                          std::vector<uint32_t>& positions) const;
     std::string normalize(const std::string& text, bool case_sensitive) const;
-    double calculate_relevance(const std::string& query, const std::string& text) const;
-    size_t levenshtein_distance(const std::string& s1, const std::string& s2) const;
-    
-    void add_to_trie(const std::string& word);
-    void add_to_inverted_index(const std::string& term, size_t track_id, 
-                              const std::string& field, double weight);
-    
-    // Search mode implementations
-    void search_exact(const std::string& query, const SearchOptions& options,
-                     std::unordered_map<size_t, double>& track_scores) const;
-    void search_prefix(const std::string& query, const SearchOptions& options,
-                      std::unordered_map<size_t, double>& track_scores) const;
-    void search_substring(const std::string& query, const SearchOptions& options,
-                         std::unordered_map<size_t, double>& track_scores) const;
-    void search_fuzzy(const std::string& query, const SearchOptions& options,
-                     std::unordered_map<size_t, double>& track_scores) const;
+    // Both arguments must already be lowercase
+    double calculate_relevance(std::string_view lower_query, std::string_view lower_text) const;
+    
+    uint32_t add_to_inverted_index(std::string_view term, uint32_t track_id,
+                              const std::array<uint16_t, kFieldCount>& term_frequency,
+                              const std::vector<uint8_t>* positions);
+    void add_to_trigram_index(const std::string& term, uint32_t term_id);
+    void update_block(uint32_t term_id, size_t index);
+    void rebuild_blocks(uint32_t term_id);
+
+    std::shared_ptr<const LinearRegex> get_compiled_regex(const std::string& pattern,
+                                                          bool case_insensitive) const;
+    std::vector<uint32_t> get_regex_candidates(const LinearRegex& regex) const;
+    
+    bool find_cached_results(const std::string& key, std::vector<SearchResult>& results) const;
+    void store_cached_results(const std::string& key, const std::vector<SearchResult>& results) const;
+    void evict_cached_results(size_t capacity) const;
+    
+    // Query evaluation
+    std::vector<SearchResult> run_query(const std::string& query, const SearchOptions& options,
+                                        TermExpansions* expansions) const;
+    std::vector<QueryClause> parse_query(const std::string& query, const SearchOptions& options,
+                                         TermExpansions* expansions) const;
+    void evaluate_query(std::vector<QueryClause>& clauses, const SearchOptions& options,
+                        ScoreAccumulator& scores) const;
+    std::vector<uint32_t> collect_track_ids(const QueryClause& clause, const SearchOptions& options) const;
+    void filter_candidates(std::vector<uint32_t>& candidates, const QueryClause& clause,
+                           const SearchOptions& options, bool keep_matches) const;
+    std::vector<uint32_t> union_track_ids(const TermMatches& terms, size_t estimated_size,
+                                          const SearchOptions& options) const;
+    bool matches_proximity(uint32_t track_id, const QueryClause& clause, const SearchOptions& options) const;
+    
+    // Search mode implementations, each expanding one query word to the
+    // index terms it matches
+    void match_term(const std::string& word, const SearchOptions& options, TermMatches& matches) const;
+    void match_term(const std::string& word, const SearchOptions& options, TermMatches& matches,
+                    TermExpansions* expansions) const;
+    void search_exact(const std::string& query, TermMatches& matches) const;
+    void search_prefix(const std::string& query, TermMatches& matches) const;
+    void search_substring(const std::string& query, TermMatches& matches) const;
+    void search_fuzzy(const std::string& query, TermMatches& matches) const;
     void search_regex(const std::string& pattern, const SearchOptions& options,
-                     std::unordered_map<size_t, double>& track_scores) const;
+                     TermMatches& matches) const;
+    
+    // BM25F contribution of every posting of a term, scaled by how well the
+    // term matched the query (1.0 for an exact match). If candidates is
+    // given, only those tracks (ascending ids) are scored.
+    void score_term(uint32_t term_id, double match_quality, const SearchOptions& options,
+                    ScoreAccumulator& scores,
+                    const std::vector<uint32_t>* candidates = nullptr) const;
+    // Scores only the tracks that can still make the best max_results of
+    // the union of terms, leaving exactly those in scores (block-max
+    // MaxScore). Results equal scoring every term with score_term.
+    void score_top_k(const TermMatches& terms, const SearchOptions& options, ScoreAccumulator& scores) const;
+    bool can_prune(const SearchOptions& options) const;
+    // Shared by both scoring paths so that they agree to the bit
+    double term_weight(uint32_t term_id, double match_quality) const;
+    std::array<double, kFieldCount> average_field_lengths() const;
+    double score_posting(const Posting& posting, double weight, const std::array<double, kFieldCount>& average_lengths,
+                         const SearchOptions& options) const;
+    double weighted_term_frequency(const Posting& posting, const std::array<double, kFieldCount>& average_lengths,
+                                   const SearchOptions& options) const;
+    double saturate(double weight, double term_frequency) const;
+    // Bounds on weighted_term_frequency over the postings of a block
+    double term_frequency_bound(const BlockSummary& block, const std::array<double, kFieldCount>& average_lengths,
+                                const SearchOptions& options) const;
+    std::vector<double> block_term_frequency_maxima(uint32_t term_id,
+                                                    const std::array<double, kFieldCount>& average_lengths) const;
+    std::vector<SearchResult> select_top_results(const ScoreAccumulator& scores,
+                                                 const SearchOptions& options) const;
     
-    bool should_search_field(const std::string& field, const SearchOptions& options) const;
+    bool should_search_field(Field field, const SearchOptions& options) const;
+    bool matches_fields(const Posting& posting, const SearchOptions& options) const;
 };
 
 } // namespace audio_library
\ No newline at end of file
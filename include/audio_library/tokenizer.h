@@ -0,0 +1,40 @@
+#pragma once
+
+#include "unicode_fold.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace audio_library {
+
+// Splits text into search tokens: runs of non-whitespace with leading and
+// trailing ASCII punctuation removed. Unless case-sensitive, text is first
+// folded with append_folded, so Unicode spaces and punctuation split and
+// trim like their ASCII counterparts.
+//
+// Tokens are copied into a buffer owned by the tokenizer and handed out as
+// views, so once its buffers have grown to fit the typical input a
+// tokenizer reused across calls allocates nothing.
+class Tokenizer {
+public:
+    // Drops the tokens of earlier calls, keeping the memory
+    void clear();
+
+    // Appends the tokens of text and returns how many there were. Earlier
+    // tokens stay valid until clear().
+    size_t append(std::string_view text, bool case_sensitive = false);
+
+    [[nodiscard]] size_t size() const noexcept { return spans_.size(); }
+    [[nodiscard]] std::string_view operator[](size_t index) const noexcept {
+        return std::string_view(buffer_).substr(spans_[index].first, spans_[index].second);
+    }
+
+private:
+    std::string buffer_;
+    std::vector<std::pair<uint32_t, uint32_t>> spans_; // (offset, length) in buffer_
+};
+
+} // namespace audio_library
@@ -3,10 +3,13 @@
 #include <string>
 #include <chrono>
 #include <optional>
+#include <string_view>
 #include <vector>
 
 namespace audio_library {
 
+class JsonReader;
+
 class Track {
 public:
     // Constructors
@@ -53,9 +56,28 @@ public:
     bool operator!=(const Track& other) const noexcept { return !(*this == other); }
     bool operator<(const Track& other) const noexcept;
     
+    // The numeric columns of a CSV record, with empty optional ones as 0
+    struct CsvNumbers {
+        int duration = 0;
+        int year = 0;
+        uint64_t play_count = 0;
+        double rating = 0.0; // As written, before set_rating clamps it
+    };
+    
     // Static factory methods
     static std::optional<Track> from_csv_line(const std::string& line);
+    // Fields in CSV column order: title, artist and duration, then
+    // optionally album, genre, year, play count and rating
+    static std::optional<Track> from_csv_fields(const std::vector<std::string_view>& fields);
+    // The numbers from_csv_fields reads from fields, or nullopt if one
+    // does not parse
+    static std::optional<CsvNumbers> parse_csv_numbers(const std::vector<std::string_view>& fields);
     static std::optional<Track> from_json(const std::string& json);
+    // Reads the object at reader's next value, mapping its keys straight
+    // onto the track. Returns nullopt if a title, artist or duration is
+    // missing or a number does not parse; the whole object is consumed
+    // unless the JSON itself is malformed.
+    static std::optional<Track> from_json_object(JsonReader& reader);
     
 private:
     std::string title_;
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace audio_library {
+
+// Splits tab-separated text into records of fields, viewing the text in
+// place. There is no quoting: every tab ends a field and every "\n" or
+// "\r\n" ends a record, so fields are never copied. The text is scanned
+// 64 bytes at a time for tabs and line breaks, with SIMD where available.
+// Blank lines are skipped.
+class TsvReader {
+public:
+    explicit TsvReader(std::string_view text) : text_(text) {}
+
+    // Fields of the next record, valid as long as the text. Returns false
+    // at the end of the text.
+    bool next_record(std::vector<std::string_view>& fields);
+
+    // Line the last record returned is on, counting from 1
+    [[nodiscard]] size_t line_number() const noexcept { return line_number_; }
+    // Offset of the next record in the text
+    [[nodiscard]] size_t position() const noexcept { return position_; }
+    // Line breaks before position()
+    [[nodiscard]] size_t lines_read() const noexcept { return next_line_ - 1; }
+
+private:
+    std::string_view text_;
+    size_t position_ = 0;
+    size_t next_line_ = 1;
+    size_t line_number_ = 0;
+    // Tabs and '\n' bytes in up to 64 bytes from block_begin_, one bit each
+    size_t block_begin_ = 0;
+    size_t block_size_ = 0;
+    uint64_t separators_ = 0;
+
+    // Offset of the first tab or '\n' at or after i, or the text size
+    size_t find_separator(size_t i);
+};
+
+} // namespace audio_library
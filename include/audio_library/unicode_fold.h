@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace audio_library {
+
+// Lowercases ASCII letters in place, 16 bytes at a time where SSE2 is
+// available. Other bytes, including UTF-8 sequences, are left untouched.
+void ascii_lowercase(char* data, size_t size);
+
+// Appends the search form of UTF-8 text to out: case-folded, with
+// diacritics removed ("Beyoncé" -> "beyonce", "Σtella" -> "σtella") and
+// Unicode spaces, dashes and quotes replaced by their ASCII counterparts.
+// ASCII runs are only lowercased; malformed bytes are copied unchanged.
+void append_folded(std::string& out, std::string_view text);
+
+[[nodiscard]] std::string fold_text(std::string_view text);
+
+// Decodes the UTF-8 sequence at the start of [data, data + size) and returns
+// its length, or 0 if it is malformed
+size_t decode_utf8(const unsigned char* data, size_t size, char32_t& code_point);
+// Appends code_point as UTF-8
+void append_utf8(std::string& out, char32_t code_point);
+
+} // namespace audio_library
@@ -0,0 +1,267 @@
+#include "audio_library/csv_reader.h"
+#include <algorithm>
+#include <charconv>
+
+#if defined(__AVX2__) || defined(__PCLMUL__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace audio_library {
+
+namespace {
+
+constexpr size_t kBlockSize = 64;
+
+#if defined(__AVX2__)
+// Bits for the bytes of 32 equal to a or b
+inline uint64_t match_mask(__m256i chunk, char a, char b) {
+    const __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(a)),
+                                         _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(b)));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+}
+#elif defined(__SSE2__)
+// Bits for the bytes of 16 equal to a or b
+inline uint64_t match_mask(__m128i chunk, char a, char b) {
+    const __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(a)),
+                                      _mm_cmpeq_epi8(chunk, _mm_set1_epi8(b)));
+    return static_cast<uint32_t>(_mm_movemask_epi8(hits));
+}
+#endif
+
+// Sets the bits of quotes and separators for the quotes and the ',' and
+// '\n' bytes among data[0, size), size being at most 64
+void scan_block(const char* data, size_t size, uint64_t& quotes, uint64_t& separators) {
+    quotes = 0;
+    separators = 0;
+#if defined(__AVX2__)
+    if (size == kBlockSize) {
+        for (size_t i = 0; i < kBlockSize; i += 32) {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            quotes |= match_mask(chunk, '"', '"') << i;
+            separators |= match_mask(chunk, ',', '\n') << i;
+        }
+        return;
+    }
+#elif defined(__SSE2__)
+    if (size == kBlockSize) {
+        for (size_t i = 0; i < kBlockSize; i += 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            quotes |= match_mask(chunk, '"', '"') << i;
+            separators |= match_mask(chunk, ',', '\n') << i;
+        }
+        return;
+    }
+#endif
+    for (size_t i = 0; i < size; ++i) {
+        quotes |= static_cast<uint64_t>(data[i] == '"') << i;
+        separators |= static_cast<uint64_t>(data[i] == ',' || data[i] == '\n') << i;
+    }
+}
+
+// Each bit set to the XOR of the bits up to and including it, so that it
+// tells whether an odd number of bits are set up to there
+inline uint64_t prefix_xor(uint64_t bits) {
+#if defined(__PCLMUL__)
+    const __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, static_cast<long long>(bits)),
+                                                 _mm_set1_epi8(-1), 0);
+    return static_cast<uint64_t>(_mm_cvtsi128_si64(product));
+#else
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+#endif
+}
+
+inline size_t lowest_bit(uint64_t bits) {
+    return static_cast<size_t>(__builtin_ctzll(bits));
+}
+
+// What std::sto* skip before the number
+std::string_view skip_space(std::string_view field) {
+    size_t i = 0;
+    while (i < field.size() && (field[i] == ' ' || (field[i] >= '\t' && field[i] <= '\r'))) {
+        ++i;
+    }
+    return field.substr(i);
+}
+
+} // namespace
+
+bool CsvReader::next_record(std::vector<std::string_view>& fields) {
+    fields.clear();
+    const char* data = text_.data();
+    const size_t end = text_.size();
+
+    // Blank lines hold no record
+    while (position_ < end && (data[position_] == '\n' ||
+           (data[position_] == '\r' && position_ + 1 < end && data[position_ + 1] == '\n'))) {
+        position_ += data[position_] == '\r' ? 2 : 1;
+        ++next_line_;
+    }
+    if (position_ >= end) {
+        return false;
+    }
+
+    const size_t record_begin = position_;
+    line_number_ = next_line_;
+    spans_.clear();
+    unescaped_.clear();
+
+    size_t i = position_;
+    bool quoted = false;
+    for (;;) {
+        if (i < end && data[i] == '"') {
+            i = read_quoted(i);
+            quoted = true;
+        } else {
+            const size_t begin = i;
+            i = find_field_end(i);
+            spans_.push_back({begin, i - begin, false});
+        }
+
+        if (i < end && data[i] == ',') {
+            ++i;
+            continue;
+        }
+        // A "\r\n" line break leaves its '\r' at the end of the last
+        // field, unless that field was quoted and closed before it
+        Span& last = spans_.back();
+        if (i < end && data[i - 1] == '\r' && last.length > 0 &&
+            (last.unescaped || last.offset + last.length == i)) {
+            --last.length;
+        }
+        if (i < end) {
+            ++i; // The '\n'
+        }
+        break;
+    }
+
+    // Only quoted fields hold line breaks of their own
+    if (quoted) {
+        next_line_ += static_cast<size_t>(std::count(data + record_begin, data + i, '\n'));
+    } else if (data[i - 1] == '\n') {
+        ++next_line_;
+    }
+    position_ = i;
+
+    // The buffer no longer grows, so views into it stay valid
+    fields.reserve(spans_.size());
+    for (const auto& span : spans_) {
+        const char* base = span.unescaped ? unescaped_.data() : data;
+        fields.emplace_back(base + span.offset, span.length);
+    }
+    return true;
+}
+
+size_t CsvReader::read_quoted(size_t i) {
+    const char* data = text_.data();
+    const size_t end = text_.size();
+    const size_t content = i + 1;
+
+    // Quotes inside the field are doubled, so the closing quote is the
+    // first to end a run of quotes with an odd count of quotes since the
+    // field opened; the prefix XOR of the quote bits holds that parity.
+    // Any quote before it means the field has doubled quotes.
+    bool doubled = false;
+    size_t close = end;
+    uint64_t odd = 0; // All ones after an odd count in earlier blocks
+    for (size_t at = content; at < end;) {
+        const Block& block = block_at(at);
+        const size_t shift = at - block.begin;
+        const size_t count = block.size - shift;
+        const uint64_t quotes = block.quotes >> shift;
+        const uint64_t parity = prefix_xor(quotes) ^ odd;
+        uint64_t followed = quotes >> 1;
+        if (at + count < end && data[at + count] == '"') {
+            followed |= uint64_t{1} << (count - 1);
+        }
+        const uint64_t closing = quotes & parity & ~followed;
+        if (closing != 0) {
+            const size_t offset = lowest_bit(closing);
+            close = at + offset;
+            doubled = doubled || (quotes & ((uint64_t{1} << offset) - 1)) != 0;
+            break;
+        }
+        doubled = doubled || quotes != 0;
+        odd = ((parity >> (count - 1)) & 1) != 0 ? ~uint64_t{0} : 0;
+        at += count;
+    }
+
+    // Text between the closing quote and the end of the field
+    size_t after = close < end ? close + 1 : end;
+    size_t field_end = find_field_end(after);
+    const bool trailing = field_end > after &&
+        !(field_end - after == 1 && field_end < end && data[after] == '\r' && data[field_end] == '\n');
+
+    if (!doubled && !trailing) {
+        spans_.push_back({content, std::min(close, end) - content, false});
+        return field_end;
+    }
+
+    const size_t offset = unescaped_.size();
+    for (size_t at = content; at < close; ++at) {
+        unescaped_ += data[at];
+        if (data[at] == '"') {
+            ++at; // Skip the second quote of the pair
+        }
+    }
+    unescaped_.append(data + after, field_end - after);
+    spans_.push_back({offset, unescaped_.size() - offset, true});
+    return field_end;
+}
+
+size_t CsvReader::find_field_end(size_t i) {
+    while (i < text_.size()) {
+        const Block& block = block_at(i);
+        const uint64_t separators = block.separators >> (i - block.begin);
+        if (separators != 0) {
+            return i + lowest_bit(separators);
+        }
+        i = block.begin + block.size;
+    }
+    return text_.size();
+}
+
+const CsvReader::Block& CsvReader::block_at(size_t i) {
+    if (i - block_.begin >= block_.size) {
+        block_.begin = i;
+        block_.size = std::min(kBlockSize, text_.size() - i);
+        scan_block(text_.data() + i, block_.size, block_.quotes, block_.separators);
+    }
+    return block_;
+}
+
+bool parse_csv_number(std::string_view field, int& value) {
+    field = skip_space(field);
+    if (!field.empty() && field[0] == '+') {
+        field.remove_prefix(1);
+    }
+    auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+    return error == std::errc();
+}
+
+bool parse_csv_number(std::string_view field, uint64_t& value) {
+    field = skip_space(field);
+    if (!field.empty() && field[0] == '+') {
+        field.remove_prefix(1);
+    }
+    auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+    return error == std::errc();
+}
+
+bool parse_csv_number(std::string_view field, double& value) {
+    field = skip_space(field);
+    if (!field.empty() && field[0] == '+') {
+        field.remove_prefix(1);
+    }
+    auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+    return error == std::errc();
+}
+
+} // namespace audio_library
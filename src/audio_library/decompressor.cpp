@@ -0,0 +1,213 @@
+#include "audio_library/decompressor.h"
+#include <algorithm>
+#include <climits>
+
+#ifdef AUDIO_LIBRARY_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef AUDIO_LIBRARY_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace audio_library {
+
+namespace {
+
+bool has_prefix(std::string_view data, std::string_view magic) {
+    return data.substr(0, magic.size()) == magic;
+}
+
+constexpr std::string_view kGzipMagic("\x1F\x8B", 2);
+constexpr std::string_view kZstdMagic("\x28\xB5\x2F\xFD", 4);
+
+} // namespace
+
+Compression detect_compression(std::string_view data) noexcept {
+    if (has_prefix(data, kGzipMagic)) return Compression::kGzip;
+    if (has_prefix(data, kZstdMagic)) return Compression::kZstd;
+    return Compression::kNone;
+}
+
+const char* compression_name(Compression compression) noexcept {
+    switch (compression) {
+        case Compression::kGzip: return "gzip";
+        case Compression::kZstd: return "zstd";
+        default: return "none";
+    }
+}
+
+bool can_decompress(Compression compression) noexcept {
+    switch (compression) {
+        case Compression::kNone: return true;
+#ifdef AUDIO_LIBRARY_HAVE_ZLIB
+        case Compression::kGzip: return true;
+#endif
+#ifdef AUDIO_LIBRARY_HAVE_ZSTD
+        case Compression::kZstd: return true;
+#endif
+        default: return false;
+    }
+}
+
+bool Decompressor::run(std::string_view input, const Sink& sink, size_t block_size) {
+    error_.clear();
+    bytes_read_ = 0;
+    block_size = std::max<size_t>(block_size, 1);
+    switch (compression_) {
+        case Compression::kNone:
+            // Passed through as it is
+            for (size_t at = 0; at < input.size(); at += block_size) {
+                bytes_read_ = std::min(input.size(), at + block_size);
+                if (!sink(std::string(input.substr(at, block_size)))) break;
+            }
+            return true;
+        case Compression::kGzip:
+            return run_gzip(input, sink, block_size);
+        case Compression::kZstd:
+            return run_zstd(input, sink, block_size);
+    }
+    return false;
+}
+
+size_t Decompressor::expected_size(std::string_view input, Compression compression) noexcept {
+    switch (compression) {
+        case Compression::kNone:
+            return input.size();
+        case Compression::kGzip: {
+            // ISIZE, the last four bytes: the size modulo 2^32, little endian
+            if (input.size() < 18) return 0;
+            const auto* trailer = reinterpret_cast<const unsigned char*>(input.data() + input.size() - 4);
+            return static_cast<size_t>(trailer[0]) | static_cast<size_t>(trailer[1]) << 8 |
+                   static_cast<size_t>(trailer[2]) << 16 | static_cast<size_t>(trailer[3]) << 24;
+        }
+        case Compression::kZstd: {
+#ifdef AUDIO_LIBRARY_HAVE_ZSTD
+            const unsigned long long size = ZSTD_getFrameContentSize(input.data(), input.size());
+            if (size != ZSTD_CONTENTSIZE_UNKNOWN && size != ZSTD_CONTENTSIZE_ERROR) {
+                return static_cast<size_t>(size);
+            }
+#endif
+            return 0;
+        }
+    }
+    return 0;
+}
+
+bool Decompressor::fail(std::string error) {
+    error_ = std::move(error);
+    return false;
+}
+
+#ifdef AUDIO_LIBRARY_HAVE_ZLIB
+
+bool Decompressor::run_gzip(std::string_view input, const Sink& sink, size_t block_size) {
+    z_stream stream{};
+    // 16 + MAX_WBITS: gzip wrapping only
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+        return fail("Cannot start gzip decompression");
+    }
+    const auto* data = reinterpret_cast<const unsigned char*>(input.data());
+    size_t consumed = 0;
+    bool ok = true;
+    bool more = true;
+    while (more) {
+        std::string block(block_size, '\0');
+        stream.next_out = reinterpret_cast<unsigned char*>(block.data());
+        stream.avail_out = static_cast<uInt>(std::min<size_t>(block_size, UINT_MAX));
+        int status = Z_OK;
+        while (stream.avail_out > 0) {
+            if (stream.avail_in == 0) {
+                // avail_in is 32 bits wide, so larger inputs go in slices
+                stream.next_in = const_cast<unsigned char*>(data + consumed);
+                stream.avail_in = static_cast<uInt>(std::min<size_t>(input.size() - consumed, UINT_MAX));
+                consumed += stream.avail_in;
+            }
+            status = inflate(&stream, Z_NO_FLUSH);
+            if (status == Z_STREAM_END) {
+                // Another member may follow
+                const size_t next = consumed - stream.avail_in;
+                if (next < input.size() && detect_compression(input.substr(next)) == Compression::kGzip) {
+                    inflateReset(&stream);
+                    continue;
+                }
+                more = false;
+                break;
+            }
+            if (status == Z_BUF_ERROR && stream.avail_in == 0 && consumed == input.size()) {
+                ok = fail("Truncated gzip data");
+                more = false;
+                break;
+            }
+            if (status != Z_OK) {
+                ok = fail(std::string("Corrupt gzip data: ") + (stream.msg ? stream.msg : "inflate failed"));
+                more = false;
+                break;
+            }
+        }
+        bytes_read_ = consumed - stream.avail_in;
+        block.resize(block.size() - stream.avail_out);
+        if (!block.empty() && !sink(std::move(block))) {
+            break;
+        }
+    }
+    inflateEnd(&stream);
+    return ok;
+}
+
+#else
+
+bool Decompressor::run_gzip(std::string_view, const Sink&, size_t) {
+    return fail("gzip input needs zlib, which this build does not have");
+}
+
+#endif
+
+#ifdef AUDIO_LIBRARY_HAVE_ZSTD
+
+bool Decompressor::run_zstd(std::string_view input, const Sink& sink, size_t block_size) {
+    ZSTD_DCtx* context = ZSTD_createDCtx();
+    if (!context) {
+        return fail("Cannot start zstd decompression");
+    }
+    ZSTD_inBuffer in{input.data(), input.size(), 0};
+    bool ok = true;
+    size_t remaining = 1; // Nonzero while a frame is unfinished
+    while (in.pos < in.size || remaining != 0) {
+        std::string block(block_size, '\0');
+        ZSTD_outBuffer out{block.data(), block.size(), 0};
+        while (out.pos < out.size) {
+            const size_t before = in.pos + out.pos;
+            const size_t result = ZSTD_decompressStream(context, &out, &in);
+            if (ZSTD_isError(result)) {
+                ok = fail(std::string("Corrupt zstd data: ") + ZSTD_getErrorName(result));
+                break;
+            }
+            if (in.pos + out.pos == before) {
+                break; // No progress: the input has run out
+            }
+            remaining = result;
+        }
+        bytes_read_ = in.pos;
+        block.resize(out.pos);
+        if (!ok) break;
+        if (block.empty() && in.pos == in.size) {
+            if (remaining != 0) ok = fail("Truncated zstd data");
+            break;
+        }
+        if (!block.empty() && !sink(std::move(block))) {
+            break;
+        }
+    }
+    ZSTD_freeDCtx(context);
+    return ok;
+}
+
+#else
+
+bool Decompressor::run_zstd(std::string_view, const Sink&, size_t) {
+    return fail("zstd input needs libzstd, which this build does not have");
+}
+
+#endif
+
+} // namespace audio_library
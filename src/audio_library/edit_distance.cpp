@@ -0,0 +1,212 @@
+#include "audio_library/edit_distance.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace audio_library {
+
+namespace {
+
+constexpr size_t kWordBits = 64;
+constexpr size_t kMaxWords = kBitParallelMaxLength / kWordBits;
+
+// Nothing can be cut off when max_distance is unbounded.
+size_t exceeded(size_t max_distance) {
+    return max_distance == std::numeric_limits<size_t>::max() ? max_distance : max_distance + 1;
+}
+
+// Single 64-bit word: pattern.size() <= 64.
+size_t myers_single_word(std::string_view pattern, std::string_view text, size_t max_distance) {
+    const size_t m = pattern.size();
+    const size_t n = text.size();
+
+    // Only the entries for bytes occurring in the pattern or the text are
+    // ever touched, so clearing just those avoids the whole 2 KiB table.
+    uint64_t peq[256];
+    for (unsigned char c : pattern) {
+        peq[c] = 0;
+    }
+    for (unsigned char c : text) {
+        peq[c] = 0;
+    }
+    for (size_t i = 0; i < m; ++i) {
+        peq[static_cast<unsigned char>(pattern[i])] |= uint64_t{1} << i;
+    }
+
+    const uint64_t last = uint64_t{1} << (m - 1);
+    uint64_t pv = ~uint64_t{0};
+    uint64_t mv = 0;
+    size_t score = m;
+
+    for (size_t j = 0; j < n; ++j) {
+        const uint64_t eq = peq[static_cast<unsigned char>(text[j])];
+        const uint64_t xv = eq | mv;
+        const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        if (ph & last) {
+            ++score;
+        } else if (mh & last) {
+            --score;
+        }
+
+        // The score can fall by at most one per remaining column
+        const size_t remaining = n - j - 1;
+        if (score > remaining && score - remaining > max_distance) {
+            return exceeded(max_distance);
+        }
+
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+
+    return score;
+}
+
+// Blocked variant for 64 < pattern.size() <= kBitParallelMaxLength. Each
+// text column is processed block by block, carrying the horizontal delta
+// out of the top bit of one block into the bottom bit of the next.
+size_t myers_multi_word(std::string_view pattern, std::string_view text, size_t max_distance) {
+    const size_t m = pattern.size();
+    const size_t n = text.size();
+    const size_t words = (m + kWordBits - 1) / kWordBits;
+
+    uint64_t peq[256 * kMaxWords];
+    for (unsigned char c : pattern) {
+        std::fill_n(peq + c * words, words, uint64_t{0});
+    }
+    for (unsigned char c : text) {
+        std::fill_n(peq + c * words, words, uint64_t{0});
+    }
+    for (size_t i = 0; i < m; ++i) {
+        const auto c = static_cast<unsigned char>(pattern[i]);
+        peq[c * words + i / kWordBits] |= uint64_t{1} << (i % kWordBits);
+    }
+
+    uint64_t pv[kMaxWords];
+    uint64_t mv[kMaxWords];
+    std::fill_n(pv, words, ~uint64_t{0});
+    std::fill_n(mv, words, uint64_t{0});
+
+    const uint64_t last = uint64_t{1} << ((m - 1) % kWordBits);
+    const uint64_t high = uint64_t{1} << (kWordBits - 1);
+    size_t score = m;
+
+    for (size_t j = 0; j < n; ++j) {
+        const uint64_t* eq_column = peq + static_cast<unsigned char>(text[j]) * words;
+
+        // Horizontal delta entering the top of the column is always +1
+        uint64_t carry_p = 1;
+        uint64_t carry_m = 0;
+
+        for (size_t w = 0; w < words; ++w) {
+            uint64_t eq = eq_column[w];
+            const uint64_t xv = eq | mv[w];
+            eq |= carry_m;
+            const uint64_t xh = (((eq & pv[w]) + pv[w]) ^ pv[w]) | eq;
+            uint64_t ph = mv[w] | ~(xh | pv[w]);
+            uint64_t mh = pv[w] & xh;
+
+            if (w + 1 == words) {
+                if (ph & last) {
+                    ++score;
+                } else if (mh & last) {
+                    --score;
+                }
+            }
+
+            const uint64_t out_p = (ph & high) ? 1 : 0;
+            const uint64_t out_m = (mh & high) ? 1 : 0;
+
+            ph = (ph << 1) | carry_p;
+            mh = (mh << 1) | carry_m;
+            pv[w] = mh | ~(xv | ph);
+            mv[w] = ph & xv;
+
+            carry_p = out_p;
+            carry_m = out_m;
+        }
+
+        const size_t remaining = n - j - 1;
+        if (score > remaining && score - remaining > max_distance) {
+            return exceeded(max_distance);
+        }
+    }
+
+    return score;
+}
+
+// Classic two-row dynamic programme for inputs too long for the
+// bit-parallel path. Stops once every cell in a row exceeds the limit.
+size_t two_row_distance(std::string_view pattern, std::string_view text, size_t max_distance) {
+    const size_t m = pattern.size();
+    const size_t n = text.size();
+
+    std::vector<size_t> previous(n + 1);
+    std::vector<size_t> current(n + 1);
+    for (size_t j = 0; j <= n; ++j) {
+        previous[j] = j;
+    }
+
+    for (size_t i = 1; i <= m; ++i) {
+        current[0] = i;
+        size_t row_min = current[0];
+        for (size_t j = 1; j <= n; ++j) {
+            size_t cost = (pattern[i - 1] == text[j - 1]) ? 0 : 1;
+            current[j] = std::min({
+                previous[j] + 1,         // deletion
+                current[j - 1] + 1,      // insertion
+                previous[j - 1] + cost   // substitution
+            });
+            row_min = std::min(row_min, current[j]);
+        }
+        if (row_min > max_distance) {
+            return exceeded(max_distance);
+        }
+        std::swap(previous, current);
+    }
+
+    return previous[n] > max_distance ? exceeded(max_distance) : previous[n];
+}
+
+} // namespace
+
+size_t edit_distance(std::string_view a, std::string_view b, size_t max_distance) {
+    // The shorter string is the pattern encoded in the bit vectors
+    if (a.size() > b.size()) {
+        std::swap(a, b);
+    }
+
+    if (b.size() - a.size() > max_distance) {
+        return exceeded(max_distance);
+    }
+    if (a.empty()) {
+        return b.size();
+    }
+
+    // Shared prefixes and suffixes never contribute to the distance
+    while (!a.empty() && a.front() == b.front()) {
+        a.remove_prefix(1);
+        b.remove_prefix(1);
+    }
+    while (!a.empty() && a.back() == b.back()) {
+        a.remove_suffix(1);
+        b.remove_suffix(1);
+    }
+    if (a.empty()) {
+        return b.size();
+    }
+
+    if (a.size() <= kWordBits) {
+        return myers_single_word(a, b, max_distance);
+    }
+    if (a.size() <= kBitParallelMaxLength) {
+        return myers_multi_word(a, b, max_distance);
+    }
+    return two_row_distance(a, b, max_distance);
+}
+
+} // namespace audio_library
@@ -1,85 +1,933 @@
 #include "audio_library/file_io.h"
+#include "audio_library/bounded_queue.h"
+#include "audio_library/csv_reader.h"
+#include "audio_library/decompressor.h"
+#include "audio_library/json_reader.h"
+#include "audio_library/mapped_file.h"
+#include "audio_library/parallel.h"
+#include "audio_library/tsv_reader.h"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
 #include <iostream>
 #include <iomanip>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <type_traits>
 
 namespace audio_library {
 
-std::vector<Track> FileIO::import_csv(const std::filesystem::path& path, 
-                                     const ImportOptions& options) {
+namespace {
+
+// Records read before an import estimates how many tracks the file holds
+constexpr size_t kSizingRecords = 1024;
+
+bool is_break(char c) {
+    return c == ',' || c == '\n' || c == '\r';
+}
+
+// Start of the first line after the one holding text[at], past any blank
+// lines, which the record before would otherwise skip
+size_t next_line_start(std::string_view text, size_t at) {
+    at = text.find('\n', at);
+    if (at == std::string_view::npos) {
+        return text.size();
+    }
+    for (++at; at < text.size(); ++at) {
+        if (text[at] == '\r' && at + 1 < text.size() && text[at + 1] == '\n') {
+            ++at;
+        } else if (text[at] != '\n') {
+            break;
+        }
+    }
+    return at;
+}
+
+// Guesses where the first CSV record at or after `from` starts, for
+// splitting a file into chunks. The first quote after `from` hints whether
+// `from` is inside a quoted field: one ending a field closes it, so the
+// record starts on the line after it; otherwise take the next line. Wrong
+// guesses are caught when the chunks are joined.
+size_t guess_record_start(std::string_view text, size_t from) {
+    size_t at = from;
+    const size_t quote = text.find('"', from);
+    if (quote != std::string_view::npos && quote > from) {
+        const char before = text[quote - 1];
+        const char after = quote + 1 < text.size() ? text[quote + 1] : '\n';
+        if (!is_break(before) && before != '"' && is_break(after)) {
+            at = quote + 1;
+        }
+    }
+    return next_line_start(text, at);
+}
+
+// Where the first record at or after `at` starts; exact for TSV, which
+// has no quoting, and a guess for CSV
+template <typename Reader>
+size_t record_start(std::string_view text, size_t at) {
+    return std::is_same_v<Reader, TsvReader> ? next_line_start(text, at) : guess_record_start(text, at);
+}
+
+// Views the whole file at path as text: in a mapping where possible, while
+// pipes and other files that cannot be mapped are read into content
+bool view_file(const std::filesystem::path& path, MappedFile& mapping, std::string& content,
+               std::string_view& text) {
+    if (mapping.open(path)) {
+        text = std::string_view(mapping.data(), mapping.size());
+        return true;
+    }
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    text = content;
+    return true;
+}
+
+// The first bytes of the file at path, decompressed if it is compressed,
+// for telling its format
+bool read_head(const std::filesystem::path& path, std::string& head) {
+    constexpr size_t kHeadBytes = 64 << 10;
+    MappedFile mapping;
+    std::string content;
+    std::string_view text;
+    if (!view_file(path, mapping, content, text)) {
+        return false;
+    }
+    const Compression compression = detect_compression(text);
+    if (compression == Compression::kNone) {
+        head.assign(text.substr(0, kHeadBytes));
+        return true;
+    }
+    head.clear();
+    Decompressor decompressor(compression);
+    decompressor.run(text, [&head](std::string&& block) {
+        head += block;
+        return false;
+    }, kHeadBytes);
+    return true;
+}
+
+bool is_json_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Runs step, adding the time it takes to seconds
+template <typename Step>
+auto timed(double& seconds, Step&& step) {
+    const auto start = std::chrono::steady_clock::now();
+    auto result = step();
+    seconds += seconds_since(start);
+    return result;
+}
+
+// Threads of a pipeline's stages, stopped and joined when it goes out of
+// scope, so that the stages end even while an exception unwinds past them
+struct StageThreads {
+    std::function<void()> stop;
+    std::vector<std::thread> threads;
+    
+    ~StageThreads() {
+        stop();
+        for (auto& thread : threads) {
+            if (thread.joinable()) thread.join();
+        }
+    }
+};
+
+// Field text for a TSV export, which cannot hold tabs or line breaks
+std::string tsv_field(const std::string& field) {
+    std::string text = field;
+    std::replace_if(text.begin(), text.end(),
+        [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+    return text;
+}
+
+} // namespace
+
+// Tracks and errors from the records starting in [begin, limit) of a CSV
+// or TSV file, with line numbers counted from the chunk's first line
+struct FileIO::RecordChunk {
+    // Where a record is, from the chunk's start
+    struct Position {
+        size_t line_number;
+        size_t offset;
+        size_t lines_before;    // Line breaks before offset
+    };
+    struct Error {
+        size_t tracks_before;   // Tracks parsed before the failing record
+        Position position;
+        bool parse_failure;     // Otherwise the data failed validation
+        std::string record;     // Text of a record that failed to parse
+    };
+    
+    size_t base = 0;            // Offset in the input of the text parsed
+    size_t begin = 0;
+    size_t limit = 0;
+    size_t end = 0;             // Offset after the last record read
+    size_t last_record = 0;     // Offset the last record read starts from
+    size_t line_count = 0;      // Line breaks in [begin, end)
+    bool at_end = false;        // Last of a pipelined import
     std::vector<Track> tracks;
-    std::ifstream file(path);
+    std::vector<Error> errors;
+    bool record_positions = false;
+    std::vector<Position> positions; // Per track, if record_positions
+};
+
+template <typename Reader>
+void FileIO::parse_chunk(std::string_view text, const ImportOptions& options, RecordChunk& chunk) {
+    chunk.tracks.clear();
+    chunk.errors.clear();
+    chunk.positions.clear();
     
-    if (!file.is_open()) {
+    const std::string_view chunk_text = text.substr(chunk.begin);
+    const size_t limit = chunk.limit > chunk.begin ? chunk.limit - chunk.begin : 0;
+    Reader reader(chunk_text);
+    std::vector<std::string_view> fields;
+    size_t record_count = 0;
+    bool first_record = chunk.base + chunk.begin == 0;
+    chunk.last_record = chunk.begin;
+    
+    for (size_t record_begin = 0, record_lines = 0; reader.position() < limit && reader.next_record(fields);
+         record_begin = reader.position(), record_lines = reader.lines_read()) {
+        const RecordChunk::Position position{reader.line_number(), record_begin, record_lines};
+        chunk.last_record = chunk.begin + record_begin;
+        
+        // Size the result from the first records, so that the tracks are
+        // not moved again and again as it grows
+        if (++record_count == kSizingRecords && reader.position() < limit) {
+            const double records_per_byte = static_cast<double>(record_count) / static_cast<double>(reader.position());
+            chunk.tracks.reserve(static_cast<size_t>(static_cast<double>(limit) * records_per_byte * 1.125));
+        }
+        
+        // Simple heuristic: if the third field of the first record is not a
+        // number, it's a header
+        if (first_record) {
+            first_record = false;
+            int duration = 0;
+            if (fields.size() >= 3 && !parse_csv_number(fields[2], duration)) {
+                continue;
+            }
+        }
+        
+        if (options.progress_callback && position.line_number % 100 == 0) {
+            options.progress_callback(chunk.begin + reader.position(), text.size());
+        }
+        
+        auto track_opt = Track::from_csv_fields(fields);
+        
+        if (track_opt) {
+            if (!options.validate_data || validate_track_data(*track_opt)) {
+                chunk.tracks.push_back(std::move(*track_opt));
+                if (chunk.record_positions) {
+                    chunk.positions.push_back(position);
+                }
+            } else {
+                chunk.errors.push_back({chunk.tracks.size(), position, false, {}});
+            }
+        } else {
+            auto record = chunk_text.substr(record_begin, reader.position() - record_begin);
+            record.remove_prefix(std::min(record.size(), record.find_first_not_of("\r\n")));
+            while (!record.empty() && (record.back() == '\n' || record.back() == '\r')) {
+                record.remove_suffix(1);
+            }
+            chunk.errors.push_back({chunk.tracks.size(), position, true, std::string(record)});
+            if (!options.skip_invalid_lines) {
+                break;
+            }
+        }
+        
+        // Whatever follows is dropped when the chunks are joined
+        if (!chunk.errors.empty() && chunk.errors.size() >= options.max_errors) {
+            break;
+        }
+    }
+    
+    chunk.end = chunk.begin + reader.position();
+    chunk.line_count = reader.lines_read();
+}
+
+// Replaces what was parsed of the record at chunk.begin, which is too long
+// to wait for, with a parse failure for its first line; the chunk ends
+// after that line
+void FileIO::skip_overlong_record(std::string_view text, RecordChunk& chunk) {
+    chunk.tracks.clear();
+    chunk.errors.clear();
+    chunk.positions.clear();
+    
+    // Blank lines before the record belong to it, as in parse_chunk
+    size_t start = chunk.begin;
+    size_t lines_before = 0;
+    while (start < text.size() && (text[start] == '\n' || text[start] == '\r')) {
+        lines_before += text[start++] == '\n';
+    }
+    const size_t line_end = std::min(text.find('\n', start), text.size());
+    auto record = text.substr(start, line_end - start);
+    if (!record.empty() && record.back() == '\r') {
+        record.remove_suffix(1);
+    }
+    
+    const RecordChunk::Position position{lines_before + 1, 0, 0};
+    chunk.errors.push_back({0, position, true, std::string(record)});
+    chunk.end = std::min(line_end + 1, text.size());
+    chunk.limit = chunk.end;
+    chunk.last_record = chunk.begin;
+    chunk.line_count = lines_before + (line_end < text.size() ? 1 : 0);
+}
+
+void FileIO::validate_chunk(RecordChunk& chunk) {
+    // Validation failures go in among the parse failures in record order
+    std::vector<RecordChunk::Error> errors;
+    errors.reserve(chunk.errors.size());
+    size_t next_error = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < chunk.tracks.size(); ++i) {
+        for (; next_error < chunk.errors.size() && chunk.errors[next_error].tracks_before <= i; ++next_error) {
+            errors.push_back(std::move(chunk.errors[next_error]));
+            errors.back().tracks_before = kept;
+        }
+        if (validate_track_data(chunk.tracks[i])) {
+            if (kept != i) {
+                chunk.tracks[kept] = std::move(chunk.tracks[i]);
+                chunk.positions[kept] = chunk.positions[i];
+            }
+            ++kept;
+        } else {
+            errors.push_back({kept, chunk.positions[i], false, {}});
+        }
+    }
+    for (; next_error < chunk.errors.size(); ++next_error) {
+        errors.push_back(std::move(chunk.errors[next_error]));
+        errors.back().tracks_before = kept;
+    }
+    chunk.tracks.erase(chunk.tracks.begin() + static_cast<std::ptrdiff_t>(kept), chunk.tracks.end());
+    chunk.positions.resize(kept);
+    chunk.errors = std::move(errors);
+}
+
+// One CSV or TSV import: joins the tracks and errors of its chunks in file
+// order, making the callbacks, and keeps the checkpoint after them
+class FileIO::ImportRun {
+public:
+    // total_bytes is the size of the input, as far as it is known yet
+    ImportRun(const ImportOptions& options, size_t total_bytes, size_t resumed_bytes)
+        : options_(options), started_(std::chrono::steady_clock::now()), resumed_bytes_(resumed_bytes) {
+        progress_.checkpoint = options.resume_from;
+        progress_.total_bytes = total_bytes;
+    }
+    
+    [[nodiscard]] size_t resumed_bytes() const { return resumed_bytes_; }
+    [[nodiscard]] const ImportCheckpoint& checkpoint() const { return progress_.checkpoint; }
+    [[nodiscard]] bool stopped() const { return stopped_; }
+    [[nodiscard]] bool has_tracks() const { return !out().empty(); }
+    
+    void set_total_bytes(size_t total_bytes) { progress_.total_bytes = total_bytes; }
+    
+    // Room for count more tracks, or for expected if the result must grow
+    void make_room(size_t count, size_t expected) {
+        auto& tracks = out();
+        if (tracks.size() + count > tracks.capacity()) {
+            tracks.reserve(tracks.size() + std::max(count, expected));
+        }
+    }
+    
+    // Takes the tracks of the chunk, which must start at the checkpoint,
+    // and reports its errors. The checkpoint moves past the chunk, or to
+    // the record that stopped the import. Returns false once stopped.
+    bool join(RecordChunk& chunk) {
+        const size_t lines_before = progress_.checkpoint.lines_read;
+        size_t kept = chunk.tracks.size();
+        for (const auto& error : chunk.errors) {
+            const size_t line_number = lines_before + error.position.line_number;
+            ++error_count_;
+            if (options_.error_callback) {
+                if (error.parse_failure) {
+                    options_.error_callback("Failed to parse line " + 
+                                          std::to_string(line_number) + ": " + error.record, line_number);
+                } else {
+                    options_.error_callback("Invalid track data at line " + 
+                                          std::to_string(line_number), line_number);
+                }
+            }
+            if (error.parse_failure && !options_.skip_invalid_lines) {
+                stopped_ = true;
+            } else if (error_count_ >= options_.max_errors) {
+                if (options_.error_callback) {
+                    options_.error_callback("Too many errors, stopping import", line_number);
+                }
+                stopped_ = true;
+            }
+            if (stopped_) {
+                // Resuming starts again at the failing record
+                kept = error.tracks_before;
+                progress_.checkpoint.byte_offset = chunk.begin + error.position.offset;
+                progress_.checkpoint.lines_read = lines_before + error.position.lines_before;
+                break;
+            }
+        }
+        
+        chunk.tracks.erase(chunk.tracks.begin() + static_cast<std::ptrdiff_t>(kept), chunk.tracks.end());
+        progress_.checkpoint.tracks_imported += chunk.tracks.size();
+        auto& tracks = out();
+        if (tracks.empty() && tracks.capacity() <= chunk.tracks.capacity()) {
+            tracks = std::move(chunk.tracks);
+        } else {
+            tracks.insert(tracks.end(), std::make_move_iterator(chunk.tracks.begin()),
+                          std::make_move_iterator(chunk.tracks.end()));
+        }
+        chunk.tracks = {};
+        if (!stopped_) {
+            progress_.checkpoint.byte_offset = chunk.end;
+            progress_.checkpoint.lines_read = lines_before + chunk.line_count;
+        }
+        return !stopped_;
+    }
+    
+    // Hands the tracks joined since the last checkpoint to batch_callback
+    // and reports the checkpoint; at_end once the whole text is read
+    void report(bool at_end) {
+        if (at_end && !stopped_) {
+            progress_.checkpoint.byte_offset = std::max(progress_.total_bytes, resumed_bytes_);
+        }
+        progress_.total_bytes = std::max(progress_.total_bytes, progress_.checkpoint.byte_offset);
+        progress_.elapsed_seconds = seconds_since(started_);
+        progress_.bytes_read = progress_.checkpoint.byte_offset - resumed_bytes_;
+        if (options_.batch_callback && !batch_.empty()) {
+            options_.batch_callback(std::move(batch_));
+            batch_.clear();
+        }
+        if (options_.checkpoint_callback) {
+            options_.checkpoint_callback(progress_);
+        }
+        if (options_.progress_callback) {
+            options_.progress_callback(progress_.checkpoint.byte_offset, progress_.total_bytes);
+        }
+    }
+    
+    std::vector<Track> take_tracks() { return std::move(tracks_); }
+    
+private:
+    const ImportOptions& options_;
+    std::chrono::steady_clock::time_point started_;
+    ImportProgress progress_;
+    size_t resumed_bytes_ = 0;
+    size_t error_count_ = 0;
+    bool stopped_ = false;
+    std::vector<Track> tracks_; // The result
+    std::vector<Track> batch_;  // For batch_callback
+    
+    std::vector<Track>& out() { return options_.batch_callback ? batch_ : tracks_; }
+    const std::vector<Track>& out() const { return options_.batch_callback ? batch_ : tracks_; }
+};
+
+std::vector<Track> FileIO::import_csv(const std::filesystem::path& path, 
+                                     const ImportOptions& options) {
+    return import_records<CsvReader>(path, options);
+}
+
+std::vector<Track> FileIO::import_tsv(const std::filesystem::path& path,
+                                     const ImportOptions& options) {
+    return import_records<TsvReader>(path, options);
+}
+
+template <typename Reader>
+std::vector<Track> FileIO::import_records(const std::filesystem::path& path, const ImportOptions& options) {
+    MappedFile mapping;
+    std::string content;
+    std::string_view text;
+    if (!view_file(path, mapping, content, text)) {
         if (options.error_callback) {
             options.error_callback("Cannot open file: " + path.string(), 0);
         }
-        return tracks;
+        return {};
     }
     
-    std::string line;
-    size_t line_number = 0;
-    size_t error_count = 0;
+    const Compression compression = detect_compression(text);
+    if (compression != Compression::kNone) {
+        ImportRun run(options, Decompressor::expected_size(text, compression), options.resume_from.byte_offset);
+        import_compressed<Reader>(text, compression, options, run);
+        return run.take_tracks();
+    }
     
-    // Check if first line is a header
-    if (std::getline(file, line)) {
-        ++line_number;
+    ImportRun run(options, text.size(), std::min(options.resume_from.byte_offset, text.size()));
+    if (options.pipelined) {
+        import_pipelined<Reader>(text, options, run);
+    } else {
+        import_windows<Reader>(text, options, run);
+    }
+    return run.take_tracks();
+}
+
+template <typename Reader>
+void FileIO::import_windows(std::string_view text, const ImportOptions& options, ImportRun& run) {
+    size_t max_threads = options.thread_count;
+    if (max_threads == 0) {
+        max_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    
+    // The file is imported one window of checkpoint_interval bytes at a
+    // time, each ending with a checkpoint
+    for (size_t window_begin = run.resumed_bytes(); window_begin < text.size() && !run.stopped();) {
+        const size_t window_limit = options.checkpoint_interval == 0 ||
+                                    text.size() - window_begin <= options.checkpoint_interval
+            ? text.size() : std::max(window_begin + 1, record_start<Reader>(text, window_begin + options.checkpoint_interval));
+        const size_t window_size = window_limit - window_begin;
+        const size_t thread_count = std::max<size_t>(1, std::min(max_threads, window_size / kMinBytesPerImportThread));
+        
+        // Each chunk starts at a guessed record boundary. The chunks are
+        // parsed in parallel, then joined in order: a chunk that did not
+        // start where the one before ended, because a quoted field crossed
+        // the guess, is parsed again from there.
+        std::vector<RecordChunk> chunks(thread_count);
+        chunks[0].begin = window_begin;
+        for (size_t c = 1; c < thread_count; ++c) {
+            chunks[c].begin = std::max(chunks[c - 1].begin,
+                                       record_start<Reader>(text, window_begin + window_size / thread_count * c));
+            chunks[c - 1].limit = chunks[c].begin;
+        }
+        chunks.back().limit = window_limit;
+        
+        if (thread_count == 1) {
+            parse_chunk<Reader>(text, options, chunks[0]);
+        } else {
+            // Progress is reported in bytes as the chunks are joined instead
+            ImportOptions chunk_options = options;
+            chunk_options.progress_callback = nullptr;
+            chunk_options.error_callback = nullptr;
+            run_parallel(thread_count, [&](size_t c) { parse_chunk<Reader>(text, chunk_options, chunks[c]); });
+        }
         
-        // Simple heuristic: if the third field is not a number, it's likely a header
-        auto fields = split_csv_line(line);
-        if (fields.size() >= 3) {
+        if (thread_count > 1 || run.has_tracks()) {
+            // Grow for the rest of the file at this window's density
+            size_t track_count = 0;
+            for (const auto& chunk : chunks) track_count += chunk.tracks.size();
+            const double tracks_per_byte = static_cast<double>(track_count) / static_cast<double>(window_size);
+            run.make_room(track_count, static_cast<size_t>(static_cast<double>(text.size() - window_begin) * tracks_per_byte * 1.125));
+        }
+        
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            RecordChunk& chunk = chunks[c];
+            if (c > 0 && chunk.begin != chunks[c - 1].end) {
+                chunk.begin = chunks[c - 1].end;
+                ImportOptions chunk_options = options;
+                chunk_options.progress_callback = nullptr;
+                parse_chunk<Reader>(text, chunk_options, chunk);
+            }
+            if (!run.join(chunk)) {
+                break;
+            }
+            if (options.progress_callback && thread_count > 1) {
+                options.progress_callback(chunk.end, text.size());
+            }
+        }
+        
+        window_begin = window_limit == text.size() ? text.size() : run.checkpoint().byte_offset;
+        run.report(window_begin == text.size());
+    }
+}
+
+template <typename Read, typename Parse, typename CloseInput>
+void FileIO::run_pipeline(const ImportOptions& options, ImportRun& run, Read read, Parse parse,
+                          CloseInput close_input) {
+    PipelineStats stats;
+    stats.stages[0].name = "read";
+    stats.stages[1].name = "parse";
+    stats.stages[2].name = "validate";
+    stats.stages[3].name = "deliver";
+    const auto started = std::chrono::steady_clock::now();
+    
+    BoundedQueue<RecordChunk> parsed(kPipelineDepth);
+    BoundedQueue<RecordChunk> validated(kPipelineDepth);
+    std::atomic<bool> cancelled{false};
+    auto stop = [&]() {
+        cancelled = true;
+        close_input();
+        parsed.close();
+        validated.close();
+    };
+    
+    // A stage that throws stops the others; the first exception is
+    // rethrown on the calling thread once they have ended
+    std::mutex failure_mutex;
+    std::exception_ptr failure;
+    auto guarded = [&](auto step) {
+        return [&, step]() {
             try {
-                std::stoi(fields[2]);
-                // It's a data line, process it
-                file.seekg(0);
-                line_number = 0;
+                step();
             } catch (...) {
-                // It's a header, skip it
+                std::lock_guard<std::mutex> lock(failure_mutex);
+                if (!failure) failure = std::current_exception();
+                stop();
+            }
+        };
+    };
+    
+    {
+        StageThreads stages{stop, {}};
+        stages.threads.reserve(3);
+        stages.threads.emplace_back(guarded([&]() { read(stats.stages[0], cancelled); }));
+        stages.threads.emplace_back(guarded([&]() {
+            parse(stats.stages[1], parsed);
+            parsed.close();
+        }));
+        stages.threads.emplace_back(guarded([&]() {
+            auto& stage = stats.stages[2];
+            RecordChunk chunk;
+            while (timed(stage.input_wait_seconds, [&]() { return parsed.pop(chunk); })) {
+                ++stage.batches;
+                if (options.validate_data) {
+                    timed(stage.busy_seconds, [&]() { validate_chunk(chunk); return true; });
+                }
+                if (!timed(stage.output_wait_seconds, [&]() { return validated.push(std::move(chunk)); })) {
+                    break;
+                }
+            }
+            validated.close();
+        }));
+        
+        // Deliver on the calling thread, in file order
+        auto& stage = stats.stages[3];
+        RecordChunk chunk;
+        while (timed(stage.input_wait_seconds, [&]() { return validated.pop(chunk); })) {
+            ++stage.batches;
+            const bool more = timed(stage.busy_seconds, [&]() {
+                if (chunk.at_end) {
+                    run.set_total_bytes(std::max(chunk.end, chunk.limit));
+                }
+                const bool joined = run.join(chunk);
+                run.report(joined && chunk.at_end);
+                return joined;
+            });
+            if (!more) {
+                break;
             }
         }
     }
     
-    // Process data lines
-    while (std::getline(file, line)) {
-        ++line_number;
-        
-        if (options.progress_callback && line_number % 100 == 0) {
-            options.progress_callback(line_number, 0); // Total unknown for streaming
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    stats.elapsed_seconds = seconds_since(started);
+    if (options.pipeline_stats) {
+        *options.pipeline_stats = stats;
+    }
+}
+
+template <typename Reader>
+void FileIO::import_pipelined(std::string_view text, const ImportOptions& options, ImportRun& run) {
+    const size_t batch_bytes = options.checkpoint_interval == 0 ? kPipelineBatchBytes
+        : std::min(kPipelineBatchBytes, options.checkpoint_interval);
+    BoundedQueue<size_t> loaded(kPipelineDepth); // Offsets read up to
+    
+    // Read ahead: touch every page of the next stretch of the text, so that
+    // a mapped file is loaded here rather than when it is parsed
+    auto read = [&](PipelineStageStats& stage, const std::atomic<bool>& cancelled) {
+        const size_t page = 4096;
+        unsigned char sum = 0;
+        for (size_t begin = run.resumed_bytes(); begin < text.size() && !cancelled; ++stage.batches) {
+            const size_t end = std::min(text.size(), begin + batch_bytes);
+            sum += timed(stage.busy_seconds, [&]() {
+                unsigned char touched = 0;
+                for (size_t i = begin; i < end; i += page) touched ^= static_cast<unsigned char>(text[i]);
+                return touched;
+            });
+            size_t offset = end;
+            if (!timed(stage.output_wait_seconds, [&]() { return loaded.push(std::move(offset)); })) {
+                break;
+            }
+            begin = end;
         }
-        
-        auto track_opt = Track::from_csv_line(line);
-        
-        if (track_opt) {
-            if (!options.validate_data || validate_track_data(*track_opt)) {
-                tracks.push_back(std::move(*track_opt));
+        loaded.close();
+        // Keeps the reads from being optimized away
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        static_cast<void>(sum);
+    };
+    
+    // Parse record-aligned batches of the text read so far. Validation is
+    // left to the next stage.
+    ImportOptions parse_options = options;
+    parse_options.validate_data = false;
+    parse_options.progress_callback = nullptr;
+    parse_options.error_callback = nullptr;
+    auto parse = [&](PipelineStageStats& stage, BoundedQueue<RecordChunk>& parsed) {
+        size_t available = run.resumed_bytes();
+        for (size_t begin = run.resumed_bytes(); begin < text.size(); ++stage.batches) {
+            while (available <= begin && available < text.size()) {
+                if (!timed(stage.input_wait_seconds, [&]() { return loaded.pop(available); })) {
+                    available = text.size(); // Read ahead stopped; parse without it
+                }
+            }
+            RecordChunk chunk;
+            chunk.begin = begin;
+            chunk.limit = std::min(available, begin + batch_bytes);
+            chunk.record_positions = options.validate_data;
+            timed(stage.busy_seconds, [&]() { parse_chunk<Reader>(text, parse_options, chunk); return true; });
+            begin = std::max(chunk.end, chunk.limit);
+            chunk.at_end = begin >= text.size();
+            if (!timed(stage.output_wait_seconds, [&]() { return parsed.push(std::move(chunk)); })) {
+                break;
+            }
+        }
+        loaded.close();
+    };
+    
+    run_pipeline(options, run, read, parse, [&]() { loaded.close(); });
+}
+
+template <typename Reader>
+void FileIO::import_compressed(std::string_view input, Compression compression, const ImportOptions& options,
+                               ImportRun& run) {
+    const size_t batch_bytes = options.checkpoint_interval == 0 ? kPipelineBatchBytes
+        : std::min(kPipelineBatchBytes, options.checkpoint_interval);
+    BoundedQueue<std::string> blocks(kPipelineDepth);
+    Decompressor decompressor(compression);
+    std::atomic<bool> decompressed{false};
+    
+    // Decompress in place of reading ahead
+    auto read = [&](PipelineStageStats& stage, const std::atomic<bool>& cancelled) {
+        stage.name = "decompress";
+        const auto started = std::chrono::steady_clock::now();
+        decompressed = decompressor.run(input, [&](std::string&& block) {
+            ++stage.batches;
+            return !cancelled && timed(stage.output_wait_seconds, [&]() { return blocks.push(std::move(block)); });
+        });
+        stage.busy_seconds = seconds_since(started) - stage.output_wait_seconds;
+        blocks.close();
+    };
+    
+    // Parse batches from a buffer holding what is decompressed but not yet
+    // parsed. A batch whose last record runs to the end of the buffer is
+    // handed on without it, as the record may go on. A batch of that record
+    // alone is parsed again once twice as much of it is in, so that a long
+    // record costs time linear in its length, up to kMaxRecordBytes.
+    ImportOptions parse_options = options;
+    parse_options.validate_data = false;
+    parse_options.progress_callback = nullptr;
+    parse_options.error_callback = nullptr;
+    auto parse = [&](PipelineStageStats& stage, BoundedQueue<RecordChunk>& parsed) {
+        std::string buffer;
+        size_t base = 0; // Offset of buffer in the decompressed text
+        bool finished = false;
+        auto fill = [&]() {
+            std::string block;
+            if (timed(stage.input_wait_seconds, [&]() { return blocks.pop(block); })) {
+                buffer += block;
             } else {
-                ++error_count;
-                if (options.error_callback) {
-                    options.error_callback("Invalid track data at line " + 
-                                         std::to_string(line_number), line_number);
+                finished = true;
+                if (!decompressed) {
+                    // Drop the line cut off where the data went bad
+                    const size_t line_end = buffer.rfind('\n');
+                    buffer.erase(line_end == std::string::npos ? 0 : line_end + 1);
                 }
             }
-        } else if (!options.skip_invalid_lines) {
-            ++error_count;
-            if (options.error_callback) {
-                options.error_callback("Failed to parse line " + 
-                                     std::to_string(line_number) + ": " + line, line_number);
+        };
+        
+        for (size_t begin = run.resumed_bytes();;) {
+            // Drop what is parsed, keeping a margin past the batch so that
+            // records crossing its end are whole
+            const size_t consumed = std::min(begin - base, buffer.size());
+            buffer.erase(0, consumed);
+            base += consumed;
+            while (!finished && base + buffer.size() < begin + batch_bytes + batch_bytes / 4) {
+                fill();
+                if (base + buffer.size() < begin) {
+                    base += buffer.size(); // Skipped to resume further on
+                    buffer.clear();
+                }
+            }
+            if (begin >= base + buffer.size()) {
+                break;
+            }
+            
+            RecordChunk chunk;
+            chunk.base = base;
+            chunk.begin = begin - base;
+            chunk.limit = std::min(buffer.size(), chunk.begin + batch_bytes);
+            chunk.record_positions = options.validate_data;
+            timed(stage.busy_seconds, [&]() { parse_chunk<Reader>(buffer, parse_options, chunk); return true; });
+            if (chunk.end >= buffer.size() && !finished) {
+                if (chunk.last_record > chunk.begin) {
+                    chunk.limit = chunk.last_record;
+                    timed(stage.busy_seconds, [&]() { parse_chunk<Reader>(buffer, parse_options, chunk); return true; });
+                } else if (buffer.size() - chunk.begin <= kMaxRecordBytes) {
+                    const size_t wanted = chunk.begin + std::min(2 * (buffer.size() - chunk.begin),
+                                                                 kMaxRecordBytes + 1);
+                    while (!finished && buffer.size() < wanted) {
+                        fill();
+                    }
+                    continue;
+                } else {
+                    skip_overlong_record(buffer, chunk);
+                }
+            }
+            
+            chunk.begin += base;
+            chunk.limit += base;
+            chunk.end += base;
+            chunk.base = 0;
+            begin = std::max(chunk.end, chunk.limit);
+            chunk.at_end = finished && decompressed && begin >= base + buffer.size();
+            ++stage.batches;
+            if (!timed(stage.output_wait_seconds, [&]() { return parsed.push(std::move(chunk)); })) {
+                break;
+            }
+        }
+        blocks.close();
+    };
+    
+    run_pipeline(options, run, read, parse, [&]() { blocks.close(); });
+    
+    if (!decompressed && options.error_callback) {
+        options.error_callback(decompressor.error(), run.checkpoint().lines_read);
+    }
+}
+
+const char* FileIO::ValidationReport::problem_name(Problem problem) noexcept {
+    switch (problem) {
+        case Problem::kUnparsable: return "unparsable";
+        case Problem::kMissingTitle: return "missing title";
+        case Problem::kMissingArtist: return "missing artist";
+        case Problem::kBadDuration: return "bad duration";
+        case Problem::kBadYear: return "bad year";
+    }
+    return "unknown";
+}
+
+// Counts from checking the records starting in [begin, limit), with line
+// numbers counted from the chunk's first line
+struct FileIO::ValidationChunk {
+    size_t begin = 0;
+    size_t limit = 0;
+    size_t end = 0;
+    size_t line_count = 0;
+    size_t records = 0;
+    size_t valid_records = 0;
+    std::array<size_t, ValidationReport::kProblemCount> problem_counts{};
+    std::array<std::vector<size_t>, ValidationReport::kProblemCount> sample_lines{};
+};
+
+template <typename Reader>
+void FileIO::check_chunk(std::string_view text, ValidationChunk& chunk) {
+    chunk.records = 0;
+    chunk.valid_records = 0;
+    chunk.problem_counts = {};
+    for (auto& lines : chunk.sample_lines) lines.clear();
+    
+    const size_t limit = chunk.limit > chunk.begin ? chunk.limit - chunk.begin : 0;
+    Reader reader(text.substr(chunk.begin));
+    std::vector<std::string_view> fields;
+    bool first_record = chunk.begin == 0;
+    while (reader.position() < limit && reader.next_record(fields)) {
+        // A header, as parse_chunk tells it
+        if (first_record) {
+            first_record = false;
+            int duration = 0;
+            if (fields.size() >= 3 && !parse_csv_number(fields[2], duration)) {
+                continue;
             }
-        } else {
-            ++error_count;
         }
         
-        if (error_count >= options.max_errors) {
-            if (options.error_callback) {
-                options.error_callback("Too many errors, stopping import", line_number);
+        ++chunk.records;
+        const auto problem = check_record(fields);
+        if (!problem) {
+            ++chunk.valid_records;
+            continue;
+        }
+        const auto index = static_cast<size_t>(*problem);
+        ++chunk.problem_counts[index];
+        if (chunk.sample_lines[index].size() < ValidationReport::kSampleLines) {
+            chunk.sample_lines[index].push_back(reader.line_number());
+        }
+    }
+    chunk.end = chunk.begin + reader.position();
+    chunk.line_count = reader.lines_read();
+}
+
+FileIO::ValidationReport FileIO::validate_csv_file(const std::filesystem::path& path, size_t thread_count) {
+    return validate_records<CsvReader>(path, thread_count);
+}
+
+FileIO::ValidationReport FileIO::validate_tsv_file(const std::filesystem::path& path, size_t thread_count) {
+    return validate_records<TsvReader>(path, thread_count);
+}
+
+template <typename Reader>
+FileIO::ValidationReport FileIO::validate_records(const std::filesystem::path& path, size_t thread_count) {
+    const auto started = std::chrono::steady_clock::now();
+    ValidationReport report;
+    MappedFile mapping;
+    std::string content;
+    std::string_view text;
+    if (!view_file(path, mapping, content, text)) {
+        report.error = "Cannot open file: " + path.string();
+        return report;
+    }
+    
+    const Compression compression = detect_compression(text);
+    std::string decompressed;
+    if (compression != Compression::kNone) {
+        Decompressor decompressor(compression);
+        decompressed.reserve(Decompressor::expected_size(text, compression));
+        if (!decompressor.run(text, [&decompressed](std::string&& block) {
+                decompressed += block;
+                return true;
+            })) {
+            // What came before the fault is still checked, but for the line
+            // it cut off
+            report.error = decompressor.error();
+            const size_t line_end = decompressed.rfind('\n');
+            decompressed.erase(line_end == std::string::npos ? 0 : line_end + 1);
+        }
+        text = decompressed;
+    }
+    report.bytes = text.size();
+    
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    thread_count = std::max<size_t>(1, std::min(thread_count, text.size() / kMinBytesPerImportThread));
+    
+    // Chunks are split and joined as import_windows does it
+    std::vector<ValidationChunk> chunks(thread_count);
+    for (size_t c = 1; c < thread_count; ++c) {
+        chunks[c].begin = std::max(chunks[c - 1].begin, record_start<Reader>(text, text.size() / thread_count * c));
+        chunks[c - 1].limit = chunks[c].begin;
+    }
+    chunks.back().limit = text.size();
+    run_parallel(thread_count, [&](size_t c) { check_chunk<Reader>(text, chunks[c]); });
+    
+    size_t lines_before = 0;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        ValidationChunk& chunk = chunks[c];
+        if (c > 0 && chunk.begin != chunks[c - 1].end) {
+            chunk.begin = chunks[c - 1].end;
+            check_chunk<Reader>(text, chunk);
+        }
+        report.records += chunk.records;
+        report.valid_records += chunk.valid_records;
+        for (size_t p = 0; p < ValidationReport::kProblemCount; ++p) {
+            report.problem_counts[p] += chunk.problem_counts[p];
+            auto& samples = report.sample_lines[p];
+            for (size_t line : chunk.sample_lines[p]) {
+                if (samples.size() == ValidationReport::kSampleLines) break;
+                samples.push_back(lines_before + line);
             }
-            break;
         }
+        lines_before += chunk.line_count;
     }
     
-    return tracks;
+    report.elapsed_seconds = seconds_since(started);
+    return report;
 }
 
 bool FileIO::export_csv(const std::filesystem::path& path, 
@@ -133,108 +981,237 @@ bool FileIO::export_csv(const std::filesystem::path& path,
     return export_csv(path, track_copies, options);
 }
 
+bool FileIO::export_tsv(const std::filesystem::path& path,
+                       const std::vector<Track>& tracks,
+                       const ExportOptions& options) {
+    std::ofstream file(path);
+    
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    file << std::fixed << std::setprecision(1);
+    size_t count = 0;
+    for (const auto& track : tracks) {
+        file << tsv_field(track.title()) << '\t'
+             << tsv_field(track.artist()) << '\t'
+             << track.duration_seconds();
+        if (options.include_metadata) {
+            file << '\t' << tsv_field(track.album())
+                 << '\t' << tsv_field(track.genre())
+                 << '\t' << track.year()
+                 << '\t' << track.play_count()
+                 << '\t' << track.rating();
+        }
+        file << '\n';
+        
+        ++count;
+        if (options.progress_callback && count % 100 == 0) {
+            options.progress_callback(count, tracks.size());
+        }
+    }
+    
+    return file.good();
+}
+
+bool FileIO::export_tsv(const std::filesystem::path& path,
+                       const std::vector<TrackPtr>& tracks,
+                       const ExportOptions& options) {
+    std::vector<Track> track_copies;
+    track_copies.reserve(tracks.size());
+    
+    for (const auto& ptr : tracks) {
+        if (ptr) {
+            track_copies.push_back(*ptr);
+        }
+    }
+    
+    return export_tsv(path, track_copies, options);
+}
+
 std::vector<Track> FileIO::import_json(const std::filesystem::path& path,
                                       const ImportOptions& options) {
     std::vector<Track> tracks;
-    std::ifstream file(path);
     
-    if (!file.is_open()) {
+    MappedFile mapping;
+    std::string content;
+    std::string_view text;
+    if (!view_file(path, mapping, content, text)) {
         if (options.error_callback) {
             options.error_callback("Cannot open file: " + path.string(), 0);
         }
         return tracks;
     }
     
-    std::string content((std::istreambuf_iterator<char>(file)),
-                       std::istreambuf_iterator<char>());
+    // Tracks are read one array element at a time from a window on the
+    // text: the whole file, or for a compressed file what has been
+    // decompressed, on a thread of its own, but not yet read
+    const Compression compression = detect_compression(text);
+    std::string_view window = text;
+    size_t base = 0;        // Offset of the window in the text
+    size_t at = 0;          // Next unread byte of the window
+    size_t total_bytes = text.size();
+    bool finished = true;
+    std::string buffer;
+    BoundedQueue<std::string> blocks(kPipelineDepth);
+    Decompressor decompressor(compression);
+    std::atomic<bool> decompressed{true};
+    std::thread decompressing;
+    if (compression != Compression::kNone) {
+        window = {};
+        total_bytes = Decompressor::expected_size(text, compression);
+        finished = false;
+        decompressing = std::thread([&]() {
+            decompressed = decompressor.run(text, [&blocks](std::string&& block) {
+                return blocks.push(std::move(block));
+            });
+            blocks.close();
+        });
+    }
+    struct Stop {
+        BoundedQueue<std::string>& blocks;
+        std::thread& thread;
+        ~Stop() {
+            blocks.close();
+            if (thread.joinable()) thread.join();
+        }
+    } stop{blocks, decompressing};
     
-    // Simple JSON array parser
-    size_t pos = content.find('[');
-    if (pos == std::string::npos) {
-        if (options.error_callback) {
-            options.error_callback("Invalid JSON format: no array found", 0);
+    // Lines are only counted up to where errors are reported, or the
+    // window moves past
+    size_t line_number = 1;
+    size_t counted = 0;
+    auto line_at = [&](size_t offset) {
+        line_number += static_cast<size_t>(std::count(window.data() + (counted - base), window.data() + (offset - base), '\n'));
+        counted = offset;
+        return line_number;
+    };
+    
+    // Moves the window up to `at` and takes in the next block; false at
+    // the end of the text
+    auto more = [&]() {
+        if (finished) {
+            return false;
         }
-        return tracks;
-    }
+        line_at(base + at);
+        buffer.erase(0, at);
+        base += at;
+        at = 0;
+        std::string block;
+        if (blocks.pop(block)) {
+            buffer += block;
+        } else {
+            finished = true;
+        }
+        window = buffer;
+        if (base == 0 && window.substr(0, 3) == "\xEF\xBB\xBF") {
+            at = 3; // Byte order mark
+        }
+        return true;
+    };
+    auto skip_space = [&]() {
+        do {
+            while (at < window.size() && is_json_space(window[at])) ++at;
+        } while (at == window.size() && more());
+    };
     
-    size_t end = content.rfind(']');
-    if (end == std::string::npos || end <= pos) {
+    JsonReader reader(window);
+    at = reader.position();
+    skip_space();
+    if (at == window.size() || window[at] != '[') {
         if (options.error_callback) {
-            options.error_callback("Invalid JSON format: array not closed", 0);
+            options.error_callback("Invalid JSON format: no array found", 0);
         }
         return tracks;
     }
+    ++at;
     
-    // Extract objects from array
-    size_t obj_start = pos + 1;
     size_t error_count = 0;
-    size_t track_count = 0;
-    
-    while (obj_start < end) {
-        // Skip whitespace
-        while (obj_start < end && std::isspace(content[obj_start])) {
-            ++obj_start;
+    bool failed = false;
+    for (bool first = true;; first = false) {
+        skip_space();
+        if (at < window.size() && window[at] == ']') {
+            break;
+        }
+        if (!first) {
+            if (at == window.size() || window[at] != ',') {
+                failed = true;
+                break;
+            }
+            ++at;
+            skip_space();
         }
         
-        if (obj_start >= end) break;
-        
-        // Find object boundaries
-        if (content[obj_start] == '{') {
-            int brace_count = 1;
-            size_t obj_end = obj_start + 1;
-            
-            while (obj_end < end && brace_count > 0) {
-                if (content[obj_end] == '{') ++brace_count;
-                else if (content[obj_end] == '}') --brace_count;
-                ++obj_end;
+        // An element cut off by the end of the window is read again once
+        // more of the text is in
+        bool is_object = false;
+        std::optional<Track> track_opt;
+        for (;;) {
+            reader.reset(window.substr(at));
+            is_object = reader.peek() == JsonReader::Type::kObject;
+            track_opt.reset();
+            if (is_object) {
+                track_opt = Track::from_json_object(reader);
+            } else {
+                reader.skip_value();
             }
-            
-            if (brace_count == 0) {
-                std::string json_obj = content.substr(obj_start, obj_end - obj_start);
-                auto track_opt = Track::from_json(json_obj);
-                
-                if (track_opt) {
-                    if (!options.validate_data || validate_track_data(*track_opt)) {
-                        tracks.push_back(std::move(*track_opt));
-                        ++track_count;
-                        
-                        if (options.progress_callback && track_count % 100 == 0) {
-                            options.progress_callback(track_count, 0);
-                        }
-                    } else {
-                        ++error_count;
-                        if (options.error_callback) {
-                            options.error_callback("Invalid track data in JSON", track_count);
-                        }
-                    }
-                } else if (!options.skip_invalid_lines) {
-                    ++error_count;
-                    if (options.error_callback) {
-                        options.error_callback("Failed to parse JSON object", track_count);
-                    }
-                } else {
-                    ++error_count;
-                }
-                
-                if (error_count >= options.max_errors) {
-                    if (options.error_callback) {
-                        options.error_callback("Too many errors, stopping import", track_count);
-                    }
-                    break;
-                }
+            size_t after = at + reader.position();
+            while (after < window.size() && is_json_space(window[after])) ++after;
+            if ((!reader.failed() && after < window.size()) || window.size() - at > kMaxJsonElementBytes ||
+                !more()) {
+                break;
+            }
+        }
+        const size_t object_begin = base + at;
+        at += reader.position();
+        if (reader.failed()) {
+            failed = true;
+            break;
+        }
+        
+        if (track_opt) {
+            if (!options.validate_data || validate_track_data(*track_opt)) {
+                tracks.push_back(std::move(*track_opt));
                 
-                // Move to next object
-                obj_start = obj_end;
-                while (obj_start < end && (std::isspace(content[obj_start]) || 
-                                         content[obj_start] == ',')) {
-                    ++obj_start;
+                if (options.progress_callback && tracks.size() % 100 == 0) {
+                    options.progress_callback(base + at, std::max(total_bytes, base + at));
                 }
-            } else {
-                break; // Malformed JSON
+                continue;
+            }
+            ++error_count;
+            if (options.error_callback) {
+                const size_t line = line_at(object_begin);
+                options.error_callback("Invalid track data in JSON at line " + std::to_string(line), line);
             }
         } else {
-            break; // Not an object
+            ++error_count;
+            if (options.error_callback) {
+                const size_t line = line_at(object_begin);
+                options.error_callback("Failed to parse JSON object at line " + std::to_string(line), line);
+            }
+            if (!options.skip_invalid_lines) {
+                break;
+            }
         }
+        
+        if (error_count >= options.max_errors) {
+            if (options.error_callback) {
+                options.error_callback("Too many errors, stopping import", line_at(object_begin));
+            }
+            break;
+        }
+    }
+    
+    if (failed && options.error_callback) {
+        const size_t line = line_at(base + std::min(at, window.size()));
+        options.error_callback("Invalid JSON format at line " + std::to_string(line), line);
+    }
+    blocks.close();
+    if (decompressing.joinable()) {
+        decompressing.join();
+    }
+    if (!decompressed && options.error_callback) {
+        options.error_callback(decompressor.error(), line_at(base + window.size()));
     }
     
     return tracks;
@@ -355,11 +1332,12 @@ bool FileIO::export_playlist(const std::filesystem::path& path,
 }
 
 bool FileIO::validate_csv_format(const std::filesystem::path& path) {
-    std::ifstream file(path);
-    
-    if (!file.is_open()) {
-        return false;
-    }
+    std::string head;
+    return read_head(path, head) && is_csv_head(head);
+}
+
+bool FileIO::is_csv_head(const std::string& head) {
+    std::istringstream file(head);
     
     std::string line;
     if (!std::getline(file, line)) {
@@ -410,13 +1388,50 @@ bool FileIO::validate_csv_format(const std::filesystem::path& path) {
     return true;
 }
 
-bool FileIO::validate_json_format(const std::filesystem::path& path) {
-    std::ifstream file(path);
+bool FileIO::validate_tsv_format(const std::filesystem::path& path) {
+    std::string head;
+    return read_head(path, head) && is_tsv_head(head);
+}
+
+bool FileIO::is_tsv_head(const std::string& head) {
+    std::istringstream file(head);
     
-    if (!file.is_open()) {
+    std::string line;
+    if (!std::getline(file, line)) {
+        return false;
+    }
+    
+    std::vector<std::string_view> fields;
+    TsvReader reader(line);
+    if (!reader.next_record(fields) || fields.size() < 3) {
         return false;
     }
     
+    if (Track::from_csv_fields(fields)) {
+        return true;
+    }
+    
+    // Otherwise a header naming the first three fields
+    const char* const headers[] = {"title", "artist", "duration"};
+    for (size_t i = 0; i < 3; ++i) {
+        std::string lower_field(fields[i]);
+        std::transform(lower_field.begin(), lower_field.end(), lower_field.begin(), ::tolower);
+        if (lower_field.find(headers[i]) == std::string::npos) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool FileIO::validate_json_format(const std::filesystem::path& path) {
+    std::string head;
+    return read_head(path, head) && is_json_head(head);
+}
+
+bool FileIO::is_json_head(const std::string& head) {
+    std::istringstream file(head);
+    
     // Simple JSON validation - check for array brackets and at least one object
     char ch;
     bool found_array_start = false;
@@ -438,28 +1453,50 @@ bool FileIO::validate_json_format(const std::filesystem::path& path) {
 }
 
 std::optional<std::string> FileIO::detect_file_format(const std::filesystem::path& path) {
-    // Check extension first
-    auto ext = path.extension().string();
-    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    // Check extension first, the one before .gz or .zst for compressed files
+    auto lower_extension = [](const std::filesystem::path& name) {
+        auto ext = name.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        return ext;
+    };
+    auto ext = lower_extension(path);
+    if (ext == ".gz" || ext == ".zst" || ext == ".zstd") {
+        ext = lower_extension(path.stem());
+    }
+    if (ext == ".m3u" || ext == ".m3u8") {
+        return "m3u";
+    }
     
-    if (ext == ".csv" || ext == ".txt") {
-        if (validate_csv_format(path)) {
+    // The start of the file is read once for all the checks
+    std::string head;
+    if (!read_head(path, head)) {
+        return std::nullopt;
+    }
+    if (ext == ".csv") {
+        if (is_csv_head(head)) {
             return "csv";
         }
+    } else if (ext == ".tsv" || ext == ".tab") {
+        if (is_tsv_head(head)) {
+            return "tsv";
+        }
     } else if (ext == ".json") {
-        if (validate_json_format(path)) {
+        if (is_json_head(head)) {
             return "json";
         }
-    } else if (ext == ".m3u" || ext == ".m3u8") {
-        return "m3u";
     }
     
-    // Try content-based detection
-    if (validate_json_format(path)) {
+    // Try content-based detection. TSV goes before CSV, as commas in a
+    // title or artist could make a tab-separated line pass for CSV.
+    if (is_json_head(head)) {
         return "json";
     }
     
-    if (validate_csv_format(path)) {
+    if (is_tsv_head(head)) {
+        return "tsv";
+    }
+    
+    if (is_csv_head(head)) {
         return "csv";
     }
     
@@ -467,46 +1504,12 @@ std::optional<std::string> FileIO::detect_file_format(const std::filesystem::pat
 }
 
 std::vector<std::string> FileIO::split_csv_line(const std::string& line) {
-    std::vector<std::string> fields;
-    std::string current_field;
-    bool in_quotes = false;
-    bool quote_escaped = false;
-    
-    for (size_t i = 0; i < line.length(); ++i) {
-        char c = line[i];
-        
-        if (quote_escaped) {
-            if (c == '"') {
-                current_field += '"';
-            } else {
-                in_quotes = false;
-                --i;
-            }
-            quote_escaped = false;
-        } else if (in_quotes) {
-            if (c == '"') {
-                if (i + 1 < line.length() && line[i + 1] == '"') {
-                    quote_escaped = true;
-                } else {
-                    in_quotes = false;
-                }
-            } else {
-                current_field += c;
-            }
-        } else {
-            if (c == '"' && current_field.empty()) {
-                in_quotes = true;
-            } else if (c == ',') {
-                fields.push_back(current_field);
-                current_field.clear();
-            } else {
-                current_field += c;
-            }
-        }
+    std::vector<std::string_view> views;
+    CsvReader reader(line);
+    if (!reader.next_record(views)) {
+        return {""};
     }
-    
-    fields.push_back(current_field);
-    return fields;
+    return std::vector<std::string>(views.begin(), views.end());
 }
 
 std::string FileIO::escape_csv_field(const std::string& field) {
@@ -523,25 +1526,39 @@ std::string FileIO::escape_csv_field(const std::string& field) {
 }
 
 bool FileIO::validate_track_data(const Track& track) {
+    // Ratings need no check: Track::set_rating keeps them in range
+    return !check_track_fields(track.title(), track.artist(), track.duration_seconds(), track.year());
+}
+
+std::optional<FileIO::ValidationReport::Problem> FileIO::check_track_fields(
+    std::string_view title, std::string_view artist, int duration, int year) {
+    using Problem = ValidationReport::Problem;
     // Basic validation rules
-    if (track.title().empty() || track.artist().empty()) {
-        return false;
+    if (title.empty()) {
+        return Problem::kMissingTitle;
     }
-    
-    if (track.duration_seconds() <= 0 || track.duration_seconds() > 36000) { // Max 10 hours
-        return false;
+    if (artist.empty()) {
+        return Problem::kMissingArtist;
     }
     
-    if (track.year() < 0 || (track.year() > 0 && track.year() < 1900) || 
-        track.year() > 2100) {
-        return false;
+    if (duration <= 0 || duration > 36000) { // Max 10 hours
+        return Problem::kBadDuration;
     }
     
-    if (track.rating() < 0.0 || track.rating() > 5.0) {
-        return false;
+    if (year < 0 || (year > 0 && year < 1900) || year > 2100) {
+        return Problem::kBadYear;
     }
     
-    return true;
+    return std::nullopt;
+}
+
+// Track::from_csv_fields followed by validate_track_data, without the Track
+std::optional<FileIO::ValidationReport::Problem> FileIO::check_record(const std::vector<std::string_view>& fields) {
+    const auto numbers = Track::parse_csv_numbers(fields);
+    if (!numbers) {
+        return ValidationReport::Problem::kUnparsable;
+    }
+    return check_track_fields(fields[0], fields[1], numbers->duration, numbers->year);
 }
 
 } // namespace audio_library
\ No newline at end of file
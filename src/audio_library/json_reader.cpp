@@ -0,0 +1,301 @@
+#include "audio_library/json_reader.h"
+#include "audio_library/unicode_fold.h"
+
+namespace audio_library {
+
+namespace {
+
+// Containers nested deeper than this are rejected rather than recursed into
+constexpr size_t kMaxDepth = 512;
+
+bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Reads the four hex digits of a "\uXXXX" escape at text[i]
+bool read_escape_code(std::string_view text, size_t i, char32_t& code) {
+    if (i + 6 > text.size() || text[i] != '\\' || text[i + 1] != 'u') {
+        return false;
+    }
+    code = 0;
+    for (size_t d = i + 2; d < i + 6; ++d) {
+        const int value = hex_value(text[d]);
+        if (value < 0) return false;
+        code = (code << 4) | static_cast<char32_t>(value);
+    }
+    return true;
+}
+
+bool is_utf8(std::string_view bytes) {
+    const auto* data = reinterpret_cast<const unsigned char*>(bytes.data());
+    for (size_t i = 0; i < bytes.size();) {
+        char32_t code_point;
+        const size_t length = decode_utf8(data + i, bytes.size() - i, code_point);
+        if (length == 0) return false;
+        i += length;
+    }
+    return true;
+}
+
+} // namespace
+
+JsonReader::JsonReader(std::string_view text) {
+    reset(text);
+}
+
+void JsonReader::reset(std::string_view text) {
+    text_ = text;
+    position_ = text_.substr(0, 3) == "\xEF\xBB\xBF" ? 3 : 0; // Byte order mark
+    failed_ = false;
+    started_.clear();
+}
+
+JsonReader::Type JsonReader::peek() {
+    skip_space();
+    if (failed_) return Type::kInvalid;
+    if (position_ >= text_.size()) return Type::kEnd;
+    switch (text_[position_]) {
+        case '{': return Type::kObject;
+        case '[': return Type::kArray;
+        case '"': return Type::kString;
+        case 't': return Type::kTrue;
+        case 'f': return Type::kFalse;
+        case 'n': return Type::kNull;
+        case '-': return Type::kNumber;
+        default:
+            return text_[position_] >= '0' && text_[position_] <= '9' ? Type::kNumber : Type::kInvalid;
+    }
+}
+
+bool JsonReader::begin_array() {
+    if (peek() != Type::kArray || started_.size() >= kMaxDepth) {
+        return fail();
+    }
+    ++position_;
+    started_.push_back(false);
+    return true;
+}
+
+bool JsonReader::begin_object() {
+    if (peek() != Type::kObject || started_.size() >= kMaxDepth) {
+        return fail();
+    }
+    ++position_;
+    started_.push_back(false);
+    return true;
+}
+
+bool JsonReader::next_element() {
+    return next_item(']');
+}
+
+bool JsonReader::next_member(std::string_view& key) {
+    if (!next_item('}') || !read_string(key)) {
+        return false;
+    }
+    skip_space();
+    if (position_ >= text_.size() || text_[position_] != ':') {
+        return fail();
+    }
+    ++position_;
+    return true;
+}
+
+bool JsonReader::read_string(std::string_view& value) {
+    if (peek() != Type::kString) {
+        return fail();
+    }
+    const size_t begin = ++position_;
+    const char* data = text_.data();
+    for (size_t i = begin; i < text_.size(); ++i) {
+        if (data[i] == '"') {
+            value = text_.substr(begin, i - begin);
+            position_ = i + 1;
+            return true;
+        }
+        if (data[i] == '\\') {
+            return unescape(begin, i, value);
+        }
+    }
+    return fail(); // Unterminated
+}
+
+bool JsonReader::read_number(std::string_view& value) {
+    if (peek() != Type::kNumber) {
+        return fail();
+    }
+    const size_t begin = position_;
+    size_t i = begin + (text_[begin] == '-' ? 1 : 0);
+    const size_t digits = i;
+    auto skip_digits = [&]() {
+        const size_t from = i;
+        while (i < text_.size() && text_[i] >= '0' && text_[i] <= '9') ++i;
+        return i > from;
+    };
+    if (!skip_digits()) {
+        return fail();
+    }
+    if (text_[digits] == '0' && i - digits > 1) {
+        return fail(); // Leading zero
+    }
+    if (i < text_.size() && text_[i] == '.') {
+        ++i;
+        if (!skip_digits()) return fail();
+    }
+    if (i < text_.size() && (text_[i] == 'e' || text_[i] == 'E')) {
+        ++i;
+        if (i < text_.size() && (text_[i] == '+' || text_[i] == '-')) ++i;
+        if (!skip_digits()) return fail();
+    }
+    value = text_.substr(begin, i - begin);
+    position_ = i;
+    return true;
+}
+
+bool JsonReader::skip_value() {
+    std::string_view ignored;
+    switch (peek()) {
+        case Type::kString: return read_string(ignored);
+        case Type::kNumber: return read_number(ignored);
+        case Type::kTrue: return read_literal("true");
+        case Type::kFalse: return read_literal("false");
+        case Type::kNull: return read_literal("null");
+        case Type::kArray:
+            if (!begin_array()) return false;
+            while (next_element()) {
+                if (!skip_value()) return false;
+            }
+            return !failed_;
+        case Type::kObject:
+            if (!begin_object()) return false;
+            while (next_member(ignored)) {
+                if (!skip_value()) return false;
+            }
+            return !failed_;
+        default:
+            return fail();
+    }
+}
+
+void JsonReader::skip_space() {
+    while (position_ < text_.size() && is_space(text_[position_])) {
+        ++position_;
+    }
+}
+
+bool JsonReader::fail() {
+    failed_ = true;
+    return false;
+}
+
+bool JsonReader::next_item(char close) {
+    if (failed_ || started_.empty()) {
+        return fail();
+    }
+    skip_space();
+    if (position_ < text_.size() && text_[position_] == close) {
+        ++position_;
+        started_.pop_back();
+        return false;
+    }
+    if (started_.back()) {
+        if (position_ >= text_.size() || text_[position_] != ',') {
+            return fail();
+        }
+        ++position_;
+    }
+    started_.back() = true;
+    return true;
+}
+
+bool JsonReader::read_literal(std::string_view literal) {
+    if (text_.substr(position_, literal.size()) != literal) {
+        return fail();
+    }
+    position_ += literal.size();
+    return true;
+}
+
+bool JsonReader::unescape(size_t begin, size_t from, std::string_view& value) {
+    const char* data = text_.data();
+    unescaped_.assign(data + begin, from - begin);
+    size_t i = from;
+    while (i < text_.size()) {
+        const char c = data[i];
+        if (c == '"') {
+            value = unescaped_;
+            position_ = i + 1;
+            return true;
+        }
+        if (c != '\\') {
+            unescaped_ += c;
+            ++i;
+            continue;
+        }
+        if (i + 1 >= text_.size()) {
+            break;
+        }
+        switch (data[i + 1]) {
+            case '"': unescaped_ += '"'; break;
+            case '\\': unescaped_ += '\\'; break;
+            case '/': unescaped_ += '/'; break;
+            case 'b': unescaped_ += '\b'; break;
+            case 'f': unescaped_ += '\f'; break;
+            case 'n': unescaped_ += '\n'; break;
+            case 'r': unescaped_ += '\r'; break;
+            case 't': unescaped_ += '\t'; break;
+            case 'u': {
+                char32_t code;
+                if (!read_escape_code(text_, i, code)) {
+                    return fail();
+                }
+                i += 6;
+                if (code >= 0x80 && code <= 0xFF) {
+                    // Older exports wrote each byte of UTF-8 text as its own
+                    // escape; a run of them that spells valid UTF-8 is
+                    // taken as those bytes
+                    std::string bytes(1, static_cast<char>(code));
+                    size_t end = i;
+                    char32_t next;
+                    while (read_escape_code(text_, end, next) && next >= 0x80 && next <= 0xFF) {
+                        bytes += static_cast<char>(next);
+                        end += 6;
+                    }
+                    if (is_utf8(bytes)) {
+                        unescaped_ += bytes;
+                        i = end;
+                    } else {
+                        append_utf8(unescaped_, code);
+                    }
+                    continue;
+                }
+                if (code >= 0xD800 && code <= 0xDBFF) {
+                    char32_t low;
+                    if (read_escape_code(text_, i, low) && low >= 0xDC00 && low <= 0xDFFF) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    } else {
+                        code = 0xFFFD; // Unpaired surrogate
+                    }
+                } else if (code >= 0xDC00 && code <= 0xDFFF) {
+                    code = 0xFFFD;
+                }
+                append_utf8(unescaped_, code);
+                continue;
+            }
+            default:
+                return fail();
+        }
+        i += 2;
+    }
+    return fail(); // Unterminated
+}
+
+} // namespace audio_library
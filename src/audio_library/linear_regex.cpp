@@ -0,0 +1,679 @@
+#include "audio_library/linear_regex.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+
+namespace audio_library {
+
+namespace {
+
+// Upper bounds that keep compilation and the DFA cache bounded for
+// adversarial patterns such as (a{1000}){1000}
+constexpr size_t kMaxNfaStates = 20000;
+constexpr int kMaxRepeat = 1000;
+constexpr size_t kMaxDfaStates = 1024;
+
+// Groups and stacked quantifiers nested deeper than this are rejected, so the
+// recursive parser, emit() and the AST destructor stay within a thread's stack
+constexpr size_t kMaxDepth = 512;
+
+constexpr int kUnbounded = -1;
+
+struct Node {
+    enum class Kind { Empty, Set, Concat, Alternate, Repeat, Begin, End };
+
+    Kind kind = Kind::Empty;
+    LinearRegex::CharSet set;
+    std::vector<std::unique_ptr<Node>> children;
+    int min = 0;
+    int max = 0;
+    size_t height = 1;
+};
+
+using NodePtr = std::unique_ptr<Node>;
+
+NodePtr make_node(Node::Kind kind) {
+    auto node = std::make_unique<Node>();
+    node->kind = kind;
+    return node;
+}
+
+LinearRegex::CharSet digit_set() {
+    LinearRegex::CharSet set;
+    for (int c = '0'; c <= '9'; ++c) set.set(c);
+    return set;
+}
+
+LinearRegex::CharSet word_set() {
+    LinearRegex::CharSet set = digit_set();
+    for (int c = 'a'; c <= 'z'; ++c) set.set(c);
+    for (int c = 'A'; c <= 'Z'; ++c) set.set(c);
+    set.set('_');
+    return set;
+}
+
+LinearRegex::CharSet space_set() {
+    LinearRegex::CharSet set;
+    for (char c : std::string_view(" \t\n\v\f\r")) set.set(static_cast<unsigned char>(c));
+    return set;
+}
+
+void fold_case(LinearRegex::CharSet& set) {
+    for (int c = 'a'; c <= 'z'; ++c) {
+        int upper = c - 'a' + 'A';
+        if (set.test(c) || set.test(upper)) {
+            set.set(c);
+            set.set(upper);
+        }
+    }
+}
+
+// If the set stands for a single literal byte (or, under case folding, both
+// cases of one letter), returns it. Folded letters come back lowercase.
+std::optional<char> literal_of(const Node& node, bool case_insensitive) {
+    if (node.kind != Node::Kind::Set) return std::nullopt;
+
+    size_t count = node.set.count();
+    if (count == 1) {
+        for (int c = 0; c < 256; ++c) {
+            if (node.set.test(c)) return static_cast<char>(c);
+        }
+    }
+    if (count == 2 && case_insensitive) {
+        for (int c = 'a'; c <= 'z'; ++c) {
+            if (node.set.test(c) && node.set.test(c - 'a' + 'A')) return static_cast<char>(c);
+        }
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+// Recursive descent parser producing an AST, followed by backwards Thompson
+// construction of the NFA
+class RegexCompiler {
+public:
+    RegexCompiler(std::string_view pattern, bool case_insensitive)
+        : pattern_(pattern), case_insensitive_(case_insensitive) {}
+
+    std::optional<LinearRegex> compile() {
+        NodePtr root = parse_alternation();
+        if (!root || pos_ != pattern_.size()) {
+            return std::nullopt;
+        }
+
+        LinearRegex regex;
+        regex_ = &regex;
+
+        uint32_t match = add_state({LinearRegex::Op::Match});
+        auto start = emit(*root, match);
+        if (!start) {
+            return std::nullopt;
+        }
+        regex.start_ = *start;
+
+        std::string run;
+        collect_literals(*root, run, regex.required_literals_);
+        flush(run, regex.required_literals_);
+
+        std::sort(regex.required_literals_.begin(), regex.required_literals_.end());
+        regex.required_literals_.erase(
+            std::unique(regex.required_literals_.begin(), regex.required_literals_.end()),
+            regex.required_literals_.end());
+
+        return regex;
+    }
+
+private:
+    std::string_view pattern_;
+    bool case_insensitive_;
+    size_t pos_ = 0;
+    size_t depth_ = 0;
+    LinearRegex* regex_ = nullptr;
+
+    bool at_end() const { return pos_ >= pattern_.size(); }
+    char peek() const { return pattern_[pos_]; }
+
+    // Parsing
+
+    // Records node under parent; fails once the tree grows too tall
+    static bool adopt(Node& parent, NodePtr node) {
+        parent.height = std::max(parent.height, node->height + 1);
+        parent.children.push_back(std::move(node));
+        return parent.height <= kMaxDepth;
+    }
+
+    NodePtr parse_alternation() {
+        NodePtr first = parse_concat();
+        if (!first) return nullptr;
+        if (at_end() || peek() != '|') return first;
+
+        auto alternate = make_node(Node::Kind::Alternate);
+        if (!adopt(*alternate, std::move(first))) return nullptr;
+        while (!at_end() && peek() == '|') {
+            ++pos_;
+            NodePtr next = parse_concat();
+            if (!next || !adopt(*alternate, std::move(next))) return nullptr;
+        }
+        return alternate;
+    }
+
+    NodePtr parse_concat() {
+        auto concat = make_node(Node::Kind::Concat);
+        while (!at_end() && peek() != '|' && peek() != ')') {
+            NodePtr item = parse_repeat();
+            if (!item || !adopt(*concat, std::move(item))) return nullptr;
+        }
+        return concat;
+    }
+
+    NodePtr parse_repeat() {
+        NodePtr atom = parse_atom();
+        if (!atom) return nullptr;
+
+        while (!at_end()) {
+            int min = 0;
+            int max = 0;
+            char c = peek();
+            if (c == '*') {
+                min = 0; max = kUnbounded; ++pos_;
+            } else if (c == '+') {
+                min = 1; max = kUnbounded; ++pos_;
+            } else if (c == '?') {
+                min = 0; max = 1; ++pos_;
+            } else if (c == '{') {
+                if (!parse_braces(min, max)) return nullptr;
+            } else {
+                break;
+            }
+
+            // Lazy quantifiers only change which match is reported
+            if (!at_end() && peek() == '?') ++pos_;
+
+            if (atom->kind == Node::Kind::Begin || atom->kind == Node::Kind::End) {
+                return nullptr;
+            }
+
+            auto repeat = make_node(Node::Kind::Repeat);
+            repeat->min = min;
+            repeat->max = max;
+            if (!adopt(*repeat, std::move(atom))) return nullptr;
+            atom = std::move(repeat);
+        }
+        return atom;
+    }
+
+    bool parse_number(int& value) {
+        size_t start = pos_;
+        value = 0;
+        while (!at_end() && std::isdigit(static_cast<unsigned char>(peek()))) {
+            value = value * 10 + (peek() - '0');
+            if (value > kMaxRepeat) return false;
+            ++pos_;
+        }
+        return pos_ > start;
+    }
+
+    bool parse_braces(int& min, int& max) {
+        ++pos_; // '{'
+        if (!parse_number(min)) return false;
+        max = min;
+        if (!at_end() && peek() == ',') {
+            ++pos_;
+            if (!at_end() && peek() == '}') {
+                max = kUnbounded;
+            } else if (!parse_number(max) || max < min) {
+                return false;
+            }
+        }
+        if (at_end() || peek() != '}') return false;
+        ++pos_;
+        return true;
+    }
+
+    NodePtr make_set(LinearRegex::CharSet set) {
+        if (case_insensitive_) fold_case(set);
+        auto node = make_node(Node::Kind::Set);
+        node->set = set;
+        return node;
+    }
+
+    NodePtr parse_atom() {
+        char c = peek();
+        switch (c) {
+            case '(': {
+                if (depth_ >= kMaxDepth) return nullptr;
+                ++pos_;
+                if (pattern_.substr(pos_, 2) == "?:") {
+                    pos_ += 2;
+                } else if (!at_end() && peek() == '?') {
+                    return nullptr; // Lookaround
+                }
+                ++depth_;
+                NodePtr inner = parse_alternation();
+                --depth_;
+                if (!inner || at_end() || peek() != ')') return nullptr;
+                ++pos_;
+                return inner;
+            }
+            case '[':
+                return parse_class();
+            case '.': {
+                ++pos_;
+                LinearRegex::CharSet set;
+                set.set();
+                set.reset('\n');
+                set.reset('\r');
+                return make_set(set);
+            }
+            case '^':
+                ++pos_;
+                return make_node(Node::Kind::Begin);
+            case '$':
+                ++pos_;
+                return make_node(Node::Kind::End);
+            case '\\': {
+                ++pos_;
+                LinearRegex::CharSet set;
+                if (!parse_escape(set, false)) return nullptr;
+                return make_set(set);
+            }
+            case '*': case '+': case '?': case '{': case ')': case ']': case '}':
+                return nullptr; // Nothing to quantify, or unbalanced
+            default: {
+                ++pos_;
+                LinearRegex::CharSet set;
+                set.set(static_cast<unsigned char>(c));
+                return make_set(set);
+            }
+        }
+    }
+
+    static int hex_value(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    // Parses the escape after a backslash into set
+    bool parse_escape(LinearRegex::CharSet& set, bool in_class) {
+        if (at_end()) return false;
+        char c = pattern_[pos_++];
+
+        switch (c) {
+            case 'd': set = digit_set(); return true;
+            case 'D': set = ~digit_set(); return true;
+            case 'w': set = word_set(); return true;
+            case 'W': set = ~word_set(); return true;
+            case 's': set = space_set(); return true;
+            case 'S': set = ~space_set(); return true;
+            case 't': set.set('\t'); return true;
+            case 'n': set.set('\n'); return true;
+            case 'r': set.set('\r'); return true;
+            case 'f': set.set('\f'); return true;
+            case 'v': set.set('\v'); return true;
+            case '0': set.set(0); return true;
+            case 'b':
+                if (!in_class) return false; // Word boundary assertion
+                set.set('\b');
+                return true;
+            case 'x': {
+                if (pos_ + 2 > pattern_.size()) return false;
+                int high = hex_value(pattern_[pos_]);
+                int low = hex_value(pattern_[pos_ + 1]);
+                if (high < 0 || low < 0) return false;
+                pos_ += 2;
+                set.set(static_cast<size_t>(high * 16 + low));
+                return true;
+            }
+            default:
+                // Backreferences, \B, \c, \u, \k and friends are unsupported;
+                // any other escaped punctuation stands for itself
+                if (std::isalnum(static_cast<unsigned char>(c))) return false;
+                set.set(static_cast<unsigned char>(c));
+                return true;
+        }
+    }
+
+    NodePtr parse_class() {
+        ++pos_; // '['
+        bool negated = false;
+        if (!at_end() && peek() == '^') {
+            negated = true;
+            ++pos_;
+        }
+
+        LinearRegex::CharSet set;
+        bool first = true;
+        while (!at_end() && (peek() != ']' || first)) {
+            first = false;
+
+            // Parse one class atom; ranges only apply between single bytes
+            LinearRegex::CharSet atom;
+            int low = -1;
+            if (peek() == '\\') {
+                ++pos_;
+                if (!parse_escape(atom, true)) return nullptr;
+                if (atom.count() == 1) low = static_cast<int>(first_member(atom));
+            } else {
+                low = static_cast<unsigned char>(pattern_[pos_++]);
+                atom.set(static_cast<size_t>(low));
+            }
+
+            if (low >= 0 && pos_ + 1 < pattern_.size() && peek() == '-' &&
+                pattern_[pos_ + 1] != ']') {
+                ++pos_; // '-'
+                int high;
+                if (peek() == '\\') {
+                    ++pos_;
+                    LinearRegex::CharSet high_atom;
+                    if (!parse_escape(high_atom, true) || high_atom.count() != 1) return nullptr;
+                    high = static_cast<int>(first_member(high_atom));
+                } else {
+                    high = static_cast<unsigned char>(pattern_[pos_++]);
+                }
+                if (high < low) return nullptr;
+                for (int ch = low; ch <= high; ++ch) set.set(static_cast<size_t>(ch));
+            } else {
+                set |= atom;
+            }
+        }
+
+        if (at_end()) return nullptr; // Unterminated class
+        ++pos_; // ']'
+
+        if (case_insensitive_) fold_case(set);
+        if (negated) set.flip();
+
+        auto node = make_node(Node::Kind::Set);
+        node->set = set;
+        return node;
+    }
+
+    static size_t first_member(const LinearRegex::CharSet& set) {
+        for (size_t c = 0; c < set.size(); ++c) {
+            if (set.test(c)) return c;
+        }
+        return 0;
+    }
+
+    // NFA construction. Fragments are emitted back to front: emit() receives
+    // the state to continue with and returns the entry state of the fragment.
+
+    uint32_t add_state(LinearRegex::State state) {
+        regex_->states_.push_back(state);
+        return static_cast<uint32_t>(regex_->states_.size() - 1);
+    }
+
+    std::optional<uint32_t> emit(const Node& node, uint32_t out) {
+        if (regex_->states_.size() > kMaxNfaStates) {
+            return std::nullopt;
+        }
+
+        switch (node.kind) {
+            case Node::Kind::Empty:
+                return out;
+            case Node::Kind::Set: {
+                regex_->sets_.push_back(node.set);
+                LinearRegex::State state{LinearRegex::Op::Char, out};
+                state.set = static_cast<uint32_t>(regex_->sets_.size() - 1);
+                return add_state(state);
+            }
+            case Node::Kind::Begin:
+                return add_state({LinearRegex::Op::Begin, out});
+            case Node::Kind::End:
+                return add_state({LinearRegex::Op::End, out});
+            case Node::Kind::Concat: {
+                uint32_t entry = out;
+                for (auto it = node.children.rbegin(); it != node.children.rend(); ++it) {
+                    auto next = emit(**it, entry);
+                    if (!next) return std::nullopt;
+                    entry = *next;
+                }
+                return entry;
+            }
+            case Node::Kind::Alternate: {
+                auto entry = emit(*node.children.back(), out);
+                if (!entry) return std::nullopt;
+                for (size_t i = node.children.size() - 1; i-- > 0; ) {
+                    auto branch = emit(*node.children[i], out);
+                    if (!branch) return std::nullopt;
+                    entry = add_state({LinearRegex::Op::Split, *branch, *entry});
+                }
+                return entry;
+            }
+            case Node::Kind::Repeat: {
+                const Node& child = *node.children.front();
+                uint32_t entry = out;
+
+                if (node.max == kUnbounded) {
+                    // Loop: split into the body (which returns here) or leave
+                    uint32_t loop = add_state({LinearRegex::Op::Split, 0, out});
+                    auto body = emit(child, loop);
+                    if (!body) return std::nullopt;
+                    regex_->states_[loop].out = *body;
+                    entry = loop;
+                } else {
+                    for (int i = node.min; i < node.max; ++i) {
+                        auto body = emit(child, entry);
+                        if (!body) return std::nullopt;
+                        entry = add_state({LinearRegex::Op::Split, *body, out});
+                    }
+                }
+
+                for (int i = 0; i < node.min; ++i) {
+                    auto body = emit(child, entry);
+                    if (!body) return std::nullopt;
+                    entry = *body;
+                }
+                return entry;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Literal extraction: consecutive single-byte atoms in a concatenation
+    // form a substring that every match contains
+
+    static void flush(std::string& run, std::vector<std::string>& literals) {
+        if (!run.empty()) {
+            literals.push_back(run);
+            run.clear();
+        }
+    }
+
+    void collect_literals(const Node& node, std::string& run,
+                          std::vector<std::string>& literals) const {
+        switch (node.kind) {
+            case Node::Kind::Set:
+                if (auto c = literal_of(node, case_insensitive_)) {
+                    run += *c;
+                } else {
+                    flush(run, literals);
+                }
+                break;
+            case Node::Kind::Concat:
+                for (const auto& child : node.children) {
+                    collect_literals(*child, run, literals);
+                }
+                break;
+            case Node::Kind::Repeat: {
+                const Node& child = *node.children.front();
+                auto c = literal_of(child, case_insensitive_);
+                if (node.min >= 1 && c) {
+                    // "ab+c" contains both "ab" and "bc"
+                    run += *c;
+                    if (node.max != 1) {
+                        flush(run, literals);
+                        run += *c;
+                    }
+                } else {
+                    flush(run, literals);
+                    if (node.min >= 1) {
+                        std::string inner;
+                        collect_literals(child, inner, literals);
+                        flush(inner, literals);
+                    }
+                }
+                break;
+            }
+            case Node::Kind::Empty:
+            case Node::Kind::Begin:
+            case Node::Kind::End:
+                break;
+            case Node::Kind::Alternate:
+                flush(run, literals);
+                break;
+        }
+    }
+};
+
+std::optional<LinearRegex> LinearRegex::compile(std::string_view pattern, bool case_insensitive) {
+    return RegexCompiler(pattern, case_insensitive).compile();
+}
+
+void LinearRegex::add_closure(uint32_t state, bool at_begin, std::vector<uint32_t>& set,
+                              std::vector<bool>& seen) const {
+    std::vector<uint32_t> stack{state};
+    while (!stack.empty()) {
+        uint32_t s = stack.back();
+        stack.pop_back();
+        if (seen[s]) continue;
+        seen[s] = true;
+
+        const State& st = states_[s];
+        switch (st.op) {
+            case Op::Split:
+                stack.push_back(st.out1);
+                stack.push_back(st.out);
+                break;
+            case Op::Begin:
+                if (at_begin) stack.push_back(st.out);
+                break;
+            case Op::Char:
+            case Op::End:
+            case Op::Match:
+                set.push_back(s);
+                break;
+        }
+    }
+}
+
+bool LinearRegex::closure_reaches_match_at_end(const std::vector<uint32_t>& states) const {
+    std::vector<bool> seen(states_.size(), false);
+    std::vector<uint32_t> pending;
+    for (uint32_t s : states) {
+        if (states_[s].op == Op::End) {
+            pending.push_back(states_[s].out);
+        }
+    }
+
+    // Past the last byte every '$' holds, so keep following them
+    while (!pending.empty()) {
+        std::vector<uint32_t> reached;
+        for (uint32_t s : pending) {
+            add_closure(s, false, reached, seen);
+        }
+        pending.clear();
+        for (uint32_t s : reached) {
+            if (states_[s].op == Op::Match) return true;
+            if (states_[s].op == Op::End) pending.push_back(states_[s].out);
+        }
+    }
+    return false;
+}
+
+LinearRegex::Matcher::Matcher(const LinearRegex& regex)
+    : regex_(regex) {
+    std::vector<bool> seen(regex_.states_.size(), false);
+    regex_.add_closure(regex_.start_, false, floating_start_, seen);
+}
+
+void LinearRegex::Matcher::reset() {
+    states_.clear();
+    state_ids_.clear();
+    initial_ = -1;
+}
+
+int32_t LinearRegex::Matcher::state_for(std::vector<uint32_t> nfa_states) {
+    std::sort(nfa_states.begin(), nfa_states.end());
+    nfa_states.erase(std::unique(nfa_states.begin(), nfa_states.end()), nfa_states.end());
+
+    std::string key(reinterpret_cast<const char*>(nfa_states.data()),
+                    nfa_states.size() * sizeof(uint32_t));
+    auto it = state_ids_.find(key);
+    if (it != state_ids_.end()) {
+        return it->second;
+    }
+
+    DfaState state;
+    std::fill(std::begin(state.next), std::end(state.next), -1);
+    state.accepting = std::any_of(nfa_states.begin(), nfa_states.end(),
+        [this](uint32_t s) { return regex_.states_[s].op == Op::Match; });
+    state.accepting_at_end = state.accepting || regex_.closure_reaches_match_at_end(nfa_states);
+    state.nfa_states = std::move(nfa_states);
+
+    states_.push_back(std::move(state));
+    auto id = static_cast<int32_t>(states_.size() - 1);
+    state_ids_.emplace(std::move(key), id);
+    return id;
+}
+
+int32_t LinearRegex::Matcher::step(int32_t from, unsigned char c) {
+    int32_t cached = states_[from].next[c];
+    if (cached >= 0) {
+        return cached;
+    }
+
+    // Advance every NFA state that consumes c, then restart the search at
+    // the next position by adding the unanchored start closure
+    std::vector<bool> seen(regex_.states_.size(), false);
+    std::vector<uint32_t> next;
+    for (uint32_t s : states_[from].nfa_states) {
+        const State& st = regex_.states_[s];
+        if (st.op == Op::Char && regex_.sets_[st.set].test(c)) {
+            regex_.add_closure(st.out, false, next, seen);
+        }
+    }
+    next.insert(next.end(), floating_start_.begin(), floating_start_.end());
+
+    if (states_.size() >= kMaxDfaStates) {
+        // Cache is full: start over rather than grow without bound
+        reset();
+        return state_for(std::move(next));
+    }
+
+    int32_t to = state_for(std::move(next));
+    states_[from].next[c] = to;
+    return to;
+}
+
+bool LinearRegex::Matcher::search(std::string_view text) {
+    if (initial_ < 0) {
+        std::vector<bool> seen(regex_.states_.size(), false);
+        std::vector<uint32_t> start;
+        regex_.add_closure(regex_.start_, true, start, seen);
+        initial_ = state_for(std::move(start));
+    }
+
+    int32_t state = initial_;
+    if (states_[state].accepting) {
+        return true;
+    }
+
+    for (char ch : text) {
+        state = step(state, static_cast<unsigned char>(ch));
+        if (states_[state].accepting) {
+            return true;
+        }
+        if (states_[state].nfa_states.empty()) {
+            return false; // Anchored pattern that can no longer match
+        }
+    }
+
+    return states_[state].accepting_at_end;
+}
+
+} // namespace audio_library
@@ -0,0 +1,129 @@
+#include "audio_library/mapped_file.h"
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace audio_library {
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      open_(std::exchange(other.open_, false)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        open_ = std::exchange(other.open_, false);
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::filesystem::path& path) {
+    close();
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        return false;
+    }
+    if (file_size.QuadPart == 0) {
+        CloseHandle(file);
+        open_ = true; // Windows cannot map an empty file
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) {
+        return false;
+    }
+    // The view keeps the mapping alive
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!view) {
+        return false;
+    }
+
+    data_ = static_cast<const char*>(view);
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    open_ = true;
+    return true;
+}
+
+void MappedFile::close() noexcept {
+    if (data_) {
+        UnmapViewOfFile(data_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    open_ = false;
+}
+
+#else
+
+bool MappedFile::open(const std::filesystem::path& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    if (info.st_size == 0) {
+        ::close(fd);
+        open_ = true; // mmap rejects empty lengths
+        return true;
+    }
+
+    // The mapping outlives the descriptor
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+
+    data_ = static_cast<const char*>(view);
+    size_ = static_cast<size_t>(info.st_size);
+    open_ = true;
+    return true;
+}
+
+void MappedFile::close() noexcept {
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    open_ = false;
+}
+
+#endif
+
+} // namespace audio_library
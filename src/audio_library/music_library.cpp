@@ -1,12 +1,58 @@
 #include "audio_library/music_library.h"
 #include "audio_library/search_engine.h"
 #include "audio_library/file_io.h"
+#include "audio_library/edit_distance.h"
+#include "audio_library/unicode_fold.h"
 #include <algorithm>
 #include <numeric>
 #include <fstream>
+#include <future>
+#include <iterator>
+#include <string_view>
 
 namespace audio_library {
 
+namespace {
+
+// Title and artist, which identify a track for duplicate checks
+struct TrackKey {
+    std::string_view title;
+    std::string_view artist;
+    
+    bool operator==(const TrackKey& other) const {
+        return title == other.title && artist == other.artist;
+    }
+};
+
+struct TrackKeyHash {
+    size_t operator()(const TrackKey& key) const {
+        return std::hash<std::string_view>{}(key.title) * 31 + std::hash<std::string_view>{}(key.artist);
+    }
+};
+
+// One of the max_distance + 1 pieces a duplicate key of the given length
+// is cut into
+struct PieceKey {
+    size_t length;
+    size_t piece;
+    std::string_view text;
+    
+    bool operator==(const PieceKey& other) const {
+        return length == other.length && piece == other.piece && text == other.text;
+    }
+};
+
+struct PieceKeyHash {
+    size_t operator()(const PieceKey& key) const {
+        return std::hash<std::string_view>{}(key.text) * 31 + key.length * 7 + key.piece;
+    }
+};
+
+// Beyond this, pieces are too short to rule out many pairs
+constexpr size_t kMaxPieceFilterDistance = 8;
+
+} // namespace
+
 MusicLibrary::MusicLibrary() 
     : search_engine_(std::make_unique<SearchEngine>()) {
     search_engine_->set_tracks(&tracks_);
@@ -20,7 +66,7 @@ bool MusicLibrary::add_track(Track track) {
     // Check for duplicates
     auto it = std::find_if(tracks_.begin(), tracks_.end(),
         [&track](const TrackPtr& t) {
-            return t->title() == track.title() && t->artist() == track.artist();
+            return t && t->title() == track.title() && t->artist() == track.artist();
         });
     
     if (it != tracks_.end()) {
@@ -46,74 +92,96 @@ bool MusicLibrary::add_track(TrackPtr track) {
     return add_track(*track);
 }
 
-bool MusicLibrary::remove_track(const std::string& title, const std::string& artist) {
-    std::unique_lock lock(mutex_);
-    
-    auto it = std::find_if(tracks_.begin(), tracks_.end(),
-        [&title, &artist](const TrackPtr& t) {
-            return t && t->title() == title && t->artist() == artist;
-        });
+size_t MusicLibrary::ingest(std::vector<Track> tracks) {
+    // Drop repeats within the batch before taking the lock
+    std::vector<TrackPtr> batch;
+    batch.reserve(tracks.size());
+    std::unordered_set<TrackKey, TrackKeyHash> seen;
+    seen.reserve(tracks.size());
+    for (auto& track : tracks) {
+        auto track_ptr = std::make_shared<Track>(std::move(track));
+        if (seen.insert({track_ptr->title(), track_ptr->artist()}).second) {
+            batch.push_back(std::move(track_ptr));
+        }
+    }
     
-    if (it == tracks_.end()) {
-        return false;
+    // Only tracks sharing a title can duplicate one in the library
+    auto is_duplicate = [this](const TrackPtr& track) {
+        auto range = title_index_.equal_range(track->title());
+        return std::any_of(range.first, range.second,
+            [&](const auto& entry) { return tracks_[entry.second]->artist() == track->artist(); });
+    };
+    
+    // Tokenizing the batch is the costly part, so it runs under a shared
+    // lock and searches carry on alongside
+    std::shared_ptr<SearchEngine::PreparedTracks> prepared;
+    {
+        std::shared_lock lock(mutex_);
+        batch.erase(std::remove_if(batch.begin(), batch.end(), is_duplicate), batch.end());
+        if (batch.empty()) {
+            return 0;
+        }
+        prepared = search_engine_->prepare_tracks(batch, 0);
     }
     
-    size_t index = std::distance(tracks_.begin(), it);
+    std::unique_lock lock(mutex_);
     
-    // Remove from indexes
-    if (*it) {
-        remove_from_indexes(index, **it);
-        search_engine_->remove_track(index);
+    // Another change may have come in between, in which case the batch is
+    // filtered and indexed again
+    const size_t prepared_size = batch.size();
+    batch.erase(std::remove_if(batch.begin(), batch.end(), is_duplicate), batch.end());
+    if (batch.empty()) {
+        return 0;
     }
     
-    // Remove track
-    tracks_.erase(it);
+    const size_t first = tracks_.size();
+    tracks_.insert(tracks_.end(), batch.begin(), batch.end());
     
-    // Rebuild indexes due to shifted positions
-    rebuild_indexes();
+    title_index_.reserve(title_index_.size() + batch.size());
+    artist_index_.reserve(artist_index_.size() + batch.size());
+    for (size_t i = first; i < tracks_.size(); ++i) {
+        add_to_indexes(i, *tracks_[i]);
+    }
+    if (batch.size() != prepared_size || !search_engine_->add_prepared_tracks(*prepared, first)) {
+        search_engine_->index_tracks(tracks_, first);
+    }
     
-    return true;
+    return batch.size();
 }
 
-bool MusicLibrary::remove_tracks_by_title(const std::string& title) {
+bool MusicLibrary::remove_track(const std::string& title, const std::string& artist) {
     std::unique_lock lock(mutex_);
     
-    auto new_end = std::remove_if(tracks_.begin(), tracks_.end(),
-        [&title](const TrackPtr& t) {
-            return t && t->title() == title;
+    auto range = title_index_.equal_range(title);
+    auto it = std::find_if(range.first, range.second,
+        [this, &artist](const auto& entry) {
+            return tracks_[entry.second]->artist() == artist;
         });
     
-    if (new_end == tracks_.end()) {
+    if (it == range.second) {
         return false;
     }
     
-    tracks_.erase(new_end, tracks_.end());
-    rebuild_indexes();
+    remove_at(it->second);
+    compact_if_sparse();
     
     return true;
 }
 
+bool MusicLibrary::remove_tracks_by_title(const std::string& title) {
+    std::unique_lock lock(mutex_);
+    return remove_all(title_index_, title);
+}
+
 bool MusicLibrary::remove_tracks_by_artist(const std::string& artist) {
     std::unique_lock lock(mutex_);
-    
-    auto new_end = std::remove_if(tracks_.begin(), tracks_.end(),
-        [&artist](const TrackPtr& t) {
-            return t && t->artist() == artist;
-        });
-    
-    if (new_end == tracks_.end()) {
-        return false;
-    }
-    
-    tracks_.erase(new_end, tracks_.end());
-    rebuild_indexes();
-    
-    return true;
+    return remove_all(artist_index_, artist);
 }
 
 void MusicLibrary::clear() {
     std::unique_lock lock(mutex_);
     tracks_.clear();
+    removed_count_ = 0;
     title_index_.clear();
     artist_index_.clear();
     album_index_.clear();
@@ -211,16 +279,39 @@ std::vector<MusicLibrary::TrackPtr> MusicLibrary::search_advanced(
     return results;
 }
 
+std::vector<std::vector<MusicLibrary::TrackPtr>> MusicLibrary::search_batch(
+    const std::vector<std::string>& queries) const {
+    
+    std::vector<SearchEngine::Query> batch;
+    batch.reserve(queries.size());
+    for (const auto& query : queries) {
+        batch.push_back({query, SearchEngine::SearchOptions{}});
+    }
+    
+    std::shared_lock lock(mutex_);
+    
+    auto search_results = search_engine_->search_batch(batch);
+    std::vector<std::vector<TrackPtr>> results(search_results.size());
+    for (size_t i = 0; i < search_results.size(); ++i) {
+        results[i].reserve(search_results[i].size());
+        for (const auto& [track_ptr, score] : search_results[i]) {
+            results[i].push_back(track_ptr);
+        }
+    }
+    
+    return results;
+}
+
 std::vector<MusicLibrary::TrackPtr> MusicLibrary::get_all_tracks() const {
     std::shared_lock lock(mutex_);
-    return tracks_;
+    return live_tracks();
 }
 
 std::vector<MusicLibrary::TrackPtr> MusicLibrary::get_tracks_sorted(
     const TrackComparator& comparator) const {
     
     std::shared_lock lock(mutex_);
-    std::vector<TrackPtr> sorted_tracks = tracks_;
+    std::vector<TrackPtr> sorted_tracks = live_tracks();
     
     std::sort(sorted_tracks.begin(), sorted_tracks.end(),
         [&comparator](const TrackPtr& a, const TrackPtr& b) {
@@ -334,21 +425,106 @@ std::vector<MusicLibrary::TrackPtr> MusicLibrary::get_top_rated_tracks(size_t li
     return tracks;
 }
 
+std::vector<std::pair<MusicLibrary::TrackPtr, MusicLibrary::TrackPtr>>
+MusicLibrary::find_potential_duplicates(size_t max_distance) const {
+    std::shared_lock lock(mutex_);
+    
+    // Compare folded "artist<US>title" keys, shortest first, each with the
+    // earlier keys no more than max_distance characters shorter
+    struct Candidate {
+        std::string key;
+        size_t index;
+    };
+    std::vector<Candidate> candidates;
+    candidates.reserve(tracks_.size());
+    
+    for (size_t i = 0; i < tracks_.size(); ++i) {
+        if (!tracks_[i]) continue;
+        candidates.push_back({fold_text(tracks_[i]->artist() + '\x1f' + tracks_[i]->title()), i});
+    }
+    
+    std::stable_sort(candidates.begin(), candidates.end(),
+        [](const Candidate& a, const Candidate& b) {
+            return a.key.size() < b.key.size();
+        });
+    
+    // A key within max_distance edits of another keeps at least one of its
+    // max_distance + 1 pieces intact, shifted by at most max_distance
+    // characters, so only keys sharing such a piece are compared in full
+    const bool use_pieces = max_distance <= kMaxPieceFilterDistance;
+    const size_t piece_count = max_distance + 1;
+    std::unordered_map<PieceKey, std::vector<size_t>, PieceKeyHash> pieces;
+    std::vector<size_t> compared_with(candidates.size(), candidates.size());
+    std::vector<size_t> earlier;
+    
+    std::vector<std::pair<size_t, size_t>> pairs;
+    for (size_t j = 0; j < candidates.size(); ++j) {
+        const std::string_view key = candidates[j].key;
+        earlier.clear();
+        if (!use_pieces) {
+            for (size_t i = j; i-- > 0 && key.size() - candidates[i].key.size() <= max_distance;) {
+                earlier.push_back(i);
+            }
+        }
+        for (size_t length = key.size() - std::min(key.size(), max_distance); use_pieces && length <= key.size();
+             ++length) {
+            for (size_t piece = 0; piece < piece_count; ++piece) {
+                const size_t begin = piece * length / piece_count;
+                const size_t size = (piece + 1) * length / piece_count - begin;
+                const size_t from = begin - std::min(begin, max_distance);
+                const size_t to = size == 0 ? from : std::min(begin + max_distance, key.size() - size);
+                for (size_t at = from; at <= to && at + size <= key.size(); ++at) {
+                    auto it = pieces.find({length, piece, key.substr(at, size)});
+                    if (it == pieces.end()) continue;
+                    for (size_t i : it->second) {
+                        if (compared_with[i] != j) {
+                            compared_with[i] = j;
+                            earlier.push_back(i);
+                        }
+                    }
+                }
+            }
+        }
+        
+        for (size_t i : earlier) {
+            if (edit_distance(candidates[i].key, key, max_distance) <= max_distance) {
+                pairs.emplace_back(std::min(candidates[i].index, candidates[j].index),
+                                   std::max(candidates[i].index, candidates[j].index));
+            }
+        }
+        if (use_pieces) {
+            for (size_t piece = 0; piece < piece_count; ++piece) {
+                const size_t begin = piece * key.size() / piece_count;
+                const size_t size = (piece + 1) * key.size() / piece_count - begin;
+                pieces[{key.size(), piece, key.substr(begin, size)}].push_back(j);
+            }
+        }
+    }
+    
+    std::sort(pairs.begin(), pairs.end());
+    std::vector<std::pair<TrackPtr, TrackPtr>> duplicates;
+    duplicates.reserve(pairs.size());
+    for (const auto& [first, second] : pairs) {
+        duplicates.emplace_back(tracks_[first], tracks_[second]);
+    }
+    return duplicates;
+}
+
 size_t MusicLibrary::size() const {
     std::shared_lock lock(mutex_);
-    return tracks_.size();
+    return tracks_.size() - removed_count_;
 }
 
 bool MusicLibrary::empty() const {
     std::shared_lock lock(mutex_);
-    return tracks_.empty();
+    return tracks_.size() == removed_count_;
 }
 
 MusicLibrary::Statistics MusicLibrary::get_statistics() const {
     std::shared_lock lock(mutex_);
     
     Statistics stats;
-    stats.total_tracks = tracks_.size();
+    stats.total_tracks = tracks_.size() - removed_count_;
     
     std::unordered_set<std::string> unique_artists;
     std::unordered_set<std::string> unique_albums;
@@ -381,12 +557,11 @@ MusicLibrary::Statistics MusicLibrary::get_statistics() const {
 
 bool MusicLibrary::import_from_csv(const std::string& filename) {
     try {
-        auto tracks = FileIO::import_csv(filename);
-        
-        for (auto& track : tracks) {
-            add_track(std::move(track));
-        }
-        
+        // Each batch is indexed while the next is parsed
+        FileIO::ImportOptions options;
+        options.pipelined = true;
+        options.batch_callback = [this](std::vector<Track>&& tracks) { ingest(std::move(tracks)); };
+        static_cast<void>(FileIO::import_csv(filename, options));
         return true;
     } catch (const std::exception&) {
         return false;
@@ -398,14 +573,22 @@ bool MusicLibrary::export_to_csv(const std::string& filename) const {
     return FileIO::export_csv(filename, tracks_);
 }
 
+bool MusicLibrary::import_from_tsv(const std::string& filename) {
+    try {
+        // Each batch is indexed while the next is parsed
+        FileIO::ImportOptions options;
+        options.pipelined = true;
+        options.batch_callback = [this](std::vector<Track>&& tracks) { ingest(std::move(tracks)); };
+        static_cast<void>(FileIO::import_tsv(filename, options));
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
 bool MusicLibrary::import_from_json(const std::string& filename) {
     try {
-        auto tracks = FileIO::import_json(filename);
-        
-        for (auto& track : tracks) {
-            add_track(std::move(track));
-        }
-        
+        ingest(FileIO::import_json(filename));
         return true;
     } catch (const std::exception&) {
         return false;
@@ -417,6 +600,16 @@ bool MusicLibrary::export_to_json(const std::string& filename) const {
     return FileIO::export_json(filename, tracks_);
 }
 
+bool MusicLibrary::save_search_index(const std::string& filename) const {
+    std::shared_lock lock(mutex_);
+    return search_engine_->save_index(filename);
+}
+
+bool MusicLibrary::load_search_index(const std::string& filename) {
+    std::unique_lock lock(mutex_);
+    return search_engine_->load_index(filename);
+}
+
 void MusicLibrary::for_each_track(const std::function<void(const Track&)>& func) const {
     std::shared_lock lock(mutex_);
     
@@ -428,18 +621,93 @@ void MusicLibrary::for_each_track(const std::function<void(const Track&)>& func)
 }
 
 void MusicLibrary::rebuild_indexes() {
-    title_index_.clear();
-    artist_index_.clear();
-    album_index_.clear();
-    genre_index_.clear();
-    search_engine_->clear_index();
-    
-    for (size_t i = 0; i < tracks_.size(); ++i) {
-        if (tracks_[i]) {
-            add_to_indexes(i, *tracks_[i]);
-            search_engine_->index_track(i, *tracks_[i]);
+    using SecondaryIndex = std::unordered_multimap<std::string, size_t>;
+    using Field = const std::string& (Track::*)() const noexcept;
+    
+    // Entries go in by track index, as add_to_indexes would add them
+    auto rebuild = [this](SecondaryIndex& index, Field field, bool skip_empty) {
+        index.clear();
+        index.reserve(tracks_.size());
+        for (size_t i = 0; i < tracks_.size(); ++i) {
+            if (!tracks_[i]) continue;
+            const std::string& key = ((*tracks_[i]).*field)();
+            if (!skip_empty || !key.empty()) {
+                index.emplace(key, i);
+            }
         }
+    };
+    
+    if (tracks_.size() < SearchEngine::kMinTracksPerBuildThread) {
+        rebuild(title_index_, &Track::title, false);
+        rebuild(artist_index_, &Track::artist, false);
+        rebuild(album_index_, &Track::album, true);
+        rebuild(genre_index_, &Track::genre, true);
+        search_engine_->rebuild_index(tracks_);
+        return;
+    }
+    
+    // The secondary indexes are independent of each other and of the
+    // search index, so each gets a thread while the search engine builds
+    std::vector<std::future<void>> secondary;
+    secondary.push_back(std::async(std::launch::async, rebuild, std::ref(title_index_), &Track::title, false));
+    secondary.push_back(std::async(std::launch::async, rebuild, std::ref(artist_index_), &Track::artist, false));
+    secondary.push_back(std::async(std::launch::async, rebuild, std::ref(album_index_), &Track::album, true));
+    secondary.push_back(std::async(std::launch::async, rebuild, std::ref(genre_index_), &Track::genre, true));
+    
+    search_engine_->rebuild_index(tracks_);
+    for (auto& task : secondary) {
+        task.get();
+    }
+}
+
+void MusicLibrary::remove_at(size_t index) {
+    remove_from_indexes(index, *tracks_[index]);
+    search_engine_->remove_track(index);
+    tracks_[index] = nullptr;
+    ++removed_count_;
+}
+
+bool MusicLibrary::remove_all(const std::unordered_multimap<std::string, size_t>& index, const std::string& key) {
+    auto range = index.equal_range(key);
+    std::vector<size_t> removed;
+    for (auto it = range.first; it != range.second; ++it) {
+        removed.push_back(it->second);
+    }
+    
+    if (removed.empty()) {
+        return false;
+    }
+    
+    for (size_t track_index : removed) {
+        remove_at(track_index);
+    }
+    compact_if_sparse();
+    
+    return true;
+}
+
+void MusicLibrary::compact_if_sparse() {
+    // Reindexing costs time in proportion to the library, so it waits
+    // until as many tracks have been removed
+    if (removed_count_ * 2 <= tracks_.size()) {
+        return;
+    }
+    
+    tracks_.erase(std::remove(tracks_.begin(), tracks_.end(), nullptr), tracks_.end());
+    removed_count_ = 0;
+    rebuild_indexes();
+}
+
+std::vector<MusicLibrary::TrackPtr> MusicLibrary::live_tracks() const {
+    if (removed_count_ == 0) {
+        return tracks_;
     }
+    
+    std::vector<TrackPtr> tracks;
+    tracks.reserve(tracks_.size() - removed_count_);
+    std::copy_if(tracks_.begin(), tracks_.end(), std::back_inserter(tracks),
+        [](const TrackPtr& track) { return track != nullptr; });
+    return tracks;
 }
 
 void MusicLibrary::add_to_indexes(size_t index, const Track& track) {
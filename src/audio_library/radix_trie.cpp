@@ -0,0 +1,563 @@
+#include "audio_library/radix_trie.h"
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace audio_library {
+
+namespace {
+
+// Leads a serialized trie; the nodes, completions and labels follow
+struct SerializedHeader {
+    uint64_t node_count;
+    uint64_t top_count;
+    uint64_t label_bytes;
+    uint64_t size;
+};
+
+} // namespace
+
+RadixTrie::RadixTrie() {
+    clear();
+}
+
+bool RadixTrie::insert(std::string_view word, uint32_t weight) {
+    if (word.empty()) {
+        return false;
+    }
+    detach();
+
+    uint32_t node = 0;
+    size_t pos = 0;
+    while (pos < word.size()) {
+        const auto c = static_cast<unsigned char>(word[pos]);
+        uint32_t prev = kNone;
+        uint32_t child = find_child(node, c, &prev);
+
+        if (child == kNone) {
+            // New leaf holding the rest of the word
+            Node leaf;
+            leaf.label_offset = static_cast<uint32_t>(labels_.size());
+            leaf.label_length = static_cast<uint32_t>(word.size() - pos);
+            leaf.parent = node;
+            leaf.first = c;
+            leaf.terminal = true;
+            leaf.weight = weight;
+            labels_.append(word.substr(pos));
+            nodes_.push_back(leaf);
+            const auto leaf_id = static_cast<uint32_t>(nodes_.size() - 1);
+
+            link_child(node, prev, leaf_id);
+            if (nodes_[node].top == kNone) {
+                allocate_top(node);
+            }
+            ++size_;
+            raise_completion(node, {leaf_id, weight});
+            return true;
+        }
+
+        std::string_view edge = label(nodes_[child]);
+        std::string_view rest = word.substr(pos);
+        size_t common = std::mismatch(edge.begin(), edge.end(), rest.begin(), rest.end()).first - edge.begin();
+
+        if (common < edge.size()) {
+            // Split the edge: a new node takes the shared part and the old
+            // child keeps the remainder below it
+            Node middle;
+            middle.label_offset = nodes_[child].label_offset;
+            middle.label_length = static_cast<uint32_t>(common);
+            middle.parent = node;
+            middle.first = c;
+            middle.first_child = child;
+            middle.next_sibling = nodes_[child].next_sibling;
+            nodes_.push_back(middle);
+            const auto middle_id = static_cast<uint32_t>(nodes_.size() - 1);
+
+            if (prev == kNone) {
+                nodes_[node].first_child = middle_id;
+            } else {
+                nodes_[prev].next_sibling = middle_id;
+            }
+
+            Node& tail = nodes_[child];
+            tail.label_offset += static_cast<uint32_t>(common);
+            tail.label_length -= static_cast<uint32_t>(common);
+            tail.parent = middle_id;
+            tail.first = static_cast<unsigned char>(labels_[tail.label_offset]);
+            tail.next_sibling = kNone;
+
+            // Same words below it as the tail, so the same completions
+            allocate_top(middle_id);
+            child = middle_id;
+        }
+
+        node = child;
+        pos += common;
+    }
+
+    Node& target = nodes_[node];
+    const bool added = !target.terminal;
+    const uint32_t old_weight = target.weight;
+    target.terminal = true;
+    target.weight = weight;
+    if (added) {
+        ++size_;
+    }
+
+    if (added || weight >= old_weight) {
+        raise_completion(node, {node, weight});
+    } else {
+        rebuild_completions(node);
+    }
+    return added;
+}
+
+bool RadixTrie::erase(std::string_view word) {
+    if (word.empty()) {
+        return false;
+    }
+    detach();
+
+    // (node, sibling before it) from the root's child down, for pruning
+    std::vector<std::pair<uint32_t, uint32_t>> path;
+    uint32_t node = 0;
+    size_t pos = 0;
+    while (pos < word.size()) {
+        uint32_t prev = kNone;
+        uint32_t child = find_child(node, static_cast<unsigned char>(word[pos]), &prev);
+        if (child == kNone) {
+            return false;
+        }
+
+        std::string_view edge = label(nodes_[child]);
+        if (word.compare(pos, edge.size(), edge) != 0) {
+            return false;
+        }
+        path.emplace_back(child, prev);
+        node = child;
+        pos += edge.size();
+    }
+
+    if (!nodes_[node].terminal) {
+        return false;
+    }
+    nodes_[node].terminal = false;
+    nodes_[node].weight = 0;
+    --size_;
+
+    // Unlink nodes that no longer lead to any word. Their storage is
+    // reclaimed by the next freeze().
+    while (!path.empty()) {
+        auto [current, prev] = path.back();
+        if (nodes_[current].terminal || nodes_[current].first_child != kNone) {
+            break;
+        }
+        path.pop_back();
+        unlink_child(path.empty() ? 0 : path.back().first, prev, current);
+    }
+
+    rebuild_completions(path.empty() ? 0 : path.back().first);
+    return true;
+}
+
+bool RadixTrie::contains(std::string_view word) const {
+    uint32_t node = 0;
+    size_t pos = 0;
+    while (pos < word.size()) {
+        uint32_t child = find_child(node, static_cast<unsigned char>(word[pos]));
+        if (child == kNone) {
+            return false;
+        }
+
+        std::string_view edge = label(node_at(child));
+        if (word.compare(pos, edge.size(), edge) != 0) {
+            return false;
+        }
+        node = child;
+        pos += edge.size();
+    }
+    return node != 0 && node_at(node).terminal;
+}
+
+std::vector<std::string> RadixTrie::complete(std::string_view prefix, size_t max_results) const {
+    std::vector<std::string> results;
+    uint32_t node = find_prefix(prefix);
+    if (node == kNone || max_results == 0) {
+        return results;
+    }
+
+    const Node& start = node_at(node);
+    if (max_results <= kTopCompletions) {
+        if (start.top == kNone) {
+            if (start.terminal) {
+                results.push_back(word_at(node));
+            }
+            return results;
+        }
+
+        size_t count = std::min<size_t>(start.top_count, max_results);
+        const Completion* list = top_at(start.top);
+        results.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            results.push_back(word_at(list[i].node));
+        }
+        return results;
+    }
+
+    // More than the lists hold: rank every word in the subtree
+    std::vector<Completion> words;
+    std::vector<uint32_t> pending{node};
+    while (!pending.empty()) {
+        uint32_t current = pending.back();
+        pending.pop_back();
+        if (node_at(current).terminal) {
+            words.push_back({current, node_at(current).weight});
+        }
+        for (uint32_t child = node_at(current).first_child; child != kNone;
+             child = node_at(child).next_sibling) {
+            pending.push_back(child);
+        }
+    }
+
+    size_t count = std::min(max_results, words.size());
+    std::partial_sort(words.begin(), words.begin() + count, words.end(), heavier);
+    results.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        results.push_back(word_at(words[i].node));
+    }
+    return results;
+}
+
+void RadixTrie::freeze() {
+    detach();
+    std::vector<Node> nodes;
+    std::string labels;
+    std::vector<uint32_t> source; // Old index of each new node
+
+    // Size the new storage exactly by counting what is still reachable
+    size_t reachable_nodes = 0;
+    size_t reachable_bytes = 0;
+    size_t inner_nodes = 0;
+    std::vector<uint32_t> pending{0};
+    while (!pending.empty()) {
+        uint32_t current = pending.back();
+        pending.pop_back();
+        ++reachable_nodes;
+        reachable_bytes += nodes_[current].label_length;
+        if (current == 0 || nodes_[current].first_child != kNone) {
+            ++inner_nodes;
+        }
+        for (uint32_t child = nodes_[current].first_child; child != kNone;
+             child = nodes_[child].next_sibling) {
+            pending.push_back(child);
+        }
+    }
+    nodes.reserve(reachable_nodes);
+    labels.reserve(reachable_bytes);
+    source.reserve(reachable_nodes);
+
+    // Breadth first, so the children of every node are adjacent
+    nodes.push_back(nodes_[0]);
+    source.push_back(0);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        uint32_t old_child = nodes_[source[i]].first_child;
+        nodes[i].first_child = old_child == kNone ? kNone : static_cast<uint32_t>(nodes.size());
+
+        for (; old_child != kNone; old_child = nodes_[old_child].next_sibling) {
+            Node copy = nodes_[old_child];
+            copy.label_offset = static_cast<uint32_t>(labels.size());
+            labels.append(label(nodes_[old_child]));
+            copy.parent = static_cast<uint32_t>(i);
+            copy.next_sibling = nodes_[old_child].next_sibling == kNone
+                ? kNone : static_cast<uint32_t>(nodes.size() + 1);
+            nodes.push_back(copy);
+            source.push_back(old_child);
+        }
+    }
+
+    nodes_.swap(nodes);
+    labels_.swap(labels);
+
+    // Children come after their parent, so a backward pass sees every
+    // child's list before it is needed
+    std::vector<Completion>().swap(top_);
+    top_.reserve(inner_nodes * kTopCompletions);
+    for (auto& node : nodes_) {
+        node.top = kNone;
+        node.top_count = 0;
+    }
+    for (size_t i = nodes_.size(); i-- > 0;) {
+        if (i == 0 || nodes_[i].first_child != kNone) {
+            allocate_top(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+void RadixTrie::clear() {
+    attached_nodes_ = nullptr;
+    attached_top_ = nullptr;
+    attached_labels_ = {};
+    nodes_.assign(1, Node{});
+    labels_.clear();
+    top_.clear();
+    size_ = 0;
+    allocate_top(0);
+}
+
+void RadixTrie::serialize(std::string& out) const {
+    static_assert(std::is_trivially_copyable_v<Node> && std::is_trivially_copyable_v<Completion>);
+    const size_t node_count = attached_nodes_ ? attached_node_count_ : nodes_.size();
+    const size_t top_count = attached_nodes_ ? attached_top_count_ : top_.size();
+    const std::string_view all_labels = labels();
+
+    const SerializedHeader header{node_count, top_count, all_labels.size(), size_};
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.append(reinterpret_cast<const char*>(&node_at(0)), node_count * sizeof(Node));
+    out.append(reinterpret_cast<const char*>(top_at(0)), top_count * sizeof(Completion));
+    out.append(all_labels);
+}
+
+bool RadixTrie::attach(const char* data, size_t size) {
+    SerializedHeader header;
+    if (size < sizeof(header) || reinterpret_cast<uintptr_t>(data) % alignof(Node) != 0) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+
+    // Checked piece by piece so that corrupt counts cannot overflow
+    size_t remaining = size - sizeof(header);
+    if (header.node_count == 0 || header.node_count > remaining / sizeof(Node)) {
+        return false;
+    }
+    remaining -= header.node_count * sizeof(Node);
+    if (header.top_count > remaining / sizeof(Completion)) {
+        return false;
+    }
+    remaining -= header.top_count * sizeof(Completion);
+    if (header.label_bytes != remaining) {
+        return false;
+    }
+
+    const char* nodes = data + sizeof(header);
+    const char* top = nodes + header.node_count * sizeof(Node);
+    if (!well_formed(reinterpret_cast<const Node*>(nodes), header.node_count,
+                     reinterpret_cast<const Completion*>(top), header.top_count, header.label_bytes)) {
+        return false;
+    }
+    nodes_.clear();
+    labels_.clear();
+    top_.clear();
+    attached_nodes_ = reinterpret_cast<const Node*>(nodes);
+    attached_top_ = reinterpret_cast<const Completion*>(top);
+    attached_labels_ = std::string_view(top + header.top_count * sizeof(Completion), header.label_bytes);
+    attached_node_count_ = header.node_count;
+    attached_top_count_ = header.top_count;
+    size_ = header.size;
+    return true;
+}
+
+bool RadixTrie::well_formed(const Node* nodes, size_t node_count, const Completion* top, size_t top_count,
+                            size_t label_bytes) {
+    auto in_range = [node_count](uint32_t node) { return node == kNone || node < node_count; };
+    for (size_t i = 0; i < node_count; ++i) {
+        const Node& node = nodes[i];
+        if (!in_range(node.parent) || !in_range(node.first_child) || !in_range(node.next_sibling) ||
+            node.label_offset > label_bytes || node.label_length > label_bytes - node.label_offset ||
+            node.top_count > kTopCompletions ||
+            (node.top != kNone && node.top >= top_count / kTopCompletions)) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < top_count; ++i) {
+        if (top[i].node >= node_count) {
+            return false;
+        }
+    }
+
+    // Walk down from the root: each node must be reached once, from the
+    // parent it names, so that walks up and down both end
+    std::vector<bool> reached(node_count, false);
+    std::vector<uint32_t> pending{0};
+    reached[0] = true;
+    if (nodes[0].parent != kNone) {
+        return false;
+    }
+    while (!pending.empty()) {
+        const uint32_t current = pending.back();
+        pending.pop_back();
+        for (uint32_t child = nodes[current].first_child; child != kNone; child = nodes[child].next_sibling) {
+            if (reached[child] || nodes[child].parent != current) {
+                return false;
+            }
+            reached[child] = true;
+            pending.push_back(child);
+        }
+    }
+
+    // Completions are turned back into words by walking up from them
+    for (size_t i = 0; i < node_count; ++i) {
+        if (!reached[i] || nodes[i].top == kNone) continue;
+        const Completion* list = top + static_cast<size_t>(nodes[i].top) * kTopCompletions;
+        for (size_t j = 0; j < nodes[i].top_count; ++j) {
+            if (!reached[list[j].node]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void RadixTrie::detach() {
+    if (!attached_nodes_) {
+        return;
+    }
+    nodes_.assign(attached_nodes_, attached_nodes_ + attached_node_count_);
+    top_.assign(attached_top_, attached_top_ + attached_top_count_);
+    labels_.assign(attached_labels_);
+    attached_nodes_ = nullptr;
+    attached_top_ = nullptr;
+    attached_labels_ = {};
+}
+
+size_t RadixTrie::memory_usage() const noexcept {
+    return nodes_.capacity() * sizeof(Node) + labels_.capacity() +
+           top_.capacity() * sizeof(Completion);
+}
+
+uint32_t RadixTrie::find_child(uint32_t parent, unsigned char c, uint32_t* prev) const {
+    uint32_t before = kNone;
+    uint32_t child = node_at(parent).first_child;
+    while (child != kNone && node_at(child).first < c) {
+        before = child;
+        child = node_at(child).next_sibling;
+    }
+    if (prev) {
+        *prev = before;
+    }
+    return child != kNone && node_at(child).first == c ? child : kNone;
+}
+
+uint32_t RadixTrie::find_prefix(std::string_view prefix) const {
+    // The prefix may end part way along the last edge
+    uint32_t node = 0;
+    size_t pos = 0;
+    while (pos < prefix.size()) {
+        uint32_t child = find_child(node, static_cast<unsigned char>(prefix[pos]));
+        if (child == kNone) {
+            return kNone;
+        }
+
+        std::string_view edge = label(node_at(child));
+        size_t length = std::min(edge.size(), prefix.size() - pos);
+        if (edge.compare(0, length, prefix.substr(pos, length)) != 0) {
+            return kNone;
+        }
+        node = child;
+        pos += length;
+    }
+    return node;
+}
+
+void RadixTrie::link_child(uint32_t parent, uint32_t prev, uint32_t child) {
+    if (prev == kNone) {
+        nodes_[child].next_sibling = nodes_[parent].first_child;
+        nodes_[parent].first_child = child;
+    } else {
+        nodes_[child].next_sibling = nodes_[prev].next_sibling;
+        nodes_[prev].next_sibling = child;
+    }
+}
+
+void RadixTrie::unlink_child(uint32_t parent, uint32_t prev, uint32_t child) {
+    if (prev == kNone) {
+        nodes_[parent].first_child = nodes_[child].next_sibling;
+    } else {
+        nodes_[prev].next_sibling = nodes_[child].next_sibling;
+    }
+    nodes_[child].next_sibling = kNone;
+}
+
+std::string RadixTrie::word_at(uint32_t node) const {
+    size_t length = 0;
+    for (uint32_t n = node; n != 0; n = node_at(n).parent) {
+        length += node_at(n).label_length;
+    }
+
+    // Fill from the end while climbing back to the root
+    std::string word(length, '\0');
+    const std::string_view all_labels = labels();
+    for (uint32_t n = node; n != 0; n = node_at(n).parent) {
+        const Node& current = node_at(n);
+        length -= current.label_length;
+        all_labels.copy(&word[length], current.label_length, current.label_offset);
+    }
+    return word;
+}
+
+void RadixTrie::allocate_top(uint32_t node) {
+    nodes_[node].top = static_cast<uint32_t>(top_.size() / kTopCompletions);
+    top_.resize(top_.size() + kTopCompletions);
+    rebuild_top(node);
+}
+
+void RadixTrie::raise_completion(uint32_t node, Completion completion) {
+    for (uint32_t n = node; n != kNone; n = nodes_[n].parent) {
+        Node& current = nodes_[n];
+        if (current.top == kNone) {
+            continue; // Leaves complete only to themselves
+        }
+
+        Completion* list = &top_[current.top * kTopCompletions];
+        size_t i = std::find_if(list, list + current.top_count,
+            [&completion](const Completion& entry) { return entry.node == completion.node; }) - list;
+
+        if (i == current.top_count) {
+            if (current.top_count < kTopCompletions) {
+                ++current.top_count;
+            } else if (heavier(completion, list[kTopCompletions - 1])) {
+                i = kTopCompletions - 1;
+            } else {
+                // Ancestors rank a superset of these words, so it cannot
+                // reach their lists either
+                return;
+            }
+        }
+
+        list[i] = completion;
+        for (; i > 0 && heavier(list[i], list[i - 1]); --i) {
+            std::swap(list[i], list[i - 1]);
+        }
+    }
+}
+
+void RadixTrie::rebuild_completions(uint32_t node) {
+    for (uint32_t n = node; n != kNone; n = nodes_[n].parent) {
+        if (nodes_[n].top != kNone) {
+            rebuild_top(n);
+        }
+    }
+}
+
+void RadixTrie::rebuild_top(uint32_t node) {
+    scratch_.clear();
+    if (nodes_[node].terminal) {
+        scratch_.push_back({node, nodes_[node].weight});
+    }
+    for (uint32_t child = nodes_[node].first_child; child != kNone;
+         child = nodes_[child].next_sibling) {
+        const Node& c = nodes_[child];
+        if (c.top != kNone) {
+            const Completion* list = &top_[c.top * kTopCompletions];
+            scratch_.insert(scratch_.end(), list, list + c.top_count);
+        } else if (c.terminal) {
+            scratch_.push_back({child, c.weight});
+        }
+    }
+
+    size_t count = std::min(scratch_.size(), kTopCompletions);
+    std::partial_sort(scratch_.begin(), scratch_.begin() + count, scratch_.end(), heavier);
+    std::copy(scratch_.begin(), scratch_.begin() + count, top_.begin() + nodes_[node].top * kTopCompletions);
+    nodes_[node].top_count = static_cast<uint8_t>(count);
+}
+
+} // namespace audio_library
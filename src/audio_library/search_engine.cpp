@@ -1,197 +1,2054 @@
 #include "audio_library/search_engine.h"
+#include "audio_library/edit_distance.h"
+#include "audio_library/mapped_file.h"
+#include "audio_library/parallel.h"
+#include "audio_library/tokenizer.h"
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
 #include <sstream>
-#include <regex>
-#include <queue>
-#include <unordered_set>
+#include <iterator>
+#include <numeric>
+#include <thread>
+#include <type_traits>
 
 namespace audio_library {
 
-SearchEngine::SearchEngine() 
-    : trie_root_(std::make_unique<TrieNode>()) {
+namespace {
+
+constexpr size_t kRegexCacheCapacity = 64;
+
+uint32_t trigram_key(const char* p) {
+    return (static_cast<uint32_t>(static_cast<unsigned char>(p[0])) << 16) |
+           (static_cast<uint32_t>(static_cast<unsigned char>(p[1])) << 8) |
+           static_cast<uint32_t>(static_cast<unsigned char>(p[2]));
+}
+
+// Cache key: the options, then the query with runs of whitespace collapsed
+// and, unless searching case-sensitively, words other than the operators
+// lowercased. Regex patterns are kept verbatim.
+std::string result_cache_key(const std::string& query, const SearchEngine::SearchOptions& options) {
+    std::string key;
+    key.reserve(query.size() + 32);
+    key += static_cast<char>('0' + static_cast<int>(options.mode));
+    key += options.case_sensitive ? 'c' : '-';
+    key += options.search_title ? 't' : '-';
+    key += options.search_artist ? 'a' : '-';
+    key += options.search_album ? 'l' : '-';
+    key += options.search_genre ? 'g' : '-';
+    key += options.match_all_terms ? '&' : '|';
+    key += std::to_string(options.max_results);
+    key += ':';
+    // The threshold's exact bits, as nearby values may filter differently
+    uint64_t min_relevance_bits = 0;
+    static_assert(sizeof(min_relevance_bits) == sizeof(options.min_relevance));
+    std::memcpy(&min_relevance_bits, &options.min_relevance, sizeof(min_relevance_bits));
+    key += std::to_string(min_relevance_bits);
+    key += '\x1f';
+    
+    if (options.mode == SearchEngine::SearchMode::REGEX) {
+        key += query;
+        return key;
+    }
+    
+    std::stringstream ss(query);
+    std::string word;
+    bool first = true;
+    while (ss >> word) {
+        if (!first) key += ' ';
+        if (!options.case_sensitive && word != "OR" && word != "AND" && word != "NOT" &&
+            word.compare(0, 4, "NEAR") != 0) {
+            append_folded(key, word);
+        } else {
+            key += word;
+        }
+        first = false;
+    }
+    return key;
+}
+
+constexpr uint32_t kNoToken = std::numeric_limits<uint32_t>::max();
+constexpr uint32_t kDefaultNearDistance = 5;
+
+// Pruned top-k retrieval pays off once a query's postings far outnumber
+// the results wanted. Past a few dozen terms (wide substring or fuzzy
+// expansions) stepping every cursor per track costs more than it saves.
+constexpr size_t kMinPostingsPerResultToPrune = 8;
+constexpr size_t kMaxPrunedTerms = 32;
+
+// Index files: a header, then each section at an offset that is a multiple
+// of 8. Runs of per-term or per-track entries are located by offset arrays
+// with one more entry than there are terms or tracks.
+constexpr char kIndexMagic[8] = {'A', 'L', 'I', 'N', 'D', 'E', 'X', '\0'};
+constexpr uint32_t kIndexVersion = 1;
+constexpr uint32_t kByteOrderMark = 0x01020304;
+
+enum IndexSection : size_t {
+    TERM_OFFSETS, TERM_BYTES, TERM_ORDER,  // Term text, and ids in text order
+    POSTING_OFFSETS, POSTINGS,
+    POSITION_OFFSETS, POSITIONS,
+    BLOCK_OFFSETS, BLOCKS,
+    FIELD_LENGTHS,                         // Per track
+    TRACK_TERM_OFFSETS, TRACK_TERMS,       // Per track
+    TRIGRAM_KEYS, TRIGRAM_OFFSETS, TRIGRAM_TERMS,
+    TRIE,                                  // RadixTrie::serialize()
+    SECTION_COUNT
+};
+
+struct IndexFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t posting_size;       // Entry sizes, which differ between builds
+    uint64_t block_size;
+    uint64_t term_count;
+    uint64_t track_count;
+    uint64_t trigram_count;
+    uint64_t live_terms;
+    uint64_t indexed_tracks;
+    uint64_t total_field_lengths[SearchEngine::kFieldCount];
+    uint64_t store_positions;
+    uint64_t has_fingerprint;
+    uint64_t fingerprint;
+    struct {
+        uint64_t offset;
+        uint64_t size;
+    } sections[SECTION_COUNT];
+};
+
+// Writes sections one after another, recording where each went
+class IndexFileWriter {
+public:
+    IndexFileWriter(std::ofstream& out, IndexFileHeader& header) : out_(out), header_(header) {
+        out_.write(reinterpret_cast<const char*>(&header_), sizeof(header_)); // Rewritten at the end
+        offset_ = sizeof(header_);
+    }
+    
+    void begin(IndexSection section) {
+        static const char padding[8] = {};
+        const uint64_t aligned = (offset_ + 7) / 8 * 8;
+        out_.write(padding, static_cast<std::streamsize>(aligned - offset_));
+        offset_ = aligned;
+        header_.sections[section] = {offset_, 0};
+        section_ = section;
+    }
+    
+    template <typename T>
+    void write(const T* data, size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const size_t bytes = count * sizeof(T);
+        if (bytes > 0) {
+            out_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        }
+        offset_ += bytes;
+        header_.sections[section_].size += bytes;
+    }
+    
+    template <typename T>
+    void section(IndexSection section, const std::vector<T>& entries) {
+        begin(section);
+        write(entries.data(), entries.size());
+    }
+    
+    bool finish() {
+        out_.seekp(0);
+        out_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+        out_.flush();
+        return static_cast<bool>(out_);
+    }
+    
+private:
+    std::ofstream& out_;
+    IndexFileHeader& header_;
+    uint64_t offset_ = 0;
+    IndexSection section_ = TERM_OFFSETS;
+};
+
+// Entries of an index file's section, or nullptr unless it lies within
+// the file and holds exactly count entries of T
+template <typename T>
+const T* index_section(const IndexFileHeader& header, IndexSection section, const MappedFile& file,
+                       uint64_t count) {
+    const auto& [offset, size] = header.sections[section];
+    if (offset % 8 != 0 || offset > file.size() || size > file.size() - offset ||
+        size % sizeof(T) != 0 || size / sizeof(T) != count) {
+        return nullptr;
+    }
+    return reinterpret_cast<const T*>(file.data() + offset);
+}
+
+// Whether offsets (count + 1 of them) never decrease and end at size
+bool valid_offsets(const uint64_t* offsets, uint64_t count, uint64_t size) {
+    return offsets[0] == 0 && offsets[count] == size &&
+           std::is_sorted(offsets, offsets + count + 1);
+}
+
+// Whether count varints of at most 32 bits start at data and end by end
+bool valid_varints(const uint8_t* data, const uint8_t* end, size_t count) {
+    for (; count > 0; --count) {
+        size_t length = 0;
+        do {
+            if (data == end || ++length > 5) {
+                return false;
+            }
+        } while (*data++ & 0x80);
+    }
+    return true;
+}
+
+// Parses the NEAR and NEAR/n operators
+bool parse_near(const std::string& word, uint32_t& distance) {
+    if (word == "NEAR") {
+        distance = kDefaultNearDistance;
+        return true;
+    }
+    if (word.size() <= 5 || word.compare(0, 5, "NEAR/") != 0) {
+        return false;
+    }
+    auto [end, error] = std::from_chars(word.data() + 5, word.data() + word.size(), distance);
+    return error == std::errc() && end == word.data() + word.size();
+}
+
+void append_varint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t read_varint(const uint8_t*& data) {
+    uint32_t value = 0;
+    int shift = 0;
+    while (*data & 0x80) {
+        value |= static_cast<uint32_t>(*data++ & 0x7F) << shift;
+        shift += 7;
+    }
+    return value | (static_cast<uint32_t>(*data++) << shift);
+}
+
+// Whether some position p of the first word has p + i among the positions
+// of word i, for every word
+bool contains_phrase(const std::vector<std::vector<uint32_t>>& positions, size_t words) {
+    for (uint32_t start : positions[0]) {
+        bool found = true;
+        for (size_t i = 1; i < words && found; ++i) {
+            found = std::binary_search(positions[i].begin(), positions[i].end(), start + static_cast<uint32_t>(i));
+        }
+        if (found) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether needed[w] distinct positions of each word w fit in a window
+// holding at most distance other words. A word repeated in the query needs
+// as many positions as it has repeats, which need none of their own, so
+// that "a NEAR a" takes two occurrences of a. Slides over all positions in
+// order, shrinking the window from the left while it still covers every
+// word.
+bool within_distance(const std::vector<std::vector<uint32_t>>& positions, const std::vector<uint32_t>& needed,
+                     uint32_t distance) {
+    std::vector<std::pair<uint32_t, uint32_t>> events; // (position, word)
+    size_t words = 0;
+    size_t distinct_words = 0;
+    for (size_t w = 0; w < needed.size(); ++w) {
+        if (needed[w] == 0) continue;
+        words += needed[w];
+        ++distinct_words;
+        for (uint32_t position : positions[w]) {
+            events.emplace_back(position, static_cast<uint32_t>(w));
+        }
+    }
+    std::sort(events.begin(), events.end());
+    
+    const auto span = static_cast<uint32_t>(distance + words - 1);
+    std::vector<uint32_t> counts(needed.size(), 0);
+    size_t covered = 0;
+    size_t left = 0;
+    for (const auto& [position, word] : events) {
+        if (++counts[word] == needed[word]) {
+            ++covered;
+        }
+        while (covered == distinct_words) {
+            if (position - events[left].first <= span) {
+                return true;
+            }
+            if (counts[events[left].second]-- == needed[events[left].second]) {
+                --covered;
+            }
+            ++left;
+        }
+    }
+    return false;
+}
+
+uint16_t saturating_increment(uint16_t value) {
+    return value == std::numeric_limits<uint16_t>::max() ? value : static_cast<uint16_t>(value + 1);
+}
+
+void add_field_lengths(std::array<uint16_t, SearchEngine::kFieldCount>& lengths,
+                       const std::array<uint32_t, SearchEngine::kFieldCount>& tokens) {
+    for (size_t f = 0; f < SearchEngine::kFieldCount; ++f) {
+        lengths[f] = static_cast<uint16_t>(std::min<uint32_t>(lengths[f] + tokens[f],
+                                                              std::numeric_limits<uint16_t>::max()));
+    }
+}
+
+// Position of the first item at or after `from` whose key is not less than
+// target. Probes 1, 2, 4, ... items ahead and then binary searches the last
+// step, so skipping a long run of a sorted list costs logarithmic time.
+template <typename Items, typename Key>
+size_t gallop(const Items& items, size_t from, uint32_t target, Key key) {
+    size_t low = from;
+    size_t high = from;
+    size_t step = 1;
+    while (high < items.size() && key(items[high]) < target) {
+        low = high + 1;
+        high += step;
+        step *= 2;
+    }
+    high = std::min(high + 1, items.size());
+    
+    auto it = std::lower_bound(items.begin() + low, items.begin() + high, target,
+        [&key](const auto& item, uint32_t value) { return key(item) < value; });
+    return static_cast<size_t>(it - items.begin());
+}
+
+} // namespace
+
+// A mapped index file. Per-term runs are found through the offset arrays;
+// the term, posting, position and block runs of a term id sit at the same
+// index in each.
+struct SearchEngine::Segment {
+    MappedFile file;
+    size_t term_count = 0;
+    const uint64_t* term_offsets = nullptr;
+    const char* term_bytes = nullptr;
+    const uint32_t* term_order = nullptr;
+    const uint64_t* posting_offsets = nullptr;
+    const Posting* postings = nullptr;
+    const uint64_t* position_offsets = nullptr;
+    const uint8_t* positions = nullptr;
+    const uint64_t* block_offsets = nullptr;
+    const BlockSummary* blocks = nullptr;
+    View<FieldLengths> field_lengths;
+    const uint64_t* track_term_offsets = nullptr;
+    const uint32_t* track_terms = nullptr;
+    View<uint32_t> trigram_keys;
+    const uint64_t* trigram_offsets = nullptr;
+    const uint32_t* trigram_terms = nullptr;
+    
+    template <typename T>
+    static View<T> run(const T* entries, const uint64_t* offsets, size_t index) {
+        return View<T>(entries + offsets[index], static_cast<size_t>(offsets[index + 1] - offsets[index]));
+    }
+    std::string_view term(uint32_t term_id) const {
+        auto text = run(term_bytes, term_offsets, term_id);
+        return std::string_view(text.data(), text.size());
+    }
+    // Whether the runs' contents keep every read inside the file: term and
+    // track ids in range, ordered postings and keys, one block summary per
+    // block, and positions that decode within their term's run. Checked in
+    // one pass at load, so that queries can trust them.
+    bool valid_content() const;
+};
+
+bool SearchEngine::Segment::valid_content() const {
+    const size_t track_count = field_lengths.size();
+    for (uint32_t id = 0; id < term_count; ++id) {
+        const auto entries = run(postings, posting_offsets, id);
+        const auto bytes = run(positions, position_offsets, id);
+        if (run(blocks, block_offsets, id).size() != (entries.size() + kBlockSize - 1) / kBlockSize) {
+            return false;
+        }
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const auto& posting = entries[i];
+            if (posting.track_id >= track_count || (i > 0 && posting.track_id <= entries[i - 1].track_id)) {
+                return false;
+            }
+            if (posting.positions == kNoPositions) continue;
+            size_t varints = 0;
+            for (uint16_t frequency : posting.term_frequency) {
+                varints += frequency;
+            }
+            if (posting.positions > bytes.size() ||
+                !valid_varints(bytes.data() + posting.positions, bytes.end(), varints)) {
+                return false;
+            }
+        }
+    }
+    
+    // Term order must be a permutation sorted by text, as find_term
+    // binary searches it
+    std::vector<bool> seen(term_count, false);
+    for (size_t i = 0; i < term_count; ++i) {
+        const uint32_t id = term_order[i];
+        if (id >= term_count || seen[id] || (i > 0 && !(term(term_order[i - 1]) < term(id)))) {
+            return false;
+        }
+        seen[id] = true;
+    }
+    
+    auto valid_ids = [this](const uint32_t* ids, size_t count) {
+        return std::all_of(ids, ids + count, [this](uint32_t id) { return id < term_count; });
+    };
+    return valid_ids(track_terms, static_cast<size_t>(track_term_offsets[track_count])) &&
+           valid_ids(trigram_terms, static_cast<size_t>(trigram_offsets[trigram_keys.size()])) &&
+           std::adjacent_find(trigram_keys.begin(), trigram_keys.end(), std::greater_equal<uint32_t>()) ==
+               trigram_keys.end();
+}
+
+// Scores indexed directly by track id. Only touched entries are cleared
+// between queries, and each thread reuses its own table, so a query costs
+// nothing proportional to the library size.
+struct SearchEngine::ScoreAccumulator {
+    std::vector<double> scores;
+    std::vector<uint32_t> touched;
+    
+    void add(uint32_t track_id, double score) {
+        if (track_id >= scores.size()) {
+            scores.resize(track_id + 1, 0.0);
+        }
+        if (scores[track_id] == 0.0) {
+            touched.push_back(track_id);
+        }
+        scores[track_id] += score;
+    }
+    
+    void reset() {
+        for (uint32_t id : touched) {
+            scores[id] = 0.0;
+        }
+        touched.clear();
+    }
+};
+
+struct SearchEngine::QueryClause {
+    enum class Proximity : uint8_t { NONE, PHRASE, NEAR };
+    
+    TermMatches terms;              // Every term the clause's words matched
+    std::vector<TermMatches> words; // Per word, for phrase and NEAR groups
+    Proximity proximity = Proximity::NONE;
+    uint32_t distance = 0;          // NEAR: most other words between the group's words
+    bool excluded = false;
+    size_t estimated_size = 0;      // Total postings of the matched terms
+};
+
+struct SearchEngine::TermExpansions {
+    std::mutex mutex;
+    std::unordered_map<std::string, TermMatches> matches; // By mode, case and word
+};
+
+SearchEngine::SearchEngine() = default;
+
+SearchEngine::~SearchEngine() = default;
+
+void SearchEngine::index_track(size_t id, const Track& track) {
+    const auto track_id = static_cast<uint32_t>(id);
+    ensure_writable();
+    ++generation_;
+    if (track_id >= field_lengths_.size()) {
+        field_lengths_.resize(track_id + 1, {});
+        track_terms_.resize(track_id + 1);
+    }
+    
+    auto& terms = track_terms_scratch_;
+    const auto tokens = count_terms(track, terms);
+    
+    auto& lengths = field_lengths_[track_id];
+    bool was_indexed = std::any_of(lengths.begin(), lengths.end(),
+        [](uint16_t length) { return length > 0; });
+    const auto position_base = lengths; // Text indexed again continues earlier positions
+    add_field_lengths(lengths, tokens);
+    for (size_t f = 0; f < kFieldCount; ++f) {
+        total_field_lengths_[f] += tokens[f];
+    }
+    
+    if (!was_indexed && !terms.counts.empty()) {
+        ++indexed_tracks_;
+    }
+    
+    auto& term_ids = track_terms_[track_id];
+    for (size_t entry = 0; entry < terms.counts.size(); ++entry) {
+        const auto& [term, term_frequency] = terms.counts[entry];
+        if (store_positions_) {
+            encode_positions(terms, entry, position_base);
+        }
+        uint32_t term_id = add_to_inverted_index(term, track_id, term_frequency,
+                                                 store_positions_ ? &terms.positions : nullptr);
+        // Indexing the same id again merges into the existing postings
+        if (!was_indexed || std::find(term_ids.begin(), term_ids.end(), term_id) == term_ids.end()) {
+            term_ids.push_back(term_id);
+        }
+        trie_.insert(term, static_cast<uint32_t>(postings_[term_id].size()));
+    }
+}
+
+void SearchEngine::remove_track(size_t id) {
+    const auto track_id = static_cast<uint32_t>(id);
+    ensure_writable();
+    ++generation_;
+    
+    if (track_id >= track_terms_.size()) {
+        return; // Never indexed
+    }
+    
+    // Remove from the posting lists of this track's terms only. Emptied
+    // terms keep their ids but leave the autocomplete trie.
+    for (uint32_t term_id : track_terms_[track_id]) {
+        auto& entries = postings_[term_id];
+        auto it = std::lower_bound(entries.begin(), entries.end(), track_id,
+            [](const Posting& posting, uint32_t value) { return posting.track_id < value; });
+        if (it == entries.end() || it->track_id != track_id) continue;
+        
+        entries.erase(it);
+        if (entries.empty()) {
+            --live_terms_;
+            trie_.erase(terms_[term_id]);
+            positions_[term_id].clear();
+            blocks_[term_id].clear();
+        } else {
+            trie_.insert(terms_[term_id], static_cast<uint32_t>(entries.size()));
+            rebuild_blocks(term_id);
+        }
+    }
+    track_terms_[track_id].clear();
+    
+    auto& lengths = field_lengths_[track_id];
+    bool was_indexed = false;
+    for (size_t f = 0; f < kFieldCount; ++f) {
+        was_indexed = was_indexed || lengths[f] > 0;
+        total_field_lengths_[f] -= lengths[f];
+        lengths[f] = 0;
+    }
+    if (was_indexed) {
+        --indexed_tracks_;
+    }
+}
+
+void SearchEngine::clear_index() {
+    ++generation_;
+    term_ids_.clear();
+    terms_.clear();
+    postings_.clear();
+    live_terms_ = 0;
+    blocks_.clear();
+    positions_.clear();
+    track_terms_.clear();
+    field_lengths_.clear();
+    total_field_lengths_ = {};
+    indexed_tracks_ = 0;
+    trigram_index_.clear();
+    trie_.clear();
+    segment_.reset();
+}
+
+void SearchEngine::rebuild_index(const std::vector<TrackPtr>& tracks, size_t thread_count) {
+    clear_index();
+    index_tracks(tracks, 0, thread_count);
+}
+
+// Tracks of a batch indexed apart from the engine. Each part is one
+// contiguous range of the batch, indexed on its own with terms numbered in
+// order of first appearance; merging the parts in order then numbers every
+// term exactly as a sequential build would. Track ids count from the start
+// of the batch until the merge.
+struct SearchEngine::PreparedTracks {
+    struct Part {
+        std::unordered_map<std::string, uint32_t> term_ids;
+        std::vector<std::string> terms;
+        std::vector<std::vector<Posting>> postings;
+        std::vector<std::vector<uint8_t>> positions;
+        std::vector<FieldLengths> field_lengths;       // Per track of the range
+        std::vector<std::vector<uint32_t>> track_terms; // Per track, local term ids
+        std::array<uint64_t, kFieldCount> total_field_lengths{};
+        size_t begin = 0;
+        size_t indexed_tracks = 0;
+        std::vector<uint32_t> merged_ids;     // Local term id -> final term id
+        std::vector<size_t> offsets;          // Start of this range in each final posting list
+        std::vector<uint32_t> byte_offsets;   // Start of this range in each term's positions
+    };
+    std::vector<Part> parts;
+    size_t count = 0;
+    bool store_positions = true;
+};
+
+namespace {
+
+size_t build_thread_count(size_t count, size_t requested) {
+    if (requested == 0) {
+        requested = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return std::max<size_t>(1, std::min(requested, count / SearchEngine::kMinTracksPerBuildThread));
+}
+
+} // namespace
+
+void SearchEngine::index_tracks(const std::vector<TrackPtr>& tracks, size_t first, size_t thread_count) {
+    if (first >= tracks.size()) {
+        return;
+    }
+    
+    const size_t count = tracks.size() - first;
+    thread_count = build_thread_count(count, thread_count);
+    if (thread_count > 1) {
+        add_prepared_tracks(*prepare_tracks(tracks, first, thread_count), first);
+        return;
+    }
+    
+    ensure_writable();
+    ++generation_;
+    for (size_t i = first; i < tracks.size(); ++i) {
+        if (tracks[i]) {
+            index_track(i, *tracks[i]);
+        }
+    }
+    if (count >= first) {
+        trie_.freeze(); // Cheap next to a batch at least the size of the index
+    }
+}
+
+std::shared_ptr<SearchEngine::PreparedTracks> SearchEngine::prepare_tracks(
+    const std::vector<TrackPtr>& tracks, size_t first, size_t thread_count) const {
+    
+    auto prepared = std::make_shared<PreparedTracks>();
+    prepared->count = tracks.size() - std::min(first, tracks.size());
+    prepared->store_positions = store_positions_;
+    thread_count = build_thread_count(prepared->count, thread_count);
+    prepared->parts.resize(thread_count);
+    const size_t range = (prepared->count + thread_count - 1) / thread_count;
+    
+    run_parallel(thread_count, [&](size_t t) {
+        auto& part = prepared->parts[t];
+        TrackTerms terms;
+        std::string key;
+        part.begin = std::min(prepared->count, t * range);
+        const size_t end = std::min(prepared->count, (t + 1) * range);
+        part.field_lengths.resize(end - part.begin);
+        part.track_terms.resize(end - part.begin);
+        
+        for (size_t i = part.begin; i < end; ++i) {
+            const auto& track = tracks[first + i];
+            if (!track) continue;
+            
+            const auto tokens = count_terms(*track, terms);
+            add_field_lengths(part.field_lengths[i - part.begin], tokens);
+            for (size_t f = 0; f < kFieldCount; ++f) {
+                part.total_field_lengths[f] += tokens[f];
+            }
+            if (terms.counts.empty()) continue;
+            ++part.indexed_tracks;
+            
+            auto& term_ids = part.track_terms[i - part.begin];
+            term_ids.reserve(terms.counts.size());
+            for (size_t entry = 0; entry < terms.counts.size(); ++entry) {
+                const auto& [term, term_frequency] = terms.counts[entry];
+                key.assign(term);
+                auto [it, inserted] = part.term_ids.try_emplace(key, static_cast<uint32_t>(part.terms.size()));
+                if (inserted) {
+                    part.terms.push_back(key);
+                    part.postings.emplace_back();
+                    part.positions.emplace_back();
+                }
+                
+                Posting posting{static_cast<uint32_t>(i), term_frequency, kNoPositions};
+                if (prepared->store_positions) {
+                    // Offsets are local to the range until the merge
+                    encode_positions(terms, entry, {});
+                    auto& bytes = part.positions[it->second];
+                    posting.positions = static_cast<uint32_t>(bytes.size());
+                    bytes.insert(bytes.end(), terms.positions.begin(), terms.positions.end());
+                }
+                part.postings[it->second].push_back(posting);
+                term_ids.push_back(it->second);
+            }
+        }
+        part.term_ids.clear();
+    });
+    return prepared;
+}
+
+bool SearchEngine::add_prepared_tracks(PreparedTracks& prepared, size_t first) {
+    if (prepared.store_positions != store_positions_) {
+        return false;
+    }
+    if (prepared.count == 0) {
+        return true;
+    }
+    ensure_writable();
+    ++generation_;
+    
+    auto& parts = prepared.parts;
+    const size_t thread_count = parts.size();
+    const size_t count = prepared.count;
+    field_lengths_.resize(std::max(field_lengths_.size(), first + count), {});
+    track_terms_.resize(std::max(track_terms_.size(), first + count));
+    
+    // Merge the dictionaries in range order and work out where each range's
+    // postings land, after those already in the index
+    const size_t known_terms = terms_.size();
+    std::vector<size_t> document_frequency(known_terms);
+    std::vector<uint32_t> position_bytes(known_terms);
+    for (size_t id = 0; id < known_terms; ++id) {
+        document_frequency[id] = postings_[id].size();
+        position_bytes[id] = static_cast<uint32_t>(positions_[id].size());
+    }
+    std::vector<uint32_t> touched; // Terms given postings, each once
+    for (auto& part : parts) {
+        part.merged_ids.resize(part.terms.size());
+        part.offsets.resize(part.terms.size());
+        part.byte_offsets.resize(part.terms.size());
+        for (size_t local = 0; local < part.terms.size(); ++local) {
+            auto [it, inserted] = term_ids_.try_emplace(part.terms[local], static_cast<uint32_t>(terms_.size()));
+            if (inserted) {
+                terms_.push_back(std::move(part.terms[local]));
+                document_frequency.push_back(0);
+                position_bytes.push_back(0);
+            }
+            const uint32_t id = it->second;
+            // A term already seen in an earlier range is touched already
+            if (inserted || (id < known_terms && document_frequency[id] == postings_[id].size())) {
+                touched.push_back(id);
+                if (document_frequency[id] == 0) {
+                    ++live_terms_; // New, or emptied by removals
+                }
+            }
+            part.merged_ids[local] = it->second;
+            part.offsets[local] = document_frequency[it->second];
+            document_frequency[it->second] += part.postings[local].size();
+            part.byte_offsets[local] = position_bytes[it->second];
+            position_bytes[it->second] += static_cast<uint32_t>(part.positions[local].size());
+        }
+        
+        for (size_t f = 0; f < kFieldCount; ++f) {
+            total_field_lengths_[f] += part.total_field_lengths[f];
+        }
+        indexed_tracks_ += part.indexed_tracks;
+    }
+    std::sort(touched.begin(), touched.end());
+    
+    postings_.resize(terms_.size());
+    blocks_.resize(terms_.size());
+    positions_.resize(terms_.size());
+    run_parallel(thread_count, [&](size_t t) {
+        for (size_t i = t; i < touched.size(); i += thread_count) {
+            postings_[touched[i]].resize(document_frequency[touched[i]]);
+            positions_[touched[i]].resize(position_bytes[touched[i]]);
+        }
+    });
+    
+    // Copy every range into place while the trigram index and the trie,
+    // which only need the vocabulary, are built alongside
+    run_parallel(thread_count + 2, [&](size_t t) {
+        if (t == thread_count) {
+            for (size_t id = known_terms; id < terms_.size(); ++id) {
+                add_to_trigram_index(terms_[id], static_cast<uint32_t>(id));
+            }
+            return;
+        }
+        if (t == thread_count + 1) {
+            for (uint32_t id : touched) {
+                trie_.insert(terms_[id], static_cast<uint32_t>(document_frequency[id]));
+            }
+            if (count >= first) {
+                trie_.freeze();
+            }
+            return;
+        }
+        
+        auto& part = parts[t];
+        for (size_t local = 0; local < part.postings.size(); ++local) {
+            const uint32_t id = part.merged_ids[local];
+            auto out = postings_[id].begin() + static_cast<std::ptrdiff_t>(part.offsets[local]);
+            for (Posting posting : part.postings[local]) {
+                posting.track_id += static_cast<uint32_t>(first);
+                if (posting.positions != kNoPositions) {
+                    posting.positions += part.byte_offsets[local];
+                }
+                *out++ = posting;
+            }
+            std::copy(part.positions[local].begin(), part.positions[local].end(),
+                      positions_[id].begin() + part.byte_offsets[local]);
+        }
+        
+        for (size_t i = 0; i < part.track_terms.size(); ++i) {
+            const size_t track_id = first + part.begin + i;
+            for (auto& term_id : part.track_terms[i]) {
+                term_id = part.merged_ids[term_id];
+            }
+            track_terms_[track_id] = std::move(part.track_terms[i]);
+            field_lengths_[track_id] = part.field_lengths[i];
+        }
+    });
+    
+    // Block summaries need each posting list complete; earlier postings
+    // keep theirs
+    run_parallel(thread_count, [&](size_t t) {
+        for (size_t i = t; i < touched.size(); i += thread_count) {
+            const auto& entries = postings_[touched[i]];
+            auto from = std::lower_bound(entries.begin(), entries.end(), static_cast<uint32_t>(first),
+                [](const Posting& posting, uint32_t value) { return posting.track_id < value; });
+            for (auto it = from; it != entries.end(); ++it) {
+                update_block(touched[i], static_cast<size_t>(it - entries.begin()));
+            }
+        }
+    });
+    prepared.parts.clear();
+    prepared.count = 0;
+    return true;
+}
+
+std::array<uint32_t, SearchEngine::kFieldCount> SearchEngine::count_terms(
+    const Track& track, TrackTerms& terms) const {
+    
+    // Count occurrences of each term per field, so that every term gets a
+    // single posting for the track
+    auto& tokenizer = terms.tokenizer;
+    tokenizer.clear();
+    terms.counts.clear();
+    terms.first_token.clear();
+    terms.last_token.clear();
+    std::array<uint32_t, kFieldCount> tokens{};
+    tokens[static_cast<size_t>(Field::TITLE)] = static_cast<uint32_t>(tokenizer.append(track.title()));
+    tokens[static_cast<size_t>(Field::ARTIST)] = static_cast<uint32_t>(tokenizer.append(track.artist()));
+    tokens[static_cast<size_t>(Field::ALBUM)] = static_cast<uint32_t>(tokenizer.append(track.album()));
+    tokens[static_cast<size_t>(Field::GENRE)] = static_cast<uint32_t>(tokenizer.append(track.genre()));
+    for (size_t f = 0; f < kFieldCount; ++f) {
+        terms.field_begin[f + 1] = terms.field_begin[f] + tokens[f];
+    }
+    terms.next_token.assign(tokenizer.size(), kNoToken);
+    
+    // Views are only taken once every field is in the tokenizer's buffer
+    for (size_t f = 0; f < kFieldCount; ++f) {
+        for (uint32_t i = terms.field_begin[f]; i < terms.field_begin[f + 1]; ++i) {
+            std::string_view token = tokenizer[i];
+            auto it = std::find_if(terms.counts.begin(), terms.counts.end(),
+                [token](const auto& entry) { return entry.first == token; });
+            const auto entry = static_cast<size_t>(it - terms.counts.begin());
+            if (it == terms.counts.end()) {
+                terms.counts.emplace_back(token, std::array<uint16_t, kFieldCount>{});
+                terms.first_token.push_back(i);
+                terms.last_token.push_back(i);
+            } else {
+                terms.next_token[terms.last_token[entry]] = i;
+                terms.last_token[entry] = i;
+            }
+            auto& frequency = terms.counts[entry].second[f];
+            frequency = saturating_increment(frequency);
+        }
+    }
+    return tokens;
+}
+
+void SearchEngine::encode_positions(TrackTerms& terms, size_t entry,
+                                    const std::array<uint16_t, kFieldCount>& base) const {
+    const auto& frequency = terms.counts[entry].second;
+    auto& out = terms.positions;
+    out.clear();
+    
+    // The chain visits the term's tokens in order, so field by field
+    std::array<uint16_t, kFieldCount> written{};
+    uint32_t previous = 0;
+    size_t f = 0;
+    for (uint32_t i = terms.first_token[entry]; i != kNoToken; i = terms.next_token[i]) {
+        while (i >= terms.field_begin[f + 1]) {
+            ++f;
+            previous = 0;
+        }
+        if (written[f] == frequency[f]) continue; // Beyond a saturated count
+        
+        const uint32_t position = base[f] + (i - terms.field_begin[f]);
+        append_varint(out, position - previous);
+        previous = position;
+        ++written[f];
+    }
+}
+
+void SearchEngine::decode_positions(uint32_t term_id, const Posting& posting, Field field,
+                                    std::vector<uint32_t>& positions) const {
+    const uint8_t* data = term_positions(term_id).data() + posting.positions;
+    const auto target = static_cast<size_t>(field);
+    for (size_t f = 0; f < target; ++f) {
+        for (uint16_t n = 0; n < posting.term_frequency[f]; ++n) {
+            read_varint(data);
+        }
+    }
+    
+    uint32_t position = 0;
+    for (uint16_t n = 0; n < posting.term_frequency[target]; ++n) {
+        position += read_varint(data);
+        positions.push_back(position);
+    }
+}
+
+std::vector<SearchEngine::SearchResult> SearchEngine::search(
+    const std::string& query, const SearchOptions& options) const {
+    
+    if (query.empty()) {
+        return {};
+    }
+    
+    const std::string key = result_cache_key(query, options);
+    std::vector<SearchResult> cached;
+    if (find_cached_results(key, cached)) {
+        return cached;
+    }
+    
+    auto results = run_query(query, options, nullptr);
+    store_cached_results(key, results);
+    return results;
+}
+
+std::vector<std::vector<SearchEngine::SearchResult>> SearchEngine::search_batch(
+    const std::vector<Query>& queries, size_t thread_count) const {
+    
+    constexpr size_t kNone = std::numeric_limits<size_t>::max();
+    std::vector<std::vector<SearchResult>> results(queries.size());
+    
+    // Identical queries, by the same key the result cache uses, are
+    // answered once from the first of them
+    std::unordered_map<std::string, size_t> first_with_key;
+    std::vector<std::string> keys;
+    std::vector<size_t> distinct;
+    std::vector<size_t> source(queries.size(), kNone);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        if (queries[i].text.empty()) continue;
+        
+        auto key = result_cache_key(queries[i].text, queries[i].options);
+        auto [it, inserted] = first_with_key.try_emplace(key, i);
+        source[i] = it->second;
+        if (inserted) {
+            keys.push_back(std::move(key));
+            distinct.push_back(i);
+        }
+    }
+    
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    thread_count = std::max<size_t>(1, std::min(thread_count, distinct.size() / kMinQueriesPerBatchThread));
+    
+    // Threads take the next distinct query until none are left
+    TermExpansions expansions;
+    std::atomic<size_t> next{0};
+    run_parallel(thread_count, [&](size_t) {
+        for (size_t d = next++; d < distinct.size(); d = next++) {
+            const auto& query = queries[distinct[d]];
+            auto& found = results[distinct[d]];
+            if (!find_cached_results(keys[d], found)) {
+                found = run_query(query.text, query.options, &expansions);
+                store_cached_results(keys[d], found);
+            }
+        }
+    });
+    
+    for (size_t i = 0; i < queries.size(); ++i) {
+        if (source[i] != kNone && source[i] != i) {
+            results[i] = results[source[i]];
+        }
+    }
+    return results;
+}
+
+std::vector<SearchEngine::SearchResult> SearchEngine::run_query(
+    const std::string& query, const SearchOptions& options, TermExpansions* expansions) const {
+    
+    std::vector<QueryClause> clauses;
+    if (options.mode == SearchMode::REGEX) {
+        // A pattern may contain spaces and operators of its own, so it is
+        // matched against the vocabulary as a whole
+        clauses.emplace_back();
+        search_regex(query, options, clauses.back().terms);
+    } else {
+        clauses = parse_query(query, options, expansions);
+    }
+    
+    thread_local ScoreAccumulator scores;
+    scores.reset();
+    evaluate_query(clauses, options, scores);
+    
+    auto results = select_top_results(scores, options);
+    scores.reset();
+    return results;
+}
+
+std::vector<SearchEngine::QueryClause> SearchEngine::parse_query(
+    const std::string& query, const SearchOptions& options, TermExpansions* expansions) const {
+    
+    constexpr size_t kNone = std::numeric_limits<size_t>::max();
+    std::vector<QueryClause> clauses;
+    size_t last_required = kNone; // Clause the previous positive word went to
+    size_t or_target = kNone;     // Clause the next positive word joins
+    bool exclude_next = false;
+    
+    // Split on whitespace before tokenizing so that operators, quotes and
+    // the '-' prefix are still visible
+    std::vector<std::string> words;
+    {
+        std::stringstream ss(query);
+        std::string word;
+        while (ss >> word) {
+            words.push_back(std::move(word));
+        }
+    }
+    
+    Tokenizer tokenizer;
+    uint32_t distance = 0;
+    
+    // Adds the tokens of word to a phrase or NEAR clause, each matching
+    // exactly and as its own word
+    auto add_group_word = [&](QueryClause& clause, const std::string& word) {
+        tokenizer.clear();
+        tokenizer.append(word, options.case_sensitive);
+        for (size_t i = 0; i < tokenizer.size(); ++i) {
+            clause.words.emplace_back();
+            search_exact(std::string(tokenizer[i]), clause.words.back());
+            clause.terms.insert(clause.terms.end(), clause.words.back().begin(), clause.words.back().end());
+        }
+    };
+    
+    for (size_t k = 0; k < words.size(); ++k) {
+        std::string word = words[k];
+        if (word == "OR") {
+            or_target = last_required;
+            continue;
+        }
+        if (word == "AND" || parse_near(word, distance)) {
+            continue; // NEAR without a word before it reads as AND
+        }
+        if (word == "NOT") {
+            exclude_next = true;
+            continue;
+        }
+        
+        bool excluded = exclude_next;
+        exclude_next = false;
+        if (word.size() > 1 && word.front() == '-') {
+            excluded = true;
+            word.erase(0, 1);
+        }
+        
+        // Quoted phrases and NEAR groups always form clauses of their own
+        const bool phrase = word.front() == '"';
+        const bool near = !phrase && k + 2 < words.size() && parse_near(words[k + 1], distance);
+        if (phrase || near) {
+            QueryClause clause;
+            clause.excluded = excluded;
+            add_group_word(clause, word);
+            if (phrase) {
+                // The tokenizer strips the quotes; an unclosed phrase runs
+                // to the end of the query
+                clause.proximity = QueryClause::Proximity::PHRASE;
+                bool closed = word.size() > 1 && word.back() == '"';
+                while (!closed && k + 1 < words.size()) {
+                    const std::string& next = words[++k];
+                    closed = next.back() == '"';
+                    add_group_word(clause, next);
+                }
+            } else {
+                clause.proximity = QueryClause::Proximity::NEAR;
+                clause.distance = distance;
+                while (k + 2 < words.size() && parse_near(words[k + 1], distance)) {
+                    clause.distance = std::max(clause.distance, distance);
+                    add_group_word(clause, words[k + 2]);
+                    k += 2;
+                }
+            }
+            
+            if (clause.words.empty()) {
+                continue; // Punctuation only
+            }
+            if (clause.words.size() == 1) {
+                clause.proximity = QueryClause::Proximity::NONE;
+            }
+            if (!excluded) {
+                last_required = clauses.size();
+                or_target = kNone;
+            }
+            clauses.push_back(std::move(clause));
+            continue;
+        }
+        
+        tokenizer.clear();
+        if (tokenizer.append(word, options.case_sensitive) == 0) {
+            continue; // Punctuation only
+        }
+        
+        size_t target = kNone;
+        if (!excluded) {
+            target = or_target != kNone ? or_target
+                   : options.match_all_terms ? kNone : last_required;
+        }
+        if (target != kNone && clauses[target].proximity != QueryClause::Proximity::NONE) {
+            target = kNone; // Groups take no alternatives
+        }
+        if (target == kNone) {
+            target = clauses.size();
+            clauses.emplace_back();
+            clauses.back().excluded = excluded;
+        }
+        
+        for (size_t i = 0; i < tokenizer.size(); ++i) {
+            match_term(std::string(tokenizer[i]), options, clauses[target].terms, expansions);
+        }
+        if (!excluded) {
+            last_required = target;
+            or_target = kNone;
+        }
+    }
+    
+    return clauses;
+}
+
+void SearchEngine::evaluate_query(std::vector<QueryClause>& clauses, const SearchOptions& options,
+                                  ScoreAccumulator& scores) const {
+    std::vector<const QueryClause*> required;
+    std::vector<const QueryClause*> excluded;
+    
+    for (auto& clause : clauses) {
+        // Alternatives may expand to the same term; keep its best match
+        std::sort(clause.terms.begin(), clause.terms.end());
+        TermMatches unique;
+        for (const auto& [term_id, quality] : clause.terms) {
+            if (!unique.empty() && unique.back().first == term_id) {
+                unique.back().second = std::max(unique.back().second, quality);
+            } else {
+                unique.emplace_back(term_id, quality);
+                clause.estimated_size += term_postings(term_id).size();
+            }
+        }
+        clause.terms.swap(unique);
+        
+        const bool unmatched = clause.terms.empty() ||
+            std::any_of(clause.words.begin(), clause.words.end(),
+                [](const TermMatches& word) { return word.empty(); });
+        if (clause.excluded) {
+            if (!unmatched) excluded.push_back(&clause);
+        } else if (unmatched) {
+            return; // A required word matched nothing
+        } else {
+            required.push_back(&clause);
+        }
+    }
+    
+    if (required.empty()) {
+        return; // Exclusions alone match nothing
+    }
+    
+    // A single clause needs no intersection: every posting of its terms is
+    // a result, unless their positions must be checked
+    if (required.size() == 1 && excluded.empty() &&
+        required.front()->proximity == QueryClause::Proximity::NONE) {
+        const auto& clause = *required.front();
+        if (can_prune(options) && clause.terms.size() <= kMaxPrunedTerms &&
+            clause.estimated_size / kMinPostingsPerResultToPrune > options.max_results) {
+            score_top_k(clause.terms, options, scores);
+            return;
+        }
+        for (const auto& [term_id, quality] : clause.terms) {
+            score_term(term_id, quality, options, scores);
+        }
+        return;
+    }
+    
+    // Start from the rarest clause so every later step probes as few
+    // candidates as possible into the longer lists
+    std::sort(required.begin(), required.end(),
+        [](const QueryClause* a, const QueryClause* b) { return a->estimated_size < b->estimated_size; });
+    
+    std::vector<uint32_t> candidates = collect_track_ids(*required.front(), options);
+    for (size_t i = 1; i < required.size() && !candidates.empty(); ++i) {
+        filter_candidates(candidates, *required[i], options, true);
+    }
+    for (size_t i = 0; i < excluded.size() && !candidates.empty(); ++i) {
+        filter_candidates(candidates, *excluded[i], options, false);
+    }
+    if (candidates.empty()) {
+        return;
+    }
+    
+    for (const auto* clause : required) {
+        for (const auto& [term_id, quality] : clause->terms) {
+            score_term(term_id, quality, options, scores, &candidates);
+        }
+    }
+}
+
+std::vector<uint32_t> SearchEngine::collect_track_ids(const QueryClause& clause,
+                                                      const SearchOptions& options) const {
+    if (clause.proximity == QueryClause::Proximity::NONE) {
+        return union_track_ids(clause.terms, clause.estimated_size, options);
+    }
+    
+    // Tracks holding every word of the group, then those where the words
+    // are placed as required
+    auto track_ids = union_track_ids(clause.words.front(), clause.estimated_size, options);
+    std::vector<uint32_t> word_ids;
+    std::vector<uint32_t> common;
+    for (size_t w = 1; w < clause.words.size() && !track_ids.empty(); ++w) {
+        word_ids = union_track_ids(clause.words[w], clause.estimated_size, options);
+        common.clear();
+        std::set_intersection(track_ids.begin(), track_ids.end(), word_ids.begin(), word_ids.end(),
+                              std::back_inserter(common));
+        track_ids.swap(common);
+    }
+    track_ids.erase(std::remove_if(track_ids.begin(), track_ids.end(),
+        [&](uint32_t track_id) { return !matches_proximity(track_id, clause, options); }),
+        track_ids.end());
+    return track_ids;
+}
+
+std::vector<uint32_t> SearchEngine::union_track_ids(const TermMatches& terms, size_t estimated_size,
+                                                    const SearchOptions& options) const {
+    std::vector<uint32_t> track_ids;
+    track_ids.reserve(estimated_size);
+    for (const auto& match : terms) {
+        for (const auto& posting : term_postings(match.first)) {
+            if (matches_fields(posting, options)) {
+                track_ids.push_back(posting.track_id);
+            }
+        }
+    }
+    
+    // Each posting list is already sorted; only unions need a merge
+    if (terms.size() > 1) {
+        std::sort(track_ids.begin(), track_ids.end());
+        track_ids.erase(std::unique(track_ids.begin(), track_ids.end()), track_ids.end());
+    }
+    return track_ids;
+}
+
+void SearchEngine::filter_candidates(std::vector<uint32_t>& candidates, const QueryClause& clause,
+                                     const SearchOptions& options, bool keep_matches) const {
+    std::vector<uint32_t> kept;
+    kept.reserve(candidates.size());
+    
+    if (clause.proximity != QueryClause::Proximity::NONE &&
+        candidates.size() * clause.terms.size() <= clause.estimated_size) {
+        // Few candidates: look each one up in the words' postings and check
+        // the positions there
+        for (uint32_t track_id : candidates) {
+            if (matches_proximity(track_id, clause, options) == keep_matches) {
+                kept.push_back(track_id);
+            }
+        }
+    } else if (clause.proximity == QueryClause::Proximity::NONE &&
+               candidates.size() * clause.terms.size() <= clause.estimated_size) {
+        // Few candidates: gallop through each term's postings in step with
+        // them, never reading most of the lists
+        std::vector<size_t> cursors(clause.terms.size(), 0);
+        for (uint32_t track_id : candidates) {
+            bool found = false;
+            for (size_t t = 0; t < clause.terms.size() && !found; ++t) {
+                const auto entries = term_postings(clause.terms[t].first);
+                cursors[t] = gallop(entries, cursors[t], track_id,
+                    [](const Posting& posting) { return posting.track_id; });
+                found = cursors[t] < entries.size() && entries[cursors[t]].track_id == track_id &&
+                        matches_fields(entries[cursors[t]], options);
+            }
+            if (found == keep_matches) {
+                kept.push_back(track_id);
+            }
+        }
+    } else {
+        const auto track_ids = collect_track_ids(clause, options);
+        size_t cursor = 0;
+        for (uint32_t track_id : candidates) {
+            cursor = gallop(track_ids, cursor, track_id, [](uint32_t id) { return id; });
+            bool found = cursor < track_ids.size() && track_ids[cursor] == track_id;
+            if (found == keep_matches) {
+                kept.push_back(track_id);
+            }
+        }
+    }
+    
+    candidates.swap(kept);
+}
+
+bool SearchEngine::matches_proximity(uint32_t track_id, const QueryClause& clause,
+                                     const SearchOptions& options) const {
+    thread_local std::vector<std::vector<uint32_t>> word_positions;
+    if (word_positions.size() < clause.words.size()) {
+        word_positions.resize(clause.words.size());
+    }
+    
+    // NEAR words matching the same terms share their first one's positions
+    thread_local std::vector<uint32_t> needed;
+    needed.assign(clause.words.size(), 0);
+    for (size_t w = 0; w < clause.words.size(); ++w) {
+        size_t first = 0;
+        while (clause.words[first] != clause.words[w]) ++first;
+        ++needed[first];
+    }
+    
+    // The words must be placed as required within a single field
+    for (size_t f = 0; f < kFieldCount; ++f) {
+        const auto field = static_cast<Field>(f);
+        if (!should_search_field(field, options)) continue;
+        
+        bool all_present = true;
+        bool unpositioned = false;
+        for (size_t w = 0; w < clause.words.size() && all_present; ++w) {
+            auto& positions = word_positions[w];
+            positions.clear();
+            bool present = false;
+            for (const auto& match : clause.words[w]) {
+                const auto entries = term_postings(match.first);
+                auto it = std::lower_bound(entries.begin(), entries.end(), track_id,
+                    [](const Posting& posting, uint32_t value) { return posting.track_id < value; });
+                if (it == entries.end() || it->track_id != track_id || it->term_frequency[f] == 0) continue;
+                
+                present = true;
+                if (it->positions == kNoPositions) {
+                    unpositioned = true;
+                } else {
+                    decode_positions(match.first, *it, field, positions);
+                }
+            }
+            if (clause.words[w].size() > 1) {
+                std::sort(positions.begin(), positions.end());
+            }
+            all_present = present;
+        }
+        if (!all_present) continue;
+        
+        // Tracks indexed without positions can only be checked for presence
+        if (unpositioned) {
+            return true;
+        }
+        if (clause.proximity == QueryClause::Proximity::PHRASE
+                ? contains_phrase(word_positions, clause.words.size())
+                : within_distance(word_positions, needed, clause.distance)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<SearchEngine::SearchResult> SearchEngine::select_top_results(
+    const ScoreAccumulator& scores, const SearchOptions& options) const {
+    
+    if (!tracks_ || options.max_results == 0) {
+        return {};
+    }
+    
+    // Higher score first; ties go to the lower track id so results are stable
+    using Candidate = std::pair<double, uint32_t>;
+    auto better = [](const Candidate& a, const Candidate& b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    };
+    
+    // Bounded heap whose front is the weakest of the best max_results seen
+    std::vector<Candidate> heap;
+    heap.reserve(std::min(options.max_results, scores.touched.size()));
+    
+    for (uint32_t track_id : scores.touched) {
+        Candidate candidate{scores.scores[track_id], track_id};
+        if (candidate.first < options.min_relevance || track_id >= tracks_->size()) {
+            continue;
+        }
+        
+        if (heap.size() < options.max_results) {
+            heap.push_back(candidate);
+            std::push_heap(heap.begin(), heap.end(), better);
+        } else if (better(candidate, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = candidate;
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+    }
+    
+    std::sort_heap(heap.begin(), heap.end(), better);
+    
+    std::vector<SearchResult> results;
+    results.reserve(heap.size());
+    for (const auto& [score, track_id] : heap) {
+        results.emplace_back((*tracks_)[track_id], score);
+    }
+    return results;
+}
+
+double SearchEngine::term_weight(uint32_t term_id, double match_quality) const {
+    // Probabilistic IDF, kept positive even for terms in most tracks
+    const double df = static_cast<double>(term_postings(term_id).size());
+    const double n = static_cast<double>(indexed_tracks_);
+    const double idf = std::log(1.0 + (n - df + 0.5) / (df + 0.5));
+    return match_quality * idf;
+}
+
+std::array<double, SearchEngine::kFieldCount> SearchEngine::average_field_lengths() const {
+    std::array<double, kFieldCount> average_lengths{};
+    for (size_t f = 0; f < kFieldCount; ++f) {
+        average_lengths[f] = static_cast<double>(total_field_lengths_[f]) / static_cast<double>(indexed_tracks_);
+    }
+    return average_lengths;
+}
+
+double SearchEngine::weighted_term_frequency(const Posting& posting,
+                                             const std::array<double, kFieldCount>& average_lengths,
+                                             const SearchOptions& options) const {
+    const auto& lengths = track_field_lengths(posting.track_id);
+    
+    double tf = 0.0;
+    for (size_t f = 0; f < kFieldCount; ++f) {
+        if (posting.term_frequency[f] == 0 || !should_search_field(static_cast<Field>(f), options)) {
+            continue;
+        }
+        const double b = scoring_.field_length_normalization[f];
+        const double normalization = 1.0 - b + b * lengths[f] / average_lengths[f];
+        tf += scoring_.field_weights[f] * posting.term_frequency[f] / normalization;
+    }
+    return tf;
+}
+
+double SearchEngine::saturate(double weight, double term_frequency) const {
+    // Written so that, evaluated in floating point, the score never falls
+    // as term_frequency grows; bounds on it then hold to the last bit
+    const double k1 = scoring_.k1;
+    return term_frequency > 0.0 ? weight * (k1 + 1.0) * (1.0 - k1 / (term_frequency + k1)) : 0.0;
+}
+
+double SearchEngine::score_posting(const Posting& posting, double weight,
+                                   const std::array<double, kFieldCount>& average_lengths,
+                                   const SearchOptions& options) const {
+    return saturate(weight, weighted_term_frequency(posting, average_lengths, options));
+}
+
+double SearchEngine::term_frequency_bound(const BlockSummary& block,
+                                          const std::array<double, kFieldCount>& average_lengths,
+                                          const SearchOptions& options) const {
+    // In each field, the most frequent occurrence over the shortest field
+    // is at least as strong as any posting of the block
+    std::array<double, kFieldCount> field_tf{};
+    for (size_t f = 0; f < kFieldCount; ++f) {
+        if (block.max_term_frequency[f] == 0 || !should_search_field(static_cast<Field>(f), options)) {
+            continue;
+        }
+        const double b = scoring_.field_length_normalization[f];
+        const double normalization = 1.0 - b + b * block.min_field_length[f] / average_lengths[f];
+        field_tf[f] = scoring_.field_weights[f] * block.max_term_frequency[f] / normalization;
+    }
+    
+    // No posting combines more than max_fields of those. Sums stay in field
+    // order, as in weighted_term_frequency, so rounding cannot undercut it.
+    double tf = 0.0;
+    for (unsigned mask = 1; mask < (1u << kFieldCount); ++mask) {
+        double sum = 0.0;
+        size_t fields = 0;
+        for (size_t f = 0; f < kFieldCount; ++f) {
+            if (mask & (1u << f)) {
+                sum += field_tf[f];
+                ++fields;
+            }
+        }
+        if (fields <= block.max_fields) {
+            tf = std::max(tf, sum);
+        }
+    }
+    return tf;
 }
 
-SearchEngine::~SearchEngine() = default;
-
-void SearchEngine::index_track(size_t id, const Track& track) {
-    // Tokenize and index each field
-    auto index_field = [this, id](const std::string& text, const std::string& field, double weight) {
-        auto tokens = tokenize(text);
-        for (const auto& token : tokens) {
-            add_to_inverted_index(token, id, field, weight);
-            add_to_trie(token);
+std::vector<double> SearchEngine::block_term_frequency_maxima(
+    uint32_t term_id, const std::array<double, kFieldCount>& average_lengths) const {
+    {
+        std::lock_guard lock(block_maxima_mutex_);
+        if (term_id < block_maxima_.size() && block_maxima_[term_id].generation == generation_) {
+            return block_maxima_[term_id].term_frequency;
         }
-    };
+    }
     
-    index_field(track.title(), "title", 1.0);
-    index_field(track.artist(), "artist", 0.8);
-    if (!track.album().empty()) {
-        index_field(track.album(), "album", 0.6);
+    // Over every field: leaving fields out of a search only lowers the sum
+    const SearchOptions all_fields;
+    const auto entries = term_postings(term_id);
+    std::vector<double> maxima((entries.size() + kBlockSize - 1) / kBlockSize, 0.0);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        auto& maximum = maxima[i / kBlockSize];
+        maximum = std::max(maximum, weighted_term_frequency(entries[i], average_lengths, all_fields));
     }
-    if (!track.genre().empty()) {
-        index_field(track.genre(), "genre", 0.4);
+    
+    std::lock_guard lock(block_maxima_mutex_);
+    if (term_id >= block_maxima_.size()) {
+        block_maxima_.resize(term_count());
     }
+    block_maxima_[term_id] = {generation_, maxima};
+    return maxima;
 }
 
-void SearchEngine::remove_track(size_t id) {
-    // Remove from inverted index
-    for (auto& [term, entries] : inverted_index_) {
-        entries.erase(std::remove_if(entries.begin(), entries.end(),
-            [id](const IndexEntry& entry) { return entry.track_id == id; }),
-            entries.end());
+void SearchEngine::score_term(uint32_t term_id, double match_quality, const SearchOptions& options,
+                              ScoreAccumulator& scores,
+                              const std::vector<uint32_t>* candidates) const {
+    const auto entries = term_postings(term_id);
+    if (entries.empty() || indexed_tracks_ == 0) {
+        return;
     }
     
-    // Clean up empty entries
-    for (auto it = inverted_index_.begin(); it != inverted_index_.end(); ) {
-        if (it->second.empty()) {
-            it = inverted_index_.erase(it);
-        } else {
-            ++it;
+    const double weight = term_weight(term_id, match_quality);
+    const auto average_lengths = average_field_lengths();
+    auto score_posting = [&](const Posting& posting) {
+        const double score = this->score_posting(posting, weight, average_lengths, options);
+        if (score > 0.0) {
+            scores.add(posting.track_id, score);
+        }
+    };
+    
+    if (!candidates) {
+        std::for_each(entries.begin(), entries.end(), score_posting);
+        return;
+    }
+    
+    // Walk whichever of the two sorted lists is shorter, galloping in the other
+    if (candidates->size() < entries.size()) {
+        size_t cursor = 0;
+        for (uint32_t track_id : *candidates) {
+            cursor = gallop(entries, cursor, track_id,
+                [](const Posting& posting) { return posting.track_id; });
+            if (cursor == entries.size()) break;
+            if (entries[cursor].track_id == track_id) {
+                score_posting(entries[cursor]);
+            }
+        }
+    } else {
+        size_t cursor = 0;
+        for (const auto& posting : entries) {
+            cursor = gallop(*candidates, cursor, posting.track_id, [](uint32_t id) { return id; });
+            if (cursor == candidates->size()) break;
+            if ((*candidates)[cursor] == posting.track_id) {
+                score_posting(posting);
+            }
         }
     }
 }
 
-void SearchEngine::clear_index() {
-    inverted_index_.clear();
-    trie_root_ = std::make_unique<TrieNode>();
-}
-
-void SearchEngine::rebuild_index(const std::vector<TrackPtr>& tracks) {
-    clear_index();
-    for (size_t i = 0; i < tracks.size(); ++i) {
-        if (tracks[i]) {
-            index_track(i, *tracks[i]);
+bool SearchEngine::can_prune(const SearchOptions& options) const {
+    // Bounds from the largest frequency and shortest field only hold while
+    // the score grows with the one and shrinks with the other
+    if (!prune_top_k_ || !tracks_ || options.max_results == 0 || indexed_tracks_ == 0 || !(scoring_.k1 > 0.0)) {
+        return false;
+    }
+    for (size_t f = 0; f < kFieldCount; ++f) {
+        const double b = scoring_.field_length_normalization[f];
+        if (!(scoring_.field_weights[f] >= 0.0) || !(b >= 0.0 && b <= 1.0)) {
+            return false;
         }
     }
+    return true;
 }
 
-std::vector<SearchEngine::SearchResult> SearchEngine::search(
-    const std::string& query, const SearchOptions& options) const {
+void SearchEngine::score_top_k(const TermMatches& terms, const SearchOptions& options,
+                               ScoreAccumulator& scores) const {
+    const auto average_lengths = average_field_lengths();
     
-    if (query.empty()) {
-        return {};
+    struct Cursor {
+        View<Posting> entries;
+        double weight;
+        std::vector<double> block_bounds;
+        double bound = 0.0;   // Largest block bound
+        size_t index = 0;
+        size_t block = 0;     // For bounds on tracks ahead of index
+        bool essential = true;
+        double value = 0.0;   // Current track's score from the term, or a bound on it
+    };
+    
+    // Cursors stay in term id order, the order score_term adds scores in.
+    // Adding bounds in that same order keeps every sum of bounds at or above
+    // the sum of the scores, to the last bit.
+    std::vector<Cursor> cursors;
+    cursors.reserve(terms.size());
+    for (const auto& [term_id, quality] : terms) {
+        const auto entries = term_postings(term_id);
+        if (entries.empty()) continue;
+        Cursor cursor{entries, term_weight(term_id, quality), {}};
+        const auto blocks = term_blocks(term_id);
+        const auto maxima = block_term_frequency_maxima(term_id, average_lengths);
+        cursor.block_bounds.reserve(blocks.size());
+        for (size_t block = 0; block < blocks.size(); ++block) {
+            const double tf = std::min(maxima[block], term_frequency_bound(blocks[block], average_lengths, options));
+            cursor.block_bounds.push_back(saturate(cursor.weight, tf));
+            cursor.bound = std::max(cursor.bound, cursor.block_bounds.back());
+        }
+        cursors.push_back(std::move(cursor));
     }
+    auto sum_values = [&]() {
+        double sum = 0.0;
+        for (const auto& cursor : cursors) sum += cursor.value;
+        return sum;
+    };
     
-    // Normalize query
-    std::string normalized_query = normalize(query, options.case_sensitive);
+    std::vector<size_t> order(cursors.size()); // By ascending bound
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(),
+        [&](size_t a, size_t b) { return cursors[a].bound < cursors[b].bound; });
     
-    // Different search strategies based on mode
-    std::unordered_map<size_t, double> track_scores;
+    // The same ordering and bounded heap as select_top_results
+    using Candidate = std::pair<double, uint32_t>;
+    auto better = [](const Candidate& a, const Candidate& b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    };
+    std::vector<Candidate> heap;
+    heap.reserve(options.max_results);
     
-    switch (options.mode) {
-        case SearchMode::EXACT:
-            search_exact(normalized_query, options, track_scores);
-            break;
-        case SearchMode::PREFIX:
-            search_prefix(normalized_query, options, track_scores);
-            break;
-        case SearchMode::SUBSTRING:
-            search_substring(normalized_query, options, track_scores);
-            break;
-        case SearchMode::FUZZY:
-            search_fuzzy(normalized_query, options, track_scores);
-            break;
-        case SearchMode::REGEX:
-            search_regex(query, options, track_scores); // Use original query for regex
-            break;
-    }
+    // Tracks come in ascending id order, so a later track only displaces
+    // the weakest result with a strictly higher score
+    auto can_enter = [&](double bound) {
+        return bound > 0.0 && !(bound < options.min_relevance) &&
+               (heap.size() < options.max_results || bound > heap.front().first);
+    };
+    auto enter = [&](double score, uint32_t track_id) {
+        if (heap.size() < options.max_results) {
+            heap.emplace_back(score, track_id);
+            std::push_heap(heap.begin(), heap.end(), better);
+        } else {
+            std::pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = {score, track_id};
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+    };
     
-    // Convert to result vector and sort by score
-    std::vector<SearchResult> results;
-    for (const auto& [track_id, score] : track_scores) {
-        if (score >= options.min_relevance && tracks_ && track_id < tracks_->size()) {
-            results.emplace_back((*tracks_)[track_id], score);
+    // The weakest terms that together cannot make a result on their own
+    // stop being essential: only tracks of the essential terms are visited
+    size_t essential = 0; // First essential position in order
+    auto update_essential = [&]() {
+        while (essential < order.size()) {
+            for (auto& cursor : cursors) cursor.value = 0.0;
+            for (size_t i = 0; i <= essential; ++i) {
+                cursors[order[i]].value = cursors[order[i]].bound;
+            }
+            if (can_enter(sum_values())) break;
+            cursors[order[essential++]].essential = false;
         }
-    }
+    };
+    update_essential();
+    
+    constexpr uint32_t kEnd = std::numeric_limits<uint32_t>::max();
+    auto current = [](const Cursor& cursor) {
+        return cursor.index < cursor.entries.size() ? cursor.entries[cursor.index].track_id : kEnd;
+    };
+    auto track_id_of = [](const Posting& posting) { return posting.track_id; };
     
-    // Sort by relevance score
-    std::sort(results.begin(), results.end(),
-        [](const SearchResult& a, const SearchResult& b) {
-            return a.second > b.second;
-        });
+    // Bound on a term's score for the tracks first to last, from the blocks
+    // that would hold them, found without touching the postings between
+    auto block_bound = [](Cursor& cursor, uint32_t first, uint32_t last) {
+        const auto& entries = cursor.entries;
+        auto block_last = [&](size_t block) {
+            return entries[std::min(entries.size(), (block + 1) * kBlockSize) - 1].track_id;
+        };
+        while (cursor.block < cursor.block_bounds.size() && block_last(cursor.block) < first) {
+            ++cursor.block;
+        }
+        double bound = 0.0;
+        for (size_t block = cursor.block;
+             block < cursor.block_bounds.size() && entries[block * kBlockSize].track_id <= last; ++block) {
+            bound = std::max(bound, cursor.block_bounds[block]);
+            if (block_last(block) >= last) break;
+        }
+        return bound;
+    };
     
-    // Limit results
-    if (results.size() > options.max_results) {
-        results.resize(options.max_results);
+    while (essential < order.size()) {
+        // Every posting of an essential term up to the end of the first of
+        // their current blocks to end lies in that term's current block, so
+        // the block bounds hold for the whole window up to there
+        uint32_t first = kEnd;
+        uint32_t last = kEnd;
+        for (auto& cursor : cursors) {
+            cursor.value = cursor.essential ? 0.0 : cursor.bound;
+            if (!cursor.essential || cursor.index == cursor.entries.size()) continue;
+            const size_t block = cursor.index / kBlockSize;
+            const size_t block_end = std::min(cursor.entries.size(), (block + 1) * kBlockSize);
+            cursor.value = cursor.block_bounds[block];
+            first = std::min(first, cursor.entries[cursor.index].track_id);
+            last = std::min(last, cursor.entries[block_end - 1].track_id);
+        }
+        if (first == kEnd) break;
+        for (auto& cursor : cursors) {
+            if (!cursor.essential) cursor.value = block_bound(cursor, first, last);
+        }
+        
+        if (!can_enter(sum_values())) {
+            for (auto& cursor : cursors) {
+                if (cursor.essential) {
+                    cursor.index = gallop(cursor.entries, cursor.index, last + 1, track_id_of);
+                }
+            }
+            continue;
+        }
+        
+        // A lone term needs no merging: its postings are the window's tracks
+        if (cursors.size() == 1) {
+            auto& cursor = cursors.front();
+            const auto& entries = cursor.entries;
+            for (; cursor.index < entries.size() && entries[cursor.index].track_id <= last; ++cursor.index) {
+                const auto& posting = entries[cursor.index];
+                const double score = score_posting(posting, cursor.weight, average_lengths, options);
+                if (can_enter(score) && posting.track_id < tracks_->size()) {
+                    enter(score, posting.track_id);
+                }
+            }
+            update_essential();
+            continue;
+        }
+        
+        // Score the window's tracks: the essential terms, then the others by
+        // descending bound for as long as the track can still make the results
+        const size_t window_essential = essential;
+        for (uint32_t track_id = first; track_id <= last && essential == window_essential;) {
+            for (auto& cursor : cursors) {
+                cursor.value = cursor.essential ? 0.0 : block_bound(cursor, track_id, track_id);
+                if (cursor.essential && current(cursor) == track_id) {
+                    cursor.value = score_posting(cursor.entries[cursor.index], cursor.weight,
+                                                 average_lengths, options);
+                    ++cursor.index;
+                }
+            }
+            double score = sum_values();
+            for (size_t i = essential; i-- > 0 && can_enter(score);) {
+                auto& cursor = cursors[order[i]];
+                cursor.value = 0.0;
+                cursor.index = gallop(cursor.entries, cursor.index, track_id, track_id_of);
+                if (current(cursor) == track_id) {
+                    cursor.value = score_posting(cursor.entries[cursor.index], cursor.weight,
+                                                 average_lengths, options);
+                }
+                score = sum_values();
+            }
+            
+            // Once every term is scored the sum is the track's exact score
+            if (can_enter(score) && track_id < tracks_->size()) {
+                enter(score, track_id);
+                update_essential();
+            }
+            
+            track_id = kEnd;
+            for (const auto& cursor : cursors) {
+                if (cursor.essential) track_id = std::min(track_id, current(cursor));
+            }
+        }
     }
     
-    return results;
+    for (const auto& [score, track_id] : heap) {
+        scores.add(track_id, score);
+    }
 }
 
 std::vector<std::string> SearchEngine::get_suggestions(const std::string& prefix, size_t max_suggestions) const {
-    if (prefix.empty() || !trie_root_) {
+    if (prefix.empty()) {
         return {};
     }
     
-    // Navigate to prefix node
-    std::string lower_prefix = normalize(prefix, false);
-    TrieNode* current = trie_root_.get();
+    return trie_.complete(normalize(prefix, false), max_suggestions);
+}
+
+size_t SearchEngine::get_indexed_terms_count() const {
+    return live_terms_;
+}
+
+size_t SearchEngine::get_indexed_tracks_count() const {
+    return indexed_tracks_;
+}
+
+bool SearchEngine::save_index(const std::filesystem::path& path) const {
+    static_assert(std::is_trivially_copyable_v<Posting> && std::is_trivially_copyable_v<BlockSummary>);
+    const size_t term_total = term_count();
+    const size_t track_total = segment_ ? segment_->field_lengths.size() : field_lengths_.size();
     
-    for (char c : lower_prefix) {
-        auto it = current->children.find(c);
-        if (it == current->children.end()) {
-            return {}; // Prefix not found
+    IndexFileHeader header{};
+    std::memcpy(header.magic, kIndexMagic, sizeof(header.magic));
+    header.version = kIndexVersion;
+    header.byte_order = kByteOrderMark;
+    header.posting_size = sizeof(Posting);
+    header.block_size = sizeof(BlockSummary);
+    header.term_count = term_total;
+    header.track_count = track_total;
+    header.live_terms = live_terms_;
+    header.indexed_tracks = indexed_tracks_;
+    for (size_t f = 0; f < kFieldCount; ++f) {
+        header.total_field_lengths[f] = total_field_lengths_[f];
+    }
+    header.store_positions = store_positions_;
+    header.has_fingerprint = tracks_ != nullptr;
+    header.fingerprint = tracks_ ? tracks_fingerprint(*tracks_) : 0;
+    
+    std::vector<uint32_t> trigram_keys;
+    if (segment_) {
+        trigram_keys.assign(segment_->trigram_keys.begin(), segment_->trigram_keys.end());
+    } else {
+        trigram_keys.reserve(trigram_index_.size());
+        for (const auto& entry : trigram_index_) {
+            trigram_keys.push_back(entry.first);
         }
-        current = it->second.get();
+        std::sort(trigram_keys.begin(), trigram_keys.end());
     }
+    header.trigram_count = trigram_keys.size();
     
-    // Collect suggestions from this node
-    std::vector<std::string> suggestions;
-    std::queue<std::pair<TrieNode*, std::string>> queue;
-    queue.push({current, lower_prefix});
+    // Written beside the target and renamed over it, so that processes
+    // still mapping an older file keep reading it intact
+    auto temporary = path;
+    temporary += ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+    IndexFileWriter writer(out, header);
     
-    while (!queue.empty() && suggestions.size() < max_suggestions) {
-        auto [node, word] = queue.front();
-        queue.pop();
-        
-        if (node->is_end_of_word) {
-            suggestions.push_back(word);
+    // Each run of entries goes out as its own write, after its offsets
+    auto write_runs = [&writer](IndexSection offsets_section, IndexSection entries_section,
+                                size_t count, auto run) {
+        std::vector<uint64_t> offsets(count + 1, 0);
+        for (size_t i = 0; i < count; ++i) {
+            offsets[i + 1] = offsets[i] + run(i).size();
         }
-        
-        // Add children to queue
-        for (const auto& [ch, child] : node->children) {
-            queue.push({child.get(), word + ch});
+        writer.section(offsets_section, offsets);
+        writer.begin(entries_section);
+        for (size_t i = 0; i < count; ++i) {
+            const auto entries = run(i);
+            writer.write(entries.data(), entries.size());
+        }
+    };
+    
+    write_runs(TERM_OFFSETS, TERM_BYTES, term_total,
+        [this](size_t id) { return term_text(static_cast<uint32_t>(id)); });
+    std::vector<uint32_t> term_order(term_total);
+    std::iota(term_order.begin(), term_order.end(), 0);
+    std::sort(term_order.begin(), term_order.end(),
+        [this](uint32_t a, uint32_t b) { return term_text(a) < term_text(b); });
+    writer.section(TERM_ORDER, term_order);
+    
+    write_runs(POSTING_OFFSETS, POSTINGS, term_total,
+        [this](size_t id) { return term_postings(static_cast<uint32_t>(id)); });
+    write_runs(POSITION_OFFSETS, POSITIONS, term_total,
+        [this](size_t id) { return term_positions(static_cast<uint32_t>(id)); });
+    write_runs(BLOCK_OFFSETS, BLOCKS, term_total,
+        [this](size_t id) { return term_blocks(static_cast<uint32_t>(id)); });
+    
+    const auto lengths = segment_ ? segment_->field_lengths : View<FieldLengths>(field_lengths_);
+    writer.begin(FIELD_LENGTHS);
+    writer.write(lengths.data(), lengths.size());
+    write_runs(TRACK_TERM_OFFSETS, TRACK_TERMS, track_total,
+        [this](size_t track_id) { return track_term_ids(static_cast<uint32_t>(track_id)); });
+    
+    writer.section(TRIGRAM_KEYS, trigram_keys);
+    write_runs(TRIGRAM_OFFSETS, TRIGRAM_TERMS, trigram_keys.size(),
+        [&](size_t i) { return trigram_terms(trigram_keys[i]); });
+    
+    std::string trie;
+    trie_.serialize(trie);
+    writer.begin(TRIE);
+    writer.write(trie.data(), trie.size());
+    
+    const bool written = writer.finish();
+    out.close();
+    std::error_code error;
+    if (!written || !out) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+bool SearchEngine::load_index(const std::filesystem::path& path) {
+    auto segment = std::make_unique<Segment>();
+    MappedFile& file = segment->file;
+    IndexFileHeader header;
+    if (!file.open(path) || file.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, kIndexMagic, sizeof(header.magic)) != 0 ||
+        header.version != kIndexVersion || header.byte_order != kByteOrderMark ||
+        header.posting_size != sizeof(Posting) || header.block_size != sizeof(BlockSummary) ||
+        header.term_count >= kNoTerm || header.track_count >= std::numeric_limits<uint32_t>::max() ||
+        header.trigram_count >= std::numeric_limits<uint32_t>::max()) {
+        return false;
+    }
+    if (tracks_ && header.has_fingerprint && header.fingerprint != tracks_fingerprint(*tracks_)) {
+        return false; // Saved for other tracks
+    }
+    
+    // Offset arrays first: their last entries size the runs they locate
+    const uint64_t terms = header.term_count;
+    const uint64_t tracks = header.track_count;
+    auto& s = *segment;
+    bool valid = true;
+    auto runs = [&](IndexSection offsets_section, IndexSection entries_section, uint64_t count,
+                    const uint64_t*& offsets, auto*& entries) {
+        using Entry = std::remove_const_t<std::remove_pointer_t<std::remove_reference_t<decltype(entries)>>>;
+        offsets = index_section<uint64_t>(header, offsets_section, file, count + 1);
+        if (!offsets) {
+            valid = false;
+            return;
         }
+        entries = index_section<Entry>(header, entries_section, file, offsets[count]);
+        valid = valid && entries && valid_offsets(offsets, count, offsets[count]);
+    };
+    runs(TERM_OFFSETS, TERM_BYTES, terms, s.term_offsets, s.term_bytes);
+    runs(POSTING_OFFSETS, POSTINGS, terms, s.posting_offsets, s.postings);
+    runs(POSITION_OFFSETS, POSITIONS, terms, s.position_offsets, s.positions);
+    runs(BLOCK_OFFSETS, BLOCKS, terms, s.block_offsets, s.blocks);
+    runs(TRACK_TERM_OFFSETS, TRACK_TERMS, tracks, s.track_term_offsets, s.track_terms);
+    runs(TRIGRAM_OFFSETS, TRIGRAM_TERMS, header.trigram_count, s.trigram_offsets, s.trigram_terms);
+    s.term_order = index_section<uint32_t>(header, TERM_ORDER, file, terms);
+    const auto* field_lengths = index_section<FieldLengths>(header, FIELD_LENGTHS, file, tracks);
+    const auto* trigram_keys = index_section<uint32_t>(header, TRIGRAM_KEYS, file, header.trigram_count);
+    const auto& [trie_offset, trie_size] = header.sections[TRIE];
+    RadixTrie trie;
+    if (!valid || !s.term_order || !field_lengths || !trigram_keys ||
+        trie_offset % 8 != 0 || trie_offset > file.size() || trie_size > file.size() - trie_offset ||
+        !trie.attach(file.data() + trie_offset, static_cast<size_t>(trie_size))) {
+        return false;
+    }
+    s.term_count = static_cast<size_t>(terms);
+    s.field_lengths = View<FieldLengths>(field_lengths, static_cast<size_t>(tracks));
+    s.trigram_keys = View<uint32_t>(trigram_keys, static_cast<size_t>(header.trigram_count));
+    if (!s.valid_content()) {
+        return false;
+    }
+    
+    // Owned structures stay empty while the segment serves reads
+    clear_index();
+    trie_ = std::move(trie);
+    live_terms_ = static_cast<size_t>(header.live_terms);
+    indexed_tracks_ = static_cast<size_t>(header.indexed_tracks);
+    for (size_t f = 0; f < kFieldCount; ++f) {
+        total_field_lengths_[f] = header.total_field_lengths[f];
+    }
+    store_positions_ = header.store_positions != 0;
+    segment_ = std::move(segment);
+    return true;
+}
+
+void SearchEngine::ensure_writable() {
+    if (!segment_) {
+        return;
+    }
+    
+    // The accessors read from the segment until it is dropped at the end
+    const size_t terms = term_count();
+    terms_.reserve(terms);
+    term_ids_.reserve(terms);
+    postings_.resize(terms);
+    positions_.resize(terms);
+    blocks_.resize(terms);
+    for (uint32_t id = 0; id < terms; ++id) {
+        terms_.emplace_back(term_text(id));
+        term_ids_.emplace(terms_.back(), id);
+        const auto entries = term_postings(id);
+        postings_[id].assign(entries.begin(), entries.end());
+        const auto bytes = term_positions(id);
+        positions_[id].assign(bytes.begin(), bytes.end());
+        const auto summaries = term_blocks(id);
+        blocks_[id].assign(summaries.begin(), summaries.end());
+    }
+    
+    const auto& lengths = segment_->field_lengths;
+    field_lengths_.assign(lengths.begin(), lengths.end());
+    track_terms_.resize(lengths.size());
+    for (uint32_t track_id = 0; track_id < lengths.size(); ++track_id) {
+        const auto ids = track_term_ids(track_id);
+        track_terms_[track_id].assign(ids.begin(), ids.end());
+    }
+    
+    for (uint32_t key : segment_->trigram_keys) {
+        const auto ids = trigram_terms(key);
+        trigram_index_[key].assign(ids.begin(), ids.end());
     }
     
-    return suggestions;
+    trie_.detach();
+    segment_.reset();
 }
 
-size_t SearchEngine::get_indexed_terms_count() const {
-    return inverted_index_.size();
+size_t SearchEngine::term_count() const {
+    return segment_ ? segment_->term_count : terms_.size();
 }
 
-size_t SearchEngine::get_indexed_tracks_count() const {
-    std::unordered_set<size_t> unique_tracks;
-    for (const auto& [term, entries] : inverted_index_) {
-        for (const auto& entry : entries) {
-            unique_tracks.insert(entry.track_id);
-        }
+std::string_view SearchEngine::term_text(uint32_t term_id) const {
+    return segment_ ? segment_->term(term_id) : std::string_view(terms_[term_id]);
+}
+
+uint32_t SearchEngine::find_term(const std::string& term) const {
+    if (!segment_) {
+        auto it = term_ids_.find(term);
+        return it == term_ids_.end() ? kNoTerm : it->second;
     }
-    return unique_tracks.size();
+    
+    const auto* order = segment_->term_order;
+    const auto* end = order + segment_->term_count;
+    const auto* it = std::lower_bound(order, end, std::string_view(term),
+        [this](uint32_t id, std::string_view value) { return segment_->term(id) < value; });
+    return it != end && segment_->term(*it) == term ? *it : kNoTerm;
+}
+
+SearchEngine::View<SearchEngine::Posting> SearchEngine::term_postings(uint32_t term_id) const {
+    return segment_ ? Segment::run(segment_->postings, segment_->posting_offsets, term_id)
+                    : View<Posting>(postings_[term_id]);
+}
+
+SearchEngine::View<uint8_t> SearchEngine::term_positions(uint32_t term_id) const {
+    return segment_ ? Segment::run(segment_->positions, segment_->position_offsets, term_id)
+                    : View<uint8_t>(positions_[term_id]);
+}
+
+SearchEngine::View<SearchEngine::BlockSummary> SearchEngine::term_blocks(uint32_t term_id) const {
+    return segment_ ? Segment::run(segment_->blocks, segment_->block_offsets, term_id)
+                    : View<BlockSummary>(blocks_[term_id]);
+}
+
+const SearchEngine::FieldLengths& SearchEngine::track_field_lengths(uint32_t track_id) const {
+    return segment_ ? segment_->field_lengths[track_id] : field_lengths_[track_id];
+}
+
+SearchEngine::View<uint32_t> SearchEngine::track_term_ids(uint32_t track_id) const {
+    return segment_ ? Segment::run(segment_->track_terms, segment_->track_term_offsets, track_id)
+                    : View<uint32_t>(track_terms_[track_id]);
 }
 
-std::vector<std::string> SearchEngine::tokenize(const std::string& text) const {
-    std::vector<std::string> tokens;
-    std::stringstream ss(text);
-    std::string token;
+SearchEngine::View<uint32_t> SearchEngine::trigram_terms(uint32_t key) const {
+    if (!segment_) {
+        auto it = trigram_index_.find(key);
+        return it == trigram_index_.end() ? View<uint32_t>() : View<uint32_t>(it->second);
+    }
     
-    while (ss >> token) {
-        // Remove punctuation from beginning and end
-        while (!token.empty() && std::ispunct(token.front())) {
-            token.erase(0, 1);
-        }
-        while (!token.empty() && std::ispunct(token.back())) {
-            token.pop_back();
+    const auto& keys = segment_->trigram_keys;
+    const auto* it = std::lower_bound(keys.begin(), keys.end(), key);
+    if (it == keys.end() || *it != key) {
+        return {};
+    }
+    return Segment::run(segment_->trigram_terms, segment_->trigram_offsets,
+                        static_cast<size_t>(it - keys.begin()));
+}
+
+uint64_t SearchEngine::tracks_fingerprint(const std::vector<TrackPtr>& tracks) {
+    // FNV-1a over the indexed fields of every track id
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](std::string_view text) {
+        for (unsigned char c : text) {
+            hash = (hash ^ c) * 1099511628211ull;
         }
-        
-        if (!token.empty()) {
-            tokens.push_back(normalize(token, false));
+        hash = (hash ^ 0xFF) * 1099511628211ull; // Never part of UTF-8 text
+    };
+    for (const auto& track : tracks) {
+        if (!track) {
+            mix({});
+            continue;
         }
+        mix(track->title());
+        mix(track->artist());
+        mix(track->album());
+        mix(track->genre());
     }
-    
-    return tokens;
+    return hash;
 }
 
 std::string SearchEngine::normalize(const std::string& text, bool case_sensitive) const {
@@ -199,19 +2056,14 @@ std::string SearchEngine::normalize(const std::string& text, bool case_sensitive
         return text;
     }
     
-    std::string normalized = text;
-    std::transform(normalized.begin(), normalized.end(), normalized.begin(), ::tolower);
-    return normalized;
+    return fold_text(text);
 }
 
-double SearchEngine::calculate_relevance(const std::string& query, const std::string& text) const {
-    if (text.empty() || query.empty()) {
+double SearchEngine::calculate_relevance(std::string_view lower_query, std::string_view lower_text) const {
+    if (lower_text.empty() || lower_query.empty()) {
         return 0.0;
     }
     
-    std::string lower_query = normalize(query, false);
-    std::string lower_text = normalize(text, false);
-    
     // Exact match
     if (lower_text == lower_query) {
         return 1.0;
@@ -227,150 +2079,425 @@ double SearchEngine::calculate_relevance(const std::string& query, const std::st
         return 0.6;
     }
     
-    // Fuzzy match using edit distance
-    size_t distance = levenshtein_distance(lower_query, lower_text);
+    // Fuzzy match using edit distance. A similarity above 0.5 means the
+    // distance is below half the longer length, so anything further away
+    // can be abandoned early.
     size_t max_len = std::max(lower_query.length(), lower_text.length());
+    size_t max_distance = (max_len - 1) / 2;
+    size_t distance = edit_distance(lower_query, lower_text, max_distance);
     
-    if (max_len > 0) {
+    if (distance <= max_distance) {
         double similarity = 1.0 - (static_cast<double>(distance) / max_len);
-        if (similarity > 0.5) {
-            return similarity * 0.4;
-        }
+        return similarity * 0.4;
     }
     
     return 0.0;
 }
 
-size_t SearchEngine::levenshtein_distance(const std::string& s1, const std::string& s2) const {
-    const size_t m = s1.length();
-    const size_t n = s2.length();
-    
-    if (m == 0) return n;
-    if (n == 0) return m;
-    
-    std::vector<std::vector<size_t>> dp(m + 1, std::vector<size_t>(n + 1));
+uint32_t SearchEngine::add_to_inverted_index(std::string_view term, uint32_t track_id,
+                                           const std::array<uint16_t, kFieldCount>& term_frequency,
+                                           const std::vector<uint8_t>* positions) {
+    // Look up through a reused key so known terms cost no allocation
+    term_key_.assign(term);
+    auto [it, inserted] = term_ids_.try_emplace(term_key_, static_cast<uint32_t>(terms_.size()));
+    if (inserted) {
+        terms_.push_back(term_key_);
+        postings_.emplace_back();
+        blocks_.emplace_back();
+        positions_.emplace_back();
+        add_to_trigram_index(term_key_, it->second);
+    }
     
-    for (size_t i = 0; i <= m; ++i) {
-        dp[i][0] = i;
+    auto& entries = postings_[it->second];
+    auto& bytes = positions_[it->second];
+    if (entries.empty()) {
+        ++live_terms_;
     }
-    for (size_t j = 0; j <= n; ++j) {
-        dp[0][j] = j;
+    
+    Posting posting{track_id, term_frequency, kNoPositions};
+    auto pos = entries.end();
+    if (!entries.empty() && entries.back().track_id >= track_id) {
+        pos = std::lower_bound(entries.begin(), entries.end(), track_id,
+            [](const Posting& entry, uint32_t value) { return entry.track_id < value; });
     }
     
-    for (size_t i = 1; i <= m; ++i) {
-        for (size_t j = 1; j <= n; ++j) {
-            size_t cost = (s1[i-1] == s2[j-1]) ? 0 : 1;
-            dp[i][j] = std::min({
-                dp[i-1][j] + 1,      // deletion
-                dp[i][j-1] + 1,      // insertion
-                dp[i-1][j-1] + cost  // substitution
-            });
+    if (pos != entries.end() && pos->track_id == track_id) {
+        for (size_t f = 0; f < kFieldCount; ++f) {
+            posting.term_frequency[f] = static_cast<uint16_t>(
+                std::min<uint32_t>(pos->term_frequency[f] + term_frequency[f],
+                                   std::numeric_limits<uint16_t>::max()));
+        }
+        
+        // Both sets of positions are needed; write them out again together,
+        // up to the merged counts, leaving the old bytes unused
+        if (positions && pos->positions != kNoPositions) {
+            std::vector<uint8_t> merged;
+            const uint8_t* old_data = bytes.data() + pos->positions;
+            const uint8_t* new_data = positions->data();
+            for (size_t f = 0; f < kFieldCount; ++f) {
+                uint32_t previous = 0;
+                uint16_t written = 0;
+                auto copy = [&](const uint8_t*& data, uint16_t count) {
+                    uint32_t position = 0;
+                    for (uint16_t n = 0; n < count; ++n) {
+                        position += read_varint(data);
+                        if (written == posting.term_frequency[f]) continue;
+                        append_varint(merged, position - previous);
+                        previous = position;
+                        ++written;
+                    }
+                };
+                copy(old_data, pos->term_frequency[f]);
+                copy(new_data, term_frequency[f]);
+            }
+            posting.positions = static_cast<uint32_t>(bytes.size());
+            bytes.insert(bytes.end(), merged.begin(), merged.end());
         }
+        *pos = posting;
+        update_block(it->second, static_cast<size_t>(pos - entries.begin()));
+        return it->second;
     }
     
-    return dp[m][n];
+    if (positions) {
+        posting.positions = static_cast<uint32_t>(bytes.size());
+        bytes.insert(bytes.end(), positions->begin(), positions->end());
+    }
+    // Tracks are normally indexed in id order, making this an append
+    const bool append = pos == entries.end();
+    entries.insert(pos, posting);
+    if (append) {
+        update_block(it->second, entries.size() - 1);
+    } else {
+        rebuild_blocks(it->second);
+    }
+    return it->second;
 }
 
-void SearchEngine::add_to_trie(const std::string& word) {
-    if (word.empty()) return;
-    
-    TrieNode* current = trie_root_.get();
-    
-    for (char c : word) {
-        if (current->children.find(c) == current->children.end()) {
-            current->children[c] = std::make_unique<TrieNode>();
-        }
-        current = current->children[c].get();
+void SearchEngine::update_block(uint32_t term_id, size_t index) {
+    auto& blocks = blocks_[term_id];
+    const size_t block = index / kBlockSize;
+    if (block >= blocks.size()) {
+        blocks.resize(block + 1);
     }
     
-    current->is_end_of_word = true;
-    current->suggestions.insert(word);
+    const auto& posting = postings_[term_id][index];
+    const auto& lengths = field_lengths_[posting.track_id];
+    auto& summary = blocks[block];
+    uint8_t fields = 0;
+    for (size_t f = 0; f < kFieldCount; ++f) {
+        if (posting.term_frequency[f] == 0) continue;
+        summary.min_field_length[f] = summary.max_term_frequency[f] == 0
+            ? lengths[f] : std::min(summary.min_field_length[f], lengths[f]);
+        summary.max_term_frequency[f] = std::max(summary.max_term_frequency[f], posting.term_frequency[f]);
+        ++fields;
+    }
+    summary.max_fields = std::max(summary.max_fields, fields);
+}
+
+void SearchEngine::rebuild_blocks(uint32_t term_id) {
+    blocks_[term_id].clear();
+    for (size_t i = 0; i < postings_[term_id].size(); ++i) {
+        update_block(term_id, i);
+    }
 }
 
-void SearchEngine::add_to_inverted_index(const std::string& term, size_t track_id,
-                                       const std::string& field, double weight) {
-    inverted_index_[term].push_back({track_id, field, weight});
+void SearchEngine::add_to_trigram_index(const std::string& term, uint32_t term_id) {
+    for (size_t i = 0; i + 3 <= term.size(); ++i) {
+        auto& ids = trigram_index_[trigram_key(term.data() + i)];
+        // A term repeating a trigram must still appear only once in its list
+        if (ids.empty() || ids.back() != term_id) {
+            ids.push_back(term_id);
+        }
+    }
 }
 
 // Private helper methods for different search modes
-void SearchEngine::search_exact(const std::string& query, const SearchOptions& options,
-                               std::unordered_map<size_t, double>& track_scores) const {
-    auto it = inverted_index_.find(query);
-    if (it != inverted_index_.end()) {
-        for (const auto& entry : it->second) {
-            if (should_search_field(entry.field, options)) {
-                track_scores[entry.track_id] += entry.weight;
-            }
+void SearchEngine::match_term(const std::string& word, const SearchOptions& options,
+                              TermMatches& matches) const {
+    switch (options.mode) {
+        case SearchMode::EXACT:
+            search_exact(word, matches);
+            break;
+        case SearchMode::PREFIX:
+            search_prefix(word, matches);
+            break;
+        case SearchMode::SUBSTRING:
+            search_substring(word, matches);
+            break;
+        case SearchMode::FUZZY:
+            search_fuzzy(word, matches);
+            break;
+        case SearchMode::REGEX:
+            search_regex(word, options, matches);
+            break;
+    }
+}
+
+void SearchEngine::match_term(const std::string& word, const SearchOptions& options, TermMatches& matches,
+                              TermExpansions* expansions) const {
+    // Exact lookups cost less than sharing them
+    if (!expansions || options.mode == SearchMode::EXACT) {
+        match_term(word, options, matches);
+        return;
+    }
+    
+    std::string key;
+    key += static_cast<char>('0' + static_cast<int>(options.mode));
+    key += options.case_sensitive ? 'c' : '-';
+    key += word;
+    {
+        std::lock_guard<std::mutex> lock(expansions->mutex);
+        auto it = expansions->matches.find(key);
+        if (it != expansions->matches.end()) {
+            matches.insert(matches.end(), it->second.begin(), it->second.end());
+            return;
         }
     }
+    
+    // Matched outside the lock; two threads may occasionally both do so
+    TermMatches expanded;
+    match_term(word, options, expanded);
+    matches.insert(matches.end(), expanded.begin(), expanded.end());
+    std::lock_guard<std::mutex> lock(expansions->mutex);
+    expansions->matches.try_emplace(std::move(key), std::move(expanded));
 }
 
-void SearchEngine::search_prefix(const std::string& query, const SearchOptions& options,
-                                std::unordered_map<size_t, double>& track_scores) const {
-    for (const auto& [term, entries] : inverted_index_) {
-        if (term.find(query) == 0) { // Prefix match
-            for (const auto& entry : entries) {
-                if (should_search_field(entry.field, options)) {
-                    track_scores[entry.track_id] += entry.weight * 0.8;
-                }
-            }
+void SearchEngine::search_exact(const std::string& query, TermMatches& matches) const {
+    const uint32_t term_id = find_term(query);
+    if (term_id != kNoTerm && !term_postings(term_id).empty()) {
+        matches.emplace_back(term_id, 1.0);
+    }
+}
+
+void SearchEngine::search_prefix(const std::string& query, TermMatches& matches) const {
+    for (uint32_t id = 0; id < term_count(); ++id) {
+        const auto term = term_text(id);
+        const auto entries = term_postings(id);
+        if (!entries.empty() && term.compare(0, query.size(), query) == 0) { // Prefix match
+            matches.emplace_back(id, 0.8);
         }
     }
 }
 
-void SearchEngine::search_substring(const std::string& query, const SearchOptions& options,
-                                   std::unordered_map<size_t, double>& track_scores) const {
-    for (const auto& [term, entries] : inverted_index_) {
-        if (term.find(query) != std::string::npos) { // Substring match
-            for (const auto& entry : entries) {
-                if (should_search_field(entry.field, options)) {
-                    double score = (term.find(query) == 0) ? 0.8 : 0.6;
-                    track_scores[entry.track_id] += entry.weight * score;
-                }
-            }
+void SearchEngine::search_substring(const std::string& query, TermMatches& matches) const {
+    for (uint32_t id = 0; id < term_count(); ++id) {
+        const auto term = term_text(id);
+        const auto entries = term_postings(id);
+        size_t pos = entries.empty() ? std::string::npos : term.find(query);
+        if (pos != std::string::npos) { // Substring match
+            matches.emplace_back(id, pos == 0 ? 0.8 : 0.6);
         }
     }
 }
 
-void SearchEngine::search_fuzzy(const std::string& query, const SearchOptions& options,
-                               std::unordered_map<size_t, double>& track_scores) const {
-    for (const auto& [term, entries] : inverted_index_) {
-        double relevance = calculate_relevance(query, term);
+void SearchEngine::search_fuzzy(const std::string& query, TermMatches& matches) const {
+    // Index terms are already lowercase; fuzzy matching ignores case
+    const std::string lower_query = normalize(query, false);
+    for (uint32_t id = 0; id < term_count(); ++id) {
+        const auto entries = term_postings(id);
+        if (entries.empty()) continue;
+        
+        double relevance = calculate_relevance(lower_query, term_text(id));
         if (relevance > 0) {
-            for (const auto& entry : entries) {
-                if (should_search_field(entry.field, options)) {
-                    track_scores[entry.track_id] += entry.weight * relevance;
-                }
-            }
+            matches.emplace_back(id, relevance);
         }
     }
 }
 
 void SearchEngine::search_regex(const std::string& pattern, const SearchOptions& options,
-                               std::unordered_map<size_t, double>& track_scores) const {
-    try {
-        std::regex regex_pattern(pattern, 
-            options.case_sensitive ? std::regex::ECMAScript : std::regex::icase);
+                               TermMatches& matches) const {
+    auto regex = get_compiled_regex(pattern, !options.case_sensitive);
+    if (!regex) {
+        return; // Invalid or unsupported pattern
+    }
+    
+    // Literals too short for the trigram index are still cheap to check
+    // before the automaton runs
+    std::vector<std::string_view> short_literals;
+    for (const auto& literal : regex->required_literals()) {
+        if (literal.size() < 3) {
+            short_literals.push_back(literal);
+        }
+    }
+    
+    LinearRegex::Matcher matcher(*regex);
+    for (uint32_t id : get_regex_candidates(*regex)) {
+        const auto term = term_text(id);
+        const auto entries = term_postings(id);
+        if (entries.empty()) continue;
         
-        for (const auto& [term, entries] : inverted_index_) {
-            if (std::regex_search(term, regex_pattern)) {
-                for (const auto& entry : entries) {
-                    if (should_search_field(entry.field, options)) {
-                        track_scores[entry.track_id] += entry.weight;
-                    }
-                }
+        bool has_literals = std::all_of(short_literals.begin(), short_literals.end(),
+            [&term](std::string_view literal) {
+                return term.find(literal) != std::string::npos;
+            });
+        if (!has_literals || !matcher.search(term)) continue;
+        
+        matches.emplace_back(id, 1.0);
+    }
+}
+
+std::shared_ptr<const LinearRegex> SearchEngine::get_compiled_regex(
+    const std::string& pattern, bool case_insensitive) const {
+    
+    std::string key = (case_insensitive ? "i:" : "s:") + pattern;
+    std::lock_guard lock(regex_cache_mutex_);
+    
+    auto it = regex_cache_index_.find(key);
+    if (it != regex_cache_index_.end()) {
+        regex_cache_.splice(regex_cache_.begin(), regex_cache_, it->second);
+        return it->second->second;
+    }
+    
+    std::shared_ptr<const LinearRegex> compiled;
+    if (auto regex = LinearRegex::compile(pattern, case_insensitive)) {
+        compiled = std::make_shared<const LinearRegex>(std::move(*regex));
+    }
+    
+    regex_cache_.emplace_front(key, compiled);
+    regex_cache_index_[key] = regex_cache_.begin();
+    if (regex_cache_.size() > kRegexCacheCapacity) {
+        regex_cache_index_.erase(regex_cache_.back().first);
+        regex_cache_.pop_back();
+    }
+    
+    return compiled;
+}
+
+void SearchEngine::set_result_cache_capacity(size_t bytes) {
+    std::lock_guard lock(result_cache_mutex_);
+    result_cache_capacity_ = bytes;
+    evict_cached_results(bytes);
+}
+
+void SearchEngine::clear_result_cache() {
+    std::lock_guard lock(result_cache_mutex_);
+    evict_cached_results(0);
+}
+
+SearchEngine::ResultCacheStats SearchEngine::get_result_cache_stats() const {
+    std::lock_guard lock(result_cache_mutex_);
+    ResultCacheStats stats;
+    stats.hits = result_cache_hits_;
+    stats.misses = result_cache_misses_;
+    stats.entries = result_cache_.size();
+    stats.bytes = result_cache_bytes_;
+    return stats;
+}
+
+bool SearchEngine::find_cached_results(const std::string& key,
+                                       std::vector<SearchResult>& results) const {
+    std::lock_guard lock(result_cache_mutex_);
+    if (result_cache_capacity_ == 0) {
+        return false;
+    }
+    
+    auto it = result_cache_index_.find(key);
+    if (it == result_cache_index_.end()) {
+        ++result_cache_misses_;
+        return false;
+    }
+    
+    auto entry = it->second;
+    if (entry->generation != generation_) {
+        // Computed before the index last changed
+        result_cache_bytes_ -= entry->bytes;
+        result_cache_index_.erase(it);
+        result_cache_.erase(entry);
+        ++result_cache_misses_;
+        return false;
+    }
+    
+    result_cache_.splice(result_cache_.begin(), result_cache_, entry);
+    ++result_cache_hits_;
+    results = entry->results;
+    return true;
+}
+
+void SearchEngine::store_cached_results(const std::string& key,
+                                        const std::vector<SearchResult>& results) const {
+    // List and hash nodes plus the result vector's own storage
+    constexpr size_t kEntryOverhead = 128;
+    const size_t bytes = kEntryOverhead + key.size() + results.size() * sizeof(SearchResult);
+    
+    std::lock_guard lock(result_cache_mutex_);
+    if (bytes > result_cache_capacity_) {
+        return;
+    }
+    
+    // Another thread may have stored the same query meanwhile
+    auto it = result_cache_index_.find(key);
+    if (it != result_cache_index_.end()) {
+        result_cache_bytes_ -= it->second->bytes;
+        result_cache_.erase(it->second);
+        result_cache_index_.erase(it);
+    }
+    
+    evict_cached_results(result_cache_capacity_ - bytes);
+    result_cache_.push_front({key, generation_, results, bytes});
+    result_cache_index_.emplace(result_cache_.front().key, result_cache_.begin());
+    result_cache_bytes_ += bytes;
+}
+
+void SearchEngine::evict_cached_results(size_t capacity) const {
+    while (result_cache_bytes_ > capacity && !result_cache_.empty()) {
+        const auto& oldest = result_cache_.back();
+        result_cache_bytes_ -= oldest.bytes;
+        result_cache_index_.erase(oldest.key);
+        result_cache_.pop_back();
+    }
+}
+
+std::vector<uint32_t> SearchEngine::get_regex_candidates(const LinearRegex& regex) const {
+    // Every trigram of a required literal must occur in a matching term, so
+    // intersect their term lists, smallest first
+    std::vector<View<uint32_t>> lists;
+    for (const auto& literal : regex.required_literals()) {
+        for (size_t i = 0; i + 3 <= literal.size(); ++i) {
+            const auto ids = trigram_terms(trigram_key(literal.data() + i));
+            if (ids.empty()) {
+                return {}; // No term contains this trigram
             }
+            lists.push_back(ids);
         }
-    } catch (const std::regex_error&) {
-        // Invalid regex pattern
     }
+    
+    if (lists.empty()) {
+        std::vector<uint32_t> all(term_count());
+        std::iota(all.begin(), all.end(), 0);
+        return all;
+    }
+    
+    std::sort(lists.begin(), lists.end(),
+        [](const auto& a, const auto& b) { return a.size() < b.size(); });
+    
+    std::vector<uint32_t> candidates(lists.front().begin(), lists.front().end());
+    std::vector<uint32_t> narrowed;
+    for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+        narrowed.clear();
+        std::set_intersection(candidates.begin(), candidates.end(),
+                              lists[i].begin(), lists[i].end(),
+                              std::back_inserter(narrowed));
+        candidates.swap(narrowed);
+    }
+    return candidates;
+}
+
+bool SearchEngine::should_search_field(Field field, const SearchOptions& options) const {
+    switch (field) {
+        case Field::TITLE: return options.search_title;
+        case Field::ARTIST: return options.search_artist;
+        case Field::ALBUM: return options.search_album;
+        case Field::GENRE: return options.search_genre;
+    }
+    return false;
 }
 
-bool SearchEngine::should_search_field(const std::string& field, const SearchOptions& options) const {
-    if (field == "title") return options.search_title;
-    if (field == "artist") return options.search_artist;
-    if (field == "album") return options.search_album;
-    if (field == "genre") return options.search_genre;
+bool SearchEngine::matches_fields(const Posting& posting, const SearchOptions& options) const {
+    for (size_t f = 0; f < kFieldCount; ++f) {
+        if (posting.term_frequency[f] > 0 && should_search_field(static_cast<Field>(f), options)) {
+            return true;
+        }
+    }
     return false;
 }
 
@@ -0,0 +1,98 @@
+#include "audio_library/tokenizer.h"
+#include <array>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace audio_library {
+
+namespace {
+
+enum CharClass : uint8_t { kWord = 0, kSpace = 1, kPunct = 2 };
+
+// Classes as the C locale's isspace and ispunct see them; bytes above 0x7F
+// are word characters
+constexpr std::array<uint8_t, 256> make_classes() {
+    std::array<uint8_t, 256> classes{};
+    for (int c = '\t'; c <= '\r'; ++c) classes[c] = kSpace;
+    classes[' '] = kSpace;
+    for (int c = '!'; c <= '/'; ++c) classes[c] = kPunct;
+    for (int c = ':'; c <= '@'; ++c) classes[c] = kPunct;
+    for (int c = '['; c <= '`'; ++c) classes[c] = kPunct;
+    for (int c = '{'; c <= '~'; ++c) classes[c] = kPunct;
+    return classes;
+}
+
+constexpr std::array<uint8_t, 256> kClasses = make_classes();
+
+inline uint8_t class_of(char c) {
+    return kClasses[static_cast<unsigned char>(c)];
+}
+
+// Position of the first whitespace byte in [pos, size), or size
+size_t find_space(const char* data, size_t pos, size_t size) {
+#if defined(__SSE2__)
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i below_tab = _mm_set1_epi8('\t' - 1);
+    const __m128i above_cr = _mm_set1_epi8('\r' + 1);
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i control = _mm_and_si128(_mm_cmpgt_epi8(chunk, below_tab), _mm_cmplt_epi8(chunk, above_cr));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), control));
+        if (mask != 0) {
+            return pos + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+    }
+#endif
+    while (pos < size && class_of(data[pos]) != kSpace) {
+        ++pos;
+    }
+    return pos;
+}
+
+} // namespace
+
+void Tokenizer::clear() {
+    buffer_.clear();
+    spans_.clear();
+}
+
+size_t Tokenizer::append(std::string_view text, bool case_sensitive) {
+    const size_t base = buffer_.size();
+    if (case_sensitive) {
+        buffer_.append(text);
+    } else {
+        append_folded(buffer_, text);
+    }
+    char* data = &buffer_[base];
+    const size_t size = buffer_.size() - base;
+
+    const size_t before = spans_.size();
+    size_t pos = 0;
+    while (pos < size) {
+        while (pos < size && class_of(data[pos]) == kSpace) {
+            ++pos;
+        }
+        if (pos == size) {
+            break;
+        }
+
+        size_t end = find_space(data, pos, size);
+        size_t first = pos;
+        size_t last = end;
+        while (first < last && class_of(data[first]) == kPunct) {
+            ++first;
+        }
+        while (last > first && class_of(data[last - 1]) == kPunct) {
+            --last;
+        }
+        if (first < last) {
+            spans_.emplace_back(static_cast<uint32_t>(base + first), static_cast<uint32_t>(last - first));
+        }
+        pos = end;
+    }
+    return spans_.size() - before;
+}
+
+} // namespace audio_library
@@ -1,12 +1,58 @@
 #include "audio_library/track.h"
+#include "audio_library/csv_reader.h"
+#include "audio_library/json_reader.h"
+#include "audio_library/unicode_fold.h"
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
 #include <cctype>
-#include <regex>
 
 namespace audio_library {
 
+namespace {
+
+// Reads a string value, or the text of a number, into text. Other values
+// are skipped, leaving it unchanged.
+bool read_json_text(JsonReader& reader, std::string& text) {
+    std::string_view value;
+    switch (reader.peek()) {
+        case JsonReader::Type::kString:
+            if (!reader.read_string(value)) return false;
+            break;
+        case JsonReader::Type::kNumber:
+            if (!reader.read_number(value)) return false;
+            break;
+        default:
+            reader.skip_value();
+            return false;
+    }
+    text.assign(value);
+    return true;
+}
+
+enum class JsonNumber { kRead, kMissing, kInvalid };
+
+// Reads a number value, or a string holding one, into value. Other values
+// such as null are skipped as missing.
+template <typename Number>
+JsonNumber read_json_number(JsonReader& reader, Number& value) {
+    std::string_view text;
+    switch (reader.peek()) {
+        case JsonReader::Type::kString:
+            if (!reader.read_string(text)) return JsonNumber::kInvalid;
+            break;
+        case JsonReader::Type::kNumber:
+            if (!reader.read_number(text)) return JsonNumber::kInvalid;
+            break;
+        default:
+            reader.skip_value();
+            return JsonNumber::kMissing;
+    }
+    return parse_csv_number(text, value) ? JsonNumber::kRead : JsonNumber::kInvalid;
+}
+
+} // namespace
+
 Track::Track(std::string title, std::string artist, std::chrono::seconds duration)
     : title_(std::move(title))
     , artist_(std::move(artist))
@@ -38,15 +84,12 @@ std::string Track::format_duration() const {
 }
 
 bool Track::matches_query(const std::string& query) const {
-    // Convert query to lowercase for case-insensitive search
-    std::string lower_query = query;
-    std::transform(lower_query.begin(), lower_query.end(), lower_query.begin(), ::tolower);
+    // Fold case and accents for case-insensitive search
+    std::string lower_query = fold_text(query);
     
     // Check each field
     auto contains_query = [&lower_query](const std::string& field) {
-        std::string lower_field = field;
-        std::transform(lower_field.begin(), lower_field.end(), lower_field.begin(), ::tolower);
-        return lower_field.find(lower_query) != std::string::npos;
+        return fold_text(field).find(lower_query) != std::string::npos;
     };
     
     return contains_query(title_) || contains_query(artist_) || 
@@ -107,10 +150,11 @@ std::string Track::to_json() const {
                 case '\r': escaped += "\\r"; break;
                 case '\t': escaped += "\\t"; break;
                 default:
-                    if (c >= 0x20 && c <= 0x7E) {
+                    // UTF-8 text is written as is; other control
+                    // characters need an escape
+                    if (static_cast<unsigned char>(c) >= 0x20) {
                         escaped += c;
                     } else {
-                        // Unicode escape for non-ASCII characters
                         std::ostringstream oss;
                         oss << "\\u" << std::hex << std::setw(4) << std::setfill('0') 
                             << static_cast<int>(static_cast<unsigned char>(c));
@@ -168,151 +212,107 @@ bool Track::operator<(const Track& other) const noexcept {
 }
 
 std::optional<Track> Track::from_csv_line(const std::string& line) {
-    // Simple CSV parser (handles quoted fields with embedded commas)
-    std::vector<std::string> fields;
-    std::string current_field;
-    bool in_quotes = false;
-    bool quote_escaped = false;
+    std::vector<std::string_view> fields;
+    CsvReader reader(line);
+    if (!reader.next_record(fields)) {
+        return std::nullopt;
+    }
+    return from_csv_fields(fields);
+}
+
+std::optional<Track> Track::from_csv_fields(const std::vector<std::string_view>& fields) {
+    const auto numbers = parse_csv_numbers(fields);
+    if (!numbers) {
+        return std::nullopt;
+    }
+    Track track{std::string(fields[0]), std::string(fields[1]), numbers->duration};
     
-    for (size_t i = 0; i < line.length(); ++i) {
-        char c = line[i];
-        
-        if (quote_escaped) {
-            if (c == '"') {
-                current_field += '"';
-            } else {
-                // Not an escaped quote, end the quoted field
-                in_quotes = false;
-                --i; // Process this character again
-            }
-            quote_escaped = false;
-        } else if (in_quotes) {
-            if (c == '"') {
-                if (i + 1 < line.length() && line[i + 1] == '"') {
-                    quote_escaped = true;
-                } else {
-                    in_quotes = false;
-                }
-            } else {
-                current_field += c;
-            }
-        } else {
-            if (c == '"' && current_field.empty()) {
-                in_quotes = true;
-            } else if (c == ',') {
-                fields.push_back(current_field);
-                current_field.clear();
-            } else {
-                current_field += c;
-            }
-        }
+    // Optional fields
+    if (fields.size() > 3 && !fields[3].empty()) {
+        track.set_album(std::string(fields[3]));
+    }
+    if (fields.size() > 4 && !fields[4].empty()) {
+        track.set_genre(std::string(fields[4]));
     }
-    fields.push_back(current_field);
+    track.year_ = numbers->year;
+    track.play_count_ = numbers->play_count;
+    track.set_rating(numbers->rating);
     
+    return track;
+}
+
+std::optional<Track::CsvNumbers> Track::parse_csv_numbers(const std::vector<std::string_view>& fields) {
     // Parse fields (minimum required: title, artist, duration)
-    if (fields.size() < 3) {
+    CsvNumbers numbers;
+    if (fields.size() < 3 || !parse_csv_number(fields[2], numbers.duration)) {
         return std::nullopt;
     }
-    
-    try {
-        Track track(fields[0], fields[1], std::stoi(fields[2]));
-        
-        // Optional fields
-        if (fields.size() > 3 && !fields[3].empty()) {
-            track.set_album(fields[3]);
-        }
-        if (fields.size() > 4 && !fields[4].empty()) {
-            track.set_genre(fields[4]);
-        }
-        if (fields.size() > 5 && !fields[5].empty()) {
-            track.set_year(std::stoi(fields[5]));
-        }
-        if (fields.size() > 6 && !fields[6].empty()) {
-            track.play_count_ = std::stoull(fields[6]);
-        }
-        if (fields.size() > 7 && !fields[7].empty()) {
-            track.set_rating(std::stod(fields[7]));
-        }
-        
-        return track;
-    } catch (const std::exception&) {
+    if (fields.size() > 5 && !fields[5].empty() && !parse_csv_number(fields[5], numbers.year)) {
         return std::nullopt;
     }
+    if (fields.size() > 6 && !fields[6].empty() && !parse_csv_number(fields[6], numbers.play_count)) {
+        return std::nullopt;
+    }
+    if (fields.size() > 7 && !fields[7].empty() && !parse_csv_number(fields[7], numbers.rating)) {
+        return std::nullopt;
+    }
+    return numbers;
 }
 
 std::optional<Track> Track::from_json(const std::string& json) {
-    // Simple JSON parser for track objects
-    static const std::regex field_regex("\"(\\w+)\"\\s*:\\s*(\"([^\"\\\\]|\\\\.)*\"|\\d+(\\.\\d+)?)");
-    
-    std::unordered_map<std::string, std::string> fields;
-    
-    auto matches_begin = std::sregex_iterator(json.begin(), json.end(), field_regex);
-    auto matches_end = std::sregex_iterator();
+    JsonReader reader(json);
+    return from_json_object(reader);
+}
+
+std::optional<Track> Track::from_json_object(JsonReader& reader) {
+    if (!reader.begin_object()) {
+        return std::nullopt;
+    }
     
-    for (auto it = matches_begin; it != matches_end; ++it) {
-        std::smatch match = *it;
-        std::string key = match[1];
-        std::string value = match[2];
-        
-        // Remove quotes from string values
-        if (value.front() == '"' && value.back() == '"') {
-            value = value.substr(1, value.length() - 2);
-            
-            // Unescape JSON string
-            std::string unescaped;
-            for (size_t i = 0; i < value.length(); ++i) {
-                if (value[i] == '\\' && i + 1 < value.length()) {
-                    switch (value[i + 1]) {
-                        case '"': unescaped += '"'; ++i; break;
-                        case '\\': unescaped += '\\'; ++i; break;
-                        case 'b': unescaped += '\b'; ++i; break;
-                        case 'f': unescaped += '\f'; ++i; break;
-                        case 'n': unescaped += '\n'; ++i; break;
-                        case 'r': unescaped += '\r'; ++i; break;
-                        case 't': unescaped += '\t'; ++i; break;
-                        default: unescaped += value[i];
-                    }
-                } else {
-                    unescaped += value[i];
-                }
+    // Keys are matched before their value is read, which invalidates them
+    Track track;
+    bool has_title = false;
+    bool has_artist = false;
+    bool has_duration = false;
+    bool valid = true;
+    std::string_view key;
+    while (reader.next_member(key)) {
+        if (key == "title") {
+            has_title = read_json_text(reader, track.title_) || has_title;
+        } else if (key == "artist") {
+            has_artist = read_json_text(reader, track.artist_) || has_artist;
+        } else if (key == "album") {
+            read_json_text(reader, track.album_);
+        } else if (key == "genre") {
+            read_json_text(reader, track.genre_);
+        } else if (key == "duration") {
+            int duration = 0;
+            const JsonNumber number = read_json_number(reader, duration);
+            if (number == JsonNumber::kRead) {
+                track.duration_ = std::chrono::seconds(duration);
+                has_duration = true;
+            }
+            valid = valid && number != JsonNumber::kInvalid;
+        } else if (key == "year") {
+            valid = valid && read_json_number(reader, track.year_) != JsonNumber::kInvalid;
+        } else if (key == "play_count") {
+            valid = valid && read_json_number(reader, track.play_count_) != JsonNumber::kInvalid;
+        } else if (key == "rating") {
+            double rating = 0.0;
+            const JsonNumber number = read_json_number(reader, rating);
+            if (number == JsonNumber::kRead) {
+                track.set_rating(rating);
             }
-            value = unescaped;
+            valid = valid && number != JsonNumber::kInvalid;
+        } else {
+            reader.skip_value();
         }
-        
-        fields[key] = value;
-    }
-    
-    // Check required fields
-    if (fields.find("title") == fields.end() || 
-        fields.find("artist") == fields.end() || 
-        fields.find("duration") == fields.end()) {
-        return std::nullopt;
     }
     
-    try {
-        Track track(fields["title"], fields["artist"], std::stoi(fields["duration"]));
-        
-        // Optional fields
-        if (fields.find("album") != fields.end()) {
-            track.set_album(fields["album"]);
-        }
-        if (fields.find("genre") != fields.end()) {
-            track.set_genre(fields["genre"]);
-        }
-        if (fields.find("year") != fields.end()) {
-            track.set_year(std::stoi(fields["year"]));
-        }
-        if (fields.find("play_count") != fields.end()) {
-            track.play_count_ = std::stoull(fields["play_count"]);
-        }
-        if (fields.find("rating") != fields.end()) {
-            track.set_rating(std::stod(fields["rating"]));
-        }
-        
-        return track;
-    } catch (const std::exception&) {
+    if (reader.failed() || !valid || !has_title || !has_artist || !has_duration) {
         return std::nullopt;
     }
+    return track;
 }
 
 std::size_t TrackHash::operator()(const Track& track) const noexcept {
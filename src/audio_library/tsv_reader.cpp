@@ -0,0 +1,97 @@
+#include "audio_library/tsv_reader.h"
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace audio_library {
+
+namespace {
+
+constexpr size_t kBlockSize = 64;
+
+// Bits for the tab and '\n' bytes among data[0, size), size being at most 64
+uint64_t scan_block(const char* data, size_t size) {
+    uint64_t separators = 0;
+#if defined(__AVX2__)
+    if (size == kBlockSize) {
+        for (size_t i = 0; i < kBlockSize; i += 32) {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            const __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t')),
+                                                 _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')));
+            separators |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(hits))) << i;
+        }
+        return separators;
+    }
+#elif defined(__SSE2__)
+    if (size == kBlockSize) {
+        for (size_t i = 0; i < kBlockSize; i += 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            const __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t')),
+                                              _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')));
+            separators |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(hits))) << i;
+        }
+        return separators;
+    }
+#endif
+    for (size_t i = 0; i < size; ++i) {
+        separators |= static_cast<uint64_t>(data[i] == '\t' || data[i] == '\n') << i;
+    }
+    return separators;
+}
+
+} // namespace
+
+bool TsvReader::next_record(std::vector<std::string_view>& fields) {
+    fields.clear();
+    const size_t end = text_.size();
+
+    while (position_ < end) {
+        const size_t begin = position_;
+        size_t field_begin = begin;
+        size_t field_end = find_separator(field_begin);
+        while (field_end < end && text_[field_end] == '\t') {
+            fields.push_back(text_.substr(field_begin, field_end - field_begin));
+            field_begin = field_end + 1;
+            field_end = find_separator(field_begin);
+        }
+
+        // field_end is at the line break or the end of the text
+        position_ = std::min(end, field_end + 1);
+        line_number_ = next_line_;
+        if (field_end < end) {
+            ++next_line_;
+        }
+        size_t line_end = field_end;
+        if (line_end > field_begin && text_[line_end - 1] == '\r') {
+            --line_end;
+        }
+        if (fields.empty() && line_end == begin) {
+            continue; // Blank line
+        }
+        fields.push_back(text_.substr(field_begin, line_end - field_begin));
+        return true;
+    }
+    return false;
+}
+
+size_t TsvReader::find_separator(size_t i) {
+    while (i < text_.size()) {
+        if (i - block_begin_ >= block_size_) {
+            block_begin_ = i;
+            block_size_ = std::min(kBlockSize, text_.size() - i);
+            separators_ = scan_block(text_.data() + i, block_size_);
+        }
+        const uint64_t separators = separators_ >> (i - block_begin_);
+        if (separators != 0) {
+            return i + static_cast<size_t>(__builtin_ctzll(separators));
+        }
+        i = block_begin_ + block_size_;
+    }
+    return text_.size();
+}
+
+} // namespace audio_library
@@ -0,0 +1,380 @@
+#include "audio_library/unicode_fold.h"
+#include <iterator>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace audio_library {
+
+namespace {
+
+// Folding tables for the blocks that hold accented Latin, Greek, Cyrillic,
+// punctuation, CJK punctuation and fullwidth forms. Generated from Unicode
+// 14.0 as casefold, then NFKD with U+0300..U+036F removed, then NFC, with
+// letters that have no decomposition (ø, đ, ł, æ, ...) spelled in ASCII and
+// spaces, dashes and quotes mapped to their ASCII counterparts. An entry is
+// the folded code point, 0 to drop the character, or kExpansionBase plus an
+// index into kExpansions when it folds to more than one.
+
+// U+00A0..U+04FF
+constexpr uint16_t kFold00A0[] = {
+    0x0020, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7, 0x0020, 0x00A9, 0x0061, 0x0022,
+    0x00AC, 0x0000, 0x00AE, 0x0020, 0x00B0, 0x00B1, 0x0032, 0x0033, 0x0020, 0x03BC, 0x00B6, 0x00B7,
+    0x0020, 0x0031, 0x006F, 0x0022, 0xE000, 0xE001, 0xE002, 0x00BF, 0x0061, 0x0061, 0x0061, 0x0061,
+    0x0061, 0x0061, 0xE003, 0x0063, 0x0065, 0x0065, 0x0065, 0x0065, 0x0069, 0x0069, 0x0069, 0x0069,
+    0x0064, 0x006E, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x00D7, 0x006F, 0x0075, 0x0075, 0x0075,
+    0x0075, 0x0079, 0xE004, 0xE005, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0xE003, 0x0063,
+    0x0065, 0x0065, 0x0065, 0x0065, 0x0069, 0x0069, 0x0069, 0x0069, 0x0064, 0x006E, 0x006F, 0x006F,
+    0x006F, 0x006F, 0x006F, 0x00F7, 0x006F, 0x0075, 0x0075, 0x0075, 0x0075, 0x0079, 0xE004, 0x0079,
+    0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0063, 0x0063, 0x0063, 0x0063, 0x0063, 0x0063,
+    0x0063, 0x0063, 0x0064, 0x0064, 0x0064, 0x0064, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065,
+    0x0065, 0x0065, 0x0065, 0x0065, 0x0067, 0x0067, 0x0067, 0x0067, 0x0067, 0x0067, 0x0067, 0x0067,
+    0x0068, 0x0068, 0x0068, 0x0068, 0x0069, 0x0069, 0x0069, 0x0069, 0x0069, 0x0069, 0x0069, 0x0069,
+    0x0069, 0x0069, 0xE006, 0xE006, 0x006A, 0x006A, 0x006B, 0x006B, 0x006B, 0x006C, 0x006C, 0x006C,
+    0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x006E, 0x006E, 0x006E, 0x006E, 0x006E,
+    0x006E, 0xE007, 0x014B, 0x014B, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0xE008, 0xE008,
+    0x0072, 0x0072, 0x0072, 0x0072, 0x0072, 0x0072, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073,
+    0x0073, 0x0073, 0x0074, 0x0074, 0x0074, 0x0074, 0x0074, 0x0074, 0x0075, 0x0075, 0x0075, 0x0075,
+    0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0077, 0x0077, 0x0079, 0x0079,
+    0x0079, 0x007A, 0x007A, 0x007A, 0x007A, 0x007A, 0x007A, 0x0073, 0x0062, 0x0253, 0x0183, 0x0183,
+    0x0185, 0x0185, 0x0254, 0x0188, 0x0188, 0x0256, 0x0257, 0x018C, 0x018C, 0x018D, 0x01DD, 0x0259,
+    0x025B, 0x0192, 0x0192, 0x0260, 0x0263, 0x0195, 0x0269, 0x0069, 0x0199, 0x0199, 0x019A, 0x019B,
+    0x026F, 0x0272, 0x019E, 0x0275, 0x006F, 0x006F, 0x01A3, 0x01A3, 0x01A5, 0x01A5, 0x0280, 0x01A8,
+    0x01A8, 0x0283, 0x01AA, 0x01AB, 0x01AD, 0x01AD, 0x0288, 0x0075, 0x0075, 0x028A, 0x028B, 0x01B4,
+    0x01B4, 0x007A, 0x007A, 0x0292, 0x01B9, 0x01B9, 0x01BA, 0x01BB, 0x01BD, 0x01BD, 0x01BE, 0x01BF,
+    0x01C0, 0x01C1, 0x01C2, 0x01C3, 0xE009, 0xE009, 0xE009, 0xE00A, 0xE00A, 0xE00A, 0xE00B, 0xE00B,
+    0xE00B, 0x0061, 0x0061, 0x0069, 0x0069, 0x006F, 0x006F, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075,
+    0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x01DD, 0x0061, 0x0061, 0x0061, 0x0061, 0xE003, 0xE003,
+    0x0067, 0x0067, 0x0067, 0x0067, 0x006B, 0x006B, 0x006F, 0x006F, 0x006F, 0x006F, 0x0292, 0x0292,
+    0x006A, 0xE009, 0xE009, 0xE009, 0x0067, 0x0067, 0x0195, 0x01BF, 0x006E, 0x006E, 0x0061, 0x0061,
+    0xE003, 0xE003, 0x006F, 0x006F, 0x0061, 0x0061, 0x0061, 0x0061, 0x0065, 0x0065, 0x0065, 0x0065,
+    0x0069, 0x0069, 0x0069, 0x0069, 0x006F, 0x006F, 0x006F, 0x006F, 0x0072, 0x0072, 0x0072, 0x0072,
+    0x0075, 0x0075, 0x0075, 0x0075, 0x0073, 0x0073, 0x0074, 0x0074, 0x021D, 0x021D, 0x0068, 0x0068,
+    0x019E, 0x0221, 0x0223, 0x0223, 0x0225, 0x0225, 0x0061, 0x0061, 0x0065, 0x0065, 0x006F, 0x006F,
+    0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x0079, 0x0079, 0x0234, 0x0235, 0x0236, 0x0237,
+    0x0238, 0x0239, 0x2C65, 0x023C, 0x023C, 0x019A, 0x2C66, 0x023F, 0x0240, 0x0242, 0x0242, 0x0062,
+    0x0289, 0x028C, 0x0247, 0x0247, 0x0249, 0x0249, 0x024B, 0x024B, 0x024D, 0x024D, 0x024F, 0x024F,
+    0x0250, 0x0251, 0x0252, 0x0253, 0x0254, 0x0255, 0x0256, 0x0257, 0x0258, 0x0259, 0x025A, 0x025B,
+    0x025C, 0x025D, 0x025E, 0x025F, 0x0260, 0x0261, 0x0262, 0x0263, 0x0264, 0x0265, 0x0266, 0x0267,
+    0x0069, 0x0269, 0x026A, 0x026B, 0x026C, 0x026D, 0x026E, 0x026F, 0x0270, 0x0271, 0x0272, 0x0273,
+    0x0274, 0x0275, 0x0276, 0x0277, 0x0278, 0x0279, 0x027A, 0x027B, 0x027C, 0x027D, 0x027E, 0x027F,
+    0x0280, 0x0281, 0x0282, 0x0283, 0x0284, 0x0285, 0x0286, 0x0287, 0x0288, 0x0289, 0x028A, 0x028B,
+    0x028C, 0x028D, 0x028E, 0x028F, 0x0290, 0x0291, 0x0292, 0x0293, 0x0294, 0x0295, 0x0296, 0x0297,
+    0x0298, 0x0299, 0x029A, 0x029B, 0x029C, 0x029D, 0x029E, 0x029F, 0x02A0, 0x02A1, 0x02A2, 0x02A3,
+    0x02A4, 0x02A5, 0x02A6, 0x02A7, 0x02A8, 0x02A9, 0x02AA, 0x02AB, 0x02AC, 0x02AD, 0x02AE, 0x02AF,
+    0x0068, 0x0266, 0x006A, 0x0072, 0x0279, 0x027B, 0x0281, 0x0077, 0x0079, 0x02B9, 0x02BA, 0x02BB,
+    0x02BC, 0x02BD, 0x02BE, 0x02BF, 0x02C0, 0x02C1, 0x02C2, 0x02C3, 0x02C4, 0x02C5, 0x02C6, 0x02C7,
+    0x02C8, 0x02C9, 0x02CA, 0x02CB, 0x02CC, 0x02CD, 0x02CE, 0x02CF, 0x02D0, 0x02D1, 0x02D2, 0x02D3,
+    0x02D4, 0x02D5, 0x02D6, 0x02D7, 0x0020, 0x0020, 0x0020, 0x0020, 0x0020, 0x0020, 0x02DE, 0x02DF,
+    0x0263, 0x006C, 0x0073, 0x0078, 0x0295, 0x02E5, 0x02E6, 0x02E7, 0x02E8, 0x02E9, 0x02EA, 0x02EB,
+    0x02EC, 0x02ED, 0x02EE, 0x02EF, 0x02F0, 0x02F1, 0x02F2, 0x02F3, 0x02F4, 0x02F5, 0x02F6, 0x02F7,
+    0x02F8, 0x02F9, 0x02FA, 0x02FB, 0x02FC, 0x02FD, 0x02FE, 0x02FF, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0371, 0x0371, 0x0373, 0x0373, 0x02B9, 0x0375, 0x0377, 0x0377, 0x0378, 0x0379, 0x0020, 0x037B,
+    0x037C, 0x037D, 0x003B, 0x03F3, 0x0380, 0x0381, 0x0382, 0x0383, 0x0020, 0x0020, 0x03B1, 0x00B7,
+    0x03B5, 0x03B7, 0x03B9, 0x038B, 0x03BF, 0x038D, 0x03C5, 0x03C9, 0x03B9, 0x03B1, 0x03B2, 0x03B3,
+    0x03B4, 0x03B5, 0x03B6, 0x03B7, 0x03B8, 0x03B9, 0x03BA, 0x03BB, 0x03BC, 0x03BD, 0x03BE, 0x03BF,
+    0x03C0, 0x03C1, 0x03A2, 0x03C3, 0x03C4, 0x03C5, 0x03C6, 0x03C7, 0x03C8, 0x03C9, 0x03B9, 0x03C5,
+    0x03B1, 0x03B5, 0x03B7, 0x03B9, 0x03C5, 0x03B1, 0x03B2, 0x03B3, 0x03B4, 0x03B5, 0x03B6, 0x03B7,
+    0x03B8, 0x03B9, 0x03BA, 0x03BB, 0x03BC, 0x03BD, 0x03BE, 0x03BF, 0x03C0, 0x03C1, 0x03C3, 0x03C3,
+    0x03C4, 0x03C5, 0x03C6, 0x03C7, 0x03C8, 0x03C9, 0x03B9, 0x03C5, 0x03BF, 0x03C5, 0x03C9, 0x03D7,
+    0x03B2, 0x03B8, 0x03C5, 0x03C5, 0x03C5, 0x03C6, 0x03C0, 0x03D7, 0x03D9, 0x03D9, 0x03DB, 0x03DB,
+    0x03DD, 0x03DD, 0x03DF, 0x03DF, 0x03E1, 0x03E1, 0x03E3, 0x03E3, 0x03E5, 0x03E5, 0x03E7, 0x03E7,
+    0x03E9, 0x03E9, 0x03EB, 0x03EB, 0x03ED, 0x03ED, 0x03EF, 0x03EF, 0x03BA, 0x03C1, 0x03C3, 0x03F3,
+    0x03B8, 0x03B5, 0x03F6, 0x03F8, 0x03F8, 0x03C3, 0x03FB, 0x03FB, 0x03FC, 0x037B, 0x037C, 0x037D,
+    0x0435, 0x0435, 0x0452, 0x0433, 0x0454, 0x0455, 0x0456, 0x0456, 0x0458, 0x0459, 0x045A, 0x045B,
+    0x043A, 0x0438, 0x0443, 0x045F, 0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437,
+    0x0438, 0x0438, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F, 0x0440, 0x0441, 0x0442, 0x0443,
+    0x0444, 0x0445, 0x0446, 0x0447, 0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F,
+    0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437, 0x0438, 0x0438, 0x043A, 0x043B,
+    0x043C, 0x043D, 0x043E, 0x043F, 0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+    0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F, 0x0435, 0x0435, 0x0452, 0x0433,
+    0x0454, 0x0455, 0x0456, 0x0456, 0x0458, 0x0459, 0x045A, 0x045B, 0x043A, 0x0438, 0x0443, 0x045F,
+    0x0461, 0x0461, 0x0463, 0x0463, 0x0465, 0x0465, 0x0467, 0x0467, 0x0469, 0x0469, 0x046B, 0x046B,
+    0x046D, 0x046D, 0x046F, 0x046F, 0x0471, 0x0471, 0x0473, 0x0473, 0x0475, 0x0475, 0x0475, 0x0475,
+    0x0479, 0x0479, 0x047B, 0x047B, 0x047D, 0x047D, 0x047F, 0x047F, 0x0481, 0x0481, 0x0482, 0x0483,
+    0x0484, 0x0485, 0x0486, 0x0487, 0x0488, 0x0489, 0x048B, 0x048B, 0x048D, 0x048D, 0x048F, 0x048F,
+    0x0491, 0x0491, 0x0493, 0x0493, 0x0495, 0x0495, 0x0497, 0x0497, 0x0499, 0x0499, 0x049B, 0x049B,
+    0x049D, 0x049D, 0x049F, 0x049F, 0x04A1, 0x04A1, 0x04A3, 0x04A3, 0x04A5, 0x04A5, 0x04A7, 0x04A7,
+    0x04A9, 0x04A9, 0x04AB, 0x04AB, 0x04AD, 0x04AD, 0x04AF, 0x04AF, 0x04B1, 0x04B1, 0x04B3, 0x04B3,
+    0x04B5, 0x04B5, 0x04B7, 0x04B7, 0x04B9, 0x04B9, 0x04BB, 0x04BB, 0x04BD, 0x04BD, 0x04BF, 0x04BF,
+    0x04CF, 0x0436, 0x0436, 0x04C4, 0x04C4, 0x04C6, 0x04C6, 0x04C8, 0x04C8, 0x04CA, 0x04CA, 0x04CC,
+    0x04CC, 0x04CE, 0x04CE, 0x04CF, 0x0430, 0x0430, 0x0430, 0x0430, 0x04D5, 0x04D5, 0x0435, 0x0435,
+    0x04D9, 0x04D9, 0x04D9, 0x04D9, 0x0436, 0x0436, 0x0437, 0x0437, 0x04E1, 0x04E1, 0x0438, 0x0438,
+    0x0438, 0x0438, 0x043E, 0x043E, 0x04E9, 0x04E9, 0x04E9, 0x04E9, 0x044D, 0x044D, 0x0443, 0x0443,
+    0x0443, 0x0443, 0x0443, 0x0443, 0x0447, 0x0447, 0x04F7, 0x04F7, 0x044B, 0x044B, 0x04FB, 0x04FB,
+    0x04FD, 0x04FD, 0x04FF, 0x04FF,
+};
+
+// U+1E00..U+1EFF
+constexpr uint16_t kFold1E00[] = {
+    0x0061, 0x0061, 0x0062, 0x0062, 0x0062, 0x0062, 0x0062, 0x0062, 0x0063, 0x0063, 0x0064, 0x0064,
+    0x0064, 0x0064, 0x0064, 0x0064, 0x0064, 0x0064, 0x0064, 0x0064, 0x0065, 0x0065, 0x0065, 0x0065,
+    0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0066, 0x0066, 0x0067, 0x0067, 0x0068, 0x0068,
+    0x0068, 0x0068, 0x0068, 0x0068, 0x0068, 0x0068, 0x0068, 0x0068, 0x0069, 0x0069, 0x0069, 0x0069,
+    0x006B, 0x006B, 0x006B, 0x006B, 0x006B, 0x006B, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C,
+    0x006C, 0x006C, 0x006D, 0x006D, 0x006D, 0x006D, 0x006D, 0x006D, 0x006E, 0x006E, 0x006E, 0x006E,
+    0x006E, 0x006E, 0x006E, 0x006E, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F,
+    0x0070, 0x0070, 0x0070, 0x0070, 0x0072, 0x0072, 0x0072, 0x0072, 0x0072, 0x0072, 0x0072, 0x0072,
+    0x0073, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073, 0x0074, 0x0074,
+    0x0074, 0x0074, 0x0074, 0x0074, 0x0074, 0x0074, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075,
+    0x0075, 0x0075, 0x0075, 0x0075, 0x0076, 0x0076, 0x0076, 0x0076, 0x0077, 0x0077, 0x0077, 0x0077,
+    0x0077, 0x0077, 0x0077, 0x0077, 0x0077, 0x0077, 0x0078, 0x0078, 0x0078, 0x0078, 0x0079, 0x0079,
+    0x007A, 0x007A, 0x007A, 0x007A, 0x007A, 0x007A, 0x0068, 0x0074, 0x0077, 0x0079, 0xE00C, 0x0073,
+    0x1E9C, 0x1E9D, 0xE005, 0x1E9F, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061,
+    0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061,
+    0x0061, 0x0061, 0x0061, 0x0061, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065,
+    0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0069, 0x0069, 0x0069, 0x0069,
+    0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F,
+    0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F,
+    0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075,
+    0x0075, 0x0075, 0x0079, 0x0079, 0x0079, 0x0079, 0x0079, 0x0079, 0x0079, 0x0079, 0x1EFB, 0x1EFB,
+    0x1EFD, 0x1EFD, 0x1EFF, 0x1EFF,
+};
+
+// U+2000..U+206F
+constexpr uint16_t kFold2000[] = {
+    0x0020, 0x0020, 0x0020, 0x0020, 0x0020, 0x0020, 0x0020, 0x0020, 0x0020, 0x0020, 0x0020, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x002D, 0x002D, 0x002D, 0x002D, 0x002D, 0x002D, 0x2016, 0x0020,
+    0x0027, 0x0027, 0x0027, 0x0027, 0x0022, 0x0022, 0x0022, 0x0022, 0x2020, 0x2021, 0x2022, 0x2023,
+    0x002E, 0xE00D, 0xE00E, 0x2027, 0x0020, 0x0020, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0020,
+    0x2030, 0x2031, 0x0027, 0x0022, 0xE00F, 0x0027, 0x0022, 0xE010, 0x2038, 0x2039, 0x203A, 0x203B,
+    0xE011, 0x203D, 0x0020, 0x203F, 0x2040, 0x2041, 0x2042, 0x2043, 0x2044, 0x2045, 0x2046, 0xE012,
+    0xE013, 0xE014, 0x204A, 0x204B, 0x204C, 0x204D, 0x204E, 0x204F, 0x2050, 0x2051, 0x2052, 0x2053,
+    0x2054, 0x2055, 0x2056, 0xE015, 0x2058, 0x2059, 0x205A, 0x205B, 0x205C, 0x205D, 0x205E, 0x0020,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x2065, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000,
+};
+
+// U+3000..U+30FF
+constexpr uint16_t kFold3000[] = {
+    0x0020, 0x002C, 0x002E, 0x3003, 0x3004, 0x3005, 0x3006, 0x3007, 0x3008, 0x3009, 0x300A, 0x300B,
+    0x0022, 0x0022, 0x0022, 0x0022, 0x3010, 0x3011, 0x3012, 0x3013, 0x3014, 0x3015, 0x3016, 0x3017,
+    0x3018, 0x3019, 0x301A, 0x301B, 0x002D, 0x301D, 0x301E, 0x301F, 0x3020, 0x3021, 0x3022, 0x3023,
+    0x3024, 0x3025, 0x3026, 0x3027, 0x3028, 0x3029, 0x302A, 0x302B, 0x302C, 0x302D, 0x302E, 0x302F,
+    0x002D, 0x3031, 0x3032, 0x3033, 0x3034, 0x3035, 0x3012, 0x3037, 0x5341, 0x5344, 0x5345, 0x303B,
+    0x303C, 0x303D, 0x303E, 0x303F, 0x3040, 0x3041, 0x3042, 0x3043, 0x3044, 0x3045, 0x3046, 0x3047,
+    0x3048, 0x3049, 0x304A, 0x304B, 0x304C, 0x304D, 0x304E, 0x304F, 0x3050, 0x3051, 0x3052, 0x3053,
+    0x3054, 0x3055, 0x3056, 0x3057, 0x3058, 0x3059, 0x305A, 0x305B, 0x305C, 0x305D, 0x305E, 0x305F,
+    0x3060, 0x3061, 0x3062, 0x3063, 0x3064, 0x3065, 0x3066, 0x3067, 0x3068, 0x3069, 0x306A, 0x306B,
+    0x306C, 0x306D, 0x306E, 0x306F, 0x3070, 0x3071, 0x3072, 0x3073, 0x3074, 0x3075, 0x3076, 0x3077,
+    0x3078, 0x3079, 0x307A, 0x307B, 0x307C, 0x307D, 0x307E, 0x307F, 0x3080, 0x3081, 0x3082, 0x3083,
+    0x3084, 0x3085, 0x3086, 0x3087, 0x3088, 0x3089, 0x308A, 0x308B, 0x308C, 0x308D, 0x308E, 0x308F,
+    0x3090, 0x3091, 0x3092, 0x3093, 0x3094, 0x3095, 0x3096, 0x3097, 0x3098, 0x3099, 0x309A, 0xE016,
+    0xE017, 0x309D, 0x309E, 0xE018, 0x002D, 0x30A1, 0x30A2, 0x30A3, 0x30A4, 0x30A5, 0x30A6, 0x30A7,
+    0x30A8, 0x30A9, 0x30AA, 0x30AB, 0x30AC, 0x30AD, 0x30AE, 0x30AF, 0x30B0, 0x30B1, 0x30B2, 0x30B3,
+    0x30B4, 0x30B5, 0x30B6, 0x30B7, 0x30B8, 0x30B9, 0x30BA, 0x30BB, 0x30BC, 0x30BD, 0x30BE, 0x30BF,
+    0x30C0, 0x30C1, 0x30C2, 0x30C3, 0x30C4, 0x30C5, 0x30C6, 0x30C7, 0x30C8, 0x30C9, 0x30CA, 0x30CB,
+    0x30CC, 0x30CD, 0x30CE, 0x30CF, 0x30D0, 0x30D1, 0x30D2, 0x30D3, 0x30D4, 0x30D5, 0x30D6, 0x30D7,
+    0x30D8, 0x30D9, 0x30DA, 0x30DB, 0x30DC, 0x30DD, 0x30DE, 0x30DF, 0x30E0, 0x30E1, 0x30E2, 0x30E3,
+    0x30E4, 0x30E5, 0x30E6, 0x30E7, 0x30E8, 0x30E9, 0x30EA, 0x30EB, 0x30EC, 0x30ED, 0x30EE, 0x30EF,
+    0x30F0, 0x30F1, 0x30F2, 0x30F3, 0x30F4, 0x30F5, 0x30F6, 0x30F7, 0x30F8, 0x30F9, 0x30FA, 0x0020,
+    0x30FC, 0x30FD, 0x30FE, 0xE019,
+};
+
+// U+FF00..U+FFEF
+constexpr uint16_t kFoldFF00[] = {
+    0xFF00, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027, 0x0028, 0x0029, 0x002A, 0x002B,
+    0x002C, 0x002D, 0x002E, 0x002F, 0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+    0x0038, 0x0039, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F, 0x0040, 0x0061, 0x0062, 0x0063,
+    0x0064, 0x0065, 0x0066, 0x0067, 0x0068, 0x0069, 0x006A, 0x006B, 0x006C, 0x006D, 0x006E, 0x006F,
+    0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077, 0x0078, 0x0079, 0x007A, 0x005B,
+    0x005C, 0x005D, 0x005E, 0x005F, 0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+    0x0068, 0x0069, 0x006A, 0x006B, 0x006C, 0x006D, 0x006E, 0x006F, 0x0070, 0x0071, 0x0072, 0x0073,
+    0x0074, 0x0075, 0x0076, 0x0077, 0x0078, 0x0079, 0x007A, 0x007B, 0x007C, 0x007D, 0x007E, 0x2985,
+    0x2986, 0x3002, 0x300C, 0x300D, 0x3001, 0x30FB, 0x30F2, 0x30A1, 0x30A3, 0x30A5, 0x30A7, 0x30A9,
+    0x30E3, 0x30E5, 0x30E7, 0x30C3, 0x30FC, 0x30A2, 0x30A4, 0x30A6, 0x30A8, 0x30AA, 0x30AB, 0x30AD,
+    0x30AF, 0x30B1, 0x30B3, 0x30B5, 0x30B7, 0x30B9, 0x30BB, 0x30BD, 0x30BF, 0x30C1, 0x30C4, 0x30C6,
+    0x30C8, 0x30CA, 0x30CB, 0x30CC, 0x30CD, 0x30CE, 0x30CF, 0x30D2, 0x30D5, 0x30D8, 0x30DB, 0x30DE,
+    0x30DF, 0x30E0, 0x30E1, 0x30E2, 0x30E4, 0x30E6, 0x30E8, 0x30E9, 0x30EA, 0x30EB, 0x30EC, 0x30ED,
+    0x30EF, 0x30F3, 0x3099, 0x309A, 0x1160, 0x1100, 0x1101, 0x11AA, 0x1102, 0x11AC, 0x11AD, 0x1103,
+    0x1104, 0x1105, 0x11B0, 0x11B1, 0x11B2, 0x11B3, 0x11B4, 0x11B5, 0x111A, 0x1106, 0x1107, 0x1108,
+    0x1121, 0x1109, 0x110A, 0x110B, 0x110C, 0x110D, 0x110E, 0x110F, 0x1110, 0x1111, 0x1112, 0xFFBF,
+    0xFFC0, 0xFFC1, 0x1161, 0x1162, 0x1163, 0x1164, 0x1165, 0x1166, 0xFFC8, 0xFFC9, 0x1167, 0x1168,
+    0x1169, 0x116A, 0x116B, 0x116C, 0xFFD0, 0xFFD1, 0x116D, 0x116E, 0x116F, 0x1170, 0x1171, 0x1172,
+    0xFFD8, 0xFFD9, 0x1173, 0x1174, 0x1175, 0xFFDD, 0xFFDE, 0xFFDF, 0x00A2, 0x00A3, 0x00AC, 0x0020,
+    0x00A6, 0x00A5, 0x20A9, 0xFFE7, 0x2502, 0x2190, 0x2191, 0x2192, 0x2193, 0x25A0, 0x25CB, 0xFFEF,
+};
+
+constexpr uint16_t kExpansionBase = 0xE000;
+
+constexpr const char* kExpansions[] = {
+    "1/4", "1/2", "3/4", "ae", "th", "ss", "ij", "\xCA\xBCn", "oe",
+    "dz", "lj", "nj", "a\xCA\xBE", "..", "...", "\xE2\x80\xB2\xE2\x80\xB2\xE2\x80\xB2",
+    "\xE2\x80\xB5\xE2\x80\xB5\xE2\x80\xB5", "!!", "??", "?!", "!?",
+    "\xE2\x80\xB2\xE2\x80\xB2\xE2\x80\xB2\xE2\x80\xB2", " \xE3\x82\x99", " \xE3\x82\x9A",
+    "\xE3\x82\x88\xE3\x82\x8A", "\xE3\x82\xB3\xE3\x83\x88",
+};
+
+struct FoldRange {
+    char32_t first;
+    char32_t last;
+    const uint16_t* table;
+};
+
+constexpr FoldRange kFoldRanges[] = {
+    {0x00A0, 0x04FF, kFold00A0},
+    {0x1E00, 0x1EFF, kFold1E00},
+    {0x2000, 0x206F, kFold2000},
+    {0x3000, 0x30FF, kFold3000},
+    {0xFF00, 0xFFEF, kFoldFF00},
+};
+
+// Position of the first byte above 0x7F in [pos, size), or size
+size_t find_non_ascii(const char* data, size_t pos, size_t size) {
+#if defined(__SSE2__)
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        int mask = _mm_movemask_epi8(chunk);
+        if (mask != 0) {
+            return pos + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+    }
+#endif
+    while (pos < size && static_cast<unsigned char>(data[pos]) < 0x80) {
+        ++pos;
+    }
+    return pos;
+}
+
+// Appends the folded form of code_point, returning false if it folds to
+// itself
+bool append_folded_code_point(std::string& out, char32_t code_point) {
+    for (const auto& range : kFoldRanges) {
+        if (code_point < range.first || code_point > range.last) continue;
+
+        const uint16_t folded = range.table[code_point - range.first];
+        if (folded == code_point) {
+            return false;
+        }
+        if (folded >= kExpansionBase && folded < kExpansionBase + std::size(kExpansions)) {
+            out += kExpansions[folded - kExpansionBase];
+        } else if (folded != 0) {
+            append_utf8(out, folded);
+        }
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+size_t decode_utf8(const unsigned char* data, size_t size, char32_t& code_point) {
+    size_t length;
+    char32_t min;
+    if (data[0] >= 0xF0 && data[0] <= 0xF4) {
+        length = 4;
+        min = 0x10000;
+        code_point = data[0] & 0x07;
+    } else if (data[0] >= 0xE0 && data[0] <= 0xEF) {
+        length = 3;
+        min = 0x800;
+        code_point = data[0] & 0x0F;
+    } else if (data[0] >= 0xC2 && data[0] <= 0xDF) {
+        length = 2;
+        min = 0x80;
+        code_point = data[0] & 0x1F;
+    } else {
+        return 0;
+    }
+    if (length > size) {
+        return 0;
+    }
+    for (size_t i = 1; i < length; ++i) {
+        if ((data[i] & 0xC0) != 0x80) {
+            return 0;
+        }
+        code_point = (code_point << 6) | (data[i] & 0x3F);
+    }
+    if (code_point < min || code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+        return 0;
+    }
+    return length;
+}
+
+void append_utf8(std::string& out, char32_t code_point) {
+    if (code_point < 0x80) {
+        out += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        out += static_cast<char>(0xC0 | (code_point >> 6));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        out += static_cast<char>(0xE0 | (code_point >> 12));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code_point >> 18));
+        out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+void ascii_lowercase(char* data, size_t size) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    // Signed compares leave bytes above 0x7F alone, as they read negative
+    const __m128i before_a = _mm_set1_epi8('A' - 1);
+    const __m128i after_z = _mm_set1_epi8('Z' + 1);
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    for (; i + 16 <= size; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(chunk, before_a), _mm_cmplt_epi8(chunk, after_z));
+        chunk = _mm_or_si128(chunk, _mm_and_si128(upper, case_bit));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), chunk);
+    }
+#endif
+    for (; i < size; ++i) {
+        if (data[i] >= 'A' && data[i] <= 'Z') {
+            data[i] = static_cast<char>(data[i] | 0x20);
+        }
+    }
+}
+
+void append_folded(std::string& out, std::string_view text) {
+    const char* data = text.data();
+    const size_t size = text.size();
+    size_t pos = 0;
+    while (pos < size) {
+        // Runs of ASCII only need lowercasing
+        const size_t next = find_non_ascii(data, pos, size);
+        if (next > pos) {
+            const size_t base = out.size();
+            out.append(data + pos, next - pos);
+            ascii_lowercase(&out[base], next - pos);
+            pos = next;
+            if (pos == size) break;
+        }
+
+        char32_t code_point = 0;
+        const auto* bytes = reinterpret_cast<const unsigned char*>(data + pos);
+        size_t length = decode_utf8(bytes, size - pos, code_point);
+        if (length == 0) {
+            out += data[pos]; // Malformed bytes are kept as they are
+            ++pos;
+            continue;
+        }
+        if (!append_folded_code_point(out, code_point)) {
+            out.append(data + pos, length);
+        }
+        pos += length;
+    }
+}
+
+std::string fold_text(std::string_view text) {
+    std::string folded;
+    folded.reserve(text.size());
+    append_folded(folded, text);
+    return folded;
+}
+
+} // namespace audio_library
@@ -31,7 +31,7 @@ public:
             }
             
             std::cout << "Loading tracks from: " << filename << "\n";
-            if (library_.import_from_csv(filename)) {
+            if (import_file(filename, FileIO::detect_file_format(filename))) {
                 std::cout << "Successfully loaded " << library_.size() << " tracks.\n\n";
             } else {
                 std::cerr << "Failed to load tracks from file.\n\n";
@@ -336,6 +336,17 @@ private:
         press_enter_to_continue();
     }
     
+    // Files of unknown format are tried as CSV
+    bool import_file(const std::string& filename, const std::optional<std::string>& format) {
+        if (format == "json") {
+            return library_.import_from_json(filename);
+        }
+        if (format == "tsv") {
+            return library_.import_from_tsv(filename);
+        }
+        return library_.import_from_csv(filename);
+    }
+    
     void import_tracks() {
         clear_screen();
         std::cout << "IMPORT TRACKS\n";
@@ -355,16 +366,11 @@ private:
         // Auto-detect format
         auto format = FileIO::detect_file_format(filename);
         
-        bool success = false;
         size_t prev_size = library_.size();
         
         std::cout << "\nImporting from " << (format.value_or("unknown")) << " format...\n";
         
-        if (format == "json") {
-            success = library_.import_from_json(filename);
-        } else {
-            success = library_.import_from_csv(filename);
-        }
+        bool success = import_file(filename, format);
         
         if (success) {
             size_t added = library_.size() - prev_size;
@@ -0,0 +1,66 @@
+#include "../include/catch.hpp"
+#include "audio_library/bounded_queue.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace audio_library;
+
+TEST_CASE("BoundedQueue passes items in order", "[bounded_queue]") {
+    SECTION("Between two threads, through a queue smaller than the stream") {
+        BoundedQueue<std::string> queue(3);
+        std::thread producer([&queue]() {
+            for (int i = 0; i < 10000; ++i) {
+                std::string item = std::to_string(i);
+                REQUIRE(queue.push(std::move(item)));
+            }
+            queue.close();
+        });
+        
+        std::vector<std::string> received;
+        std::string item;
+        while (queue.pop(item)) {
+            received.push_back(item);
+        }
+        producer.join();
+        
+        REQUIRE(received.size() == 10000);
+        for (size_t i = 0; i < received.size(); ++i) {
+            REQUIRE(received[i] == std::to_string(i));
+        }
+    }
+    
+    SECTION("Items pushed before close are still popped") {
+        BoundedQueue<int> queue(4);
+        int value = 1;
+        REQUIRE(queue.push(std::move(value)));
+        value = 2;
+        REQUIRE(queue.push(std::move(value)));
+        queue.close();
+        value = 3;
+        REQUIRE_FALSE(queue.push(std::move(value)));
+        
+        int popped = 0;
+        REQUIRE(queue.pop(popped));
+        REQUIRE(popped == 1);
+        REQUIRE(queue.pop(popped));
+        REQUIRE(popped == 2);
+        REQUIRE_FALSE(queue.pop(popped));
+    }
+    
+    SECTION("Closing releases a producer held back by a full queue") {
+        BoundedQueue<int> queue(2);
+        for (int i = 0; i < 2; ++i) {
+            int item = i;
+            REQUIRE(queue.push(std::move(item)));
+        }
+        bool pushed = true;
+        std::thread producer([&]() {
+            int item = 2;
+            pushed = queue.push(std::move(item));
+        });
+        queue.close();
+        producer.join();
+        REQUIRE_FALSE(pushed);
+    }
+}
@@ -0,0 +1,173 @@
+#include "../include/catch.hpp"
+#include "audio_library/csv_reader.h"
+#include "audio_library/track.h"
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace audio_library;
+
+namespace {
+
+using Records = std::vector<std::vector<std::string>>;
+
+Records read_all(std::string_view text, std::vector<size_t>* line_numbers = nullptr) {
+    Records records;
+    CsvReader reader(text);
+    std::vector<std::string_view> fields;
+    while (reader.next_record(fields)) {
+        records.emplace_back(fields.begin(), fields.end());
+        if (line_numbers) line_numbers->push_back(reader.line_number());
+    }
+    return records;
+}
+
+// Byte-at-a-time reading of the format CsvReader documents
+Records reference_records(std::string_view text) {
+    Records records;
+    size_t i = 0;
+    const size_t n = text.size();
+    for (;;) {
+        while (i < n && (text[i] == '\n' || (text[i] == '\r' && i + 1 < n && text[i + 1] == '\n'))) {
+            i += text[i] == '\r' ? 2 : 1;
+        }
+        if (i >= n) break;
+
+        std::vector<std::string> record;
+        for (;;) {
+            std::string field;
+            if (text[i] == '"') {
+                for (++i; i < n; ++i) {
+                    if (text[i] == '"') {
+                        if (i + 1 < n && text[i + 1] == '"') {
+                            ++i;
+                        } else {
+                            ++i;
+                            break;
+                        }
+                    }
+                    field += text[i];
+                }
+            }
+            while (i < n && text[i] != ',' && text[i] != '\n') {
+                field += text[i++];
+            }
+            if (i < n && text[i] == ',') {
+                record.push_back(field);
+                ++i;
+                continue;
+            }
+            if (i < n && text[i - 1] == '\r') {
+                field.pop_back();
+            }
+            record.push_back(field);
+            ++i;
+            break;
+        }
+        records.push_back(record);
+    }
+    return records;
+}
+
+} // namespace
+
+TEST_CASE("CsvReader splits records and fields", "[csv_reader]") {
+    SECTION("Plain fields") {
+        REQUIRE(read_all("a,b,c\n1,,3") == Records{{"a", "b", "c"}, {"1", "", "3"}});
+        REQUIRE(read_all("") == Records{});
+        REQUIRE(read_all("x,") == Records{{"x", ""}});
+    }
+
+    SECTION("Quoted fields") {
+        REQUIRE(read_all(R"("a, b","say ""hi""",c)") == Records{{"a, b", "say \"hi\"", "c"}});
+        REQUIRE(read_all(R"("",x"y",z")") == Records{{"", "x\"y\"", "z\""}});
+        REQUIRE(read_all(R"("ab"cd,e)") == Records{{"abcd", "e"}});
+        REQUIRE(read_all("\"open,to the end") == Records{{"open,to the end"}});
+    }
+
+    SECTION("Line breaks") {
+        std::vector<size_t> lines;
+        auto records = read_all("a,\"two\nlines\"\r\n\r\n\nb,\"x\"\"\r\ny\"\r\nc,d\r\n", &lines);
+        REQUIRE(records == Records{{"a", "two\nlines"}, {"b", "x\"\r\ny"}, {"c", "d"}});
+        REQUIRE(lines == std::vector<size_t>{1, 5, 7});
+    }
+
+    SECTION("Carriage returns inside fields are kept") {
+        REQUIRE(read_all("a\rb,\"c\r\"\n") == Records{{"a\rb", "c\r"}});
+    }
+}
+
+TEST_CASE("CsvReader agrees with a byte-at-a-time reader", "[csv_reader]") {
+    // Texts long enough to cross several 64-byte blocks, with quote runs
+    // of every length landing on block edges
+    const std::string alphabet = "abc,,\"\"\"\n\r ";
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+    std::uniform_int_distribution<size_t> length(0, 300);
+
+    for (int round = 0; round < 5000; ++round) {
+        std::string text(length(rng), ' ');
+        for (auto& c : text) c = alphabet[pick(rng)];
+        INFO("text '" << text << "'");
+        REQUIRE(read_all(text) == reference_records(text));
+    }
+}
+
+TEST_CASE("parse_csv_number reads like std::stoi and std::stod", "[csv_reader]") {
+    int i = 0;
+    REQUIRE(parse_csv_number("180", i));
+    REQUIRE(i == 180);
+    REQUIRE(parse_csv_number(" +42abc", i));
+    REQUIRE(i == 42);
+    REQUIRE(parse_csv_number("-7", i));
+    REQUIRE(i == -7);
+    REQUIRE_FALSE(parse_csv_number("", i));
+    REQUIRE_FALSE(parse_csv_number("abc", i));
+    REQUIRE_FALSE(parse_csv_number("99999999999", i));
+
+    uint64_t count = 0;
+    REQUIRE(parse_csv_number("18446744073709551615", count));
+    REQUIRE(count == 18446744073709551615ull);
+
+    double d = 0.0;
+    REQUIRE(parse_csv_number("4.25", d));
+    REQUIRE(d == 4.25);
+    REQUIRE(parse_csv_number("\t3e0 stars", d));
+    REQUIRE(d == 3.0);
+    REQUIRE_FALSE(parse_csv_number("rating", d));
+}
+
+TEST_CASE("Track CSV lines survive a round trip", "[csv_reader]") {
+    const std::string alphabet = "ab ,\"\n\r'";
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+    std::uniform_int_distribution<size_t> length(1, 12);
+    auto text = [&]() {
+        std::string value(length(rng), ' ');
+        for (auto& c : value) c = alphabet[pick(rng)];
+        return value;
+    };
+
+    for (int round = 0; round < 500; ++round) {
+        Track track(text(), text(), round + 1);
+        track.set_album(text());
+        track.set_genre(text());
+        track.set_year(1950 + round % 70);
+        track.set_rating((round % 11) * 0.5);
+
+        std::string line = track.to_csv();
+        CsvReader reader(line);
+        std::vector<std::string_view> fields;
+        REQUIRE(reader.next_record(fields));
+        auto parsed = Track::from_csv_fields(fields);
+        INFO(line);
+        REQUIRE(parsed.has_value());
+        REQUIRE(parsed->title() == track.title());
+        REQUIRE(parsed->artist() == track.artist());
+        REQUIRE(parsed->album() == track.album());
+        REQUIRE(parsed->genre() == track.genre());
+        REQUIRE(parsed->duration_seconds() == track.duration_seconds());
+        REQUIRE(parsed->year() == track.year());
+        REQUIRE(parsed->rating() == Approx(track.rating()));
+    }
+}
@@ -0,0 +1,360 @@
+#include "../include/catch.hpp"
+#include "audio_library/decompressor.h"
+#include "audio_library/file_io.h"
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace audio_library;
+
+namespace {
+
+const std::string kSample = "Title,Artist,Duration\nSong A,Artist A,180\nSong A,Artist A,180\n";
+// kSample compressed by gzip and by zstd
+const std::string kSampleGzip(
+    "\x1F\x8B\x08\x00\x00\x00\x00\x00\x02\x03\x0B\xC9\x2C\xC9\x49\xD5\x71\x2C\x2A\xC9\x2C\x2E\xD1\x71"
+    "\x29\x2D\x4A\x2C\xC9\xCC\xCF\xE3\x0A\xCE\xCF\x4B\x57\x70\x84\x0A\x03\x19\x86\x16\x06\x58\xC5\x00"
+    "\xFE\x09\xF0\x8B\x3E\x00\x00\x00", 56);
+const std::string kSampleZstd(
+    "\x28\xB5\x2F\xFD\x20\x3E\x65\x01\x00\x24\x02\x54\x69\x74\x6C\x65\x2C\x41\x72\x74\x69\x73\x74\x2C"
+    "\x44\x75\x72\x61\x74\x69\x6F\x6E\x0A\x53\x6F\x6E\x67\x20\x41\x20\x41\x2C\x31\x38\x30\x02\x00\x37"
+    "\x7F\x41\xB3\xE9\x04", 53);
+
+void append_le(std::string& out, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+uint32_t crc32(std::string_view data) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (unsigned char c : data) {
+        crc ^= c;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+// gzip member holding data in stored deflate blocks, so that tests can
+// make any amount of it without a compressor
+std::string stored_gzip(std::string_view data) {
+    std::string out("\x1F\x8B\x08\x00\x00\x00\x00\x00\x00\xFF", 10);
+    size_t at = 0;
+    do {
+        const size_t size = std::min<size_t>(data.size() - at, 65535);
+        out += static_cast<char>(at + size == data.size() ? 1 : 0);
+        append_le(out, static_cast<uint32_t>(size), 2);
+        append_le(out, static_cast<uint32_t>(~size & 0xFFFF), 2);
+        out += data.substr(at, size);
+        at += size;
+    } while (at < data.size());
+    append_le(out, crc32(data), 4);
+    append_le(out, static_cast<uint32_t>(data.size()), 4);
+    return out;
+}
+
+// zstd frame holding data in raw blocks, with a 128 KiB window
+std::string raw_zstd(std::string_view data) {
+    std::string out("\x28\xB5\x2F\xFD\x00\x38", 6);
+    size_t at = 0;
+    do {
+        const size_t size = std::min<size_t>(data.size() - at, 128 << 10);
+        const bool last = at + size == data.size();
+        append_le(out, static_cast<uint32_t>(size << 3 | (last ? 1 : 0)), 3);
+        out += data.substr(at, size);
+        at += size;
+    } while (at < data.size());
+    return out;
+}
+
+std::string catalogue_csv(size_t count) {
+    std::string csv = "Title,Artist,Duration\n";
+    for (size_t i = 0; i < count; ++i) {
+        const std::string n = std::to_string(i);
+        if (i % 500 == 7) {
+            csv += "Broken " + n + ",Artist,not_a_number\n";
+        } else if (i % 9 == 0) {
+            csv += "\"Notes " + n + "\nover two lines\",Artist " + n + ",180\n";
+        } else {
+            csv += "Song " + n + ",Artist " + n + "," + std::to_string(100 + i % 500) + "\n";
+        }
+    }
+    return csv;
+}
+
+class TempFile {
+public:
+    explicit TempFile(const std::string& filename) : path_(fs::temp_directory_path() / filename) {}
+    ~TempFile() { fs::remove(path_); }
+    
+    const fs::path& path() const { return path_; }
+    
+    void write(const std::string& content) {
+        std::ofstream file(path_, std::ios::binary);
+        file << content;
+    }
+    
+private:
+    fs::path path_;
+};
+
+struct Import {
+    std::vector<std::string> tracks;
+    std::vector<std::string> errors;
+};
+
+using ImportFunction = std::vector<Track> (*)(const fs::path&, const FileIO::ImportOptions&);
+
+Import run_import(ImportFunction import, const fs::path& path, FileIO::ImportOptions options = {}) {
+    Import result;
+    options.error_callback = [&result](const std::string& error, size_t) { result.errors.push_back(error); };
+    for (const auto& track : import(path, options)) {
+        result.tracks.push_back(track.to_csv());
+    }
+    return result;
+}
+
+} // namespace
+
+TEST_CASE("Detect compression by magic bytes", "[decompressor]") {
+    REQUIRE(detect_compression(kSampleGzip) == Compression::kGzip);
+    REQUIRE(detect_compression(kSampleZstd) == Compression::kZstd);
+    REQUIRE(detect_compression(kSample) == Compression::kNone);
+    REQUIRE(detect_compression("\x1F") == Compression::kNone);
+    REQUIRE(detect_compression("") == Compression::kNone);
+    REQUIRE(std::string(compression_name(Compression::kZstd)) == "zstd");
+    REQUIRE(can_decompress(Compression::kNone));
+    
+    REQUIRE(Decompressor::expected_size(stored_gzip(kSample), Compression::kGzip) == kSample.size());
+    if (can_decompress(Compression::kZstd)) {
+        REQUIRE(Decompressor::expected_size(kSampleZstd, Compression::kZstd) == kSample.size());
+    }
+}
+
+TEST_CASE("Decompressor streams blocks", "[decompressor]") {
+    std::string text;
+    for (int i = 0; text.size() < 300000; ++i) {
+        text += "Song " + std::to_string(i) + ",Artist " + std::to_string(i % 97) + ",180\n";
+    }
+    
+    auto decompress = [](Compression compression, std::string_view input, std::string& output,
+                         size_t block_size, size_t max_blocks = SIZE_MAX) {
+        Decompressor decompressor(compression);
+        output.clear();
+        size_t blocks = 0;
+        const bool ok = decompressor.run(input, [&](std::string&& block) {
+            REQUIRE(!block.empty());
+            REQUIRE(block.size() <= block_size);
+            output += block;
+            return ++blocks < max_blocks;
+        }, block_size);
+        return ok ? std::string() : decompressor.error();
+    };
+    
+    for (const auto compression : {Compression::kGzip, Compression::kZstd}) {
+        const std::string name = compression_name(compression);
+        const bool gzip = compression == Compression::kGzip;
+        const std::string compressed = gzip ? stored_gzip(text) : raw_zstd(text);
+        std::string output;
+        
+        if (!can_decompress(compression)) {
+            SECTION("Without " + name + " support, runs fail with an error") {
+                REQUIRE_FALSE(decompress(compression, compressed, output, 4096).empty());
+                REQUIRE(output.empty());
+            }
+            continue;
+        }
+        
+        SECTION(name + " in small blocks") {
+            REQUIRE(decompress(compression, compressed, output, 4096).empty());
+            REQUIRE(output == text);
+            REQUIRE(decompress(compression, gzip ? kSampleGzip : kSampleZstd, output, 7).empty());
+            REQUIRE(output == kSample);
+        }
+        
+        SECTION(name + " members or frames in a row read as one stream") {
+            const std::string twice = compressed + (gzip ? stored_gzip(kSample) : raw_zstd(kSample));
+            REQUIRE(decompress(compression, twice, output, 65536).empty());
+            REQUIRE(output == text + kSample);
+        }
+        
+        SECTION(name + " stops when the sink does") {
+            REQUIRE(decompress(compression, compressed, output, 1000, 3).empty());
+            REQUIRE(output == text.substr(0, 3000));
+        }
+        
+        SECTION(name + " that is cut short or corrupt fails") {
+            const std::string cut = compressed.substr(0, compressed.size() / 2);
+            REQUIRE_FALSE(decompress(compression, cut, output, 4096).empty());
+            REQUIRE(text.compare(0, output.size(), output) == 0);
+            
+            std::string corrupt = compressed;
+            corrupt[gzip ? 10 : 6] = '\x07'; // Invalid block type
+            REQUIRE_FALSE(decompress(compression, corrupt, output, 4096).empty());
+        }
+    }
+}
+
+TEST_CASE("FileIO imports compressed files", "[file_io]") {
+    const std::string csv = catalogue_csv(20000);
+    TempFile plain("test_catalogue.csv");
+    plain.write(csv);
+    TempFile gzipped("test_catalogue.csv.gz");
+    gzipped.write(stored_gzip(csv));
+    TempFile zstd("test_catalogue.csv.zst");
+    zstd.write(raw_zstd(csv));
+    
+    const Import expected = run_import(FileIO::import_csv, plain.path());
+    REQUIRE(expected.tracks.size() == 19960);
+    
+    for (const auto* file : {&gzipped, &zstd}) {
+        const Compression compression = file == &gzipped ? Compression::kGzip : Compression::kZstd;
+        const std::string name = compression_name(compression);
+        
+        if (!can_decompress(compression)) {
+            SECTION("Without " + name + " support, the import reports why") {
+                const Import imported = run_import(FileIO::import_csv, file->path());
+                REQUIRE(imported.tracks.empty());
+                REQUIRE(imported.errors.size() == 1);
+                REQUIRE(imported.errors[0].find(name) != std::string::npos);
+            }
+            continue;
+        }
+        
+        SECTION(name + " CSV imports as the plain file does") {
+            REQUIRE(FileIO::detect_file_format(file->path()) == "csv");
+            const Import imported = run_import(FileIO::import_csv, file->path());
+            REQUIRE(imported.tracks == expected.tracks);
+            REQUIRE(imported.errors == expected.errors);
+        }
+        
+        SECTION(name + " CSV checkpoints in decompressed bytes") {
+            std::vector<FileIO::ImportCheckpoint> checkpoints;
+            std::vector<std::string> batched;
+            FileIO::ImportOptions options;
+            options.checkpoint_interval = 16384;
+            options.batch_callback = [&batched](std::vector<Track>&& tracks) {
+                for (const auto& track : tracks) batched.push_back(track.to_csv());
+            };
+            options.checkpoint_callback = [&checkpoints](const FileIO::ImportProgress& progress) {
+                checkpoints.push_back(progress.checkpoint);
+            };
+            FileIO::PipelineStats stats;
+            options.pipeline_stats = &stats;
+            REQUIRE(run_import(FileIO::import_csv, file->path(), options).tracks.empty());
+            REQUIRE(batched == expected.tracks);
+            REQUIRE(checkpoints.size() > 20);
+            REQUIRE(checkpoints.back().byte_offset == csv.size());
+            REQUIRE(std::string(stats.stages[0].name) == "decompress");
+            REQUIRE(stats.stages[1].batches == checkpoints.size());
+            
+            // Resuming decompresses up to the checkpoint and parses on
+            const auto& checkpoint = checkpoints[checkpoints.size() / 2];
+            FileIO::ImportOptions resume;
+            resume.resume_from = checkpoint;
+            const Import resumed = run_import(FileIO::import_csv, file->path(), resume);
+            REQUIRE(resumed.tracks == std::vector<std::string>(
+                expected.tracks.begin() + static_cast<std::ptrdiff_t>(checkpoint.tracks_imported),
+                expected.tracks.end()));
+        }
+        
+        SECTION(name + " CSV with an unterminated quote") {
+            const auto compress = [compression](const std::string& text) {
+                return compression == Compression::kGzip ? stored_gzip(text) : raw_zstd(text);
+            };
+            
+            // The quoted field runs on to the end, as in the plain file
+            std::string broken = csv;
+            broken.insert(broken.find('\n', 1000) + 1, "\"Unterminated,Artist,100\n");
+            TempFile plain_broken("test_broken.csv");
+            plain_broken.write(broken);
+            TempFile compressed_broken("test_broken.csv" + file->path().extension().string());
+            compressed_broken.write(compress(broken));
+            const Import imported = run_import(FileIO::import_csv, compressed_broken.path());
+            const Import reference = run_import(FileIO::import_csv, plain_broken.path());
+            REQUIRE(imported.tracks == reference.tracks);
+            REQUIRE(imported.errors == reference.errors);
+            
+            // Past kMaxRecordBytes the record's first line is given up on
+            std::string huge = "Title,Artist,Duration\n\"Unterminated,Artist,100\n";
+            size_t rows = 0;
+            while (huge.size() <= FileIO::kMaxRecordBytes + 4 * FileIO::kPipelineBatchBytes) {
+                huge += "Song,Artist," + std::to_string(100 + rows++ % 500) + "\n";
+            }
+            TempFile compressed_huge("test_huge.csv" + file->path().extension().string());
+            compressed_huge.write(compress(huge));
+            const Import recovered = run_import(FileIO::import_csv, compressed_huge.path());
+            REQUIRE(recovered.tracks.size() == rows);
+            REQUIRE(recovered.errors.size() == 1);
+            REQUIRE(recovered.errors[0] == "Failed to parse line 2: \"Unterminated,Artist,100");
+        }
+        
+        SECTION(name + " CSV import passes on a throwing callback") {
+            FileIO::ImportOptions options;
+            options.checkpoint_interval = 16384;
+            size_t batches = 0;
+            options.batch_callback = [&batches](std::vector<Track>&&) {
+                if (++batches == 2) throw std::runtime_error("batch rejected");
+            };
+            REQUIRE_THROWS_AS(FileIO::import_csv(file->path(), options), std::runtime_error);
+            REQUIRE(batches == 2);
+        }
+        
+        SECTION(name + " cut short keeps the tracks before the fault") {
+            const std::string compressed = compression == Compression::kGzip ? stored_gzip(csv) : raw_zstd(csv);
+            TempFile cut("test_cut.csv" + file->path().extension().string());
+            cut.write(compressed.substr(0, compressed.size() / 2));
+            const Import imported = run_import(FileIO::import_csv, cut.path());
+            REQUIRE(!imported.tracks.empty());
+            REQUIRE(imported.tracks.size() < expected.tracks.size());
+            REQUIRE(std::equal(imported.tracks.begin(), imported.tracks.end(), expected.tracks.begin()));
+            REQUIRE(imported.errors.back().find("Truncated") != std::string::npos);
+        }
+    }
+    
+    if (can_decompress(Compression::kGzip)) {
+        SECTION("gzip TSV and JSON") {
+            TempFile tsv("test_catalogue.tsv");
+            std::string tsv_text;
+            for (size_t i = 0; i < 30000; ++i) {
+                tsv_text += "Song " + std::to_string(i) + "\tArtist\t" + std::to_string(100 + i % 300) + "\n";
+            }
+            tsv.write(tsv_text);
+            TempFile tsv_gz("test_catalogue.tsv.gz");
+            tsv_gz.write(stored_gzip(tsv_text));
+            REQUIRE(FileIO::detect_file_format(tsv_gz.path()) == "tsv");
+            REQUIRE(run_import(FileIO::import_tsv, tsv_gz.path()).tracks ==
+                    run_import(FileIO::import_tsv, tsv.path()).tracks);
+            
+            TempFile json("test_catalogue.json");
+            REQUIRE(FileIO::export_json(json.path(), FileIO::import_csv(plain.path())));
+            std::ifstream file(json.path(), std::ios::binary);
+            const std::string json_text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            REQUIRE(json_text.size() > 3 * Decompressor::kBlockSize);
+            TempFile json_gz("test_catalogue.json.gz");
+            json_gz.write(stored_gzip(json_text));
+            REQUIRE(FileIO::detect_file_format(json_gz.path()) == "json");
+            
+            const Import from_json = run_import(FileIO::import_json, json.path());
+            REQUIRE(from_json.tracks.size() == expected.tracks.size());
+            const Import from_gzip = run_import(FileIO::import_json, json_gz.path());
+            REQUIRE(from_gzip.tracks == from_json.tracks);
+            REQUIRE(from_gzip.errors.empty());
+            
+            TempFile cut("test_cut.json.gz");
+            const std::string compressed = stored_gzip(json_text);
+            cut.write(compressed.substr(0, compressed.size() / 2));
+            const Import imported = run_import(FileIO::import_json, cut.path());
+            REQUIRE(!imported.tracks.empty());
+            REQUIRE(std::equal(imported.tracks.begin(), imported.tracks.end(), from_json.tracks.begin()));
+            REQUIRE(imported.errors.back().find("Truncated") != std::string::npos);
+        }
+    }
+}
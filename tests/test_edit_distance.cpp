@@ -0,0 +1,97 @@
+#include "../include/catch.hpp"
+#include "audio_library/edit_distance.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace audio_library;
+
+namespace {
+
+// Reference full-table implementation to check the bit-parallel kernel against
+size_t reference_distance(const std::string& s1, const std::string& s2) {
+    std::vector<std::vector<size_t>> dp(s1.size() + 1, std::vector<size_t>(s2.size() + 1));
+    for (size_t i = 0; i <= s1.size(); ++i) dp[i][0] = i;
+    for (size_t j = 0; j <= s2.size(); ++j) dp[0][j] = j;
+
+    for (size_t i = 1; i <= s1.size(); ++i) {
+        for (size_t j = 1; j <= s2.size(); ++j) {
+            size_t cost = (s1[i-1] == s2[j-1]) ? 0 : 1;
+            dp[i][j] = std::min({dp[i-1][j] + 1, dp[i][j-1] + 1, dp[i-1][j-1] + cost});
+        }
+    }
+    return dp[s1.size()][s2.size()];
+}
+
+std::string random_string(std::mt19937& rng, size_t length) {
+    std::uniform_int_distribution<int> letter('a', 'e');
+    std::string s;
+    for (size_t i = 0; i < length; ++i) {
+        s += static_cast<char>(letter(rng));
+    }
+    return s;
+}
+
+} // namespace
+
+TEST_CASE("Edit distance known values", "[edit_distance]") {
+    REQUIRE(edit_distance("", "") == 0);
+    REQUIRE(edit_distance("", "abc") == 3);
+    REQUIRE(edit_distance("abc", "") == 3);
+    REQUIRE(edit_distance("kitten", "sitting") == 3);
+    REQUIRE(edit_distance("flaw", "lawn") == 2);
+    REQUIRE(edit_distance("bohemian", "bohemain") == 2);
+    REQUIRE(edit_distance("queen", "queen") == 0);
+    REQUIRE(edit_distance("Sigur Rós", "Sigur Ros") == 2); // Two UTF-8 bytes vs one
+}
+
+TEST_CASE("Edit distance early cutoff", "[edit_distance]") {
+    SECTION("Within limit returns the exact distance") {
+        REQUIRE(edit_distance("kitten", "sitting", 3) == 3);
+        REQUIRE(edit_distance("kitten", "sitting", 10) == 3);
+    }
+
+    SECTION("Beyond limit returns max_distance + 1") {
+        REQUIRE(edit_distance("kitten", "sitting", 2) == 3);
+        REQUIRE(edit_distance("kitten", "sitting", 0) == 1);
+        REQUIRE(edit_distance("a", "abcdefgh", 2) == 3);
+        REQUIRE(edit_distance("abcdefgh", "hgfedcba", 1) == 2);
+    }
+}
+
+TEST_CASE("Edit distance matches reference implementation", "[edit_distance]") {
+    std::mt19937 rng(42);
+
+    SECTION("Single word patterns") {
+        for (int i = 0; i < 200; ++i) {
+            auto a = random_string(rng, rng() % 64);
+            auto b = random_string(rng, rng() % 80);
+            REQUIRE(edit_distance(a, b) == reference_distance(a, b));
+        }
+    }
+
+    SECTION("Multi word patterns") {
+        for (int i = 0; i < 50; ++i) {
+            auto a = random_string(rng, 65 + rng() % 300);
+            auto b = random_string(rng, 65 + rng() % 300);
+            REQUIRE(edit_distance(a, b) == reference_distance(a, b));
+        }
+    }
+
+    SECTION("Longer than the bit-parallel limit") {
+        auto a = random_string(rng, kBitParallelMaxLength + 40);
+        auto b = random_string(rng, kBitParallelMaxLength + 10);
+        REQUIRE(edit_distance(a, b) == reference_distance(a, b));
+    }
+
+    SECTION("Cutoff agrees with reference") {
+        for (int i = 0; i < 200; ++i) {
+            auto a = random_string(rng, rng() % 150);
+            auto b = random_string(rng, rng() % 150);
+            size_t limit = rng() % 20;
+            size_t expected = std::min(reference_distance(a, b), limit + 1);
+            REQUIRE(edit_distance(a, b, limit) == expected);
+        }
+    }
+}
@@ -2,6 +2,8 @@
 #include "audio_library/file_io.h"
 #include <fstream>
 #include <filesystem>
+#include <random>
+#include <stdexcept>
 
 namespace fs = std::filesystem;
 using namespace audio_library;
@@ -72,6 +74,19 @@ TEST_CASE("FileIO CSV operations", "[file_io]") {
         REQUIRE(imported.size() == 2);
         REQUIRE(imported[0].title() == "Title, with comma");
         REQUIRE(imported[0].artist() == "Artist \"quoted\"");
+        REQUIRE(imported[1].title() == "Title\nwith\nnewline");
+        REQUIRE(imported[1].artist() == "Artist\twith\ttab");
+    }
+    
+    SECTION("Import CSV with Windows line endings") {
+        TempFile temp_file("test_crlf.csv");
+        temp_file.write("Title,Artist,Duration,Album\r\nSong,Artist,180,Album\r\n\r\nOther,Artist,90\r\n");
+        
+        auto imported = FileIO::import_csv(temp_file.path());
+        
+        REQUIRE(imported.size() == 2);
+        REQUIRE(imported[0].album() == "Album");
+        REQUIRE(imported[1].duration_seconds() == 90);
     }
     
     SECTION("Import invalid CSV") {
@@ -85,6 +100,313 @@ TEST_CASE("FileIO CSV operations", "[file_io]") {
         
         REQUIRE(imported.empty()); // All lines were invalid
     }
+    
+    SECTION("Stop at the first invalid line") {
+        TempFile temp_file("test_stop.csv");
+        temp_file.write("Song,Artist,100\n\"Quoted\nsong\",Artist,not_a_number\nLater,Artist,200\n");
+        
+        std::vector<size_t> error_lines;
+        FileIO::ImportOptions options;
+        options.skip_invalid_lines = false;
+        options.error_callback = [&error_lines](const std::string&, size_t line_number) {
+            error_lines.push_back(line_number);
+        };
+        
+        auto imported = FileIO::import_csv(temp_file.path(), options);
+        
+        REQUIRE(imported.size() == 1);
+        REQUIRE(error_lines == std::vector<size_t>{2});
+    }
+}
+
+TEST_CASE("FileIO imports large CSV files in parallel", "[file_io]") {
+    // Long quoted fields spanning many lines, some with quotes inside that
+    // look like they close the field, so that chunks often start mid-record
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> kind(0, 15);
+    std::uniform_int_distribution<int> lines(1, 40);
+    std::string csv = "Title,Artist,Duration,Album\r\n";
+    for (size_t i = 0; csv.size() < 3 * FileIO::kMinBytesPerImportThread; ++i) {
+        const std::string n = std::to_string(i);
+        switch (kind(rng)) {
+        case 0:
+        case 1: {
+            csv += "\"Notes " + n;
+            for (int l = lines(rng); l > 0; --l) csv += "\nsaid \"\"stop\"\",\nthen \"\"go\"\"";
+            csv += "\",Artist " + n + ",180,Album\n";
+            break;
+        }
+        case 2:
+            csv += "Broken " + n + ",Artist,not_a_number\n";
+            break;
+        case 3:
+            csv += "Invalid " + n + ",Artist,0\n\n\r\n";
+            break;
+        default:
+            csv += "Song " + n + ",\"Artist, " + n + "\"," + std::to_string(100 + i % 500) + ",Album " + n + "\r\n";
+        }
+    }
+    TempFile temp_file("test_parallel.csv");
+    temp_file.write(csv);
+    
+    auto import = [&](size_t thread_count, size_t max_errors, bool skip_invalid_lines) {
+        std::vector<std::string> results;
+        FileIO::ImportOptions options;
+        options.thread_count = thread_count;
+        options.max_errors = max_errors;
+        options.skip_invalid_lines = skip_invalid_lines;
+        options.error_callback = [&results](const std::string& error, size_t line_number) {
+            results.push_back(std::to_string(line_number) + " " + error);
+        };
+        for (const auto& track : FileIO::import_csv(temp_file.path(), options)) {
+            results.push_back(track.to_csv());
+        }
+        return results;
+    };
+    
+    auto sequential = import(1, 1000000, true);
+    REQUIRE(sequential.size() > 10000);
+    REQUIRE(import(4, 1000000, true) == sequential);
+    REQUIRE(import(3, 2000, true) == import(1, 2000, true));
+    REQUIRE(import(4, 1000000, false) == import(1, 1000000, false));
+}
+
+TEST_CASE("FileIO imports in checkpointed runs", "[file_io]") {
+    std::string csv = "Title,Artist,Duration\n";
+    for (size_t i = 0; i < 4000; ++i) {
+        const std::string n = std::to_string(i);
+        if (i % 250 == 7) {
+            csv += "Broken " + n + ",Artist,not_a_number\n";
+        } else if (i % 9 == 0) {
+            csv += "\"Notes " + n + "\nover two lines\",Artist " + n + ",180\n\n";
+        } else {
+            csv += "Song " + n + ",Artist " + n + "," + std::to_string(100 + i % 500) + "\n";
+        }
+    }
+    TempFile temp_file("test_checkpoints.csv");
+    temp_file.write(csv);
+    
+    struct Run {
+        std::vector<std::string> tracks;
+        std::vector<size_t> error_lines;
+        std::vector<FileIO::ImportCheckpoint> checkpoints;
+    };
+    auto import = [&](size_t interval, size_t max_errors, FileIO::ImportCheckpoint resume_from,
+                      bool pipelined = false) {
+        Run run;
+        FileIO::ImportOptions options;
+        options.pipelined = pipelined;
+        options.checkpoint_interval = interval;
+        options.max_errors = max_errors;
+        options.resume_from = resume_from;
+        options.error_callback = [&run](const std::string& error, size_t line_number) {
+            if (error.rfind("Failed", 0) == 0) run.error_lines.push_back(line_number);
+        };
+        options.batch_callback = [&run](std::vector<Track>&& tracks) {
+            for (const auto& track : tracks) run.tracks.push_back(track.to_csv());
+        };
+        options.checkpoint_callback = [&run, &csv](const FileIO::ImportProgress& progress) {
+            REQUIRE(progress.total_bytes == csv.size());
+            REQUIRE(progress.checkpoint.tracks_imported >= run.tracks.size());
+            run.checkpoints.push_back(progress.checkpoint);
+        };
+        REQUIRE(FileIO::import_csv(temp_file.path(), options).empty());
+        return run;
+    };
+    
+    const Run whole = import(0, 1000, {});
+    REQUIRE(whole.tracks.size() == 3984);
+    REQUIRE(whole.error_lines.size() == 16);
+    REQUIRE(whole.checkpoints.size() == 1);
+    REQUIRE(whole.checkpoints[0].byte_offset == csv.size());
+    
+    SECTION("Runs give the same result as one pass") {
+        const Run windowed = import(4096, 1000, {});
+        REQUIRE(windowed.tracks == whole.tracks);
+        REQUIRE(windowed.error_lines == whole.error_lines);
+        REQUIRE(windowed.checkpoints.size() > 20);
+        REQUIRE(windowed.checkpoints.back().byte_offset == csv.size());
+        REQUIRE(windowed.checkpoints.back().tracks_imported == whole.tracks.size());
+        
+        // Resuming from any checkpoint imports the rest
+        const auto& checkpoint = windowed.checkpoints[windowed.checkpoints.size() / 2];
+        const Run resumed = import(4096, 1000, checkpoint);
+        REQUIRE(resumed.tracks == std::vector<std::string>(
+            whole.tracks.begin() + static_cast<std::ptrdiff_t>(checkpoint.tracks_imported), whole.tracks.end()));
+        REQUIRE(resumed.error_lines.front() > checkpoint.lines_read);
+        REQUIRE(resumed.error_lines.back() == whole.error_lines.back());
+    }
+    
+    SECTION("Stopping at max_errors leaves a checkpoint at the failing record") {
+        const Run stopped = import(4096, 3, {});
+        REQUIRE(stopped.error_lines.size() == 3);
+        const auto& checkpoint = stopped.checkpoints.back();
+        REQUIRE(checkpoint.tracks_imported == stopped.tracks.size());
+        REQUIRE(checkpoint.lines_read + 1 == stopped.error_lines.back());
+        REQUIRE(csv.compare(checkpoint.byte_offset, 6, "Broken") == 0);
+        
+        Run resumed = import(0, 1000, checkpoint);
+        REQUIRE(resumed.error_lines.front() == stopped.error_lines.back());
+        auto tracks = stopped.tracks;
+        tracks.insert(tracks.end(), resumed.tracks.begin(), resumed.tracks.end());
+        REQUIRE(tracks == whole.tracks);
+    }
+    
+    SECTION("Pipelined runs give the same result") {
+        const Run pipelined = import(4096, 1000, {}, true);
+        REQUIRE(pipelined.tracks == whole.tracks);
+        REQUIRE(pipelined.error_lines == whole.error_lines);
+        REQUIRE(pipelined.checkpoints.size() > 20);
+        REQUIRE(pipelined.checkpoints.back().byte_offset == csv.size());
+        REQUIRE(pipelined.checkpoints.back().tracks_imported == whole.tracks.size());
+        
+        const auto& checkpoint = pipelined.checkpoints[pipelined.checkpoints.size() / 3];
+        const Run resumed = import(4096, 1000, checkpoint, true);
+        REQUIRE(resumed.tracks == std::vector<std::string>(
+            whole.tracks.begin() + static_cast<std::ptrdiff_t>(checkpoint.tracks_imported), whole.tracks.end()));
+        
+        const Run stopped = import(4096, 3, {}, true);
+        const Run stopped_in_windows = import(4096, 3, {});
+        REQUIRE(stopped.tracks == stopped_in_windows.tracks);
+        REQUIRE(stopped.error_lines == stopped_in_windows.error_lines);
+        REQUIRE(stopped.checkpoints.back().byte_offset == stopped_in_windows.checkpoints.back().byte_offset);
+        REQUIRE(stopped.checkpoints.back().lines_read == stopped_in_windows.checkpoints.back().lines_read);
+    }
+    
+    SECTION("Pipeline stage timings") {
+        FileIO::PipelineStats stats;
+        FileIO::ImportOptions options;
+        options.pipelined = true;
+        options.checkpoint_interval = 8192;
+        options.pipeline_stats = &stats;
+        REQUIRE(FileIO::import_csv(temp_file.path(), options).size() == whole.tracks.size());
+        REQUIRE(std::string(stats.stages[0].name) == "read");
+        REQUIRE(std::string(stats.stages[3].name) == "deliver");
+        for (const auto& stage : stats.stages) {
+            REQUIRE(stage.batches >= csv.size() / 8192);
+            REQUIRE(stage.busy_seconds >= 0.0);
+            REQUIRE(stage.busy_seconds <= stats.elapsed_seconds);
+        }
+        REQUIRE(stats.stages[3].batches == stats.stages[1].batches);
+    }
+    
+    SECTION("Pipelined callbacks that throw reach the caller") {
+        FileIO::ImportOptions options;
+        options.pipelined = true;
+        options.checkpoint_interval = 4096;
+        size_t batches = 0;
+        options.batch_callback = [&batches](std::vector<Track>&&) {
+            if (++batches == 3) throw std::runtime_error("batch rejected");
+        };
+        REQUIRE_THROWS_AS(FileIO::import_csv(temp_file.path(), options), std::runtime_error);
+        REQUIRE(batches == 3);
+        
+        options.batch_callback = nullptr;
+        options.checkpoint_callback = [](const FileIO::ImportProgress&) { throw std::runtime_error("full"); };
+        REQUIRE_THROWS_AS(FileIO::import_csv(temp_file.path(), options), std::runtime_error);
+        
+        options.checkpoint_callback = nullptr;
+        options.error_callback = [](const std::string&, size_t) { throw std::logic_error("bad line"); };
+        REQUIRE_THROWS_AS(FileIO::import_csv(temp_file.path(), options), std::logic_error);
+    }
+    
+    SECTION("Progress against the file size") {
+        std::vector<std::pair<size_t, size_t>> reports;
+        FileIO::ImportOptions options;
+        options.checkpoint_interval = 16384;
+        options.progress_callback = [&reports](size_t current, size_t total) {
+            reports.emplace_back(current, total);
+        };
+        REQUIRE(FileIO::import_csv(temp_file.path(), options).size() == whole.tracks.size());
+        REQUIRE(reports.size() > 5);
+        for (size_t i = 0; i < reports.size(); ++i) {
+            REQUIRE(reports[i].second == csv.size());
+            REQUIRE(reports[i].first <= csv.size());
+            if (i > 0) REQUIRE(reports[i].first >= reports[i - 1].first);
+        }
+        REQUIRE(reports.back().first == csv.size());
+    }
+}
+
+TEST_CASE("FileIO TSV operations", "[file_io]") {
+    SECTION("Import a tracks.txt dump") {
+        TempFile temp_file("test_tracks.txt");
+        temp_file.write("Decades (2007 Remaster)\tJoy Division\t374\n"
+                        "Hello, Goodbye, Again\tThe \"Band\"\t199\r\n"
+                        "\n"
+                        "Broken\tArtist\tlong\n"
+                        "Jump For Joy\tNew York Trio\t286");
+        
+        std::vector<size_t> error_lines;
+        FileIO::ImportOptions options;
+        options.error_callback = [&error_lines](const std::string&, size_t line_number) {
+            error_lines.push_back(line_number);
+        };
+        auto tracks = FileIO::import_tsv(temp_file.path(), options);
+        
+        REQUIRE(tracks.size() == 3);
+        REQUIRE(tracks[0].title() == "Decades (2007 Remaster)");
+        REQUIRE(tracks[1].title() == "Hello, Goodbye, Again");
+        REQUIRE(tracks[1].artist() == "The \"Band\"");
+        REQUIRE(tracks[1].duration_seconds() == 199);
+        REQUIRE(tracks[2].artist() == "New York Trio");
+        REQUIRE(error_lines == std::vector<size_t>{4});
+    }
+    
+    SECTION("Export and import TSV") {
+        TempFile temp_file("test_tracks.tsv");
+        std::vector<Track> tracks;
+        tracks.emplace_back("Tab\tin title", "Line\nbreak", 180);
+        tracks[0].set_album("Album");
+        tracks[0].set_year(2001);
+        tracks[0].set_rating(4.5);
+        tracks.emplace_back("Plain", "Artist", 200);
+        
+        REQUIRE(FileIO::export_tsv(temp_file.path(), tracks));
+        auto imported = FileIO::import_tsv(temp_file.path());
+        
+        REQUIRE(imported.size() == 2);
+        REQUIRE(imported[0].title() == "Tab in title");
+        REQUIRE(imported[0].artist() == "Line break");
+        REQUIRE(imported[0].album() == "Album");
+        REQUIRE(imported[0].year() == 2001);
+        REQUIRE(imported[0].rating() == Approx(4.5));
+        REQUIRE(imported[1].title() == "Plain");
+    }
+    
+    SECTION("Large files in parallel") {
+        std::string tsv = "Title\tArtist\tDuration\n";
+        for (size_t i = 0; tsv.size() < 3 * FileIO::kMinBytesPerImportThread; ++i) {
+            const std::string n = std::to_string(i);
+            if (i % 17 == 0) {
+                tsv += "Broken " + n + "\tArtist\tnot_a_number\n";
+            } else if (i % 13 == 0) {
+                tsv += "\r\n";
+            } else {
+                tsv += "Song, " + n + "\t\"Artist " + n + "\t" + std::to_string(100 + i % 500) + "\r\n";
+            }
+        }
+        TempFile temp_file("test_parallel.tsv");
+        temp_file.write(tsv);
+        
+        auto import = [&](size_t thread_count) {
+            std::vector<std::string> results;
+            FileIO::ImportOptions options;
+            options.thread_count = thread_count;
+            options.max_errors = 1000000;
+            options.error_callback = [&results](const std::string& error, size_t line_number) {
+                results.push_back(std::to_string(line_number) + " " + error);
+            };
+            for (const auto& track : FileIO::import_tsv(temp_file.path(), options)) {
+                results.push_back(track.to_csv());
+            }
+            return results;
+        };
+        
+        auto sequential = import(1);
+        REQUIRE(sequential.size() > 10000);
+        REQUIRE(import(4) == sequential);
+    }
 }
 
 TEST_CASE("FileIO JSON operations", "[file_io]") {
@@ -138,6 +460,36 @@ TEST_CASE("FileIO JSON operations", "[file_io]") {
             REQUIRE(imported[i].duration_seconds() == 100 + i * 10);
         }
     }
+    
+    SECTION("Braces inside strings and errors by line") {
+        TempFile temp_file("test_errors.json");
+        temp_file.write("[\n"
+                        "  {\"title\": \"{Live}\", \"artist\": \"A } B\", \"duration\": 200},\n"
+                        "  {\"title\": \"No duration\", \"artist\": \"Artist\"},\n"
+                        "  42,\n"
+                        "  {\"title\": \"Too long\", \"artist\": \"Artist\", \"duration\": 99999},\n"
+                        "  {\"title\": \"Last\", \"artist\": \"Artist\", \"duration\": 100}\n"
+                        "]\n");
+        
+        std::vector<size_t> error_lines;
+        FileIO::ImportOptions options;
+        options.error_callback = [&error_lines](const std::string&, size_t line_number) {
+            error_lines.push_back(line_number);
+        };
+        
+        auto imported = FileIO::import_json(temp_file.path(), options);
+        REQUIRE(imported.size() == 2);
+        REQUIRE(imported[0].title() == "{Live}");
+        REQUIRE(imported[0].artist() == "A } B");
+        REQUIRE(imported[1].title() == "Last");
+        REQUIRE(error_lines == std::vector<size_t>{3, 4, 5});
+        
+        temp_file.write("[{\"title\": \"Song\", \"artist\": \"Artist\", \"duration\": 100},\n\n{\"title\": ]");
+        error_lines.clear();
+        imported = FileIO::import_json(temp_file.path(), options);
+        REQUIRE(imported.size() == 1);
+        REQUIRE(error_lines == std::vector<size_t>{3});
+    }
 }
 
 TEST_CASE("FileIO format detection", "[file_io]") {
@@ -167,6 +519,20 @@ TEST_CASE("FileIO format detection", "[file_io]") {
         REQUIRE(format.has_value());
         REQUIRE(*format == "json");
     }
+    
+    SECTION("Detect TSV dumps") {
+        TempFile txt_file("test.txt");
+        txt_file.write("Hello, Goodbye, Again\tArtist\t180\nSong\tArtist\t200\n");
+        REQUIRE(FileIO::detect_file_format(txt_file.path()) == "tsv");
+        
+        TempFile tsv_file("test.tsv");
+        tsv_file.write("Title\tArtist\tDuration\nSong\tArtist\t200\n");
+        REQUIRE(FileIO::detect_file_format(tsv_file.path()) == "tsv");
+        
+        TempFile csv_file("test_content.txt");
+        csv_file.write("Song,Artist,180\n");
+        REQUIRE(FileIO::detect_file_format(csv_file.path()) == "csv");
+    }
 }
 
 TEST_CASE("FileIO validation", "[file_io]") {
@@ -195,6 +561,103 @@ TEST_CASE("FileIO validation", "[file_io]") {
     }
 }
 
+TEST_CASE("FileIO validates whole files", "[file_io]") {
+    using Problem = FileIO::ValidationReport::Problem;
+    auto count = [](const FileIO::ValidationReport& report, Problem problem) {
+        return report.problem_counts[static_cast<size_t>(problem)];
+    };
+    auto samples = [](const FileIO::ValidationReport& report, Problem problem) {
+        return report.sample_lines[static_cast<size_t>(problem)];
+    };
+    
+    SECTION("Each rule of an import") {
+        TempFile temp_file("test_validate.csv");
+        temp_file.write("Title,Artist,Duration,Album,Genre,Year,Plays,Rating\n"
+                        "Good,Artist,180\n"
+                        ",Artist,180\n"
+                        "Song,,180\n"
+                        "Song,Artist,0\n"
+                        "Song,Artist,40000\n"
+                        "Song,Artist,180,,,1850\n"
+                        "Song,Artist,180,,,2001,7,9.5\n"
+                        "Song,Artist,long\n"
+                        "Song,Artist,180,,,year\n"
+                        "\"Two\nlines\",Artist,200\n"
+                        "Song,Artist\n");
+        const auto report = FileIO::validate_csv_file(temp_file.path());
+        
+        REQUIRE(report.error.empty());
+        REQUIRE(report.records == 11);
+        REQUIRE(report.valid_records == 3); // A rating over 5 is clamped
+        REQUIRE(report.error_count() == 8);
+        REQUIRE_FALSE(report.ok());
+        REQUIRE(count(report, Problem::kMissingTitle) == 1);
+        REQUIRE(count(report, Problem::kMissingArtist) == 1);
+        REQUIRE(count(report, Problem::kBadDuration) == 2);
+        REQUIRE(count(report, Problem::kBadYear) == 1);
+        REQUIRE(count(report, Problem::kUnparsable) == 3);
+        REQUIRE(samples(report, Problem::kMissingTitle) == std::vector<size_t>{3});
+        REQUIRE(samples(report, Problem::kBadDuration) == std::vector<size_t>{5, 6});
+        REQUIRE(samples(report, Problem::kUnparsable) == std::vector<size_t>{9, 10, 13});
+        REQUIRE(std::string(FileIO::ValidationReport::problem_name(Problem::kBadYear)) == "bad year");
+    }
+    
+    SECTION("Parallel chunks agree with an import") {
+        std::string csv = "Title,Artist,Duration\n";
+        for (size_t i = 0; i < 150000; ++i) {
+            const std::string n = std::to_string(i);
+            if (i % 1000 == 3) {
+                csv += "Broken " + n + ",Artist,not_a_number\n";
+            } else if (i % 700 == 5) {
+                csv += "Long " + n + ",Artist,99999\n";
+            } else if (i % 11 == 0) {
+                csv += "\"Notes " + n + "\nover, two lines\",Artist " + n + ",180\n\n";
+            } else {
+                csv += "Song " + n + ",Artist " + n + "," + std::to_string(100 + i % 500) + "\n";
+            }
+        }
+        TempFile temp_file("test_validate_large.csv");
+        temp_file.write(csv);
+        REQUIRE(csv.size() > 4 * FileIO::kMinBytesPerImportThread);
+        
+        std::vector<size_t> parse_failures;
+        std::vector<size_t> invalid;
+        FileIO::ImportOptions options;
+        options.max_errors = SIZE_MAX;
+        options.error_callback = [&](const std::string& error, size_t line_number) {
+            (error.rfind("Failed", 0) == 0 ? parse_failures : invalid).push_back(line_number);
+        };
+        const auto tracks = FileIO::import_csv(temp_file.path(), options);
+        
+        for (size_t threads : {1, 4}) {
+            const auto report = FileIO::validate_csv_file(temp_file.path(), threads);
+            REQUIRE(report.bytes == csv.size());
+            REQUIRE(report.valid_records == tracks.size());
+            REQUIRE(count(report, Problem::kUnparsable) == parse_failures.size());
+            REQUIRE(count(report, Problem::kBadDuration) == invalid.size());
+            REQUIRE(report.records == tracks.size() + parse_failures.size() + invalid.size());
+            REQUIRE(samples(report, Problem::kUnparsable) ==
+                    std::vector<size_t>(parse_failures.begin(), parse_failures.begin() + 10));
+            REQUIRE(samples(report, Problem::kBadDuration) ==
+                    std::vector<size_t>(invalid.begin(), invalid.begin() + 10));
+        }
+    }
+    
+    SECTION("TSV, and files that cannot be read") {
+        TempFile temp_file("test_validate.tsv");
+        temp_file.write("Song\tArtist\t180\nSong\t\t180\nSong\tArtist\n");
+        const auto report = FileIO::validate_tsv_file(temp_file.path());
+        REQUIRE(report.records == 3);
+        REQUIRE(report.valid_records == 1);
+        REQUIRE(samples(report, Problem::kMissingArtist) == std::vector<size_t>{2});
+        REQUIRE(samples(report, Problem::kUnparsable) == std::vector<size_t>{3});
+        
+        const auto missing = FileIO::validate_csv_file(fs::temp_directory_path() / "does_not_exist.csv");
+        REQUIRE_FALSE(missing.error.empty());
+        REQUIRE_FALSE(missing.ok());
+    }
+}
+
 TEST_CASE("FileIO error handling", "[file_io]") {
     SECTION("Import from non-existent file") {
         fs::path non_existent = fs::temp_directory_path() / "does_not_exist.csv";
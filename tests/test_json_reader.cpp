@@ -0,0 +1,140 @@
+#include "../include/catch.hpp"
+#include "audio_library/json_reader.h"
+#include "audio_library/track.h"
+#include <string>
+#include <vector>
+
+using namespace audio_library;
+
+namespace {
+
+// The strings of a JSON array of strings
+std::vector<std::string> read_strings(std::string_view json) {
+    std::vector<std::string> strings;
+    JsonReader reader(json);
+    REQUIRE(reader.begin_array());
+    std::string_view value;
+    while (reader.next_element()) {
+        REQUIRE(reader.read_string(value));
+        strings.emplace_back(value);
+    }
+    REQUIRE_FALSE(reader.failed());
+    return strings;
+}
+
+// Whether skipping the one value in json succeeds and reaches the end
+bool skips(std::string_view json) {
+    JsonReader reader(json);
+    return reader.skip_value() && reader.peek() == JsonReader::Type::kEnd;
+}
+
+} // namespace
+
+TEST_CASE("JsonReader reads values in order", "[json_reader]") {
+    JsonReader reader(R"( {"name": "x", "list": [1, -2.5e3, true, null], "empty": {}} )");
+    std::string_view key;
+    std::string_view value;
+
+    REQUIRE(reader.begin_object());
+    REQUIRE(reader.next_member(key));
+    REQUIRE(key == "name");
+    REQUIRE(reader.read_string(value));
+    REQUIRE(value == "x");
+
+    REQUIRE(reader.next_member(key));
+    REQUIRE(key == "list");
+    REQUIRE(reader.begin_array());
+    REQUIRE(reader.next_element());
+    REQUIRE(reader.read_number(value));
+    REQUIRE(value == "1");
+    REQUIRE(reader.next_element());
+    REQUIRE(reader.read_number(value));
+    REQUIRE(value == "-2.5e3");
+    REQUIRE(reader.next_element());
+    REQUIRE(reader.peek() == JsonReader::Type::kTrue);
+    REQUIRE(reader.skip_value());
+    REQUIRE(reader.next_element());
+    REQUIRE(reader.peek() == JsonReader::Type::kNull);
+    REQUIRE(reader.skip_value());
+    REQUIRE_FALSE(reader.next_element());
+
+    REQUIRE(reader.next_member(key));
+    REQUIRE(key == "empty");
+    REQUIRE(reader.skip_value());
+    REQUIRE_FALSE(reader.next_member(key));
+    REQUIRE_FALSE(reader.failed());
+    REQUIRE(reader.peek() == JsonReader::Type::kEnd);
+}
+
+TEST_CASE("JsonReader unescapes strings", "[json_reader]") {
+    SECTION("Simple escapes") {
+        REQUIRE(read_strings(R"(["plain", "a\"b\\c\/d", "\b\f\n\r\t", "{not [a brace}"])") ==
+                std::vector<std::string>{"plain", "a\"b\\c/d", "\b\f\n\r\t", "{not [a brace}"});
+    }
+
+    SECTION("Unicode escapes") {
+        REQUIRE(read_strings(R"(["caf\u00e9", "\u00C9t\u00e9", "\u20ac", "\uD83C\uDFB5", "\ud83c!", "\u0041"])") ==
+                std::vector<std::string>{"caf\xC3\xA9", "\xC3\x89t\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x8E\xB5", "\xEF\xBF\xBD!", "A"});
+    }
+
+    SECTION("Raw UTF-8 is kept") {
+        REQUIRE(read_strings("[\"Bj\xC3\xB6rk\", \"\xEF\xBB\xBF\"]") == std::vector<std::string>{"Bj\xC3\xB6rk", "\xEF\xBB\xBF"});
+    }
+
+    SECTION("Bytes escaped one by one by older exports") {
+        REQUIRE(read_strings(R"(["Beyonc\u00c3\u00a9", "\u00c3x"])") == std::vector<std::string>{"Beyonc\xC3\xA9", "\xC3\x83x"});
+    }
+}
+
+TEST_CASE("JsonReader rejects malformed JSON", "[json_reader]") {
+    REQUIRE(skips(R"([{"a": [1, {"b": "}"}]}, "x"])"));
+    REQUIRE(skips("\xEF\xBB\xBF [] "));
+
+    REQUIRE_FALSE(skips(R"([1, 2)"));
+    REQUIRE_FALSE(skips(R"([1, 2,])"));
+    REQUIRE_FALSE(skips(R"({"a" 1})"));
+    REQUIRE_FALSE(skips(R"({"a": 1,})"));
+    REQUIRE_FALSE(skips(R"(["open)"));
+    REQUIRE_FALSE(skips(R"(["bad \q escape"])"));
+    REQUIRE_FALSE(skips(R"(["\u12"])"));
+    REQUIRE_FALSE(skips(R"([01])"));
+    REQUIRE_FALSE(skips(R"([1.])"));
+    REQUIRE_FALSE(skips(R"([tru])"));
+    REQUIRE_FALSE(skips(std::string(1000, '[') + std::string(1000, ']')));
+
+    JsonReader reader("[1 2]");
+    REQUIRE(reader.begin_array());
+    REQUIRE(reader.next_element());
+    REQUIRE(reader.skip_value());
+    REQUIRE_FALSE(reader.next_element());
+    REQUIRE(reader.failed());
+    std::string_view value;
+    REQUIRE_FALSE(reader.read_number(value));
+}
+
+TEST_CASE("Track JSON survives a round trip", "[json_reader]") {
+    Track track("Tab\there \"quoted\" \\ back", "Sigur Rós \xF0\x9F\x8E\xB5", 245);
+    track.set_album("Ágætis byrjun\n");
+    track.set_genre("Post-rock\x01");
+    track.set_year(1999);
+    track.set_rating(4.5);
+
+    auto parsed = Track::from_json(track.to_json());
+    REQUIRE(parsed.has_value());
+    REQUIRE(parsed->to_csv() == track.to_csv());
+
+    SECTION("Unknown keys and nested values are skipped") {
+        auto other = Track::from_json(R"({"extra": {"title": "Nested"}, "title": "Song", "tags": ["a", {}],
+                                          "artist": "Artist", "duration": "180", "year": null})");
+        REQUIRE(other.has_value());
+        REQUIRE(other->title() == "Song");
+        REQUIRE(other->duration_seconds() == 180);
+        REQUIRE(other->year() == 0);
+    }
+
+    SECTION("Missing or malformed fields") {
+        REQUIRE_FALSE(Track::from_json(R"({"title": "Song", "artist": "Artist"})").has_value());
+        REQUIRE_FALSE(Track::from_json(R"({"title": "Song", "artist": "Artist", "duration": "long"})").has_value());
+        REQUIRE_FALSE(Track::from_json(R"({"title": "Song", "artist": "Artist", "duration": 1)").has_value());
+    }
+}
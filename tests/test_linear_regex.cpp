@@ -0,0 +1,136 @@
+#include "../include/catch.hpp"
+#include "audio_library/linear_regex.h"
+#include <regex>
+#include <string>
+#include <vector>
+
+using namespace audio_library;
+
+namespace {
+
+bool matches(const std::string& pattern, const std::string& text, bool icase = false) {
+    auto regex = LinearRegex::compile(pattern, icase);
+    REQUIRE(regex.has_value());
+    LinearRegex::Matcher matcher(*regex);
+    return matcher.search(text);
+}
+
+} // namespace
+
+TEST_CASE("LinearRegex basic matching", "[linear_regex]") {
+    SECTION("Literals and search semantics") {
+        REQUIRE(matches("queen", "queen"));
+        REQUIRE(matches("ee", "queen"));
+        REQUIRE_FALSE(matches("king", "queen"));
+        REQUIRE(matches("", "anything"));
+    }
+
+    SECTION("Anchors") {
+        REQUIRE(matches("^que", "queen"));
+        REQUIRE_FALSE(matches("^een", "queen"));
+        REQUIRE(matches("een$", "queen"));
+        REQUIRE_FALSE(matches("que$", "queen"));
+        REQUIRE(matches("^queen$", "queen"));
+        REQUIRE(matches("^$", ""));
+    }
+
+    SECTION("Classes and escapes") {
+        REQUIRE(matches("[a-c]at", "bat"));
+        REQUIRE_FALSE(matches("[a-c]at", "rat"));
+        REQUIRE(matches("[^a-c]at", "rat"));
+        REQUIRE(matches("\\d+", "track 42"));
+        REQUIRE_FALSE(matches("\\d", "no digits"));
+        REQUIRE(matches("a\\.b", "a.b"));
+        REQUIRE_FALSE(matches("a\\.b", "axb"));
+        REQUIRE(matches("\\x41", "A"));
+    }
+
+    SECTION("Quantifiers and alternation") {
+        REQUIRE(matches("^ab*c$", "ac"));
+        REQUIRE(matches("^ab+c$", "abbbc"));
+        REQUIRE_FALSE(matches("^ab+c$", "ac"));
+        REQUIRE(matches("^a{2,3}$", "aaa"));
+        REQUIRE_FALSE(matches("^a{2,3}$", "aaaa"));
+        REQUIRE(matches("^(rock|pop)$", "pop"));
+        REQUIRE(matches("^(?:ro|po)+$", "roporo"));
+        REQUIRE(matches("^colou?r$", "color"));
+        REQUIRE(matches("^a.*?z$", "abcz"));
+    }
+
+    SECTION("Case insensitivity") {
+        REQUIRE_FALSE(matches("QUEEN", "queen"));
+        REQUIRE(matches("QUEEN", "queen", true));
+        REQUIRE(matches("[A-C]at", "bat", true));
+    }
+}
+
+TEST_CASE("LinearRegex agrees with std::regex", "[linear_regex]") {
+    const std::vector<std::string> patterns = {
+        "a", "ab|cd", "^a", "b$", "a*b", "(ab)+", "[0-9]{2}", "^[a-z]+$",
+        "x?y?z?", "a.c", "(a|b)*c", "\\w+\\s\\w+", "^(a|ab)(c|bcd)$", "[^aeiou]{3}"
+    };
+    const std::vector<std::string> texts = {
+        "", "a", "b", "ab", "abc", "cd", "aab", "ababab", "12", "x1", "hello",
+        "hello world", "abcd", "xyz", "rhythm", "aaaaaaaac", "Abc"
+    };
+
+    for (const auto& pattern : patterns) {
+        std::regex reference(pattern);
+        auto regex = LinearRegex::compile(pattern, false);
+        REQUIRE(regex.has_value());
+        LinearRegex::Matcher matcher(*regex);
+
+        for (const auto& text : texts) {
+            INFO("pattern: " << pattern << ", text: " << text);
+            REQUIRE(matcher.search(text) == std::regex_search(text, reference));
+        }
+    }
+}
+
+TEST_CASE("LinearRegex rejects malformed and unsupported patterns", "[linear_regex]") {
+    REQUIRE_FALSE(LinearRegex::compile("(abc", false).has_value());
+    REQUIRE_FALSE(LinearRegex::compile("abc)", false).has_value());
+    REQUIRE_FALSE(LinearRegex::compile("[abc", false).has_value());
+    REQUIRE_FALSE(LinearRegex::compile("*a", false).has_value());
+    REQUIRE_FALSE(LinearRegex::compile("a{3,1}", false).has_value());
+    REQUIRE_FALSE(LinearRegex::compile("(a)\\1", false).has_value());
+    REQUIRE_FALSE(LinearRegex::compile("a(?=b)", false).has_value());
+    REQUIRE_FALSE(LinearRegex::compile("\\bword", false).has_value());
+    REQUIRE_FALSE(LinearRegex::compile("a{5000}", false).has_value());
+}
+
+TEST_CASE("LinearRegex pathological patterns stay linear", "[linear_regex]") {
+    // Catastrophic for backtracking engines
+    std::string text(5000, 'a');
+    REQUIRE_FALSE(matches("^(a+)+$b", text));
+    REQUIRE_FALSE(matches("(a*)*b", text));
+    REQUIRE_FALSE(matches("(a|aa)+c", text));
+}
+
+TEST_CASE("LinearRegex bounds nesting depth", "[linear_regex]") {
+    std::string shallow = std::string(100, '(') + "a" + std::string(100, ')');
+    REQUIRE(matches(shallow, "xay"));
+
+    // Would overflow the stack if parsed recursively without a limit
+    std::string deep = std::string(100000, '(') + "a" + std::string(100000, ')');
+    REQUIRE_FALSE(LinearRegex::compile(deep, false).has_value());
+
+    std::string stacked = "a" + std::string(100000, '?');
+    REQUIRE_FALSE(LinearRegex::compile(stacked, false).has_value());
+}
+
+TEST_CASE("LinearRegex required literals", "[linear_regex]") {
+    auto literals_of = [](const std::string& pattern, bool icase) {
+        auto regex = LinearRegex::compile(pattern, icase);
+        REQUIRE(regex.has_value());
+        return regex->required_literals();
+    };
+
+    using Literals = std::vector<std::string>;
+    REQUIRE(literals_of("queen", false) == Literals{"queen"});
+    REQUIRE(literals_of("^hotel.*nia$", false) == Literals{"hotel", "nia"});
+    REQUIRE(literals_of("ab+c", false) == Literals{"ab", "bc"});
+    REQUIRE(literals_of("QUEEN", true) == Literals{"queen"});
+    REQUIRE(literals_of("rock|pop", false).empty());
+    REQUIRE(literals_of("x(abc)?y", false) == Literals{"x", "y"});
+}
@@ -1,7 +1,11 @@
 #include "../include/catch.hpp"
 #include "audio_library/music_library.h"
+#include "audio_library/edit_distance.h"
+#include "audio_library/unicode_fold.h"
+#include <filesystem>
 #include <thread>
 #include <atomic>
+#include <random>
 
 using namespace audio_library;
 
@@ -92,6 +96,16 @@ TEST_CASE("MusicLibrary search operations", "[music_library]") {
         results = library.search("california");
         REQUIRE(results.size() >= 1);
     }
+    
+    SECTION("Batch search") {
+        auto results = library.search_batch({"Queen", "heaven", "", "Queen", "nothing"});
+        REQUIRE(results.size() == 5);
+        REQUIRE(results[0] == library.search("Queen"));
+        REQUIRE(results[1] == library.search("heaven"));
+        REQUIRE(results[2].empty());
+        REQUIRE(results[3] == results[0]);
+        REQUIRE(results[4].empty());
+    }
 }
 
 TEST_CASE("MusicLibrary advanced features", "[music_library]") {
@@ -162,6 +176,74 @@ TEST_CASE("MusicLibrary advanced features", "[music_library]") {
     }
 }
 
+TEST_CASE("MusicLibrary duplicate detection", "[music_library]") {
+    MusicLibrary library;
+    
+    library.add_track(Track("Bohemian Rhapsody", "Queen", 354));
+    library.add_track(Track("Bohemian Rhapsodie", "Queen", 354));
+    library.add_track(Track("bohemian rhapsody", "QUEEN", 354));
+    library.add_track(Track("Imagine", "John Lennon", 183));
+    
+    SECTION("Near duplicates within distance") {
+        auto duplicates = library.find_potential_duplicates(2);
+        REQUIRE(duplicates.size() == 3);
+        
+        for (const auto& [first, second] : duplicates) {
+            REQUIRE(first->title() != "Imagine");
+            REQUIRE(second->title() != "Imagine");
+        }
+    }
+    
+    SECTION("Case-only differences at distance zero") {
+        auto duplicates = library.find_potential_duplicates(0);
+        REQUIRE(duplicates.size() == 1);
+        REQUIRE(duplicates[0].first->title() == "Bohemian Rhapsody");
+        REQUIRE(duplicates[0].second->title() == "bohemian rhapsody");
+    }
+    
+    SECTION("Accented and non-ASCII text") {
+        library.add_track(Track("Halo", "Beyoncé", 261));
+        library.add_track(Track("HALO", "BEYONCE", 261));
+        library.add_track(Track("Ёлка", "Кино", 200));
+        library.add_track(Track("ёлка", "кино", 200));
+        auto duplicates = library.find_potential_duplicates(0);
+        REQUIRE(duplicates.size() == 3);
+        REQUIRE(duplicates[1].first->artist() == "Beyoncé");
+        REQUIRE(duplicates[2].first->artist() == "Кино");
+    }
+    
+    SECTION("Same pairs as comparing every track") {
+        std::mt19937 rng(5);
+        std::uniform_int_distribution<int> letter('a', 'e');
+        std::uniform_int_distribution<int> length(1, 9);
+        auto word = [&]() {
+            std::string text(static_cast<size_t>(length(rng)), ' ');
+            for (auto& c : text) c = static_cast<char>(letter(rng));
+            return text;
+        };
+        for (size_t i = 0; i < 400; ++i) {
+            library.add_track(Track(word(), word(), 200));
+        }
+        auto tracks = library.get_all_tracks();
+        
+        for (size_t max_distance : {0, 1, 2, 3, 12}) {
+            std::vector<std::pair<MusicLibrary::TrackPtr, MusicLibrary::TrackPtr>> expected;
+            for (size_t i = 0; i < tracks.size(); ++i) {
+                for (size_t j = i + 1; j < tracks.size(); ++j) {
+                    auto key = [](const MusicLibrary::TrackPtr& track) {
+                        return fold_text(track->artist() + '\x1f' + track->title());
+                    };
+                    if (edit_distance(key(tracks[i]), key(tracks[j]), max_distance) <= max_distance) {
+                        expected.emplace_back(tracks[i], tracks[j]);
+                    }
+                }
+            }
+            INFO(max_distance);
+            REQUIRE(library.find_potential_duplicates(max_distance) == expected);
+        }
+    }
+}
+
 TEST_CASE("MusicLibrary sorting", "[music_library]") {
     MusicLibrary library;
     
@@ -326,4 +408,160 @@ TEST_CASE("MusicLibrary edge cases", "[music_library]") {
         results = library.find_by_title("Same Song");
         REQUIRE(results.empty());
     }
-}
\ No newline at end of file
+}
+TEST_CASE("MusicLibrary rebuilds large indexes after removal", "[music_library]") {
+    MusicLibrary library;
+    const std::vector<std::string> genres = {"Rock", "Jazz", "Pop"};
+    
+    for (size_t i = 0; i < 1200; ++i) {
+        Track track("Song " + std::to_string(i), "Artist " + std::to_string(i % 40), 200);
+        track.set_album("Album " + std::to_string(i % 100));
+        track.set_genre(genres[i % genres.size()]);
+        library.add_track(std::move(track));
+    }
+    
+    REQUIRE(library.remove_track("Song 0", "Artist 0"));
+    REQUIRE(library.size() == 1199);
+    REQUIRE(library.find_by_title("Song 0").empty());
+    REQUIRE(library.find_by_title("Song 1199").size() == 1);
+    REQUIRE(library.find_by_artist("Artist 0").size() == 29);
+    REQUIRE(library.find_by_album("Album 7").size() == 12);
+    REQUIRE(library.find_by_genre("Rock").size() == 399);
+    REQUIRE(library.search("1199").size() == 1);
+}
+
+TEST_CASE("MusicLibrary keeps its indexes through many removals", "[music_library]") {
+    MusicLibrary library;
+    for (size_t i = 0; i < 1000; ++i) {
+        library.add_track(Track("Song " + std::to_string(i), "Artist " + std::to_string(i % 10), 200));
+    }
+    
+    // Enough removals to compact the library on the way
+    for (size_t i = 0; i < 1000; i += 4) {
+        REQUIRE(library.remove_track("Song " + std::to_string(i), "Artist " + std::to_string(i % 10)));
+        REQUIRE(library.size() == 1000 - i / 4 - 1);
+    }
+    REQUIRE(library.remove_tracks_by_artist("Artist 1"));
+    REQUIRE(library.remove_tracks_by_title("Song 3"));
+    REQUIRE_FALSE(library.remove_tracks_by_title("Song 3"));
+    
+    REQUIRE(library.size() == 649);
+    REQUIRE(library.get_all_tracks().size() == 649);
+    REQUIRE(library.get_statistics().total_tracks == 649);
+    REQUIRE(library.find_by_artist("Artist 1").empty());
+    REQUIRE(library.find_by_artist("Artist 2").size() == 50);
+    REQUIRE(library.find_by_title("Song 4").empty());
+    REQUIRE(library.search("999").size() == 1);
+    REQUIRE(library.search("998").size() == 1);
+    REQUIRE(library.search("996").empty());
+    
+    // Removed slots are not matched as duplicates
+    REQUIRE(library.add_track(Track("Song 4", "Artist 4", 100)));
+    REQUIRE(library.find_by_title("Song 4").size() == 1);
+    REQUIRE(library.find_by_artist("Artist 4").size() == 51);
+}
+
+TEST_CASE("MusicLibrary saves and loads its search index", "[music_library]") {
+    auto fill = [](MusicLibrary& library) {
+        for (size_t i = 0; i < 600; ++i) {
+            Track track("Song " + std::to_string(i), "Artist " + std::to_string(i % 30), 200);
+            track.set_genre(i % 2 == 0 ? "Rock" : "Jazz");
+            library.add_track(std::move(track));
+        }
+    };
+    const auto path = std::filesystem::temp_directory_path() / "audio_library_library.index";
+    
+    MusicLibrary original;
+    fill(original);
+    REQUIRE(original.save_search_index(path.string()));
+    
+    MusicLibrary restarted;
+    fill(restarted);
+    REQUIRE(restarted.load_search_index(path.string()));
+    REQUIRE(restarted.search("artist 7").size() == original.search("artist 7").size());
+    REQUIRE(restarted.search("599").size() == 1);
+    
+    restarted.add_track(Track("Song 599", "Someone Else", 100));
+    REQUIRE(restarted.search("599").size() == 2);
+    
+    MusicLibrary other;
+    other.add_track(Track("Different", "Tracks", 100));
+    REQUIRE_FALSE(other.load_search_index(path.string()));
+    REQUIRE(other.search("different").size() == 1);
+    
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("MusicLibrary ingests batches of tracks", "[music_library]") {
+    MusicLibrary library;
+    library.add_track(Track("Song 0", "Artist 0", 200));
+    library.add_track(Track("Shared Title", "Artist 1", 200));
+    
+    std::vector<Track> batch;
+    for (size_t i = 0; i < 1500; ++i) {
+        Track track("Song " + std::to_string(i), "Artist " + std::to_string(i % 50), 200);
+        track.set_genre(i % 2 == 0 ? "Rock" : "Jazz");
+        batch.push_back(std::move(track));
+    }
+    batch.emplace_back("Song 7", "Artist 7", 100);       // Repeated within the batch
+    batch.emplace_back("Shared Title", "Artist 1", 100); // Already in the library
+    batch.emplace_back("Shared Title", "Artist 2", 100); // Same title, other artist
+    
+    REQUIRE(library.ingest(std::move(batch)) == 1500);
+    REQUIRE(library.size() == 1502);
+    REQUIRE(library.find_by_title("Song 7").size() == 1);
+    REQUIRE(library.find_by_title("Shared Title").size() == 2);
+    REQUIRE(library.find_by_artist("Artist 3").size() == 30);
+    REQUIRE(library.find_by_genre("Jazz").size() == 750);
+    REQUIRE(library.search("1499").size() == 1);
+    REQUIRE(library.search("shared").size() == 2);
+    
+    // Later single additions and removals see the ingested tracks
+    REQUIRE_FALSE(library.add_track(Track("Song 1499", "Artist 49", 200)));
+    REQUIRE(library.remove_track("Song 3", "Artist 3"));
+    REQUIRE(library.find_by_artist("Artist 3").size() == 29);
+    REQUIRE(library.find_by_title("Song 3").empty());
+    REQUIRE(library.ingest({}) == 0);
+}
+
+TEST_CASE("MusicLibrary ingests batches alongside searches and other batches", "[music_library]") {
+    MusicLibrary library;
+    auto make_batch = [](size_t from, size_t to) {
+        std::vector<Track> batch;
+        for (size_t i = from; i < to; ++i) {
+            batch.emplace_back("Song " + std::to_string(i), "Artist " + std::to_string(i % 10), 200);
+        }
+        return batch;
+    };
+    
+    // Overlapping batches race to add the same tracks, each exactly once
+    std::atomic<size_t> added{0};
+    std::atomic<bool> done{false};
+    std::atomic<size_t> missing{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            for (size_t round = 0; round < 5; ++round) {
+                added += library.ingest(make_batch(round * 200 + t * 50, round * 200 + t * 50 + 400));
+            }
+        });
+    }
+    std::thread reader([&]() {
+        while (!done) {
+            for (const auto& track : library.search("song")) {
+                missing += track ? 0 : 1;
+            }
+        }
+    });
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    done = true;
+    reader.join();
+    
+    REQUIRE(missing == 0);
+    REQUIRE(added == 1350);
+    REQUIRE(library.size() == 1350);
+    REQUIRE(library.search("1349").size() == 1);
+    REQUIRE(library.find_by_artist("Artist 3").size() == 135);
+}
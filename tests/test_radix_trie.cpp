@@ -0,0 +1,244 @@
+#include "../include/catch.hpp"
+#include "audio_library/radix_trie.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace audio_library;
+
+TEST_CASE("RadixTrie insertion and lookup", "[radix_trie]") {
+    RadixTrie trie;
+    REQUIRE(trie.empty());
+
+    SECTION("Words sharing prefixes split edges") {
+        REQUIRE(trie.insert("paradise"));
+        REQUIRE(trie.insert("paranoid"));
+        REQUIRE(trie.insert("para"));
+        REQUIRE(trie.insert("p"));
+        REQUIRE_FALSE(trie.insert("paranoid"));
+        REQUIRE_FALSE(trie.insert(""));
+        REQUIRE(trie.size() == 4);
+
+        REQUIRE(trie.contains("para"));
+        REQUIRE(trie.contains("paranoid"));
+        REQUIRE(trie.contains("p"));
+        REQUIRE_FALSE(trie.contains("par"));
+        REQUIRE_FALSE(trie.contains("paradises"));
+        REQUIRE_FALSE(trie.contains(""));
+    }
+
+    SECTION("Erase removes only the given word") {
+        trie.insert("rock");
+        trie.insert("rocket");
+        trie.insert("rocks");
+
+        REQUIRE(trie.erase("rock"));
+        REQUIRE_FALSE(trie.erase("rock"));
+        REQUIRE_FALSE(trie.erase("roc"));
+        REQUIRE_FALSE(trie.contains("rock"));
+        REQUIRE(trie.contains("rocket"));
+        REQUIRE(trie.contains("rocks"));
+
+        REQUIRE(trie.erase("rocket"));
+        REQUIRE(trie.complete("r", 10) == std::vector<std::string>{"rocks"});
+        REQUIRE(trie.size() == 1);
+    }
+}
+
+TEST_CASE("RadixTrie completion ranks by weight", "[radix_trie]") {
+    RadixTrie trie;
+    trie.insert("paranoid", 5);
+    trie.insert("paradise", 9);
+    trie.insert("city", 7);
+    trie.insert("para", 1);
+    trie.insert("parade", 3);
+    trie.insert("pop", 4);
+
+    using Words = std::vector<std::string>;
+    REQUIRE(trie.complete("para", 10) == Words{"paradise", "paranoid", "parade", "para"});
+    REQUIRE(trie.complete("parad", 10) == Words{"paradise", "parade"});
+    REQUIRE(trie.complete("p", 2) == Words{"paradise", "paranoid"});
+    REQUIRE(trie.complete("", 3) == Words{"paradise", "city", "paranoid"});
+    REQUIRE(trie.complete("pop", 10) == Words{"pop"});
+    REQUIRE(trie.complete("parx", 10).empty());
+    REQUIRE(trie.complete("paranoids", 10).empty());
+    REQUIRE(trie.complete("para", 0).empty());
+
+    SECTION("Weights can be raised and lowered") {
+        REQUIRE_FALSE(trie.insert("para", 20));
+        REQUIRE(trie.complete("p", 2) == Words{"para", "paradise"});
+
+        trie.insert("paradise", 0);
+        REQUIRE(trie.complete("parad", 10) == Words{"parade", "paradise"});
+        REQUIRE(trie.complete("", 2) == Words{"para", "city"});
+    }
+
+    SECTION("Erased words leave the lists") {
+        trie.erase("paradise");
+        REQUIRE(trie.complete("", 2) == Words{"city", "paranoid"});
+    }
+
+    SECTION("Requests beyond the precomputed lists are still ranked") {
+        for (uint32_t i = 0; i < 20; ++i) {
+            trie.insert("pad" + std::to_string(i), 100 + i);
+        }
+        auto words = trie.complete("pa", 25);
+        REQUIRE(words.size() == 24);
+        REQUIRE(words.front() == "pad19");
+        REQUIRE(words[20] == "paradise");
+        REQUIRE(words.back() == "para");
+    }
+}
+
+TEST_CASE("RadixTrie completions agree with a full ranking", "[radix_trie]") {
+    RadixTrie trie;
+    std::map<std::string, uint32_t> reference;
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> letter('a', 'd');
+    std::uniform_int_distribution<int> length(1, 6);
+    std::uniform_int_distribution<int> action(0, 9);
+    uint32_t next_weight = 1;
+
+    auto random_word = [&]() {
+        std::string word(static_cast<size_t>(length(rng)), 'a');
+        for (auto& c : word) c = static_cast<char>(letter(rng));
+        return word;
+    };
+
+    for (int step = 0; step < 6000; ++step) {
+        std::string word = random_word();
+        int choice = action(rng);
+        if (choice < 2) {
+            REQUIRE(trie.erase(word) == (reference.erase(word) == 1));
+        } else {
+            // Distinct weights keep the expected order unambiguous; odd
+            // steps lower an existing word's weight instead of raising it
+            uint32_t weight = (choice % 2 == 0) ? 100000 + next_weight++ : next_weight++ % 997;
+            trie.insert(word, weight);
+            reference[word] = weight;
+        }
+        if (step == 3000) {
+            trie.freeze();
+        }
+
+        if (step % 50 != 0) continue;
+        for (std::string prefix : {"", "a", "ab", "dc", "bad"}) {
+            std::vector<std::pair<uint32_t, std::string>> ranked;
+            for (const auto& [w, weight] : reference) {
+                if (w.compare(0, prefix.size(), prefix) == 0) ranked.emplace_back(weight, w);
+            }
+            std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) {
+                return a.first > b.first;
+            });
+
+            auto completions = trie.complete(prefix, RadixTrie::kTopCompletions);
+            REQUIRE(completions.size() == std::min(ranked.size(), RadixTrie::kTopCompletions));
+            for (size_t i = 0; i < completions.size(); ++i) {
+                INFO("prefix '" << prefix << "' rank " << i);
+                REQUIRE(reference.count(completions[i]) == 1);
+                REQUIRE(reference.at(completions[i]) == ranked[i].first);
+            }
+        }
+    }
+}
+
+TEST_CASE("RadixTrie freeze keeps contents and allows updates", "[radix_trie]") {
+    RadixTrie trie;
+    std::set<std::string> reference;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> letter('a', 'e');
+    std::uniform_int_distribution<int> length(1, 8);
+
+    auto random_word = [&]() {
+        std::string word(static_cast<size_t>(length(rng)), 'a');
+        for (auto& c : word) c = static_cast<char>(letter(rng));
+        return word;
+    };
+
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 2000; ++i) {
+            std::string word = random_word();
+            REQUIRE(trie.insert(word) == reference.insert(word).second);
+        }
+        for (int i = 0; i < 1000; ++i) {
+            std::string word = random_word();
+            REQUIRE(trie.erase(word) == (reference.erase(word) == 1));
+        }
+
+        size_t before = trie.memory_usage();
+        trie.freeze();
+        REQUIRE(trie.memory_usage() <= before);
+        REQUIRE(trie.size() == reference.size());
+
+        std::vector<std::string> expected(reference.begin(), reference.end());
+        auto words = trie.complete("", reference.size());
+        std::sort(words.begin(), words.end());
+        REQUIRE(words == expected);
+    }
+}
+
+TEST_CASE("RadixTrie stays compact", "[radix_trie]") {
+    RadixTrie trie;
+    size_t total_bytes = 0;
+    for (int i = 0; i < 10000; ++i) {
+        std::string word = "track" + std::to_string(i * 7919);
+        total_bytes += word.size();
+        trie.insert(word);
+    }
+    trie.freeze();
+
+    // Roughly two small nodes per word plus its unshared bytes; a node per
+    // character with its own hash map would take well over 50 bytes each
+    REQUIRE(trie.memory_usage() < total_bytes * 8);
+}
+
+TEST_CASE("RadixTrie attaches serialized storage in place", "[radix_trie]") {
+    RadixTrie trie;
+    for (int i = 0; i < 500; ++i) {
+        trie.insert("word" + std::to_string(i * 37), static_cast<uint32_t>(i % 50));
+    }
+    trie.erase("word37");
+
+    std::string bytes;
+    trie.serialize(bytes);
+    std::vector<uint64_t> aligned((bytes.size() + 7) / 8);
+    std::memcpy(aligned.data(), bytes.data(), bytes.size());
+    const char* data = reinterpret_cast<const char*>(aligned.data());
+
+    RadixTrie attached;
+    REQUIRE_FALSE(attached.attach(data, bytes.size() - 1));
+    REQUIRE_FALSE(attached.attach(data, 16));
+    REQUIRE(attached.empty());
+
+    REQUIRE(attached.attach(data, bytes.size()));
+    REQUIRE(attached.attached());
+    REQUIRE(attached.memory_usage() < trie.memory_usage());
+    REQUIRE(attached.size() == trie.size());
+    REQUIRE(attached.contains("word74"));
+    REQUIRE_FALSE(attached.contains("word37"));
+    for (const char* prefix : {"", "w", "word1", "word99", "x"}) {
+        REQUIRE(attached.complete(prefix, 10) == trie.complete(prefix, 10));
+        REQUIRE(attached.complete(prefix, 100) == trie.complete(prefix, 100));
+    }
+
+    SECTION("Clearing lets go of the storage") {
+        std::fill(aligned.begin(), aligned.end(), 0);
+        attached.clear();
+        REQUIRE_FALSE(attached.attached());
+        REQUIRE(attached.empty());
+    }
+
+    SECTION("The first change detaches") {
+        REQUIRE(attached.insert("word74", 1000) == false);
+        trie.insert("word74", 1000);
+        REQUIRE_FALSE(attached.attached());
+        std::fill(aligned.begin(), aligned.end(), 0); // No longer read
+        REQUIRE(attached.complete("word", 10) == trie.complete("word", 10));
+        REQUIRE(attached.erase("word74"));
+        REQUIRE_FALSE(attached.contains("word74"));
+    }
+}
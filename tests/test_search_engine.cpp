@@ -1,6 +1,13 @@
 #include "../include/catch.hpp"
 #include "audio_library/search_engine.h"
 #include "audio_library/track.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <set>
 
 using namespace audio_library;
 
@@ -64,6 +71,40 @@ TEST_CASE("SearchEngine basic operations", "[search_engine]") {
         REQUIRE(results.size() >= 1);
     }
     
+    SECTION("Fuzzy search") {
+        SearchEngine::SearchOptions options;
+        options.mode = SearchEngine::SearchMode::FUZZY;
+        
+        auto results = engine.search("bohemain", options);
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].first->title() == "Bohemian Rhapsody");
+        
+        results = engine.search("xyzzyq", options);
+        REQUIRE(results.empty());
+    }
+
+    SECTION("Regex search") {
+        SearchEngine::SearchOptions options;
+        options.mode = SearchEngine::SearchMode::REGEX;
+
+        auto results = engine.search("^cal.*nia$", options);
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].first->title() == "Hotel California");
+
+        results = engine.search("QU[aeiou]+N", options);
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].first->artist() == "Queen");
+
+        results = engine.search("^(rhapsody|imagine)$", options);
+        REQUIRE(results.size() == 2);
+
+        results = engine.search("zeppelin", options);
+        REQUIRE(results.empty());
+
+        results = engine.search("(unclosed", options);
+        REQUIRE(results.empty());
+    }
+
     SECTION("Case sensitivity") {
         SearchEngine::SearchOptions options;
         options.mode = SearchEngine::SearchMode::EXACT;
@@ -140,6 +181,21 @@ TEST_CASE("SearchEngine suggestions", "[search_engine]") {
         auto suggestions = engine.get_suggestions("para", 1);
         REQUIRE(suggestions.size() == 1);
     }
+
+    SECTION("Terms in more tracks are suggested first") {
+        auto suggestions = engine.get_suggestions("PARA", 10);
+        REQUIRE(suggestions == std::vector<std::string>{"paradise", "paranoid"});
+
+        tracks.push_back(std::make_shared<Track>("Paranoid Android", "Radiohead", 387));
+        tracks.push_back(std::make_shared<Track>("Paranoid Eyes", "Pink Floyd", 221));
+        engine.index_track(3, *tracks[3]);
+        engine.index_track(4, *tracks[4]);
+        REQUIRE(engine.get_suggestions("para", 1) == std::vector<std::string>{"paranoid"});
+
+        engine.remove_track(3);
+        engine.remove_track(4);
+        REQUIRE(engine.get_suggestions("para", 1) == std::vector<std::string>{"paradise"});
+    }
 }
 
 TEST_CASE("SearchEngine statistics", "[search_engine]") {
@@ -195,4 +251,967 @@ TEST_CASE("SearchEngine removal", "[search_engine]") {
     
     results = engine.search("keep", options);
     REQUIRE(results.size() == 1);
-}
\ No newline at end of file
+}
+TEST_CASE("SearchEngine BM25F ranking", "[search_engine]") {
+    SearchEngine engine;
+    std::vector<std::shared_ptr<Track>> tracks;
+    
+    auto in_title = std::make_shared<Track>("Rock Lobster", "The B-52's", 409);
+    in_title->set_genre("New Wave");
+    tracks.push_back(in_title);
+    
+    auto in_genre = std::make_shared<Track>("Paranoid", "Black Sabbath", 172);
+    in_genre->set_genre("Rock");
+    tracks.push_back(in_genre);
+    
+    auto long_title = std::make_shared<Track>("We Will Rock You And Then Some More", "Somebody", 200);
+    tracks.push_back(long_title);
+    
+    auto repeated = std::make_shared<Track>("Rock Rock", "Rockers", 180);
+    tracks.push_back(repeated);
+    
+    engine.set_tracks(&tracks);
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        engine.index_track(i, *tracks[i]);
+    }
+    
+    SearchEngine::SearchOptions options;
+    options.mode = SearchEngine::SearchMode::EXACT;
+    
+    SECTION("Title matches outrank genre matches") {
+        auto results = engine.search("rock", options);
+        REQUIRE(results.size() == 4);
+        REQUIRE(results.back().first->title() == "Paranoid");
+    }
+    
+    SECTION("Shorter fields outrank longer ones") {
+        auto results = engine.search("rock", options);
+        auto rank_of = [&results](const std::string& title) {
+            for (size_t i = 0; i < results.size(); ++i) {
+                if (results[i].first->title() == title) return i;
+            }
+            return results.size();
+        };
+        REQUIRE(rank_of("Rock Lobster") < rank_of("We Will Rock You And Then Some More"));
+    }
+    
+    SECTION("Scores are sorted and truncated to max_results") {
+        options.max_results = 2;
+        auto results = engine.search("rock", options);
+        REQUIRE(results.size() == 2);
+        REQUIRE(results[0].second >= results[1].second);
+        REQUIRE(results[0].first->title() == "Rock Rock");
+    }
+    
+    SECTION("Field weights are configurable") {
+        SearchEngine::ScoringParameters parameters;
+        parameters.field_weights = {0.1, 0.1, 0.1, 10.0};
+        engine.set_scoring_parameters(parameters);
+        
+        auto results = engine.search("rock", options);
+        REQUIRE(results.front().first->title() == "Paranoid");
+    }
+    
+    SECTION("Removed tracks stop contributing") {
+        engine.remove_track(3);
+        REQUIRE(engine.get_indexed_tracks_count() == 3);
+        
+        auto results = engine.search("rock", options);
+        REQUIRE(results.size() == 3);
+    }
+}
+
+TEST_CASE("SearchEngine multi-term queries", "[search_engine]") {
+    SearchEngine engine;
+    std::vector<std::shared_ptr<Track>> tracks;
+    
+    tracks.push_back(std::make_shared<Track>("Bohemian Rhapsody", "Queen", 354));
+    tracks.push_back(std::make_shared<Track>("Rhapsody in Blue", "George Gershwin", 1020));
+    tracks.push_back(std::make_shared<Track>("Another One Bites the Dust", "Queen", 215));
+    tracks.push_back(std::make_shared<Track>("Killer Queen", "Queen", 180));
+    
+    engine.set_tracks(&tracks);
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        engine.index_track(i, *tracks[i]);
+    }
+    
+    SearchEngine::SearchOptions options;
+    options.mode = SearchEngine::SearchMode::EXACT;
+    
+    SECTION("Words are ANDed by default") {
+        auto results = engine.search("bohemian rhapsody", options);
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].first->title() == "Bohemian Rhapsody");
+        
+        results = engine.search("Queen, rhapsody!", options);
+        REQUIRE(results.size() == 1);
+        
+        results = engine.search("queen gershwin", options);
+        REQUIRE(results.empty());
+    }
+    
+    SECTION("OR joins neighbouring words") {
+        auto results = engine.search("rhapsody OR dust", options);
+        REQUIRE(results.size() == 3);
+        
+        results = engine.search("queen rhapsody OR killer", options);
+        REQUIRE(results.size() == 2);
+        
+        options.match_all_terms = false;
+        results = engine.search("bohemian blue", options);
+        REQUIRE(results.size() == 2);
+    }
+    
+    SECTION("NOT and '-' exclude tracks") {
+        auto results = engine.search("queen -killer", options);
+        REQUIRE(results.size() == 2);
+        
+        results = engine.search("queen NOT killer NOT dust", options);
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].first->title() == "Bohemian Rhapsody");
+        
+        results = engine.search("-queen", options);
+        REQUIRE(results.empty());
+    }
+    
+    SECTION("Every word is expanded in non-exact modes") {
+        options.mode = SearchEngine::SearchMode::SUBSTRING;
+        auto results = engine.search("rhap que", options);
+        REQUIRE(results.size() == 1);
+        
+        options.mode = SearchEngine::SearchMode::FUZZY;
+        results = engine.search("bohemain rapsody", options);
+        REQUIRE(results.size() == 1);
+    }
+    
+    SECTION("Field selection applies to every word") {
+        options.search_artist = false;
+        auto results = engine.search("queen rhapsody", options);
+        REQUIRE(results.empty());
+    }
+    
+    SECTION("Tracks matching more words rank higher") {
+        options.match_all_terms = false;
+        auto results = engine.search("queen killer", options);
+        REQUIRE(results.size() == 3);
+        REQUIRE(results[0].first->title() == "Killer Queen");
+    }
+}
+
+TEST_CASE("SearchEngine intersections agree with a linear scan", "[search_engine]") {
+    SearchEngine engine;
+    std::vector<std::shared_ptr<Track>> tracks;
+    const std::vector<std::string> words = {"alpha", "beta", "gamma", "delta", "omega"};
+    
+    // Word w appears in every (w + 2)-th title, giving lists of varied density
+    for (size_t i = 0; i < 3000; ++i) {
+        std::string title = "t" + std::to_string(i);
+        for (size_t w = 0; w < words.size(); ++w) {
+            if (i % (w + 2) == 0) title += " " + words[w];
+        }
+        tracks.push_back(std::make_shared<Track>(title, "Artist", 100));
+    }
+    
+    engine.set_tracks(&tracks);
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        engine.index_track(i, *tracks[i]);
+    }
+    
+    SearchEngine::SearchOptions options;
+    options.mode = SearchEngine::SearchMode::EXACT;
+    options.max_results = tracks.size();
+    
+    for (size_t a = 0; a < words.size(); ++a) {
+        for (size_t b = 0; b < words.size(); ++b) {
+            if (a == b) continue;
+            
+            auto results = engine.search(words[a] + " " + words[b], options);
+            size_t expected = 0;
+            for (size_t i = 0; i < tracks.size(); ++i) {
+                if (i % (a + 2) == 0 && i % (b + 2) == 0) ++expected;
+            }
+            INFO(words[a] << " " << words[b]);
+            REQUIRE(results.size() == expected);
+            
+            results = engine.search(words[a] + " -" + words[b], options);
+            expected = 0;
+            for (size_t i = 0; i < tracks.size(); ++i) {
+                if (i % (a + 2) == 0 && i % (b + 2) != 0) ++expected;
+            }
+            REQUIRE(results.size() == expected);
+        }
+    }
+}
+
+TEST_CASE("SearchEngine removal updates postings and suggestions", "[search_engine]") {
+    SearchEngine engine;
+    std::vector<std::shared_ptr<Track>> tracks;
+    
+    tracks.push_back(std::make_shared<Track>("Paranoid", "Black Sabbath", 172));
+    tracks.push_back(std::make_shared<Track>("Paradise", "Coldplay", 278));
+    tracks.push_back(std::make_shared<Track>("Paradise City", "Guns N' Roses", 346));
+    
+    engine.set_tracks(&tracks);
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        engine.index_track(i, *tracks[i]);
+    }
+    
+    SearchEngine::SearchOptions options;
+    options.mode = SearchEngine::SearchMode::EXACT;
+    size_t terms_before = engine.get_indexed_terms_count();
+    
+    SECTION("Terms unique to the track disappear") {
+        engine.remove_track(0);
+        REQUIRE(engine.search("paranoid", options).empty());
+        REQUIRE(engine.search("sabbath", options).empty());
+        REQUIRE(engine.get_indexed_terms_count() == terms_before - 3);
+        REQUIRE(engine.get_suggestions("para", 10) == std::vector<std::string>{"paradise"});
+    }
+    
+    SECTION("Shared terms keep their other postings") {
+        engine.remove_track(1);
+        REQUIRE(engine.search("paradise", options).size() == 1);
+        REQUIRE(engine.get_suggestions("para", 10).size() == 2);
+        REQUIRE(engine.get_suggestions("cold", 10).empty());
+    }
+    
+    SECTION("Removing twice or an unknown id is harmless") {
+        engine.remove_track(2);
+        engine.remove_track(2);
+        engine.remove_track(42);
+        REQUIRE(engine.get_indexed_tracks_count() == 2);
+        REQUIRE(engine.search("city", options).empty());
+        
+        engine.index_track(2, *tracks[2]);
+        REQUIRE(engine.search("city", options).size() == 1);
+        REQUIRE(engine.get_suggestions("cit", 10).size() == 1);
+    }
+}
+
+TEST_CASE("SearchEngine result cache", "[search_engine]") {
+    SearchEngine engine;
+    std::vector<std::shared_ptr<Track>> tracks;
+    
+    tracks.push_back(std::make_shared<Track>("Bohemian Rhapsody", "Queen", 354));
+    tracks.push_back(std::make_shared<Track>("Killer Queen", "Queen", 180));
+    
+    engine.set_tracks(&tracks);
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        engine.index_track(i, *tracks[i]);
+    }
+    
+    SearchEngine::SearchOptions options;
+    options.mode = SearchEngine::SearchMode::EXACT;
+    
+    SECTION("Repeated queries are served from the cache") {
+        auto first = engine.search("queen", options);
+        auto second = engine.search("  QUEEN ", options);
+        REQUIRE(first == second);
+        
+        auto stats = engine.get_result_cache_stats();
+        REQUIRE(stats.misses == 1);
+        REQUIRE(stats.hits == 1);
+        REQUIRE(stats.entries == 1);
+        REQUIRE(stats.bytes > 0);
+    }
+    
+    SECTION("Options are part of the key") {
+        (void)engine.search("queen", options);
+        options.search_artist = false;
+        auto results = engine.search("queen", options);
+        REQUIRE(results.size() == 1);
+        REQUIRE(engine.get_result_cache_stats().hits == 0);
+        
+        options.search_artist = true;
+        options.case_sensitive = true;
+        REQUIRE(engine.search("QUEEN", options).empty());
+        REQUIRE(engine.get_result_cache_stats().entries == 3);
+        
+        // Thresholds alike to six decimal places are still told apart
+        options.case_sensitive = false;
+        options.min_relevance = 0.1234561;
+        (void)engine.search("queen", options);
+        options.min_relevance = 0.1234564;
+        (void)engine.search("queen", options);
+        REQUIRE(engine.get_result_cache_stats().hits == 0);
+        REQUIRE(engine.get_result_cache_stats().entries == 5);
+    }
+    
+    SECTION("Index changes invalidate cached results") {
+        REQUIRE(engine.search("queen", options).size() == 2);
+        
+        tracks.push_back(std::make_shared<Track>("Radio Ga Ga", "Queen", 343));
+        engine.index_track(2, *tracks[2]);
+        REQUIRE(engine.search("queen", options).size() == 3);
+        
+        engine.remove_track(0);
+        REQUIRE(engine.search("queen", options).size() == 2);
+        REQUIRE(engine.get_result_cache_stats().hits == 0);
+        
+        REQUIRE(engine.search("queen", options).size() == 2);
+        REQUIRE(engine.get_result_cache_stats().hits == 1);
+    }
+    
+    SECTION("The byte budget bounds the cache") {
+        engine.set_result_cache_capacity(400);
+        for (const char* query : {"queen", "killer", "bohemian", "rhapsody", "queen killer"}) {
+            (void)engine.search(query, options);
+        }
+        auto stats = engine.get_result_cache_stats();
+        REQUIRE(stats.bytes <= 400);
+        REQUIRE(stats.entries < 5);
+        
+        // Least recently used entries go first
+        (void)engine.search("queen killer", options);
+        REQUIRE(engine.get_result_cache_stats().hits == 1);
+        
+        engine.set_result_cache_capacity(0);
+        REQUIRE(engine.get_result_cache_stats().entries == 0);
+        (void)engine.search("queen killer", options);
+        REQUIRE(engine.get_result_cache_stats().entries == 0);
+    }
+}
+
+TEST_CASE("SearchEngine parallel rebuild matches a sequential build", "[search_engine]") {
+    std::vector<std::shared_ptr<Track>> tracks;
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> word(0, 299);
+    std::uniform_int_distribution<int> count(1, 4);
+    
+    auto phrase = [&]() {
+        std::string text;
+        for (int i = count(rng); i > 0; --i) {
+            text += "w" + std::to_string(word(rng)) + (i > 1 ? " " : "");
+        }
+        return text;
+    };
+    
+    for (size_t i = 0; i < 3000; ++i) {
+        if (i % 97 == 0) {
+            tracks.push_back(nullptr);
+            continue;
+        }
+        auto track = std::make_shared<Track>(phrase(), phrase(), 200);
+        if (i % 3 == 0) track->set_album(phrase());
+        if (i % 5 == 0) track->set_genre(phrase());
+        tracks.push_back(track);
+    }
+    
+    SearchEngine sequential;
+    SearchEngine parallel;
+    SearchEngine appended;
+    sequential.set_tracks(&tracks);
+    parallel.set_tracks(&tracks);
+    appended.set_tracks(&tracks);
+    sequential.rebuild_index(tracks, 1);
+    parallel.rebuild_index(tracks, 4);
+    
+    // A batch appended to an index extends its existing posting lists
+    for (size_t i = 0; i < 1000; ++i) {
+        if (tracks[i]) appended.index_track(i, *tracks[i]);
+    }
+    appended.index_tracks(tracks, 1000, 4);
+    
+    auto same_results = [&](const std::string& query, const SearchEngine::SearchOptions& options) {
+        auto expected = sequential.search(query, options);
+        auto actual = parallel.search(query, options);
+        INFO(query);
+        REQUIRE(actual == expected);
+        REQUIRE(appended.search(query, options) == expected);
+    };
+    
+    REQUIRE(parallel.get_indexed_terms_count() == sequential.get_indexed_terms_count());
+    REQUIRE(parallel.get_indexed_tracks_count() == sequential.get_indexed_tracks_count());
+    REQUIRE(appended.get_indexed_terms_count() == sequential.get_indexed_terms_count());
+    REQUIRE(appended.get_indexed_tracks_count() == sequential.get_indexed_tracks_count());
+    
+    SearchEngine::SearchOptions options;
+    options.max_results = tracks.size();
+    for (auto mode : {SearchEngine::SearchMode::EXACT, SearchEngine::SearchMode::PREFIX,
+                      SearchEngine::SearchMode::SUBSTRING}) {
+        options.mode = mode;
+        for (const char* query : {"w1", "w29", "w7 w70", "w1 OR w2", "w12 -w120", "\"w3 w4\"", "w5 NEAR/2 w6"}) {
+            same_results(query, options);
+        }
+    }
+    options.mode = SearchEngine::SearchMode::REGEX;
+    same_results("^w1[0-9]$", options);
+    
+    for (const char* prefix : {"w", "w1", "w29"}) {
+        REQUIRE(parallel.get_suggestions(prefix, 10) == sequential.get_suggestions(prefix, 10));
+        REQUIRE(appended.get_suggestions(prefix, 10) == sequential.get_suggestions(prefix, 10));
+    }
+    
+    // The forward index must refer to the merged term ids
+    for (size_t id : {1u, 1500u, 2999u}) {
+        sequential.remove_track(id);
+        parallel.remove_track(id);
+        appended.remove_track(id);
+    }
+    options.mode = SearchEngine::SearchMode::PREFIX;
+    same_results("w", options);
+    REQUIRE(parallel.get_indexed_terms_count() == sequential.get_indexed_terms_count());
+}
+
+TEST_CASE("SearchEngine parallel builds share new terms across ranges", "[search_engine]") {
+    // Every range introduces the same new terms, which must each be merged
+    // by exactly one thread
+    std::vector<std::shared_ptr<Track>> tracks;
+    for (size_t i = 0; i < 2000; ++i) {
+        tracks.push_back(std::make_shared<Track>("shared title " + std::to_string(i % 7),
+                                                 i < 400 ? "early" : "fresh", 200));
+    }
+    
+    SearchEngine engine;
+    engine.set_tracks(&tracks);
+    for (size_t i = 0; i < 400; ++i) {
+        engine.index_track(i, *tracks[i]);
+    }
+    engine.index_tracks(tracks, 400, 4);
+    
+    SearchEngine rebuilt;
+    rebuilt.set_tracks(&tracks);
+    rebuilt.rebuild_index(tracks, 4);
+    
+    SearchEngine::SearchOptions options;
+    options.max_results = tracks.size();
+    for (SearchEngine* index : {&engine, &rebuilt}) {
+        REQUIRE(index->get_indexed_terms_count() == 11);
+        REQUIRE(index->search("shared", options).size() == 2000);
+        REQUIRE(index->search("fresh", options).size() == 1600);
+        REQUIRE(index->search("early", options).size() == 400);
+        REQUIRE(index->search("fresh 3", options).size() == 229);
+        REQUIRE(index->get_suggestions("fr", 5) == std::vector<std::string>{"fresh"});
+    }
+}
+
+TEST_CASE("SearchEngine phrase and NEAR queries", "[search_engine]") {
+    SearchEngine engine;
+    std::vector<std::shared_ptr<Track>> tracks;
+    
+    tracks.push_back(std::make_shared<Track>("Stairway to Heaven", "Led Zeppelin", 482));
+    tracks.push_back(std::make_shared<Track>("Highway to Hell", "AC/DC", 208));
+    tracks.push_back(std::make_shared<Track>("Heaven Knows I'm Miserable Now", "The Smiths", 214));
+    tracks.push_back(std::make_shared<Track>("Live at Wembley '86", "Queen", 3600));
+    tracks.push_back(std::make_shared<Track>("Wembley Stadium Live Bootleg Recording", "Queen", 3500));
+    tracks.push_back(std::make_shared<Track>("Live", "Wembley", 100));
+    
+    engine.set_tracks(&tracks);
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        engine.index_track(i, *tracks[i]);
+    }
+    
+    SearchEngine::SearchOptions options;
+    auto titles = [&](const std::string& query) {
+        std::vector<std::string> found;
+        for (const auto& [track, score] : engine.search(query, options)) {
+            found.push_back(track->title());
+        }
+        std::sort(found.begin(), found.end());
+        return found;
+    };
+    using Titles = std::vector<std::string>;
+    
+    SECTION("Phrases match consecutive words in one field") {
+        REQUIRE(titles("\"stairway to heaven\"") == Titles{"Stairway to Heaven"});
+        REQUIRE(titles("\"to heaven\"") == Titles{"Stairway to Heaven"});
+        REQUIRE(titles("\"heaven to\"").empty());
+        REQUIRE(titles("\"to hell\" OR \"to heaven\"").empty()); // Phrases take no alternatives
+        REQUIRE(titles("\"live wembley\"").empty()); // Title and artist are separate fields
+        REQUIRE(titles("\"heaven knows\" smiths") == Titles{"Heaven Knows I'm Miserable Now"});
+        REQUIRE(titles("heaven -\"stairway to\"") == Titles{"Heaven Knows I'm Miserable Now"});
+    }
+    
+    SECTION("Phrase words match exactly in every mode") {
+        REQUIRE(titles("\"stair to\"").empty());
+        options.mode = SearchEngine::SearchMode::PREFIX;
+        REQUIRE(titles("\"stair to\"").empty());
+        REQUIRE(titles("stair to").size() == 1);
+    }
+    
+    SECTION("NEAR matches words in either order within the distance") {
+        REQUIRE(titles("live NEAR wembley") ==
+                Titles{"Live at Wembley '86", "Wembley Stadium Live Bootleg Recording"});
+        REQUIRE(titles("wembley NEAR/1 live").size() == 2);
+        REQUIRE(titles("live NEAR/0 wembley").empty());
+        REQUIRE(titles("bootleg NEAR/0 live") == Titles{"Wembley Stadium Live Bootleg Recording"});
+        REQUIRE(titles("wembley NEAR/0 stadium NEAR/0 live") ==
+                Titles{"Wembley Stadium Live Bootleg Recording"});
+        REQUIRE(titles("wembley NEAR/2 recording").empty());
+        REQUIRE(titles("wembley NEAR/3 recording").size() == 1);
+        REQUIRE(titles("live NEAR queen").empty());
+    }
+    
+    SECTION("Repeated NEAR words need an occurrence each") {
+        tracks.push_back(std::make_shared<Track>("Love Love Me Do", "The Beatles", 140));
+        engine.index_track(6, *tracks[6]);
+        REQUIRE(titles("heaven NEAR heaven").empty());
+        REQUIRE(titles("live NEAR/5 live").empty());
+        REQUIRE(titles("love NEAR/0 love") == Titles{"Love Love Me Do"});
+        REQUIRE(titles("love NEAR/1 me NEAR/1 love") == Titles{"Love Love Me Do"});
+        REQUIRE(titles("love NEAR love NEAR love").empty());
+    }
+    
+    SECTION("Text indexed again under an id keeps both sets of positions") {
+        engine.index_track(1, Track("Back in Black", "AC/DC", 255));
+        REQUIRE(titles("\"highway to hell\"") == Titles{"Highway to Hell"});
+        REQUIRE(titles("\"back in black\"") == Titles{"Highway to Hell"});
+        REQUIRE(titles("\"hell back\"") == Titles{"Highway to Hell"}); // Continues the title
+    }
+    
+    SECTION("Without positions phrases match like AND") {
+        engine.set_store_positions(false);
+        REQUIRE_FALSE(engine.stores_positions());
+        engine.rebuild_index(tracks);
+        REQUIRE(titles("\"heaven to\"") == Titles{"Stairway to Heaven"});
+        REQUIRE(titles("live NEAR/0 wembley").size() == 2);
+    }
+}
+
+TEST_CASE("SearchEngine phrases agree with a scan of the text", "[search_engine]") {
+    std::vector<std::shared_ptr<Track>> tracks;
+    std::mt19937 rng(17);
+    std::uniform_int_distribution<int> letter(0, 4);
+    std::uniform_int_distribution<int> count(1, 8);
+    
+    auto text = [&]() {
+        std::string words;
+        for (int i = count(rng); i > 0; --i) {
+            words += static_cast<char>('a' + letter(rng));
+            words += i > 1 ? " " : "";
+        }
+        return words;
+    };
+    for (int i = 0; i < 1500; ++i) {
+        tracks.push_back(std::make_shared<Track>(text(), text(), 100));
+    }
+    
+    SearchEngine engine;
+    engine.set_tracks(&tracks);
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        engine.index_track(i, *tracks[i]);
+    }
+    // Text indexed again under the first ids continues their positions;
+    // those tracks are left out of the comparison
+    const size_t merged = 40;
+    for (size_t i = 0; i < merged; ++i) {
+        engine.index_track(i, Track(text(), text(), 100));
+    }
+    
+    SearchEngine::SearchOptions options;
+    options.mode = SearchEngine::SearchMode::EXACT;
+    options.max_results = tracks.size();
+    
+    for (const std::string phrase : {"a b", "c c", "a b c", "e d c b", "b a a"}) {
+        std::set<const Track*> expected;
+        for (size_t i = merged; i < tracks.size(); ++i) {
+            for (const std::string& field : {tracks[i]->title(), tracks[i]->artist()}) {
+                std::string padded = " " + field + " ";
+                if (padded.find(" " + phrase + " ") != std::string::npos) {
+                    expected.insert(tracks[i].get());
+                }
+            }
+        }
+        
+        std::set<const Track*> found;
+        for (const auto& [track, score] : engine.search("\"" + phrase + "\"", options)) {
+            if (std::find(tracks.begin(), tracks.begin() + merged, track) == tracks.begin() + merged) {
+                found.insert(track.get());
+            }
+        }
+        INFO(phrase);
+        REQUIRE(found == expected);
+    }
+}
+
+TEST_CASE("SearchEngine batch search matches single queries", "[search_engine]") {
+    std::vector<std::shared_ptr<Track>> tracks;
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> word(0, 199);
+    std::uniform_int_distribution<int> count(1, 4);
+    
+    auto phrase = [&]() {
+        std::string text;
+        for (int i = count(rng); i > 0; --i) {
+            text += "t" + std::to_string(word(rng)) + (i > 1 ? " " : "");
+        }
+        return text;
+    };
+    for (int i = 0; i < 2000; ++i) {
+        tracks.push_back(std::make_shared<Track>(phrase(), phrase(), 100));
+    }
+    
+    SearchEngine engine;
+    engine.set_tracks(&tracks);
+    engine.rebuild_index(tracks);
+    engine.set_result_cache_capacity(0); // Every query is evaluated
+    
+    // Repeated queries and shared words across several modes
+    std::vector<SearchEngine::Query> queries;
+    const SearchEngine::SearchMode modes[] = {SearchEngine::SearchMode::EXACT, SearchEngine::SearchMode::PREFIX,
+                                              SearchEngine::SearchMode::SUBSTRING, SearchEngine::SearchMode::FUZZY};
+    for (int i = 0; i < 400; ++i) {
+        SearchEngine::Query query;
+        query.text = phrase();
+        if (i % 7 == 0) query.text += " -t" + std::to_string(word(rng));
+        if (i % 11 == 0) query.text = "\"" + query.text + "\"";
+        query.options.mode = modes[i % 4];
+        query.options.max_results = 20;
+        queries.push_back(query);
+        if (i % 5 == 0) queries.push_back(query);
+    }
+    queries.push_back({"", {}});
+    queries.push_back({"^t1[0-9]$", {}});
+    queries.back().options.mode = SearchEngine::SearchMode::REGEX;
+    
+    for (size_t threads : {1, 4}) {
+        auto results = engine.search_batch(queries, threads);
+        REQUIRE(results.size() == queries.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+            INFO(queries[i].text << " with " << threads << " threads");
+            REQUIRE(results[i] == engine.search(queries[i].text, queries[i].options));
+        }
+    }
+    
+    SECTION("Batch results fill the result cache") {
+        engine.set_result_cache_capacity(SearchEngine::kDefaultResultCacheBytes);
+        auto results = engine.search_batch(queries);
+        auto misses = engine.get_result_cache_stats().misses;
+        REQUIRE(engine.search_batch(queries) == results);
+        REQUIRE(engine.get_result_cache_stats().misses == misses);
+    }
+    
+    REQUIRE(engine.search_batch({}).empty());
+}
+
+TEST_CASE("SearchEngine folds accents and Unicode case", "[search_engine]") {
+    SearchEngine engine;
+    std::vector<std::shared_ptr<Track>> tracks;
+    
+    tracks.push_back(std::make_shared<Track>("Halo", "Beyoncé", 261));
+    tracks.push_back(std::make_shared<Track>("Hoppípolla", "Sigur Rós", 268));
+    tracks.push_back(std::make_shared<Track>("Même sous la pluie", "Françoise Hardy", 125));
+    tracks.push_back(std::make_shared<Track>("Sleeping Separate", "Σtella", 207));
+    
+    engine.set_tracks(&tracks);
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        engine.index_track(i, *tracks[i]);
+    }
+    
+    SearchEngine::SearchOptions options;
+    options.mode = SearchEngine::SearchMode::EXACT;
+    
+    SECTION("Unaccented queries find accented text") {
+        auto results = engine.search("beyonce", options);
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].first->artist() == "Beyoncé");
+        
+        REQUIRE(engine.search("sigur ros hoppipolla", options).size() == 1);
+        REQUIRE(engine.search("meme francoise", options).size() == 1);
+    }
+    
+    SECTION("Accented and uppercase queries fold the same way") {
+        REQUIRE(engine.search("BEYONCÉ", options).size() == 1);
+        REQUIRE(engine.search("Beyonce\xCC\x81", options).size() == 1); // Decomposed é
+        REQUIRE(engine.search("ΣTELLA", options).size() == 1);
+        
+        options.mode = SearchEngine::SearchMode::PREFIX;
+        REQUIRE(engine.search("Mêm", options).size() == 1);
+    }
+    
+    SECTION("Suggestions use the folded terms") {
+        auto suggestions = engine.get_suggestions("BEY", 5);
+        REQUIRE(suggestions == std::vector<std::string>{"beyonce"});
+    }
+}
+
+TEST_CASE("SearchEngine pruned top-k matches exhaustive scoring", "[search_engine]") {
+    std::vector<std::shared_ptr<Track>> tracks;
+    std::mt19937 rng(11);
+    // Skewed word choice gives a few terms thousands of postings. Fields
+    // run longer in some ranges of ids than others, so that blocks differ.
+    std::geometric_distribution<int> common(0.3);
+    std::uniform_int_distribution<int> rare(0, 499);
+    std::uniform_int_distribution<int> count(1, 6);
+    std::uniform_int_distribution<int> coin(0, 3);
+    
+    auto text = [&](size_t padding) {
+        std::string result;
+        for (int i = count(rng); i > 0; --i) {
+            result += coin(rng) == 0 ? "r" + std::to_string(rare(rng)) : "c" + std::to_string(common(rng) % 10);
+            result += ' ';
+        }
+        for (size_t i = 0; i < padding; ++i) {
+            result += "r" + std::to_string(rare(rng)) + ' ';
+        }
+        return result;
+    };
+    
+    for (size_t i = 0; i < 6000; ++i) {
+        const size_t padding = (i / 400) % 4 * 4;
+        auto track = std::make_shared<Track>(text(padding), text(padding), 200);
+        if (i % 2 == 0) track->set_album(text(padding));
+        if (i % 7 == 0) track->set_genre(text(0));
+        tracks.push_back(track);
+    }
+    
+    SearchEngine engine;
+    engine.set_tracks(&tracks);
+    engine.rebuild_index(tracks, 1);
+    
+    // The best k of every result, ties broken the same way
+    auto check = [&](const std::string& query, SearchEngine::SearchOptions options) {
+        options.max_results = tracks.size();
+        const auto all = engine.search(query, options);
+        for (size_t k : {1u, 10u, 100u}) {
+            options.max_results = k;
+            std::vector<SearchEngine::SearchResult> expected(
+                all.begin(), all.begin() + static_cast<std::ptrdiff_t>(std::min(k, all.size())));
+            INFO(query << " k=" << k);
+            REQUIRE(engine.search(query, options) == expected);
+        }
+    };
+    
+    auto check_all = [&]() {
+        SearchEngine::SearchOptions options;
+        options.mode = SearchEngine::SearchMode::EXACT;
+        for (const char* query : {"c0", "c3", "c0 OR c1", "c2 OR r7 OR c5", "r1 OR c9",
+                                  "c6 OR c0", "c8 OR c1 OR c0 OR c4"}) {
+            check(query, options);
+        }
+        
+        options.mode = SearchEngine::SearchMode::PREFIX;
+        check("c", options);
+        options.mode = SearchEngine::SearchMode::SUBSTRING;
+        check("c1", options);
+        
+        options.mode = SearchEngine::SearchMode::EXACT;
+        options.match_all_terms = false;
+        check("c0 c4 r12", options);
+        
+        options.match_all_terms = true;
+        options.search_title = false;
+        options.search_genre = false;
+        check("c0 OR c2", options);
+        
+        options = {};
+        options.mode = SearchEngine::SearchMode::EXACT;
+        options.min_relevance = 0.5;
+        check("c1 OR c6", options);
+    };
+    
+    check_all();
+    
+    SECTION("After removals and re-indexing") {
+        for (size_t id = 0; id < tracks.size(); id += 3) {
+            engine.remove_track(id);
+        }
+        for (size_t id = 0; id < tracks.size(); id += 9) {
+            engine.index_track(id, *tracks[id]);
+        }
+        // Out of order and merged into existing postings
+        engine.index_track(5, *tracks[5999]);
+        engine.index_track(6, Track("c0 c0 c0 c0", "c0", 200));
+        check_all();
+    }
+    
+    SECTION("With other scoring parameters") {
+        SearchEngine::ScoringParameters parameters;
+        parameters.k1 = 2.0;
+        parameters.field_weights = {3.0, 0.0, 1.0, 0.5};
+        parameters.field_length_normalization = {1.0, 0.0, 0.3, 0.9};
+        engine.set_scoring_parameters(parameters);
+        check_all();
+    }
+}
+
+TEST_CASE("SearchEngine saves and maps its index", "[search_engine]") {
+    std::vector<std::shared_ptr<Track>> tracks;
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> word(0, 199);
+    std::uniform_int_distribution<int> count(1, 4);
+    
+    auto phrase = [&]() {
+        std::string text;
+        for (int i = count(rng); i > 0; --i) {
+            text += "w" + std::to_string(word(rng)) + (i > 1 ? " " : "");
+        }
+        return text;
+    };
+    
+    for (size_t i = 0; i < 2000; ++i) {
+        if (i % 89 == 0) {
+            tracks.push_back(nullptr);
+            continue;
+        }
+        auto track = std::make_shared<Track>(phrase(), phrase(), 200);
+        if (i % 3 == 0) track->set_album(phrase());
+        if (i % 4 == 0) track->set_genre(phrase());
+        tracks.push_back(track);
+    }
+    
+    SearchEngine original;
+    original.set_tracks(&tracks);
+    original.rebuild_index(tracks, 1);
+    original.remove_track(5); // Leaves a term id without postings
+    
+    const auto path = std::filesystem::temp_directory_path() / "audio_library_test.index";
+    REQUIRE(original.save_index(path));
+    
+    SearchEngine loaded;
+    loaded.set_tracks(&tracks);
+    loaded.set_result_cache_capacity(0);
+    REQUIRE(loaded.load_index(path));
+    REQUIRE(loaded.is_index_mapped());
+    REQUIRE_FALSE(original.is_index_mapped());
+    
+    auto same_results = [&]() {
+        REQUIRE(loaded.get_indexed_terms_count() == original.get_indexed_terms_count());
+        REQUIRE(loaded.get_indexed_tracks_count() == original.get_indexed_tracks_count());
+        
+        SearchEngine::SearchOptions options;
+        for (auto mode : {SearchEngine::SearchMode::EXACT, SearchEngine::SearchMode::PREFIX,
+                          SearchEngine::SearchMode::SUBSTRING, SearchEngine::SearchMode::FUZZY}) {
+            options.mode = mode;
+            for (size_t max_results : {size_t{10}, tracks.size()}) {
+                options.max_results = max_results;
+                for (const char* query : {"w1", "w19", "w7 w70", "w1 OR w2", "w12 -w120",
+                                          "\"w3 w4\"", "w5 NEAR/2 w6", "w199"}) {
+                    INFO(query);
+                    REQUIRE(loaded.search(query, options) == original.search(query, options));
+                }
+            }
+        }
+        options.mode = SearchEngine::SearchMode::REGEX;
+        REQUIRE(loaded.search("^w1[0-9]$", options) == original.search("^w1[0-9]$", options));
+        REQUIRE(loaded.search("^w12[0-9]?$", options) == original.search("^w12[0-9]?$", options));
+        
+        for (const char* prefix : {"", "w", "w1", "w19"}) {
+            REQUIRE(loaded.get_suggestions(prefix, 10) == original.get_suggestions(prefix, 10));
+            REQUIRE(loaded.get_suggestions(prefix, 50) == original.get_suggestions(prefix, 50));
+        }
+    };
+    same_results();
+    
+    SECTION("A mapped index saves the same file") {
+        const auto copy = std::filesystem::temp_directory_path() / "audio_library_test_copy.index";
+        REQUIRE(loaded.save_index(copy));
+        SearchEngine reloaded;
+        reloaded.set_tracks(&tracks);
+        REQUIRE(reloaded.load_index(copy));
+        REQUIRE(reloaded.search("w1 OR w2") == original.search("w1 OR w2"));
+        std::filesystem::remove(copy);
+    }
+    
+    SECTION("Changes copy the index into memory") {
+        auto track = std::make_shared<Track>("w1 brand new", "w2", 100);
+        tracks.push_back(track);
+        for (auto* engine : {&original, &loaded}) {
+            engine->index_track(tracks.size() - 1, *track);
+            engine->remove_track(10);
+            engine->remove_track(11);
+        }
+        REQUIRE_FALSE(loaded.is_index_mapped());
+        same_results();
+        
+        loaded.rebuild_index(tracks, 1);
+        original.rebuild_index(tracks, 1);
+        same_results();
+    }
+    
+    SECTION("Unusable files leave the index alone") {
+        const auto expected = loaded.search("w1 OR w2");
+        REQUIRE_FALSE(loaded.load_index(path.string() + ".missing"));
+        
+        std::string bytes;
+        {
+            std::ifstream in(path, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        const auto damaged = std::filesystem::temp_directory_path() / "audio_library_damaged.index";
+        auto write_damaged = [&](const std::string& content) {
+            std::ofstream out(damaged, std::ios::binary | std::ios::trunc);
+            out << content;
+        };
+        
+        write_damaged(bytes.substr(0, bytes.size() / 2));
+        REQUIRE_FALSE(loaded.load_index(damaged));
+        write_damaged(bytes.substr(0, 40));
+        REQUIRE_FALSE(loaded.load_index(damaged));
+        write_damaged("X" + bytes.substr(1));
+        REQUIRE_FALSE(loaded.load_index(damaged));
+        
+        // Well-formed sections whose contents point outside the index. The
+        // header's (offset, size) pairs per section follow its first 128
+        // bytes; postings are 16 bytes, the track id first and the offset
+        // of the positions last.
+        auto write_patched = [&](size_t section, uint64_t at, const std::string& patch) {
+            uint64_t offset = 0;
+            std::memcpy(&offset, bytes.data() + 128 + section * 16, sizeof(offset));
+            auto content = bytes;
+            content.replace(static_cast<size_t>(offset + at), patch.size(), patch);
+            write_damaged(content);
+        };
+        auto patch_value = [](uint32_t value) {
+            return std::string(reinterpret_cast<const char*>(&value), sizeof(value));
+        };
+        const size_t kTermOrder = 2;
+        const size_t kPostings = 4;
+        const size_t kPositions = 6;
+        const size_t kTrackTerms = 11;
+        const size_t kTrigramTerms = 14;
+        {
+            SearchEngine unpatched;
+            unpatched.set_tracks(&tracks);
+            write_patched(kPostings, 0, "");
+            REQUIRE(unpatched.load_index(damaged));
+        }
+        write_patched(kPostings, 0, patch_value(5000)); // Track id past the tracks
+        REQUIRE_FALSE(loaded.load_index(damaged));
+        write_patched(kPostings, 12, patch_value(1u << 30)); // Positions past the term's run
+        REQUIRE_FALSE(loaded.load_index(damaged));
+        write_patched(kPositions, 0, std::string(64, '\x80')); // Unterminated varints
+        REQUIRE_FALSE(loaded.load_index(damaged));
+        write_patched(kTermOrder, 0, patch_value(1u << 20)); // Term id past the terms
+        REQUIRE_FALSE(loaded.load_index(damaged));
+        write_patched(kTermOrder, 0, patch_value(0) + patch_value(0)); // Not a permutation
+        REQUIRE_FALSE(loaded.load_index(damaged));
+        write_patched(kTrackTerms, 0, patch_value(1u << 20));
+        REQUIRE_FALSE(loaded.load_index(damaged));
+        write_patched(kTrigramTerms, 0, patch_value(1u << 20));
+        REQUIRE_FALSE(loaded.load_index(damaged));
+        
+        // The trie: a 32-byte header counting its nodes first, then 32-byte
+        // nodes holding label offset and length, parent, first child, next
+        // sibling and completion block, then the completions
+        const size_t kTrie = 15;
+        uint64_t trie_offset = 0;
+        uint64_t trie_nodes = 0;
+        std::memcpy(&trie_offset, bytes.data() + 128 + kTrie * 16, sizeof(trie_offset));
+        std::memcpy(&trie_nodes, bytes.data() + trie_offset, sizeof(trie_nodes));
+        REQUIRE(trie_nodes > 2);
+        auto node_field = [](uint64_t node, size_t field) { return 32 + node * 32 + field * 4; };
+        write_patched(kTrie, node_field(0, 3), patch_value(1u << 30)); // Root's first child
+        REQUIRE_FALSE(loaded.load_index(damaged));
+        write_patched(kTrie, node_field(1, 1), patch_value(1u << 30)); // Label past the labels
+        REQUIRE_FALSE(loaded.load_index(damaged));
+        write_patched(kTrie, node_field(1, 4), patch_value(1)); // Sibling of itself
+        REQUIRE_FALSE(loaded.load_index(damaged));
+        write_patched(kTrie, node_field(1, 2), patch_value(2)); // Parent it is not reached from
+        REQUIRE_FALSE(loaded.load_index(damaged));
+        write_patched(kTrie, node_field(0, 5), patch_value(1u << 30)); // Completions past the list
+        REQUIRE_FALSE(loaded.load_index(damaged));
+        write_patched(kTrie, node_field(trie_nodes, 0), patch_value(1u << 30)); // Completion's node
+        REQUIRE_FALSE(loaded.load_index(damaged));
+        std::filesystem::remove(damaged);
+        
+        // Saved for tracks that have changed since
+        tracks[1] = std::make_shared<Track>("something else", "w2", 100);
+        REQUIRE_FALSE(loaded.load_index(path));
+        
+        REQUIRE(loaded.is_index_mapped());
+        REQUIRE(loaded.search("w1 OR w2") == expected);
+    }
+    
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,151 @@
+#include "../include/catch.hpp"
+#include "audio_library/tokenizer.h"
+#include "audio_library/unicode_fold.h"
+#include <algorithm>
+#include <cctype>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace audio_library;
+
+namespace {
+
+// The stream-based tokenizer the search engine used before
+std::vector<std::string> reference_tokens(const std::string& text, bool case_sensitive) {
+    std::vector<std::string> tokens;
+    std::stringstream ss(text);
+    std::string word;
+    while (ss >> word) {
+        word.erase(0, word.find_first_not_of("!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~"));
+        while (!word.empty() && std::ispunct(static_cast<unsigned char>(word.back()))) {
+            word.pop_back();
+        }
+        if (word.empty()) continue;
+        if (!case_sensitive) {
+            std::transform(word.begin(), word.end(), word.begin(),
+                [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            for (size_t pos; (pos = word.find("\xC3\xA9")) != std::string::npos;) {
+                word.replace(pos, 2, "e"); // The only folded character in the alphabet
+            }
+        }
+        tokens.push_back(word);
+    }
+    return tokens;
+}
+
+std::vector<std::string> tokens_of(const Tokenizer& tokenizer) {
+    std::vector<std::string> tokens;
+    for (size_t i = 0; i < tokenizer.size(); ++i) {
+        tokens.emplace_back(tokenizer[i]);
+    }
+    return tokens;
+}
+
+} // namespace
+
+TEST_CASE("Tokenizer splits and trims tokens", "[tokenizer]") {
+    Tokenizer tokenizer;
+    using Tokens = std::vector<std::string>;
+
+    SECTION("Whitespace and punctuation") {
+        REQUIRE(tokenizer.append("  Don't Stop\tMe-Now!! (Live) ... ") == 4);
+        REQUIRE(tokens_of(tokenizer) == Tokens{"don't", "stop", "me-now", "live"});
+    }
+
+    SECTION("Case-sensitive tokens keep their case") {
+        tokenizer.append("AC/DC Back In Black", true);
+        REQUIRE(tokens_of(tokenizer) == Tokens{"AC/DC", "Back", "In", "Black"});
+    }
+
+    SECTION("Appends accumulate until cleared") {
+        tokenizer.append("Bohemian Rhapsody");
+        REQUIRE(tokenizer.append("") == 0);
+        REQUIRE(tokenizer.append("Queen") == 1);
+        REQUIRE(tokens_of(tokenizer) == Tokens{"bohemian", "rhapsody", "queen"});
+
+        tokenizer.clear();
+        REQUIRE(tokenizer.size() == 0);
+        REQUIRE(tokenizer.append("--- ??? ***") == 0);
+    }
+
+    SECTION("Non-ASCII text is folded before splitting") {
+        tokenizer.append("Beyoncé \xC3\x89T\xC3\x89 «Björk»\xC2\xA0Ø \xE2\x80\x9CJ\xE2\x80\x99" "accélère\xE2\x80\x9D\xE2\x80\xA6");
+        REQUIRE(tokens_of(tokenizer) == Tokens{"beyonce", "ete", "bjork", "o", "j'accelere"});
+
+        tokenizer.clear();
+        tokenizer.append("One・Two・Three");
+        REQUIRE(tokens_of(tokenizer) == Tokens{"one", "two", "three"});
+    }
+
+    SECTION("Case-sensitive tokens are not folded") {
+        tokenizer.append("Beyoncé", true);
+        REQUIRE(tokens_of(tokenizer) == Tokens{"Beyoncé"});
+    }
+}
+
+TEST_CASE("Tokenizer agrees with the stream tokenizer", "[tokenizer]") {
+    const std::string alphabet = "abcXYZ019 \t\n\r\v\f.,!'-()&\xC3\xA9\x7F";
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+    std::uniform_int_distribution<size_t> length(0, 80);
+
+    Tokenizer tokenizer;
+    for (int round = 0; round < 2000; ++round) {
+        std::string text(length(rng), ' ');
+        for (auto& c : text) c = alphabet[pick(rng)];
+        bool case_sensitive = round % 3 == 0;
+
+        tokenizer.clear();
+        tokenizer.append(text, case_sensitive);
+        INFO("text '" << text << "'");
+        REQUIRE(tokens_of(tokenizer) == reference_tokens(text, case_sensitive));
+    }
+}
+
+TEST_CASE("ascii_lowercase only changes ASCII capitals", "[tokenizer]") {
+    std::string text;
+    for (int c = 0; c < 256; ++c) {
+        text += static_cast<char>(c);
+    }
+    text += "MIXED Case Across The Vector Boundary";
+
+    std::string expected = text;
+    for (auto& c : expected) {
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    }
+
+    // Every length and offset exercises both the vector and scalar paths
+    for (size_t offset = 0; offset < 17; ++offset) {
+        std::string copy = text;
+        ascii_lowercase(copy.data() + offset, copy.size() - offset);
+        REQUIRE(copy.substr(offset) == expected.substr(offset));
+        REQUIRE(copy.substr(0, offset) == text.substr(0, offset));
+    }
+}
+
+TEST_CASE("fold_text folds case and strips diacritics", "[tokenizer]") {
+    REQUIRE(fold_text("Sigur Rós") == "sigur ros");
+    REQUIRE(fold_text("Françoise Hardy") == "francoise hardy");
+    REQUIRE(fold_text("Así No Te Amará Jamás") == "asi no te amara jamas");
+    REQUIRE(fold_text("STRAßE Æon Œuvre Łódź") == "strasse aeon oeuvre lodz");
+    REQUIRE(fold_text("Σtella ΆΛΜΑ") == "σtella αλμα");
+    REQUIRE(fold_text("Ёжик ВЕТЕР") == "ежик ветер");
+    REQUIRE(fold_text("Ｍｏｒｎｉｎｇ Musume。") == "morning musume.");
+    REQUIRE(fold_text("Tiếng Việt") == "tieng viet");
+
+    SECTION("Decomposed input folds like precomposed") {
+        REQUIRE(fold_text("Beyonce\xCC\x81") == fold_text("Beyonc\xC3\xA9"));
+    }
+
+    SECTION("Other scripts and malformed bytes pass through") {
+        REQUIRE(fold_text("モーニング娘") == "モーニング娘");
+        REQUIRE(fold_text("ab\xC3(\xFF\xE2\x82") == "ab\xC3(\xFF\xE2\x82");
+    }
+
+    SECTION("Long ASCII runs around multibyte characters") {
+        const std::string run(40, 'Q');
+        REQUIRE(fold_text(run + "É" + run) == std::string(40, 'q') + "e" + std::string(40, 'q'));
+    }
+}
@@ -116,6 +116,22 @@ TEST_CASE("Track CSV operations", "[track]") {
         REQUIRE(track.artist() == "Artist \"Name\"");
         REQUIRE(track.duration_seconds() == 180);
     }
+    
+    SECTION("Numeric columns") {
+        std::vector<std::string_view> fields{"Song", "Artist", "240", "", "", "1985", "", "9.5"};
+        auto numbers = Track::parse_csv_numbers(fields);
+        REQUIRE(numbers.has_value());
+        REQUIRE(numbers->duration == 240);
+        REQUIRE(numbers->year == 1985);
+        REQUIRE(numbers->play_count == 0);
+        REQUIRE(numbers->rating == Approx(9.5)); // Clamped only on the track
+        REQUIRE(Track::from_csv_fields(fields)->rating() == Approx(5.0));
+        
+        fields[5] = "year";
+        REQUIRE_FALSE(Track::parse_csv_numbers(fields).has_value());
+        REQUIRE_FALSE(Track::from_csv_fields(fields).has_value());
+        REQUIRE_FALSE(Track::parse_csv_numbers({"Song", "Artist"}).has_value());
+    }
 }
 
 TEST_CASE("Track JSON operations", "[track]") {
@@ -204,4 +220,11 @@ TEST_CASE("Track search matching", "[track]") {
         REQUIRE_FALSE(track.matches_query("mozart"));
         REQUIRE_FALSE(track.matches_query("jazz"));
     }
+    
+    SECTION("Accent insensitive matching") {
+        Track accented("Même sous la pluie", "Françoise Hardy", 125);
+        REQUIRE(accented.matches_query("meme"));
+        REQUIRE(accented.matches_query("FRANÇOISE"));
+        REQUIRE(accented.matches_query("francoise h"));
+    }
 }
\ No newline at end of file
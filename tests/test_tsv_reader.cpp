@@ -0,0 +1,94 @@
+#include "../include/catch.hpp"
+#include "audio_library/tsv_reader.h"
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace audio_library;
+
+namespace {
+
+using Records = std::vector<std::vector<std::string>>;
+
+Records read_all(std::string_view text, std::vector<size_t>* line_numbers = nullptr) {
+    Records records;
+    TsvReader reader(text);
+    std::vector<std::string_view> fields;
+    while (reader.next_record(fields)) {
+        records.emplace_back(fields.begin(), fields.end());
+        if (line_numbers) line_numbers->push_back(reader.line_number());
+    }
+    return records;
+}
+
+// Line-by-line reading of the format TsvReader documents
+Records reference_records(const std::string& text) {
+    Records records;
+    size_t begin = 0;
+    while (begin < text.size()) {
+        size_t end = text.find('\n', begin);
+        if (end == std::string::npos) end = text.size();
+        std::string line = text.substr(begin, end - begin);
+        begin = end + 1;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        
+        std::vector<std::string> record;
+        size_t from = 0;
+        for (size_t tab; (tab = line.find('\t', from)) != std::string::npos; from = tab + 1) {
+            record.push_back(line.substr(from, tab - from));
+        }
+        record.push_back(line.substr(from));
+        records.push_back(std::move(record));
+    }
+    return records;
+}
+
+} // namespace
+
+TEST_CASE("TsvReader splits records", "[tsv_reader]") {
+    SECTION("Tabs and line breaks") {
+        auto records = read_all("Decades\tJoy Division\t374\nJump For Joy\tNew York Trio\t286\n");
+        REQUIRE(records == Records{{"Decades", "Joy Division", "374"},
+                                   {"Jump For Joy", "New York Trio", "286"}});
+    }
+    
+    SECTION("No quoting") {
+        auto records = read_all("\"Quoted\"\tA, B\t100");
+        REQUIRE(records == Records{{"\"Quoted\"", "A, B", "100"}});
+    }
+    
+    SECTION("Empty fields, CRLF and blank lines") {
+        std::vector<size_t> lines;
+        auto records = read_all("a\t\tc\r\n\r\n\n\tb\t\r\n", &lines);
+        REQUIRE(records == Records{{"a", "", "c"}, {"", "b", ""}});
+        REQUIRE(lines == std::vector<size_t>{1, 4});
+    }
+    
+    SECTION("Last record without a line break") {
+        TsvReader reader("a\tb\nc\td");
+        std::vector<std::string_view> fields;
+        REQUIRE(reader.next_record(fields));
+        REQUIRE(reader.position() == 4);
+        REQUIRE(reader.next_record(fields));
+        REQUIRE(fields == std::vector<std::string_view>{"c", "d"});
+        REQUIRE(reader.lines_read() == 1);
+        REQUIRE_FALSE(reader.next_record(fields));
+    }
+}
+
+TEST_CASE("TsvReader agrees with a line-by-line reader", "[tsv_reader]") {
+    // Short alphabets put tabs and line breaks at every offset of the
+    // 64-byte scanning blocks
+    std::mt19937 rng(11);
+    const std::string alphabet = "ab\t\n\r ";
+    std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+    std::uniform_int_distribution<size_t> length(0, 300);
+    
+    for (int round = 0; round < 300; ++round) {
+        std::string text(length(rng), 'a');
+        for (auto& c : text) c = alphabet[pick(rng)];
+        INFO(text);
+        REQUIRE(read_all(text) == reference_records(text));
+    }
+}